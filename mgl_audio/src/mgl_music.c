@@ -1,6 +1,7 @@
 #include "mgl_music.h"
 #include "mgl_logger.h"
 #include "mgl_resource.h"
+#include "mgl_pack.h"
 #include "mgl_config.h"
 #include "mgl_dict.h"
 #include <glib/glist.h>
@@ -51,15 +52,23 @@ void mgl_music_close()
 MglBool mgl_music_load_resource(char *filename,void *data)
 {
     MglMusic *music;
+    SDL_RWops *rw;
+    Sint64 size;
     if (!filename)return MglFalse;
     if (!data)return MglFalse;
     music = (MglMusic *)data;
-    music->music = Mix_LoadMUS(filename);
+    rw = mgl_pack_open_rw(filename);
+    if (!rw)return MglFalse;
+    size = SDL_RWsize(rw);
+    /*the music streams from the rw, which keeps a packed file's pack mapped until Mix_FreeMusic closes it*/
+    music->music = Mix_LoadMUS_RW(rw,1);
     if (!music->music)
     {
         mgl_logger_error("failed to load music file: %s",filename);
         return MglFalse;
     }
+    /*decoders may buffer the whole file, so count it all*/
+    mgl_resource_element_set_size(__mgl_music_resource_manager,music,size > 0 ? (size_t)size : 0);
     return MglTrue;
 }
 
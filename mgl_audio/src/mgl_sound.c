@@ -1,6 +1,7 @@
 #include "mgl_sound.h"
 #include "mgl_logger.h"
 #include "mgl_resource.h"
+#include "mgl_pack.h"
 #include "mgl_config.h"
 #include "mgl_dict.h"
 #include <SDL.h>
@@ -58,7 +59,7 @@ MglBool mgl_sound_load_resource(char *filename,void *data)
     }
     sound = (MglSound *)data;
     
-    sound->chunk = Mix_LoadWAV(filename);
+    sound->chunk = Mix_LoadWAV_RW(mgl_pack_open_rw(filename),1);
     if (!sound->chunk)
     {
         mgl_logger_error("failed to load sound chunk: %s re:%s",filename,SDL_GetError());
@@ -66,6 +67,7 @@ MglBool mgl_sound_load_resource(char *filename,void *data)
     }
     sound->volume = 1;
     sound->defaultChannel = -1;
+    mgl_resource_element_set_size(__mgl_sound_resource_manager,sound,sound->chunk->alen);
     return MglTrue;
 }
 
@@ -23,6 +23,7 @@
  */
 
 #include "mgl_dict.h"
+#include "mgl_callback.h"
 
 typedef struct MglConfig_S MglConfig;
 
@@ -32,13 +33,38 @@ typedef struct MglConfig_S MglConfig;
 void mgl_config_init();
 
 /**
- * @brief loads a config file from disk.  Supports JSON and YAML.
- * Automatically detects file type and loads the data into an MglDict
+ * @brief cache the compiled binary form of text configs in a directory.
+ * A cached config is used while its source keeps the same size and modification time,
+ * or the same contents, so unchanged files skip text parsing entirely.
+ * Set this before loading starts.  Caching is off until it is called.
+ * @param dir the directory to keep the cache in, created if missing.  NULL turns caching off
+ */
+void mgl_config_set_cache_dir(const char *dir);
+
+/**
+ * @brief loads a config file from disk.  Supports JSON, YAML and binary configs.
+ * Detects the file type from its contents and loads the data into an MglDict
  * @param filename the filename / path to the file to load.
  * @return a loaded MglConfig or NULL on error.  See logs for errors.
  */
 MglConfig *mgl_config_load(MglLine filename);
 
+/**
+ * @brief starts loading a config file on a loader thread.
+ * The config is completed by mgl_resource_async_update on the main thread.
+ * @param filename the filename / path to the file to load.
+ * @param onLoaded optional, called with the config as context once loading completes
+ * @return a config that must not be read until mgl_config_is_loaded returns true, or NULL on error.
+ */
+MglConfig *mgl_config_load_async(MglLine filename,MglCallback *onLoaded);
+
+/**
+ * @brief check if a config has finished loading
+ * @param config the config to check
+ * @return MglTrue if the config's dictionary is ready, MglFalse if still loading or failed
+ */
+MglBool mgl_config_is_loaded(MglConfig *config);
+
 /**
  * @brief free a config file loaded.
  * 
@@ -0,0 +1,143 @@
+#ifndef __MGL_CONFIG_VIEW__
+#define __MGL_CONFIG_VIEW__
+
+/**
+ * mgl_config_view
+ * @license The MIT License (MIT)
+   @copyright Copyright (c) 2015 EngineerOfLies
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ */
+
+#include "mgl_dict.h"
+
+/**
+ * @purpose a config view reads a binary config in place, from a mounted pack or a memory mapped file,
+ * without building a dictionary.  It suits large read mostly data like tilemaps and sprite tables.
+ * Views are read only and may be shared between threads.
+ */
+
+typedef struct MglConfigView_S MglConfigView;
+
+/**
+ * @brief a value in a config view.  Only valid while the view is open.
+ */
+typedef struct
+{
+  const MglConfigView *view;    /**<NULL if there is no value*/
+  size_t               offset;  /**<where the value starts in the view's data*/
+}MglConfigValue;
+
+/**
+ * @brief open a binary config saved with mgl_save_dict_as_binary_config as a view.
+ * Packed files are read straight from the pack, and loose files are memory mapped.
+ * The whole file is checked once here, so later queries do not need to.
+ * @param filename the file to open
+ * @return NULL if the file is missing, not a binary config or corrupt, the view otherwise
+ */
+MglConfigView *mgl_config_view_open(const char *filename);
+
+/**
+ * @brief close a view and set the pointer to NULL.  Values from it are invalid afterwards
+ * @param view a pointer to the view to close
+ */
+void mgl_config_view_close(MglConfigView **view);
+
+/**
+ * @brief get the top level value of the view
+ * @param view the view
+ * @return the root value, usually a hash
+ */
+MglConfigValue mgl_config_view_get_root(MglConfigView *view);
+
+/**
+ * @brief get the type of a value
+ * @param value the value to check
+ * @return MGL_DICT_VOID if there is no value, its dict type otherwise
+ */
+MglDictTypes mgl_config_value_get_type(MglConfigValue value);
+
+/**
+ * @brief get the number of items of a list or hash value
+ * @param value the list or hash
+ * @return 0 if empty or not a list or hash, the count otherwise
+ */
+MglUint mgl_config_value_get_count(MglConfigValue value);
+
+/**
+ * @brief looks up the key in a hash value.  Keys are matched by their index in the string table, not by text
+ * @param hash the hash value to search
+ * @param key the key to find
+ * @return a value with a NULL view if not a hash or not found, the value otherwise
+ */
+MglConfigValue mgl_config_value_get_hash_value(MglConfigValue hash,const char *key);
+
+/**
+ * @brief get the nth key and value of a hash value, in the order they were saved
+ * @param key output, set to the key text in the view.  May be NULL
+ * @param hash the hash value
+ * @param n the index of the key
+ * @return a value with a NULL view if not a hash or out of range, the value otherwise
+ */
+MglConfigValue mgl_config_value_get_hash_nth(const char **key,MglConfigValue hash,MglUint n);
+
+/**
+ * @brief get the nth item of a list value
+ * @param list the list value
+ * @param n the index of the item
+ * @return a value with a NULL view if not a list or out of range, the value otherwise
+ */
+MglConfigValue mgl_config_value_get_list_nth(MglConfigValue list,MglUint n);
+
+/**
+ * @brief get the text of a string value
+ * @param value the string value
+ * @return NULL if not a string, otherwise the text in the view.  Do not free it
+ */
+const char *mgl_config_value_get_string(MglConfigValue value);
+
+/**
+ * @brief build a dictionary from a value, for code that needs an MglDict
+ * @param value the value to copy
+ * @return NULL on error, a new dictionary that must be freed with mgl_dict_free otherwise
+ */
+MglDict *mgl_config_value_to_dict(MglConfigValue value);
+
+/*read a single value, converting the same way as mgl_dict_get_value_as_* */
+MglBool mgl_config_value_as_bool(MglBool *output, MglConfigValue value);
+MglBool mgl_config_value_as_uint(MglUint *output, MglConfigValue value);
+MglBool mgl_config_value_as_int(MglInt *output, MglConfigValue value);
+MglBool mgl_config_value_as_float(MglFloat *output, MglConfigValue value);
+MglBool mgl_config_value_as_line(MglLine output, MglConfigValue value);
+MglBool mgl_config_value_as_vec2d(MglVec2D *output, MglConfigValue value);
+MglBool mgl_config_value_as_vec3d(MglVec3D *output, MglConfigValue value);
+MglBool mgl_config_value_as_vec4d(MglVec4D *output, MglConfigValue value);
+MglBool mgl_config_value_as_rect(MglRect *output, MglConfigValue value);
+MglBool mgl_config_value_as_rectfloat(MglRectFloat *output, MglConfigValue value);
+
+/*look up a key in a hash value and read it, see mgl_dict_get_hash_value_as_* */
+MglBool mgl_config_value_get_hash_value_as_bool(MglBool *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_uint(MglUint *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_int(MglInt *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_float(MglFloat *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_line(MglLine output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_vec2d(MglVec2D *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_vec3d(MglVec3D *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_vec4d(MglVec4D *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_rect(MglRect *output, MglConfigValue hash, const char *key);
+MglBool mgl_config_value_get_hash_value_as_rectfloat(MglRectFloat *output, MglConfigValue hash, const char *key);
+
+#endif
@@ -21,6 +21,16 @@ MglDict *mgl_json_parse(char *filename);
  */
 MglDict *mgl_json_parse_string(char *string);
 
+/**
+ * @brief parses json held in memory into an Mgl Dictionary
+ * 
+ * @param buffer the json data, it does not need to be terminated
+ * @param size the length of the json data in bytes
+ * 
+ * @return NULL on error or not-a-json buffer or a valid MglDict
+ */
+MglDict *mgl_json_parse_buffer(const char *buffer,size_t size);
+
 /**
  * @brief converts an MglDict back into a human readable json string
  * @param dict the dictionary to convert
@@ -33,12 +33,29 @@ void mgl_save_dict_as_json(MglDict *dict, char *filepath);
 
 /**
  * @brief converts a dicitonary to a binary file format that is not human readable
+ * The dict is written directly in typed form with a shared string table, and is read back without any text parsing.
  * 
  * @param dict the dictionary to convert
  * @param filepath the path to the file to save to
  */
 void mgl_save_dict_as_binary_config(MglDict *dict, char *filepath);
 
+/**
+ * @brief encode a dictionary as a binary config in memory, the same bytes mgl_save_dict_as_binary_config writes
+ * @param dict the dictionary to encode
+ * @param size output, the length of the encoded data
+ * @return NULL on error, or the encoded data that must be free()d
+ */
+void *mgl_save_dict_to_binary(MglDict *dict,size_t *size);
+
+/**
+ * @brief check if a buffer starts with a binary config header of any version
+ * @param buffer the data to check
+ * @param size the length of the buffer in bytes
+ * @return MglTrue if it does, MglFalse otherwise
+ */
+MglBool mgl_save_is_binary(const void *buffer,size_t size);
+
 /**
  * @brief loads a previously saved binary config file from disk
  * NOTE returned character data must be free()d
@@ -47,5 +64,38 @@ void mgl_save_dict_as_binary_config(MglDict *dict, char *filepath);
  */
 char *mgl_save_binary_load(char *filepath);
 
+/**
+ * @brief decodes a binary config file that is already in memory
+ * NOTE returned character data must be free()d
+ * @param buffer the contents of the binary config file
+ * @param size the length of the buffer in bytes
+ * @return NULL on error or if the buffer is not a binary config, or a terminated character buffer otherwise
+ */
+char *mgl_save_binary_load_from_memory(const void *buffer,size_t size);
+
+/**
+ * @brief loads a previously saved binary config file from disk straight into a dictionary
+ * @param filepath the path to load the file from
+ * @return NULL on error or if the file is not a binary config, the dictionary otherwise
+ */
+MglDict *mgl_save_binary_load_dict(char *filepath);
+
+/**
+ * @brief decodes a binary config file that is already in memory straight into a dictionary
+ * @param buffer the contents of the binary config file
+ * @param size the length of the buffer in bytes
+ * @return NULL on error or if the buffer is not a binary config, the dictionary otherwise
+ */
+MglDict *mgl_save_binary_load_dict_from_memory(const void *buffer,size_t size);
+
+/**
+ * @brief find the encoded dict in a binary config, for reading it in place.  The layout is described in mgl_save.c
+ * @param buffer the contents of the binary config file
+ * @param size the length of the buffer in bytes
+ * @param dataSize output, the length of the encoded data
+ * @return NULL if the buffer is not a version 2 binary config, a pointer into the buffer otherwise
+ */
+const void *mgl_save_binary_get_dict_data(const void *buffer,size_t size,size_t *dataSize);
+
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef __MGL_XML_PARSE__
+#define __MGL_XML_PARSE__
+#include "mgl_dict.h"
+
+/**
+ * XML documents are read into an Mgl Dictionary as they are parsed, without building a DOM.
+ * The root is a hash holding the document element under its own name.
+ * Each element is a hash of its attributes (as strings) and its child elements.
+ * Children that share a name become a list, in document order.
+ * An element with only text is the string itself, otherwise its text is kept under "text".
+ * <data> elements with encoding="csv" or encoding="base64" (optionally compression="zlib" or "gzip"),
+ * and the <chunk> elements inside them, are decoded straight into a packed MGL_DICT_UI32_ARRAY under "tiles",
+ * the way tiled stores its layers.  Read it with mgl_dict_get_ui32_array.
+ */
+
+/**
+ * @brief parse an xml file into an Mgl Dictionary
+ * The file is read and parsed a block at a time.
+ *
+ * @param filename the path to the file to parse
+ *
+ * @return NULL on error or a pointer to a valid MglDict
+ */
+MglDict *mgl_xml_parse(char *filename);
+
+/**
+ * @brief parse xml held in memory into an Mgl Dictionary
+ *
+ * @param buffer the xml data, it does not need to be terminated
+ * @param size the length of the xml data in bytes
+ *
+ * @return NULL on error or a pointer to a valid MglDict
+ */
+MglDict *mgl_xml_parse_buffer(const char *buffer,size_t size);
+
+#endif
@@ -11,6 +11,16 @@
  */
 MglDict *mgl_yaml_parse(char* filename);
 
+/**
+ * @brief parse yaml held in memory into an Mgl Dictionary
+ * 
+ * @param buffer the yaml data, it does not need to be terminated
+ * @param size the length of the yaml data in bytes
+ * 
+ * @return NULL on error or a pointer to a valid MglDict
+ */
+MglDict *mgl_yaml_parse_buffer(const char *buffer,size_t size);
+
 
 #endif
 
@@ -1,19 +1,48 @@
 #include "mgl_config.h"
 #include "mgl_resource.h"
+#include "mgl_pack.h"
 #include "mgl_logger.h"
 #include "mgl_yaml_parse.h"
 #include "mgl_json_parse.h"
+#include "mgl_xml_parse.h"
 #include "mgl_save.h"
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
+#define MGL_CONFIG_CACHE_KEY     1296516931
+#define MGL_CONFIG_CACHE_VERSION 2
 
 struct MglConfig_S
 {
   MglDict *_dictionary;
 };
 
+typedef enum
+{
+  MglConfigBinary,
+  MglConfigJson,
+  MglConfigXml,
+  MglConfigYaml
+}MglConfigFormat;
+
+typedef struct
+{
+  MglUint key;        /**<MGL_CONFIG_CACHE_KEY*/
+  MglUint version;    /**<MGL_CONFIG_CACHE_VERSION*/
+  MglUI64 pathHash;   /**<hash of the source filename, in case two names share a cache file*/
+  MglUI64 sourceSize; /**<size of the source file*/
+  MglSI64 sourceTime; /**<modification time of the source file in nanoseconds, 0 if it came from a pack*/
+  MglUI64 sourceHash; /**<hash of the source contents*/
+}MglConfigCacheHeader;/*followed by the binary config*/
+
 static MglResourceManager * __mgl_config_manager = NULL;
+static char * __mgl_config_cache_dir = NULL;
 
 void mgl_config_delete(void *data);
 MglBool mgl_config_load_from_file(char *filename,void *data);
+static void *mgl_config_parse_file(char *filename);
+static MglBool mgl_config_finalize(void *prepared,void *data);
+static void mgl_config_prepared_free(void *prepared);
 
 void mgl_config_close();
 
@@ -27,12 +56,31 @@ void mgl_config_init()
     mgl_config_delete,
     mgl_config_load_from_file
   );
+  mgl_resource_manager_set_async_loader(
+    __mgl_config_manager,
+    mgl_config_parse_file,
+    mgl_config_finalize,
+    mgl_config_prepared_free);
   atexit(mgl_config_close);
 }
 
 void mgl_config_close()
 {
   mgl_resource_manager_free(&__mgl_config_manager);
+  mgl_config_set_cache_dir(NULL);
+}
+
+void mgl_config_set_cache_dir(const char *dir)
+{
+  g_free(__mgl_config_cache_dir);
+  __mgl_config_cache_dir = NULL;
+  if (!dir)return;
+  if (g_mkdir_with_parents(dir,0755) != 0)
+  {
+    mgl_logger_warn("failed to create config cache directory %s, configs will not be cached",dir);
+    return;
+  }
+  __mgl_config_cache_dir = g_strdup(dir);
 }
 
 MglConfig *mgl_config_load(MglLine filename)
@@ -40,6 +88,16 @@ MglConfig *mgl_config_load(MglLine filename)
   return (MglConfig *)mgl_resource_manager_load_resource(__mgl_config_manager,filename);
 }
 
+MglConfig *mgl_config_load_async(MglLine filename,MglCallback *onLoaded)
+{
+  return (MglConfig *)mgl_resource_manager_load_resource_async(__mgl_config_manager,filename,onLoaded);
+}
+
+MglBool mgl_config_is_loaded(MglConfig *config)
+{
+  return mgl_resource_element_get_load_state(__mgl_config_manager,config) == MglResourceLoaded;
+}
+
 void mgl_config_free(MglConfig **config)
 {
   mgl_resource_free_element(__mgl_config_manager,(void **)config);
@@ -47,33 +105,259 @@ void mgl_config_free(MglConfig **config)
 
 MglBool mgl_config_load_from_file(char *filename,void *data)
 {
-  MglConfig *config;
+  return mgl_config_finalize(mgl_config_parse_file(filename),data);
+}
+
+static MglUI64 mgl_config_hash(const void *data,size_t size)
+{
+  const MglUI8 *bytes;
+  MglUI64 hash = 14695981039346656037ULL;
+  size_t i;
+  bytes = (const MglUI8 *)data;
+  for (i = 0; i < size;i++)
+  {
+    hash = (hash ^ bytes[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+/*looks at the first bytes instead of trying each parser in turn*/
+static MglConfigFormat mgl_config_sniff_format(const char *data,size_t size)
+{
+  size_t i = 0;
+  if (mgl_save_is_binary(data,size))return MglConfigBinary;
+  if ((size >= 3) && (memcmp(data,"\xEF\xBB\xBF",3) == 0))i = 3;
+  for (;(i < size) && ((data[i] == ' ') || (data[i] == '\t') || (data[i] == '\r') || (data[i] == '\n'));i++);
+  if ((i < size) && ((data[i] == '{') || (data[i] == '[')))return MglConfigJson;
+  if ((i < size) && (data[i] == '<'))return MglConfigXml;
+  return MglConfigYaml;
+}
+
+/*modification time in nanoseconds, only whole seconds where stat has nothing finer*/
+static MglSI64 mgl_config_file_time(struct stat *info)
+{
+#ifndef _WIN32
+  return (MglSI64)info->st_mtim.tv_sec * 1000000000LL + (MglSI64)info->st_mtim.tv_nsec;
+#else
+  return (MglSI64)info->st_mtime * 1000000000LL;
+#endif
+}
+
+static char *mgl_config_cache_path(const char *filename)
+{
+  return g_strdup_printf("%s/%016llx.mglc",__mgl_config_cache_dir,(unsigned long long)mgl_config_hash(filename,strlen(filename)));
+}
+
+/*loads the cached dictionary if it was compiled from this source.
+  With no contentHash only the size and time are compared, so the source need not be read.
+  That is only trusted if the cache was written more than a second after the source changed,
+  an edit within the same clock tick keeps the time and may keep the size*/
+static MglDict *mgl_config_cache_load(const char *filename,MglUI64 size,MglSI64 time,const MglUI64 *contentHash)
+{
+  MglConfigCacheHeader header;
   MglDict *dict = NULL;
-  char *string = NULL;
-  config = (MglConfig *)data;
-  
-  string = mgl_save_binary_load(filename);  
-  if (string != NULL)
+  struct stat info;
+  MglBool written;
+  char *path;
+  void *data;
+  FILE *file;
+  long length;
+  if (!__mgl_config_cache_dir)return NULL;
+  path = mgl_config_cache_path(filename);
+  file = fopen(path,"rb");
+  if (!file)
   {
-      dict = mgl_json_parse_string(string);
-      free(string);
+    g_free(path);
+    return NULL;
   }
-  if (!dict)
+  if ((fread(&header,sizeof(MglConfigCacheHeader),1,file) != 1) ||
+      (header.key != MGL_CONFIG_CACHE_KEY) ||
+      (header.version != MGL_CONFIG_CACHE_VERSION) ||
+      (header.pathHash != mgl_config_hash(filename,strlen(filename))) ||
+      (header.sourceSize != size) ||
+      ((contentHash == NULL) && ((time == 0) || (header.sourceTime != time))) ||
+      ((contentHash != NULL) && (header.sourceHash != *contentHash)) ||
+      ((contentHash == NULL) &&
+       ((fstat(fileno(file),&info) != 0) || (mgl_config_file_time(&info) - time < 1000000000LL))) ||
+      (fseek(file,0,SEEK_END) != 0) ||
+      ((length = ftell(file)) < 0) ||
+      (fseek(file,sizeof(MglConfigCacheHeader),SEEK_SET) != 0))
   {
-    dict = mgl_json_parse(filename);
+    fclose(file);
+    g_free(path);
+    return NULL;
   }
-  if (!dict)
+  length -= sizeof(MglConfigCacheHeader);
+  data = (length > 0)?malloc(length):NULL;
+  if ((data != NULL) && (fread(data,1,length,file) == (size_t)length))
   {
-    dict = mgl_yaml_parse(filename);
+    dict = mgl_save_binary_load_dict_from_memory(data,length);
   }
-  if (!dict)
+  free(data);
+  if ((dict != NULL) && (contentHash != NULL) && (header.sourceTime != time))
+  {
+    /*same contents with a new time, refresh it so the next load can skip reading the source*/
+    fclose(file);
+    file = fopen(path,"r+b");
+    if (file)
+    {
+      header.sourceTime = time;
+      written = (fwrite(&header,sizeof(MglConfigCacheHeader),1,file) == 1);
+      if (fclose(file) != 0)written = MglFalse;
+      if (!written)
+      {
+        /*a header left half written could match the wrong source*/
+        remove(path);
+      }
+      file = NULL;
+    }
+  }
+  if (file)fclose(file);
+  g_free(path);
+  return dict;
+}
+
+static void mgl_config_cache_save(const char *filename,MglDict *dict,MglUI64 size,MglSI64 time,MglUI64 contentHash)
+{
+  MglConfigCacheHeader header;
+  char *path,*temp;
+  void *data;
+  size_t length = 0;
+  MglBool written;
+  FILE *file;
+  if (!__mgl_config_cache_dir)return;
+  data = mgl_save_dict_to_binary(dict,&length);
+  if (!data)return;
+  memset(&header,0,sizeof(MglConfigCacheHeader));
+  header.key = MGL_CONFIG_CACHE_KEY;
+  header.version = MGL_CONFIG_CACHE_VERSION;
+  header.pathHash = mgl_config_hash(filename,strlen(filename));
+  header.sourceSize = size;
+  header.sourceTime = time;
+  header.sourceHash = contentHash;
+  path = mgl_config_cache_path(filename);
+  temp = g_strdup_printf("%s.tmp",path);
+  /*written to the side and moved in place so a reader never sees half a cache file*/
+  file = fopen(temp,"wb");
+  if (file)
+  {
+    written = (fwrite(&header,sizeof(MglConfigCacheHeader),1,file) == 1) &&
+              (fwrite(data,1,length,file) == length);
+    if (fclose(file) != 0)written = MglFalse;
+    if (!written)
+    {
+      /*a short cache file must never replace a good one*/
+      mgl_logger_debug("failed to write config cache %s for %s",path,filename);
+      remove(temp);
+    }
+    else
+    {
+      remove(path);
+      if (rename(temp,path) != 0)
+      {
+        remove(temp);
+      }
+    }
+  }
+  else
+  {
+    mgl_logger_debug("failed to write config cache %s for %s",path,filename);
+  }
+  free(data);
+  g_free(path);
+  g_free(temp);
+}
+
+/*time is 0 when the source has no file of its own*/
+static MglDict *mgl_config_parse_source(const char *filename,const char *data,size_t size,MglSI64 time)
+{
+  MglDict *dict = NULL;
+  MglConfigFormat format;
+  MglUI64 contentHash = 0;
+  format = mgl_config_sniff_format(data,size);
+  if (format == MglConfigBinary)
+  {
+    return mgl_save_binary_load_dict_from_memory(data,size);
+  }
+  if (__mgl_config_cache_dir)
+  {
+    contentHash = mgl_config_hash(data,size);
+    dict = mgl_config_cache_load(filename,size,time,&contentHash);
+    if (dict)return dict;
+  }
+  if (format == MglConfigJson)
+  {
+    dict = mgl_json_parse_buffer(data,size);
+  }
+  else if (format == MglConfigXml)
+  {
+    dict = mgl_xml_parse_buffer(data,size);
+  }
+  if ((!dict) && (format != MglConfigXml))
+  {
+    /*yaml also covers json style flow documents the json parser rejected*/
+    dict = mgl_yaml_parse_buffer(data,size);
+  }
+  if (dict)
+  {
+    mgl_config_cache_save(filename,dict,size,time,contentHash);
+  }
+  return dict;
+}
+
+/*parsing only builds a new dictionary, so it is safe to do on a loader thread*/
+static void *mgl_config_parse_file(char *filename)
+{
+  MglDict *dict = NULL;
+  const void *packed;
+  char *buffer;
+  struct stat info;
+  MglSI64 time = 0;
+  size_t size;
+
+  packed = mgl_pack_get(filename,&size);
+  if (packed != NULL)
+  {
+    /*packed configs are parsed straight out of the mapped pack*/
+    return mgl_config_parse_source(filename,(const char *)packed,size,0);
+  }
+  if (stat(filename,&info) == 0)
+  {
+    time = mgl_config_file_time(&info);
+    /*an unchanged source does not even need to be read*/
+    dict = mgl_config_cache_load(filename,info.st_size,time,NULL);
+    if (dict)return dict;
+  }
+  buffer = mgl_pack_load_file(filename,&size);
+  if (!buffer)
+  {
+    mgl_logger_warn("failed to read config file %s",filename);
+    return NULL;
+  }
+  dict = mgl_config_parse_source(filename,buffer,size,time);
+  free(buffer);
+  return dict;
+}
+
+static MglBool mgl_config_finalize(void *prepared,void *data)
+{
+  MglConfig *config;
+  config = (MglConfig *)data;
+  if (!prepared)
   {
     return MglFalse;
   }
-  config->_dictionary = dict;
+  config->_dictionary = (MglDict *)prepared;
   return MglTrue;
 }
 
+static void mgl_config_prepared_free(void *prepared)
+{
+  MglDict *dict;
+  dict = (MglDict *)prepared;
+  mgl_dict_free(&dict);
+}
+
 void mgl_config_delete(void *data)
 {
   MglConfig *config;
@@ -0,0 +1,545 @@
+#include "mgl_config_view.h"
+#include "mgl_save.h"
+#include "mgl_pack.h"
+#include "mgl_logger.h"
+#include <glib.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define MGL_CONFIG_VIEW_MAX_DEPTH 256
+
+struct MglConfigView_S
+{
+  const MglUI8 *data;        /**<the encoded dict, see mgl_save.c for the layout*/
+  size_t        size;
+  const char  **strings;     /**<point into data*/
+  MglUI32       stringCount;
+  GHashTable   *keys;        /**<string to its index in the table plus one*/
+  size_t        root;        /**<offset of the top level value*/
+  void         *map;         /**<the mapped file, NULL if the data is in a mounted pack*/
+  size_t        mapSize;
+};
+
+static void *mgl_config_view_map_file(const char *filename,size_t *size);
+static void mgl_config_view_unmap(void *map,size_t size);
+
+static MglUI32 mgl_config_view_read_32(const MglConfigView *view,size_t offset)
+{
+  MglUI32 value;
+  /*mapped data may not be aligned for a direct read*/
+  memcpy(&value,&view->data[offset],sizeof(MglUI32));
+  return value;
+}
+
+/*bytes following the type byte of a value, 0 for containers and unknown types*/
+static size_t mgl_config_view_payload_size(MglUI8 type)
+{
+  switch (type)
+  {
+    case MGL_DICT_BOOL:
+      return 1;
+    case MGL_DICT_INT:
+    case MGL_DICT_UINT:
+    case MGL_DICT_FLOAT:
+    case MGL_DICT_STRING:
+      return 4;
+    case MGL_DICT_VEC2D:
+      return sizeof(MglVec2D);
+    case MGL_DICT_VEC3D:
+      return sizeof(MglVec3D);
+    case MGL_DICT_VEC4D:
+      return sizeof(MglVec4D);
+    case MGL_DICT_RECT:
+      return sizeof(MglRect);
+    case MGL_DICT_RECTF:
+      return sizeof(MglRectFloat);
+    default:
+      return 0;
+  }
+}
+
+/*offset just past the value, containers are skipped by their size*/
+static size_t mgl_config_view_next(const MglConfigView *view,size_t offset)
+{
+  MglUI8 type;
+  type = view->data[offset];
+  if ((type == MGL_DICT_LIST) || (type == MGL_DICT_HASH))
+  {
+    return offset + 1 + (sizeof(MglUI32) * 2) + mgl_config_view_read_32(view,offset + 1 + sizeof(MglUI32));
+  }
+  return offset + 1 + mgl_config_view_payload_size(type);
+}
+
+/*checks a value fits in [offset,end) so queries never need to*/
+static MglBool mgl_config_view_check(const MglConfigView *view,size_t offset,size_t end,size_t *next,MglUint depth)
+{
+  MglUI8 type;
+  MglUI32 count,size,i;
+  size_t payload;
+  if ((depth > MGL_CONFIG_VIEW_MAX_DEPTH) || (offset >= end))return MglFalse;
+  type = view->data[offset++];
+  if ((type == MGL_DICT_LIST) || (type == MGL_DICT_HASH))
+  {
+    if (end - offset < sizeof(MglUI32) * 2)return MglFalse;
+    count = mgl_config_view_read_32(view,offset);
+    size = mgl_config_view_read_32(view,offset + sizeof(MglUI32));
+    offset += sizeof(MglUI32) * 2;
+    if (end - offset < size)return MglFalse;
+    end = offset + size;
+    for (i = 0; i < count;i++)
+    {
+      if (type == MGL_DICT_HASH)
+      {
+        if (end - offset < sizeof(MglUI32))return MglFalse;
+        if (mgl_config_view_read_32(view,offset) >= view->stringCount)return MglFalse;
+        offset += sizeof(MglUI32);
+      }
+      if (!mgl_config_view_check(view,offset,end,&offset,depth + 1))return MglFalse;
+    }
+    if (offset != end)return MglFalse;
+    *next = end;
+    return MglTrue;
+  }
+  payload = mgl_config_view_payload_size(type);
+  if ((payload == 0) || (end - offset < payload))return MglFalse;
+  if ((type == MGL_DICT_STRING) && (mgl_config_view_read_32(view,offset) >= view->stringCount))return MglFalse;
+  *next = offset + payload;
+  return MglTrue;
+}
+
+static MglBool mgl_config_view_load_strings(MglConfigView *view)
+{
+  MglUI32 count,tableSize,length,i;
+  size_t offset;
+  if (view->size < sizeof(MglUI32) * 2)return MglFalse;
+  count = mgl_config_view_read_32(view,0);
+  tableSize = mgl_config_view_read_32(view,sizeof(MglUI32));
+  offset = sizeof(MglUI32) * 2;
+  if ((tableSize > view->size - offset) || (count > tableSize / (sizeof(MglUI32) + 1)))return MglFalse;
+  view->strings = (const char **)malloc(sizeof(const char *) * (count + 1));
+  view->keys = g_hash_table_new(g_str_hash,g_str_equal);
+  if ((!view->strings) || (!view->keys))return MglFalse;
+  for (i = 0; i < count;i++)
+  {
+    if (view->size - offset < sizeof(MglUI32))return MglFalse;
+    length = mgl_config_view_read_32(view,offset);
+    offset += sizeof(MglUI32);
+    if ((length >= view->size - offset) || (view->data[offset + length] != '\0'))return MglFalse;
+    view->strings[i] = (const char *)&view->data[offset];
+    g_hash_table_insert(view->keys,(gpointer)view->strings[i],GUINT_TO_POINTER(i + 1));
+    offset += length + 1;
+  }
+  view->stringCount = count;
+  view->root = offset;
+  return MglTrue;
+}
+
+MglConfigView *mgl_config_view_open(const char *filename)
+{
+  MglConfigView *view;
+  const void *file;
+  const void *data;
+  void *map = NULL;
+  size_t fileSize = 0,mapSize = 0,size = 0,end = 0;
+  if (!filename)return NULL;
+  file = mgl_pack_get(filename,&fileSize);
+  if (!file)
+  {
+    map = mgl_config_view_map_file(filename,&mapSize);
+    if (!map)return NULL;
+    file = map;
+    fileSize = mapSize;
+  }
+  data = mgl_save_binary_get_dict_data(file,fileSize,&size);
+  if (!data)
+  {
+    mgl_logger_warn("config view: %s is not a binary config",filename);
+    mgl_config_view_unmap(map,mapSize);
+    return NULL;
+  }
+  view = (MglConfigView *)malloc(sizeof(MglConfigView));
+  if (!view)
+  {
+    mgl_logger_error("config view: failed to allocate a view for %s",filename);
+    mgl_config_view_unmap(map,mapSize);
+    return NULL;
+  }
+  memset(view,0,sizeof(MglConfigView));
+  view->data = (const MglUI8 *)data;
+  view->size = size;
+  view->map = map;
+  view->mapSize = mapSize;
+  if ((!mgl_config_view_load_strings(view)) ||
+      (!mgl_config_view_check(view,view->root,view->size,&end,0)) ||
+      (end != view->size))
+  {
+    mgl_logger_warn("config view: %s is corrupt",filename);
+    mgl_config_view_close(&view);
+    return NULL;
+  }
+  return view;
+}
+
+void mgl_config_view_close(MglConfigView **view)
+{
+  if ((!view) || (!*view))return;
+  if ((*view)->keys)g_hash_table_destroy((*view)->keys);
+  free((*view)->strings);
+  mgl_config_view_unmap((*view)->map,(*view)->mapSize);
+  free(*view);
+  *view = NULL;
+}
+
+MglConfigValue mgl_config_view_get_root(MglConfigView *view)
+{
+  MglConfigValue value = {NULL,0};
+  if (!view)return value;
+  value.view = view;
+  value.offset = view->root;
+  return value;
+}
+
+MglDictTypes mgl_config_value_get_type(MglConfigValue value)
+{
+  if (!value.view)return MGL_DICT_VOID;
+  return (MglDictTypes)value.view->data[value.offset];
+}
+
+MglUint mgl_config_value_get_count(MglConfigValue value)
+{
+  MglDictTypes type;
+  type = mgl_config_value_get_type(value);
+  if ((type != MGL_DICT_LIST) && (type != MGL_DICT_HASH))return 0;
+  return mgl_config_view_read_32(value.view,value.offset + 1);
+}
+
+MglConfigValue mgl_config_value_get_hash_value(MglConfigValue hash,const char *key)
+{
+  MglConfigValue value = {NULL,0};
+  gpointer index;
+  MglUI32 count,keyIndex,i;
+  size_t offset;
+  if (mgl_config_value_get_type(hash) != MGL_DICT_HASH)return value;
+  if (!key)return value;
+  index = g_hash_table_lookup(hash.view->keys,key);
+  if (index == NULL)return value;/*not in the string table, so no hash has it*/
+  keyIndex = GPOINTER_TO_UINT(index) - 1;
+  count = mgl_config_view_read_32(hash.view,hash.offset + 1);
+  offset = hash.offset + 1 + (sizeof(MglUI32) * 2);
+  for (i = 0; i < count;i++)
+  {
+    if (mgl_config_view_read_32(hash.view,offset) == keyIndex)
+    {
+      value.view = hash.view;
+      value.offset = offset + sizeof(MglUI32);
+      return value;
+    }
+    offset = mgl_config_view_next(hash.view,offset + sizeof(MglUI32));
+  }
+  return value;
+}
+
+MglConfigValue mgl_config_value_get_hash_nth(const char **key,MglConfigValue hash,MglUint n)
+{
+  MglConfigValue value = {NULL,0};
+  MglUint i;
+  size_t offset;
+  if (n >= mgl_config_value_get_count(hash))return value;
+  if (mgl_config_value_get_type(hash) != MGL_DICT_HASH)return value;
+  offset = hash.offset + 1 + (sizeof(MglUI32) * 2);
+  for (i = 0; i < n;i++)
+  {
+    offset = mgl_config_view_next(hash.view,offset + sizeof(MglUI32));
+  }
+  if (key)*key = hash.view->strings[mgl_config_view_read_32(hash.view,offset)];
+  value.view = hash.view;
+  value.offset = offset + sizeof(MglUI32);
+  return value;
+}
+
+MglConfigValue mgl_config_value_get_list_nth(MglConfigValue list,MglUint n)
+{
+  MglConfigValue value = {NULL,0};
+  MglUint i;
+  size_t offset;
+  if (n >= mgl_config_value_get_count(list))return value;
+  if (mgl_config_value_get_type(list) != MGL_DICT_LIST)return value;
+  offset = list.offset + 1 + (sizeof(MglUI32) * 2);
+  for (i = 0; i < n;i++)
+  {
+    offset = mgl_config_view_next(list.view,offset);
+  }
+  value.view = list.view;
+  value.offset = offset;
+  return value;
+}
+
+const char *mgl_config_value_get_string(MglConfigValue value)
+{
+  if (mgl_config_value_get_type(value) != MGL_DICT_STRING)return NULL;
+  return value.view->strings[mgl_config_view_read_32(value.view,value.offset + 1)];
+}
+
+/*fills in a dict on the stack so the dict getters can do the conversions, nothing is allocated*/
+static MglBool mgl_config_value_load(MglDict *dict,MglConfigValue value)
+{
+  MglDictTypes type;
+  memset(dict,0,sizeof(MglDict));
+  type = mgl_config_value_get_type(value);
+  dict->keyType = type;
+  if (type == MGL_DICT_STRING)
+  {
+    dict->keyValue = (void *)mgl_config_value_get_string(value);
+    return MglTrue;
+  }
+  if (!mgl_dict_is_scalar(dict))return MglFalse;
+  if (type == MGL_DICT_BOOL)
+  {
+    dict->scalar.b = value.view->data[value.offset + 1];
+    return MglTrue;
+  }
+  memcpy(&dict->scalar,&value.view->data[value.offset + 1],mgl_config_view_payload_size(type));
+  return MglTrue;
+}
+
+static MglDict *mgl_config_value_build(MglConfigValue value)
+{
+  MglConfigValue item;
+  MglDict dict;
+  MglDict *out;
+  const char *key;
+  MglUint count,i;
+  switch (mgl_config_value_get_type(value))
+  {
+    case MGL_DICT_LIST:
+      out = mgl_dict_new_list();
+      count = mgl_config_value_get_count(value);
+      item = mgl_config_value_get_list_nth(value,0);
+      for (i = 0; i < count;i++)
+      {
+        mgl_dict_list_append(out,mgl_config_value_build(item));
+        item.offset = mgl_config_view_next(item.view,item.offset);
+      }
+      return out;
+    case MGL_DICT_HASH:
+      out = mgl_dict_new_hash();
+      count = mgl_config_value_get_count(value);
+      for (i = 0; i < count;i++)
+      {
+        item = mgl_config_value_get_hash_nth(&key,value,i);
+        mgl_dict_hash_insert(out,(char *)key,mgl_config_value_build(item));
+      }
+      return out;
+    case MGL_DICT_STRING:
+      return mgl_dict_new_string((char *)mgl_config_value_get_string(value));
+    default:
+      break;
+  }
+  if (!mgl_config_value_load(&dict,value))return NULL;
+  switch (dict.keyType)
+  {
+    case MGL_DICT_BOOL:
+      return mgl_dict_new_bool(dict.scalar.b);
+    case MGL_DICT_INT:
+      return mgl_dict_new_int(dict.scalar.i);
+    case MGL_DICT_UINT:
+      return mgl_dict_new_uint(dict.scalar.u);
+    case MGL_DICT_FLOAT:
+      return mgl_dict_new_float(dict.scalar.f);
+    case MGL_DICT_VEC2D:
+      return mgl_dict_new_vec2d(dict.scalar.v2);
+    case MGL_DICT_VEC3D:
+      return mgl_dict_new_vec3d(dict.scalar.v3);
+    case MGL_DICT_VEC4D:
+      return mgl_dict_new_vec4d(dict.scalar.v4);
+    case MGL_DICT_RECT:
+      return mgl_dict_new_rect(dict.scalar.r);
+    case MGL_DICT_RECTF:
+      return mgl_dict_new_rectf(dict.scalar.rf);
+    default:
+      return NULL;
+  }
+}
+
+MglDict *mgl_config_value_to_dict(MglConfigValue value)
+{
+  MglDictArena *arena;
+  if (!value.view)return NULL;
+  arena = mgl_dict_arena_new(0);
+  mgl_dict_arena_begin(arena);
+  return mgl_dict_arena_end(arena,mgl_config_value_build(value));
+}
+
+MglBool mgl_config_value_as_bool(MglBool *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_bool(output,&dict);
+}
+
+MglBool mgl_config_value_as_uint(MglUint *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_uint(output,&dict);
+}
+
+MglBool mgl_config_value_as_int(MglInt *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_int(output,&dict);
+}
+
+MglBool mgl_config_value_as_float(MglFloat *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_float(output,&dict);
+}
+
+MglBool mgl_config_value_as_line(MglLine output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_line(output,&dict);
+}
+
+MglBool mgl_config_value_as_vec2d(MglVec2D *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_vec2d(output,&dict);
+}
+
+MglBool mgl_config_value_as_vec3d(MglVec3D *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_vec3d(output,&dict);
+}
+
+MglBool mgl_config_value_as_vec4d(MglVec4D *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_vec4d(output,&dict);
+}
+
+MglBool mgl_config_value_as_rect(MglRect *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_rect(output,&dict);
+}
+
+MglBool mgl_config_value_as_rectfloat(MglRectFloat *output, MglConfigValue value)
+{
+  MglDict dict;
+  if (!mgl_config_value_load(&dict,value))return MglFalse;
+  return mgl_dict_get_value_as_rectfloat(output,&dict);
+}
+
+MglBool mgl_config_value_get_hash_value_as_bool(MglBool *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_bool(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_uint(MglUint *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_uint(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_int(MglInt *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_int(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_float(MglFloat *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_float(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_line(MglLine output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_line(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_vec2d(MglVec2D *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_vec2d(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_vec3d(MglVec3D *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_vec3d(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_vec4d(MglVec4D *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_vec4d(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_rect(MglRect *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_rect(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+MglBool mgl_config_value_get_hash_value_as_rectfloat(MglRectFloat *output, MglConfigValue hash, const char *key)
+{
+  return mgl_config_value_as_rectfloat(output,mgl_config_value_get_hash_value(hash,key));
+}
+
+#ifndef _WIN32
+static void *mgl_config_view_map_file(const char *filename,size_t *size)
+{
+  int fd;
+  struct stat info;
+  void *map;
+  fd = open(filename,O_RDONLY);
+  if (fd == -1)
+  {
+    mgl_logger_warn("config view: failed to open %s",filename);
+    return NULL;
+  }
+  if ((fstat(fd,&info) == -1) || (info.st_size == 0))
+  {
+    mgl_logger_warn("config view: failed to get the size of %s",filename);
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL,info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  /*the mapping holds its own reference to the file*/
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    mgl_logger_warn("config view: failed to map %s",filename);
+    return NULL;
+  }
+  *size = info.st_size;
+  return map;
+}
+
+static void mgl_config_view_unmap(void *map,size_t size)
+{
+  if (map)munmap(map,size);
+}
+#else
+/*no mmap, the file is read into memory in one go instead*/
+static void *mgl_config_view_map_file(const char *filename,size_t *size)
+{
+  return mgl_pack_load_file(filename,size);
+}
+
+static void mgl_config_view_unmap(void *map,size_t size)
+{
+  free(map);
+}
+#endif
+
+/*eol@eof*/
@@ -2,141 +2,547 @@
 #include "mgl_logger.h"
 
 #include <jansson.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-MglDict *mgl_json_convert(json_t *json);
-MglDict *mgl_json_hash_convert(json_t *json);
-MglDict *mgl_json_list_convert(json_t *json);
+/*deeper than this is taken to be a broken or hostile file*/
+#define MGL_JSON_MAX_DEPTH 512
+
+/**
+ * @brief state for parsing json text straight into dict nodes.
+ * There is no intermediate json_t tree, each value is created in the arena as soon as it is read.
+ */
+typedef struct
+{
+  const char *text;       /**<the json text, not terminated*/
+  size_t      size;       /**<length of the text*/
+  size_t      position;   /**<read position*/
+  MglUint     depth;      /**<how many containers are open*/
+  char       *scratch;    /**<decoded strings and keys are terminated here before use*/
+  size_t      scratchSize;
+  const char *error;      /**<the first error encountered*/
+  size_t      errorPosition;
+}MglJsonStream;
 
 json_t *mgl_json_from_dict(MglDict *dict);
 
-void mgl_json_log_error(json_error_t *er);
+static MglDict *mgl_json_stream_value(MglJsonStream *stream,MglBool *ok);
 
-MglDict *mgl_json_parse_string(char *string)
+static MglBool mgl_json_stream_fail(MglJsonStream *stream,const char *error)
 {
-    MglDict *data;
-    json_t *json;
-    json_error_t jer;
-    mgl_logger_debug("begin json parse");
-    json = json_loads(string,0,&jer);
-    if (json == NULL)
+  if (!stream->error)
+  {
+    stream->error = error;
+    stream->errorPosition = stream->position;
+  }
+  return MglFalse;
+}
+
+static void mgl_json_stream_log_error(MglJsonStream *stream,const char *source)
+{
+  size_t i;
+  int line = 1,column = 1;
+  /*only worked out when something went wrong*/
+  for (i = 0;(i < stream->errorPosition) && (i < stream->size);i++)
+  {
+    if (stream->text[i] == '\n')
     {
-        mgl_logger_debug("mgl_json_parse: failed to load file %s as json\n", string);
-        mgl_json_log_error(&jer);
-        return NULL;
+      line++;
+      column = 1;
     }
-    data = mgl_json_convert(json);
-    json_decref(json); 
-    if (data == NULL)
+    else column++;
+  }
+  mgl_logger_error("json error: %s in %s at %i:%i",stream->error,source,line,column);
+}
+
+static void mgl_json_stream_skip_space(MglJsonStream *stream)
+{
+  const char *text = stream->text;
+  size_t position = stream->position;
+  while (position < stream->size)
+  {
+    switch (text[position])
     {
-        mgl_logger_debug("mgl_json_parse: failed to parse file %s as json\n", string);
-        mgl_json_log_error(&jer);
+      case ' ':
+      case '\t':
+      case '\n':
+      case '\r':
+        position++;
+        continue;
     }
-    return data;
+    break;
+  }
+  stream->position = position;
 }
 
-MglDict *mgl_json_parse(char *filename)
+static MglBool mgl_json_stream_reserve(MglJsonStream *stream,size_t size)
 {
-  MglDict *data;
-  json_t *json;
-  json_error_t jer;
-  mgl_logger_debug("begin json parse");
-  json = json_load_file(filename,0,&jer);
-  if (json == NULL)
-  {
-    mgl_logger_debug("mgl_json_parse: failed to load file %s as json\n", filename);
-    mgl_json_log_error(&jer);
-    return NULL;
+  char *scratch;
+  size_t scratchSize;
+  if (size <= stream->scratchSize)return MglTrue;
+  scratchSize = stream->scratchSize?stream->scratchSize:256;
+  while (scratchSize < size)scratchSize *= 2;
+  scratch = realloc(stream->scratch,scratchSize);
+  if (!scratch)return mgl_json_stream_fail(stream,"out of memory");
+  stream->scratch = scratch;
+  stream->scratchSize = scratchSize;
+  return MglTrue;
+}
+
+static int mgl_json_stream_hex(MglJsonStream *stream,size_t position)
+{
+  int i,c,value = 0;
+  if (position + 4 > stream->size)return -1;
+  for (i = 0;i < 4;i++)
+  {
+    c = stream->text[position + i];
+    value <<= 4;
+    if ((c >= '0') && (c <= '9'))value |= c - '0';
+    else if ((c >= 'a') && (c <= 'f'))value |= c - 'a' + 10;
+    else if ((c >= 'A') && (c <= 'F'))value |= c - 'A' + 10;
+    else return -1;
   }
-  data = mgl_json_convert(json);
-  json_decref(json); 
-  if (data == NULL)
+  return value;
+}
+
+static size_t mgl_json_stream_utf8(char *out,MglUI32 code)
+{
+  if (code < 0x80)
   {
-    mgl_logger_debug("mgl_json_parse: failed to parse file %s as json\n", filename);
-    mgl_json_log_error(&jer);
+    out[0] = (char)code;
+    return 1;
   }
-  return data;
+  if (code < 0x800)
+  {
+    out[0] = (char)(0xC0 | (code >> 6));
+    out[1] = (char)(0x80 | (code & 0x3F));
+    return 2;
+  }
+  if (code < 0x10000)
+  {
+    out[0] = (char)(0xE0 | (code >> 12));
+    out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (code & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (code >> 18));
+  out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (code & 0x3F));
+  return 4;
 }
 
-MglDict *mgl_json_convert(json_t *json)
+/**
+ * @brief reads the string at the read position into scratch, decoding escapes
+ * @return MglFalse on error, the terminated string is in stream->scratch otherwise
+ */
+static MglBool mgl_json_stream_string(MglJsonStream *stream)
 {
-  if (json_is_object(json))
+  const char *text = stream->text;
+  size_t start,end,length = 0;
+  int code,low;
+  unsigned char c;
+  start = ++stream->position;
+  /*most strings have no escapes, so find the end first and copy it in one go*/
+  for (end = start;end < stream->size;end++)
   {
-    return mgl_json_hash_convert(json);
+    c = (unsigned char)text[end];
+    if ((c == '"') || (c == '\\') || (c < 0x20))break;
   }
-  if (json_is_array(json))
+  /*escapes only ever shrink the text, so this is enough for the whole string*/
+  if (!mgl_json_stream_reserve(stream,end - start + 1))return MglFalse;
+  memcpy(stream->scratch,&text[start],end - start);
+  length = end - start;
+  stream->position = end;
+  while (stream->position < stream->size)
   {
-    return mgl_json_list_convert(json);
+    c = (unsigned char)text[stream->position];
+    if (c == '"')
+    {
+      stream->position++;
+      stream->scratch[length] = '\0';
+      return MglTrue;
+    }
+    if (c < 0x20)return mgl_json_stream_fail(stream,"control character in string");
+    if (c != '\\')
+    {
+      if (!mgl_json_stream_reserve(stream,length + 2))return MglFalse;
+      stream->scratch[length++] = (char)c;
+      stream->position++;
+      continue;
+    }
+    if (stream->position + 1 >= stream->size)break;
+    if (!mgl_json_stream_reserve(stream,length + 5))return MglFalse;
+    c = (unsigned char)text[stream->position + 1];
+    stream->position += 2;
+    switch (c)
+    {
+      case '"':
+      case '\\':
+      case '/':
+        stream->scratch[length++] = (char)c;
+        break;
+      case 'b':
+        stream->scratch[length++] = '\b';
+        break;
+      case 'f':
+        stream->scratch[length++] = '\f';
+        break;
+      case 'n':
+        stream->scratch[length++] = '\n';
+        break;
+      case 'r':
+        stream->scratch[length++] = '\r';
+        break;
+      case 't':
+        stream->scratch[length++] = '\t';
+        break;
+      case 'u':
+        code = mgl_json_stream_hex(stream,stream->position);
+        if (code < 0)return mgl_json_stream_fail(stream,"invalid \\u escape");
+        stream->position += 4;
+        if ((code >= 0xD800) && (code <= 0xDBFF))
+        {
+          /*a high surrogate must be followed by an escaped low one*/
+          if ((stream->position + 6 > stream->size) ||
+              (text[stream->position] != '\\') ||
+              (text[stream->position + 1] != 'u'))
+          {
+            return mgl_json_stream_fail(stream,"invalid unicode surrogate pair");
+          }
+          low = mgl_json_stream_hex(stream,stream->position + 2);
+          if ((low < 0xDC00) || (low > 0xDFFF))
+          {
+            return mgl_json_stream_fail(stream,"invalid unicode surrogate pair");
+          }
+          stream->position += 6;
+          code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        else if ((code >= 0xDC00) && (code <= 0xDFFF))
+        {
+          return mgl_json_stream_fail(stream,"invalid unicode surrogate pair");
+        }
+        if (code == 0)return mgl_json_stream_fail(stream,"\\u0000 is not allowed");
+        length += mgl_json_stream_utf8(&stream->scratch[length],(MglUI32)code);
+        break;
+      default:
+        stream->position -= 2;
+        return mgl_json_stream_fail(stream,"invalid escape");
+    }
+  }
+  return mgl_json_stream_fail(stream,"unterminated string");
+}
+
+static MglDict *mgl_json_stream_number(MglJsonStream *stream,MglBool *ok)
+{
+  const char *text = stream->text;
+  size_t start = stream->position,position = start;
+  MglBool real = MglFalse;
+  char number[64];
+  long long integer;
+  double value;
+  if ((position < stream->size) && (text[position] == '-'))position++;
+  if ((position >= stream->size) || (text[position] < '0') || (text[position] > '9'))
+  {
+    *ok = mgl_json_stream_fail(stream,"invalid token");
+    return NULL;
   }
-  if (json_is_string(json))
+  if (text[position] == '0')position++;
+  else while ((position < stream->size) && (text[position] >= '0') && (text[position] <= '9'))position++;
+  if ((position < stream->size) && (text[position] == '.'))
   {
-    return mgl_dict_new_string((char *)json_string_value(json));
+    real = MglTrue;
+    position++;
+    if ((position >= stream->size) || (text[position] < '0') || (text[position] > '9'))
+    {
+      stream->position = position;
+      *ok = mgl_json_stream_fail(stream,"invalid real value");
+      return NULL;
+    }
+    while ((position < stream->size) && (text[position] >= '0') && (text[position] <= '9'))position++;
   }
-  if (json_is_boolean(json))
+  if ((position < stream->size) && ((text[position] == 'e') || (text[position] == 'E')))
   {
-    return mgl_dict_new_bool(json_is_true(json));
+    real = MglTrue;
+    position++;
+    if ((position < stream->size) && ((text[position] == '+') || (text[position] == '-')))position++;
+    if ((position >= stream->size) || (text[position] < '0') || (text[position] > '9'))
+    {
+      stream->position = position;
+      *ok = mgl_json_stream_fail(stream,"invalid real value");
+      return NULL;
+    }
+    while ((position < stream->size) && (text[position] >= '0') && (text[position] <= '9'))position++;
   }
-  if (json_is_integer(json))
+  if (position - start >= sizeof(number))
   {
-    return mgl_dict_new_int(json_integer_value(json));
+    *ok = mgl_json_stream_fail(stream,"number too long");
+    return NULL;
   }
-  if (json_is_real(json))
+  memcpy(number,&text[start],position - start);
+  number[position - start] = '\0';
+  stream->position = position;
+  errno = 0;
+  if (!real)
   {
-    return mgl_dict_new_float(json_real_value(json));
+    integer = strtoll(number,NULL,10);
+    if (errno == ERANGE)
+    {
+      stream->position = start;
+      *ok = mgl_json_stream_fail(stream,"too big integer");
+      return NULL;
+    }
+    return mgl_dict_new_int((MglInt)integer);
   }
-  if (json_is_null(json))
+  value = strtod(number,NULL);
+  if ((errno == ERANGE) && (value != 0))
   {
+    stream->position = start;
+    *ok = mgl_json_stream_fail(stream,"real number overflow");
     return NULL;
   }
-  mgl_logger_debug("failed to convert object\n");
-  return NULL;
+  return mgl_dict_new_float(value);
 }
 
-MglDict *mgl_json_list_convert(json_t *json)
+static MglBool mgl_json_stream_literal(MglJsonStream *stream,const char *literal,size_t length)
 {
-  int index;
-  json_t *value;
-  MglDict *data = mgl_dict_new_list();
-  json_array_foreach(json, index, value)
+  if ((stream->position + length > stream->size) ||
+      (strncmp(&stream->text[stream->position],literal,length) != 0))
   {
-    mgl_dict_list_append(data,mgl_json_convert(value));
+    return mgl_json_stream_fail(stream,"invalid token");
   }
-  return data;
+  stream->position += length;
+  return MglTrue;
 }
 
-MglDict *mgl_json_hash_convert(json_t *json)
+static MglDict *mgl_json_stream_hash(MglJsonStream *stream,MglBool *ok)
 {
-  MglDict *data = mgl_dict_new_hash();
-  char *key;
-  json_t *value;
-  json_object_foreach(json, key, value)
+  MglDict *hash;
+  MglDict *value;
+  MglDictKey key;
+  hash = mgl_dict_new_hash();
+  stream->position++;
+  mgl_json_stream_skip_space(stream);
+  if ((stream->position < stream->size) && (stream->text[stream->position] == '}'))
   {
-    mgl_dict_hash_insert(data,key,mgl_json_convert(value));
+    stream->position++;
+    return hash;
   }
-  return data;
+  for (;;)
+  {
+    if ((stream->position >= stream->size) || (stream->text[stream->position] != '"'))
+    {
+      *ok = mgl_json_stream_fail(stream,"string or '}' expected");
+      return hash;
+    }
+    if (!mgl_json_stream_string(stream))
+    {
+      *ok = MglFalse;
+      return hash;
+    }
+    /*interned now, the scratch is reused by the value*/
+    key = mgl_dict_key_intern(stream->scratch);
+    mgl_json_stream_skip_space(stream);
+    if ((stream->position >= stream->size) || (stream->text[stream->position] != ':'))
+    {
+      *ok = mgl_json_stream_fail(stream,"':' expected");
+      return hash;
+    }
+    stream->position++;
+    value = mgl_json_stream_value(stream,ok);
+    if (!*ok)return hash;
+    mgl_dict_hash_insert_key(hash,key,value);
+    mgl_json_stream_skip_space(stream);
+    if (stream->position >= stream->size)break;
+    if (stream->text[stream->position] == '}')
+    {
+      stream->position++;
+      return hash;
+    }
+    if (stream->text[stream->position] != ',')break;
+    stream->position++;
+    mgl_json_stream_skip_space(stream);
+  }
+  *ok = mgl_json_stream_fail(stream,"'}' expected");
+  return hash;
 }
 
-void mgl_json_log_error(json_error_t *er)
+static MglDict *mgl_json_stream_list(MglJsonStream *stream,MglBool *ok)
 {
-  if (!er)return;
-  mgl_logger_error("json error: %s in %s at %i:%i",er->text,er->source,er->line,er->column);
+  MglDict *list;
+  MglDict *value;
+  list = mgl_dict_new_list();
+  stream->position++;
+  mgl_json_stream_skip_space(stream);
+  if ((stream->position < stream->size) && (stream->text[stream->position] == ']'))
+  {
+    stream->position++;
+    return list;
+  }
+  for (;;)
+  {
+    value = mgl_json_stream_value(stream,ok);
+    if (!*ok)return list;
+    mgl_dict_list_append(list,value);
+    mgl_json_stream_skip_space(stream);
+    if (stream->position >= stream->size)break;
+    if (stream->text[stream->position] == ']')
+    {
+      stream->position++;
+      return list;
+    }
+    if (stream->text[stream->position] != ',')break;
+    stream->position++;
+  }
+  *ok = mgl_json_stream_fail(stream,"']' expected");
+  return list;
+}
+
+/**
+ * @brief reads one value, creating its dict in the current arena
+ * @param ok set to MglFalse on error.  null values are NULL without an error
+ */
+static MglDict *mgl_json_stream_value(MglJsonStream *stream,MglBool *ok)
+{
+  MglDict *value;
+  mgl_json_stream_skip_space(stream);
+  if (stream->position >= stream->size)
+  {
+    *ok = mgl_json_stream_fail(stream,"unexpected end of input");
+    return NULL;
+  }
+  switch (stream->text[stream->position])
+  {
+    case '{':
+    case '[':
+      if (stream->depth >= MGL_JSON_MAX_DEPTH)
+      {
+        *ok = mgl_json_stream_fail(stream,"maximum parsing depth reached");
+        return NULL;
+      }
+      stream->depth++;
+      if (stream->text[stream->position] == '{')value = mgl_json_stream_hash(stream,ok);
+      else value = mgl_json_stream_list(stream,ok);
+      stream->depth--;
+      return value;
+    case '"':
+      if (!mgl_json_stream_string(stream))
+      {
+        *ok = MglFalse;
+        return NULL;
+      }
+      return mgl_dict_new_string(stream->scratch);
+    case 't':
+      *ok = mgl_json_stream_literal(stream,"true",4);
+      return *ok?mgl_dict_new_bool(MglTrue):NULL;
+    case 'f':
+      *ok = mgl_json_stream_literal(stream,"false",5);
+      return *ok?mgl_dict_new_bool(MglFalse):NULL;
+    case 'n':
+      *ok = mgl_json_stream_literal(stream,"null",4);
+      return NULL;
+  }
+  return mgl_json_stream_number(stream,ok);
+}
+
+/**
+ * @brief parse a whole json document into a single arena
+ * @param source named in error messages
+ */
+static MglDict *mgl_json_stream_parse(const char *buffer,size_t size,const char *source)
+{
+  MglJsonStream stream = {0};
+  MglDictArena *arena;
+  MglDict *data = NULL;
+  MglBool ok = MglTrue;
+  stream.text = buffer;
+  stream.size = size;
+  arena = mgl_dict_arena_new(0);
+  mgl_dict_arena_begin(arena);
+  mgl_json_stream_skip_space(&stream);
+  if ((stream.position >= size) ||
+      ((buffer[stream.position] != '{') && (buffer[stream.position] != '[')))
+  {
+    ok = mgl_json_stream_fail(&stream,"'[' or '{' expected");
+  }
+  else
+  {
+    data = mgl_json_stream_value(&stream,&ok);
+    mgl_json_stream_skip_space(&stream);
+    if ((ok) && (stream.position < size))
+    {
+      ok = mgl_json_stream_fail(&stream,"end of file expected");
+    }
+  }
+  free(stream.scratch);
+  if (!ok)
+  {
+    /*the partial tree is in the arena, ending without a root frees it*/
+    mgl_dict_arena_end(arena,NULL);
+    mgl_json_stream_log_error(&stream,source);
+    return NULL;
+  }
+  return mgl_dict_arena_end(arena,data);
 }
 
+MglDict *mgl_json_parse_string(char *string)
+{
+  if (!string)return NULL;
+  return mgl_json_stream_parse(string,strlen(string),"<string>");
+}
+
+MglDict *mgl_json_parse_buffer(const char *buffer,size_t size)
+{
+  if (!buffer)return NULL;
+  return mgl_json_stream_parse(buffer,size,"<buffer>");
+}
+
+MglDict *mgl_json_parse(char *filename)
+{
+  MglDict *data;
+  FILE *file;
+  char *buffer;
+  long size;
+  if (!filename)return NULL;
+  file = fopen(filename,"rb");
+  if (!file)
+  {
+    mgl_logger_debug("mgl_json_parse: failed to open file %s\n", filename);
+    return NULL;
+  }
+  fseek(file,0,SEEK_END);
+  size = ftell(file);
+  rewind(file);
+  buffer = (size > 0)?malloc(size):NULL;
+  if ((!buffer) || (fread(buffer,size,1,file) != 1))
+  {
+    mgl_logger_debug("mgl_json_parse: failed to read file %s\n", filename);
+    free(buffer);
+    fclose(file);
+    return NULL;
+  }
+  fclose(file);
+  data = mgl_json_stream_parse(buffer,size,filename);
+  free(buffer);
+  return data;
+}
 
 json_t *mgl_json_from_hash(MglDict *dict)
 {
     json_t *json;
-    MglUint count,i;
-    MglLine keystring;
+    MglDictIter iter;
+    const char *key;
     MglDict *value;
     if (!dict)return NULL;
     json = json_object();
     if (!json)return NULL;
-    count = mgl_dict_get_hash_count(dict);
-    for (i = 0;i < count;i++)
+    mgl_dict_iter_init(&iter,dict);
+    while (mgl_dict_iter_next(&iter,&key,&value))
     {
-        value = mgl_dict_get_hash_nth(keystring,dict, i);
         if (!value)continue;
-        json_object_set(json,keystring,mgl_json_from_dict(value));
+        json_object_set_new(json,key,mgl_json_from_dict(value));
     }
     return json;
 }
@@ -151,13 +557,29 @@ json_t *mgl_json_from_list(MglDict *dict)
     count = mgl_dict_get_list_count(dict);
     for (i = 0; i < count;i++)
     {
-        json_array_append(json,mgl_json_from_dict(mgl_dict_get_list_nth(dict,i)));
+        json_array_append_new(json,mgl_json_from_dict(mgl_dict_get_list_nth(dict,i)));
+    }
+    return json;
+}
+
+json_t *mgl_json_from_ui32_array(MglDict *dict)
+{
+    json_t *json;
+    const MglUI32 *values;
+    MglUint count,i;
+    json = json_array();
+    if (!json)return NULL;
+    values = mgl_dict_get_ui32_array(dict,&count);
+    for (i = 0; i < count;i++)
+    {
+        json_array_append_new(json,json_integer(values[i]));
     }
     return json;
 }
 
 json_t *mgl_json_from_dict(MglDict *dict)
 {
+    MglLine text;
     if (!dict)return NULL;
     switch (dict->keyType)
     {
@@ -167,9 +589,30 @@ json_t *mgl_json_from_dict(MglDict *dict)
         case MGL_DICT_LIST:
             return mgl_json_from_list(dict);
             break;
+        case MGL_DICT_UI32_ARRAY:
+            return mgl_json_from_ui32_array(dict);
+            break;
         case MGL_DICT_INT:
+            return json_integer(dict->scalar.i);
+            break;
         case MGL_DICT_UINT:
+            return json_integer(dict->scalar.u);
+            break;
         case MGL_DICT_FLOAT:
+            return json_real(dict->scalar.f);
+            break;
+        case MGL_DICT_BOOL:
+            return json_boolean(dict->scalar.b);
+            break;
+        case MGL_DICT_VEC2D:
+        case MGL_DICT_VEC3D:
+        case MGL_DICT_VEC4D:
+        case MGL_DICT_RECT:
+        case MGL_DICT_RECTF:
+            /*written the way they are written by hand, the getters parse them back*/
+            if (!mgl_dict_get_line(text,dict))return NULL;
+            return json_string(text);
+            break;
         case MGL_DICT_STRING:
         case MGL_DICT_VOID:
         case MGL_DICT_CUSTOM0:
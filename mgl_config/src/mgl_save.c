@@ -2,19 +2,57 @@
 #include "mgl_logger.h"
 #include "mgl_json_parse.h"
 
-#define MGLSAVEMAJOR 1
+#define MGLSAVEMAJOR 2
 #define MGLSAVEMINOR 0
 #define MGLSAVEKEY   1439072147
 #define MGLSAVEOFFSET 100
+#define MGLSAVEMAXDEPTH 256
 
 typedef struct
 {
     MglUint key;    /**<unique key meant to verify file type*/
     MglUint major;  /**<major version of the file type*/
     MglUint minor;  /**<minor version of the file type*/
-    size_t  size;   /**<size of the header*/
+    size_t  size;   /**<size of the data following the header*/
 }MglSaveHeader;
 
+/*
+ * version 2 data, all values in native byte order:
+ * MglUI32 string count, MglUI32 string table size in bytes, then each string as
+ * MglUI32 length and its characters with a null terminator.
+ * then the root dict, each dict being a MglUI8 type followed by:
+ *   string: MglUI32 string index
+ *   scalar: the value, 1 byte for bools, 4 bytes for ints, uints, floats and each MglRect component,
+ *           8 bytes per component for vectors and MglRectFloat since those are MglDouble
+ *   list:   MglUI32 count, MglUI32 size in bytes of the items, then the items
+ *   hash:   MglUI32 count, MglUI32 size in bytes of the entries, then MglUI32 key string index and the value for each
+ */
+
+typedef struct
+{
+    MglUI8 *data;
+    size_t  size;
+    size_t  capacity;
+    MglBool error;
+}MglSaveBuffer;
+
+typedef struct
+{
+    MglSaveBuffer strings;    /**<the string table*/
+    MglSaveBuffer tree;       /**<the encoded dict*/
+    GHashTable   *indices;    /**<string to its index in the table plus one*/
+    MglUI32       stringCount;
+}MglSaveWriter;
+
+typedef struct
+{
+    const MglUI8 *data;
+    size_t        size;
+    size_t        position;
+    const char  **strings;    /**<point into data*/
+    MglUI32       stringCount;
+}MglSaveReader;
+
 void mgl_save_dict_as_json(MglDict *dict, char *filepath)
 {
     char *json;
@@ -55,99 +93,508 @@ MglSaveHeader *mgl_save_new_header()
     return header;
 }
 
-void mgl_save_dict_as_binary_config(MglDict *dict, char *filepath)
+static void *mgl_save_buffer_reserve(MglSaveBuffer *buffer,size_t size)
 {
-    char *json;
-    FILE *file;
-    int i,count;
-    MglUI64 out;
-    MglSaveHeader *header;
-    if (!dict)
+    MglUI8 *data;
+    size_t capacity;
+    if (buffer->error)return NULL;
+    if (buffer->size + size > buffer->capacity)
     {
-        mgl_logger_warn("could not save: no data provided");
+        capacity = buffer->capacity?buffer->capacity * 2:4096;
+        while (capacity < buffer->size + size)capacity *= 2;
+        data = (MglUI8 *)realloc(buffer->data,capacity);
+        if (!data)
+        {
+            mgl_logger_error("failed to allocate %lu bytes for binary config",(unsigned long)capacity);
+            buffer->error = MglTrue;
+            return NULL;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    buffer->size += size;
+    return &buffer->data[buffer->size - size];
+}
+
+static void mgl_save_buffer_write(MglSaveBuffer *buffer,const void *data,size_t size)
+{
+    void *out;
+    if (!size)return;/*a tree without strings has an empty table*/
+    out = mgl_save_buffer_reserve(buffer,size);
+    if (!out)return;
+    memcpy(out,data,size);
+}
+
+static void mgl_save_buffer_write_uint(MglSaveBuffer *buffer,MglUI32 value)
+{
+    mgl_save_buffer_write(buffer,&value,sizeof(MglUI32));
+}
+
+static MglUI32 mgl_save_writer_string(MglSaveWriter *writer,const char *string)
+{
+    gpointer index;
+    MglUI32 length;
+    index = g_hash_table_lookup(writer->indices,string);
+    if (index != NULL)return GPOINTER_TO_UINT(index) - 1;
+    length = strlen(string);
+    mgl_save_buffer_write_uint(&writer->strings,length);
+    mgl_save_buffer_write(&writer->strings,string,length + 1);
+    g_hash_table_insert(writer->indices,(gpointer)string,GUINT_TO_POINTER(writer->stringCount + 1));
+    return writer->stringCount++;
+}
+
+static void mgl_save_encode_dict(MglSaveWriter *writer,MglDict *dict)
+{
+    MglSaveBuffer *out;
+    MglDictIter iter;
+    const char *key;
+    MglDict *value;
+    MglUI8 type,b;
+    size_t countAt;
+    MglUI32 count = 0,size,i;
+    const MglUI32 *values;
+    out = &writer->tree;
+    type = (MglUI8)dict->keyType;
+    if (dict->keyType == MGL_DICT_UI32_ARRAY)
+    {
+        /*saved as a list of uints, so it loads back without knowing about packed arrays*/
+        values = mgl_dict_get_ui32_array(dict,&count);
+        type = MGL_DICT_LIST;
+        mgl_save_buffer_write(out,&type,1);
+        mgl_save_buffer_write_uint(out,count);
+        mgl_save_buffer_write_uint(out,count * (1 + sizeof(MglUI32)));
+        type = MGL_DICT_UINT;
+        for (i = 0;i < count;i++)
+        {
+            mgl_save_buffer_write(out,&type,1);
+            mgl_save_buffer_write_uint(out,values[i]);
+        }
         return;
     }
+    if ((!mgl_dict_is_scalar(dict)) && (dict->keyType != MGL_DICT_LIST) && (dict->keyType != MGL_DICT_HASH))
+    {
+        /*anything else is saved the way the json writer saves it*/
+        type = MGL_DICT_STRING;
+    }
+    mgl_save_buffer_write(out,&type,1);
+    switch (type)
+    {
+        case MGL_DICT_BOOL:
+            b = dict->scalar.b;
+            mgl_save_buffer_write(out,&b,1);
+            break;
+        case MGL_DICT_INT:
+        case MGL_DICT_UINT:
+        case MGL_DICT_FLOAT:
+            mgl_save_buffer_write(out,&dict->scalar,4);
+            break;
+        case MGL_DICT_VEC2D:
+            mgl_save_buffer_write(out,&dict->scalar.v2,sizeof(MglVec2D));
+            break;
+        case MGL_DICT_VEC3D:
+            mgl_save_buffer_write(out,&dict->scalar.v3,sizeof(MglVec3D));
+            break;
+        case MGL_DICT_VEC4D:
+            mgl_save_buffer_write(out,&dict->scalar.v4,sizeof(MglVec4D));
+            break;
+        case MGL_DICT_RECT:
+            mgl_save_buffer_write(out,&dict->scalar.r,sizeof(MglRect));
+            break;
+        case MGL_DICT_RECTF:
+            mgl_save_buffer_write(out,&dict->scalar.rf,sizeof(MglRectFloat));
+            break;
+        case MGL_DICT_LIST:
+        case MGL_DICT_HASH:
+            /*count and size are filled in once the items are written*/
+            countAt = out->size;
+            mgl_save_buffer_write_uint(out,0);
+            mgl_save_buffer_write_uint(out,0);
+            mgl_dict_iter_init(&iter,dict);
+            while (mgl_dict_iter_next(&iter,&key,&value))
+            {
+                if (!value)continue;
+                if (type == MGL_DICT_HASH)
+                {
+                    mgl_save_buffer_write_uint(out,mgl_save_writer_string(writer,key));
+                }
+                mgl_save_encode_dict(writer,value);
+                count++;
+            }
+            if (out->error)return;
+            /*the size lets readers skip the container without decoding it*/
+            size = out->size - countAt - (sizeof(MglUI32) * 2);
+            memcpy(&out->data[countAt],&count,sizeof(MglUI32));
+            memcpy(&out->data[countAt + sizeof(MglUI32)],&size,sizeof(MglUI32));
+            break;
+        default:
+            mgl_save_buffer_write_uint(out,mgl_save_writer_string(writer,dict->keyValue?dict->keyValue:""));
+            break;
+    }
+}
+
+void *mgl_save_dict_to_binary(MglDict *dict,size_t *size)
+{
+    MglSaveWriter writer = {0};
+    MglSaveHeader *header;
+    MglSaveBuffer out = {0};
+    MglUI32 table[2];
+    if (!dict)return NULL;
     header = mgl_save_new_header();
-    if (!header)return;
-    json = mgl_json_convert_dict_to_packed_string(dict);
-    if (!json)
+    if (!header)return NULL;
+    writer.indices = g_hash_table_new(g_str_hash,g_str_equal);
+    mgl_save_encode_dict(&writer,dict);
+    g_hash_table_destroy(writer.indices);
+    table[0] = writer.stringCount;
+    table[1] = writer.strings.size;
+    header->size = sizeof(table) + writer.strings.size + writer.tree.size;
+    if ((!writer.tree.error) && (!writer.strings.error))
     {
-        mgl_logger_warn("failed to convert dict to json");
-        free(header);
+        mgl_save_buffer_write(&out,header,sizeof(MglSaveHeader));
+        mgl_save_buffer_write(&out,table,sizeof(table));
+        mgl_save_buffer_write(&out,writer.strings.data,writer.strings.size);
+        mgl_save_buffer_write(&out,writer.tree.data,writer.tree.size);
+    }
+    free(writer.tree.data);
+    free(writer.strings.data);
+    free(header);
+    if ((writer.tree.error) || (writer.strings.error) || (out.error))
+    {
+        mgl_logger_warn("failed to encode dict as a binary config");
+        free(out.data);
+        return NULL;
+    }
+    if (size)*size = out.size;
+    return out.data;
+}
+
+void mgl_save_dict_as_binary_config(MglDict *dict, char *filepath)
+{
+    void *data;
+    size_t size = 0;
+    FILE *file;
+    if (!dict)
+    {
+        mgl_logger_warn("could not save: no data provided");
         return;
     }
+    data = mgl_save_dict_to_binary(dict,&size);
+    if (!data)return;
     file = fopen(filepath,"wb");
     if (!file)
     {
         mgl_logger_warn("failed to open file %s for writing",filepath);
-        free(header);
-        free(json);
+        free(data);
         return;
     }
-    count = strlen(json);
-    header->size = count;
-    fwrite(header,sizeof(MglSaveHeader),1,file);
-    for (i = 0; i < count;i++)
+    fwrite(data,1,size,file);
+    fclose(file);
+    free(data);
+}
+
+static MglBool mgl_save_read(MglSaveReader *reader,void *out,size_t size)
+{
+    if (reader->size - reader->position < size)return MglFalse;
+    /*the data may not be aligned for a direct read*/
+    memcpy(out,&reader->data[reader->position],size);
+    reader->position += size;
+    return MglTrue;
+}
+
+static const char *mgl_save_read_string(MglSaveReader *reader)
+{
+    MglUI32 index;
+    if (!mgl_save_read(reader,&index,sizeof(MglUI32)))return NULL;
+    if (index >= reader->stringCount)return NULL;
+    return reader->strings[index];
+}
+
+static MglDict *mgl_save_decode_dict(MglSaveReader *reader,MglUint depth)
+{
+    MglDict *dict = NULL,*value;
+    MglDictScalar scalar;
+    const char *key;
+    MglUI32 count,size,i;
+    MglUI8 type,b;
+    if (depth > MGLSAVEMAXDEPTH)return NULL;
+    if (!mgl_save_read(reader,&type,1))return NULL;
+    switch (type)
     {
-        out = json[i] + MGLSAVEOFFSET;
-        fwrite(&out,sizeof(MglUI64),1,file);
+        case MGL_DICT_BOOL:
+            if (!mgl_save_read(reader,&b,1))return NULL;
+            return mgl_dict_new_bool(b);
+        case MGL_DICT_INT:
+            if (!mgl_save_read(reader,&scalar.i,4))return NULL;
+            return mgl_dict_new_int(scalar.i);
+        case MGL_DICT_UINT:
+            if (!mgl_save_read(reader,&scalar.u,4))return NULL;
+            return mgl_dict_new_uint(scalar.u);
+        case MGL_DICT_FLOAT:
+            if (!mgl_save_read(reader,&scalar.f,4))return NULL;
+            return mgl_dict_new_float(scalar.f);
+        case MGL_DICT_VEC2D:
+            if (!mgl_save_read(reader,&scalar.v2,sizeof(MglVec2D)))return NULL;
+            return mgl_dict_new_vec2d(scalar.v2);
+        case MGL_DICT_VEC3D:
+            if (!mgl_save_read(reader,&scalar.v3,sizeof(MglVec3D)))return NULL;
+            return mgl_dict_new_vec3d(scalar.v3);
+        case MGL_DICT_VEC4D:
+            if (!mgl_save_read(reader,&scalar.v4,sizeof(MglVec4D)))return NULL;
+            return mgl_dict_new_vec4d(scalar.v4);
+        case MGL_DICT_RECT:
+            if (!mgl_save_read(reader,&scalar.r,sizeof(MglRect)))return NULL;
+            return mgl_dict_new_rect(scalar.r);
+        case MGL_DICT_RECTF:
+            if (!mgl_save_read(reader,&scalar.rf,sizeof(MglRectFloat)))return NULL;
+            return mgl_dict_new_rectf(scalar.rf);
+        case MGL_DICT_STRING:
+            key = mgl_save_read_string(reader);
+            if (!key)return NULL;
+            return mgl_dict_new_string((char *)key);
+        case MGL_DICT_LIST:
+        case MGL_DICT_HASH:
+            if (!mgl_save_read(reader,&count,sizeof(MglUI32)))return NULL;
+            if (!mgl_save_read(reader,&size,sizeof(MglUI32)))return NULL;
+            if (reader->size - reader->position < size)return NULL;
+            dict = (type == MGL_DICT_LIST)?mgl_dict_new_list():mgl_dict_new_hash();
+            if (!dict)return NULL;
+            for (i = 0; i < count;i++)
+            {
+                key = NULL;
+                if ((type == MGL_DICT_HASH) && ((key = mgl_save_read_string(reader)) == NULL))break;
+                value = mgl_save_decode_dict(reader,depth + 1);
+                if (!value)break;
+                if (key)mgl_dict_hash_insert(dict,(char *)key,value);
+                else mgl_dict_list_append(dict,value);
+            }
+            if (i < count)
+            {
+                mgl_dict_free(&dict);
+                return NULL;
+            }
+            return dict;
     }
-    fclose(file);
-    free(header);
-    free(json);
+    return NULL;
+}
+
+static MglDict *mgl_save_decode_v2(const MglUI8 *data,size_t size)
+{
+    MglSaveReader reader = {0};
+    MglUI32 table[2],length,i;
+    MglDictArena *arena;
+    MglDict *dict = NULL;
+    reader.data = data;
+    reader.size = size;
+    if (!mgl_save_read(&reader,table,sizeof(table)))return NULL;
+    if ((table[1] > size - reader.position) || (table[0] > table[1] / (sizeof(MglUI32) + 1)))
+    {
+        mgl_logger_warn("binary config string table is corrupt");
+        return NULL;
+    }
+    reader.strings = (const char **)malloc(sizeof(const char *) * (table[0] + 1));
+    if (!reader.strings)
+    {
+        mgl_logger_warn("failed to allocate binary config string table");
+        return NULL;
+    }
+    for (i = 0; i < table[0];i++)
+    {
+        if ((!mgl_save_read(&reader,&length,sizeof(MglUI32))) ||
+            (length >= reader.size - reader.position) ||
+            (data[reader.position + length] != '\0'))
+        {
+            break;
+        }
+        reader.strings[i] = (const char *)&data[reader.position];
+        reader.position += length + 1;
+    }
+    reader.stringCount = i;
+    if (i == table[0])
+    {
+        arena = mgl_dict_arena_new(0);
+        mgl_dict_arena_begin(arena);
+        dict = mgl_dict_arena_end(arena,mgl_save_decode_dict(&reader,0));
+    }
+    if (!dict)
+    {
+        mgl_logger_warn("binary config data is corrupt");
+    }
+    free(reader.strings);
+    return dict;
 }
 
-char * mgl_save_load_binary_data_v1_0(FILE *file, MglSaveHeader *header)
+/*version 1 is the packed json text, one character per MglUI64*/
+static char *mgl_save_decode_v1(const MglUI8 *bytes,size_t size,size_t count)
 {
     char * data;
-    int i;
+    size_t i;
     MglUI64 in;
-    if (!file)return NULL;
-    if (!header)return NULL;
-    data = malloc(sizeof(char) * header->size);
+    if (size / sizeof(MglUI64) < count)
+    {
+        mgl_logger_warn("binary config data is truncated");
+        return NULL;
+    }
+    data = malloc(sizeof(char) * (count + 1));
     if (!data)
     {
         mgl_logger_warn("failed to allocate file data");
         return NULL;
     }
-    memset(data,0,sizeof(sizeof(char) * header->size));
-    for (i = 0; i < header->size;i++)
+    for (i = 0; i < count;i++)
     {
-        fread(&in,sizeof(MglUI64),1,file);
+        /*the buffer may not be aligned for a direct read*/
+        memcpy(&in,&bytes[i * sizeof(MglUI64)],sizeof(MglUI64));
         data[i] = (char)in - MGLSAVEOFFSET;
     }
+    data[count] = '\0';
     return data;
 }
 
-char *mgl_save_binary_load(char *filepath)
+/*checks the header, NULL if this is not a supported binary config*/
+static const MglUI8 *mgl_save_check_header(const void *buffer,size_t size,MglSaveHeader *header)
+{
+    if (!buffer)return NULL;
+    if (size < sizeof(MglSaveHeader))return NULL;
+    memcpy(header,buffer,sizeof(MglSaveHeader));
+    if (header->key != MGLSAVEKEY)
+    {
+        /*NOT an MGL binary file*/
+        return NULL;
+    }
+    if (((header->major != 1) && (header->major != 2)) || (header->minor != 0))
+    {
+        mgl_logger_warn("unsupported file version : %i.%i",header->major,header->minor);
+        return NULL;
+    }
+    return (const MglUI8 *)buffer + sizeof(MglSaveHeader);
+}
+
+MglBool mgl_save_is_binary(const void *buffer,size_t size)
+{
+    MglSaveHeader header;
+    if ((!buffer) || (size < sizeof(MglSaveHeader)))return MglFalse;
+    memcpy(&header,buffer,sizeof(MglSaveHeader));
+    return header.key == MGLSAVEKEY;
+}
+
+const void *mgl_save_binary_get_dict_data(const void *buffer,size_t size,size_t *dataSize)
+{
+    MglSaveHeader header;
+    const MglUI8 *bytes;
+    bytes = mgl_save_check_header(buffer,size,&header);
+    if (!bytes)return NULL;
+    if ((header.major != 2) || (header.size > size - sizeof(MglSaveHeader)))return NULL;
+    if (dataSize)*dataSize = header.size;
+    return bytes;
+}
+
+MglDict *mgl_save_binary_load_dict_from_memory(const void *buffer,size_t size)
+{
+    MglSaveHeader header;
+    const MglUI8 *bytes;
+    MglDict *dict;
+    char *json;
+    bytes = mgl_save_check_header(buffer,size,&header);
+    if (!bytes)return NULL;
+    size -= sizeof(MglSaveHeader);
+    if (header.major == 1)
+    {
+        json = mgl_save_decode_v1(bytes,size,header.size);
+        if (!json)return NULL;
+        dict = mgl_json_parse_string(json);
+        free(json);
+        return dict;
+    }
+    if (header.size > size)
+    {
+        mgl_logger_warn("binary config data is truncated");
+        return NULL;
+    }
+    return mgl_save_decode_v2(bytes,header.size);
+}
+
+char *mgl_save_binary_load_from_memory(const void *buffer,size_t size)
+{
+    MglSaveHeader header;
+    const MglUI8 *bytes;
+    MglDict *dict;
+    char *json;
+    bytes = mgl_save_check_header(buffer,size,&header);
+    if (!bytes)return NULL;
+    if (header.major == 1)
+    {
+        return mgl_save_decode_v1(bytes,size - sizeof(MglSaveHeader),header.size);
+    }
+    dict = mgl_save_binary_load_dict_from_memory(buffer,size);
+    if (!dict)return NULL;
+    json = mgl_json_convert_dict_to_packed_string(dict);
+    mgl_dict_free(&dict);
+    return json;
+}
+
+/*reads the whole file in one go, NULL if it is not a binary config*/
+static MglUI8 *mgl_save_read_file(char *filepath,size_t *size)
 {
-    char * data = NULL;
-    FILE *file;
     MglSaveHeader header;
+    MglUI8 *data;
+    FILE *file;
+    long length;
     file = fopen(filepath,"rb");
     if (!file)
     {
         mgl_logger_warn("failed to open file %s for reading",filepath);
         return NULL;
     }
-    fread(&header,sizeof(MglSaveHeader),1,file);
-    if (header.key != MGLSAVEKEY)
+    if ((fread(&header,sizeof(MglSaveHeader),1,file) != 1) || (header.key != MGLSAVEKEY))
     {
         /*NOT an MGL binary file*/
         mgl_logger_debug("file %s is not an MGL Save File",filepath);
         fclose(file);
         return NULL;
     }
-    if ((header.major == 1) && (header.minor == 0))
+    fseek(file,0,SEEK_END);
+    length = ftell(file);
+    rewind(file);
+    data = (length > 0)?(MglUI8 *)malloc(length):NULL;
+    if (!data)
     {
-        data = mgl_save_load_binary_data_v1_0(file,&header);
+        mgl_logger_warn("failed to allocate file data for %s",filepath);
+        fclose(file);
+        return NULL;
     }
-    else
+    if (fread(data,1,length,file) != (size_t)length)
     {
-        mgl_logger_warn("unsupported file version : %i.%i",header.major,header.minor);
+        mgl_logger_warn("failed to read file %s",filepath);
+        free(data);
+        fclose(file);
+        return NULL;
     }
     fclose(file);
+    *size = length;
     return data;
 }
 
+MglDict *mgl_save_binary_load_dict(char *filepath)
+{
+    MglUI8 *data;
+    MglDict *dict;
+    size_t size = 0;
+    data = mgl_save_read_file(filepath,&size);
+    if (!data)return NULL;
+    dict = mgl_save_binary_load_dict_from_memory(data,size);
+    free(data);
+    return dict;
+}
+
+char *mgl_save_binary_load(char *filepath)
+{
+    MglUI8 *data;
+    char *json;
+    size_t size = 0;
+    data = mgl_save_read_file(filepath,&size);
+    if (!data)return NULL;
+    json = mgl_save_binary_load_from_memory(data,size);
+    free(data);
+    return json;
+}
+
 /*eol@eof*/
@@ -0,0 +1,507 @@
+#include "mgl_xml_parse.h"
+#include "mgl_logger.h"
+#include "mgl_dict.h"
+#include <expat.h>
+#include <zlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*deeper than this is taken to be a broken or hostile file*/
+#define MGL_XML_MAX_DEPTH 512
+/*expat takes lengths as int, so large buffers are fed a block at a time*/
+#define MGL_XML_BLOCK_SIZE (1 << 20)
+#define MGL_XML_INFLATE_SIZE 4096
+
+/**
+ * @brief decodes the text of a tile <data> or <chunk> element as it arrives
+ */
+typedef struct
+{
+  MglBool   active;
+  MglUint   depth;      /**<depth of the element being decoded*/
+  MglBool   base64;     /**<csv otherwise*/
+  MglBool   compressed;
+  z_stream  zlib;
+  MglUI8    packed[MGL_XML_INFLATE_SIZE];/**<base64 decoded bytes waiting to be inflated*/
+  MglUint   packedSize;
+  MglUI32   bits;       /**<base64 bits not yet making a byte*/
+  MglUint   bitCount;
+  MglBool   padded;     /**<base64 padding was seen, nothing may follow it*/
+  MglUI32   word;       /**<bytes of the current little endian tile*/
+  MglUint   wordSize;
+  MglUI64   value;      /**<the csv number being read*/
+  MglBool   inNumber;
+  MglDict  *tiles;      /**<MGL_DICT_UI32_ARRAY of the decoded ids*/
+}MglXmlTiles;
+
+/**
+ * @brief an element that has been started but not ended
+ */
+typedef struct
+{
+  MglDict    *element;
+  MglDictKey  name;
+  size_t      textStart;/**<where this element's text begins in the text buffer*/
+  MglBool     tileData; /**<a <data> element whose chunks are decoded too*/
+}MglXmlLevel;
+
+typedef struct
+{
+  XML_Parser   parser;
+  MglXmlLevel *levels;
+  MglUint      depth;
+  MglUint      levelCount;
+  MglDict     *root;
+  char        *text;    /**<character data of every open element, innermost last*/
+  size_t       textSize;
+  size_t       textCapacity;
+  MglXmlTiles  tiles;
+  const char  *error;   /**<set when the document is fine but we could not use it*/
+  MglDictKey   textKey;
+  MglDictKey   tilesKey;
+}MglXmlBuilder;
+
+static void mgl_xml_fail(MglXmlBuilder *builder,const char *error)
+{
+  if (builder->error)return;
+  builder->error = error;
+  XML_StopParser(builder->parser,XML_FALSE);
+}
+
+/*a hash of the same name becomes a list when a second one turns up*/
+static void mgl_xml_attach(MglDict *parent,MglDictKey name,MglDict *value)
+{
+  MglDict *existing;
+  MglDict *list;
+  existing = mgl_dict_get_hash_value_by_key(parent,name);
+  if (!existing)
+  {
+    mgl_dict_hash_insert_key(parent,name,value);
+    return;
+  }
+  if (existing->keyType == MGL_DICT_LIST)
+  {
+    mgl_dict_list_append(existing,value);
+    return;
+  }
+  list = mgl_dict_new_list();
+  mgl_dict_list_append(list,existing);
+  mgl_dict_list_append(list,value);
+  /*everything is in the arena, so replacing the entry does not free the old value*/
+  mgl_dict_hash_insert_key(parent,name,list);
+}
+
+/*tile ids are packed 4 bytes apiece rather than a dict per cell*/
+static void mgl_xml_tiles_add(MglXmlBuilder *builder,MglUI32 tile)
+{
+  if (!builder->tiles.tiles)builder->tiles.tiles = mgl_dict_new_ui32_array(NULL,0);
+  if (!mgl_dict_ui32_array_append(builder->tiles.tiles,tile))mgl_xml_fail(builder,"out of memory");
+}
+
+/*tiles are stored as little endian 32 bit ids*/
+static void mgl_xml_tiles_bytes(MglXmlBuilder *builder,const MglUI8 *bytes,size_t count)
+{
+  MglXmlTiles *tiles = &builder->tiles;
+  size_t i;
+  for (i = 0;i < count;i++)
+  {
+    tiles->word |= (MglUI32)bytes[i] << (tiles->wordSize * 8);
+    if (++tiles->wordSize == 4)
+    {
+      mgl_xml_tiles_add(builder,tiles->word);
+      tiles->word = 0;
+      tiles->wordSize = 0;
+    }
+  }
+}
+
+static void mgl_xml_tiles_inflate(MglXmlBuilder *builder,MglBool finish)
+{
+  MglXmlTiles *tiles = &builder->tiles;
+  MglUI8 out[MGL_XML_INFLATE_SIZE];
+  int result;
+  tiles->zlib.next_in = tiles->packed;
+  tiles->zlib.avail_in = tiles->packedSize;
+  do
+  {
+    tiles->zlib.next_out = out;
+    tiles->zlib.avail_out = sizeof(out);
+    result = inflate(&tiles->zlib,Z_NO_FLUSH);
+    if ((result != Z_OK) && (result != Z_STREAM_END) && (result != Z_BUF_ERROR))
+    {
+      mgl_xml_fail(builder,"corrupt compressed tile data");
+      return;
+    }
+    mgl_xml_tiles_bytes(builder,out,sizeof(out) - tiles->zlib.avail_out);
+    if (result == Z_STREAM_END)break;
+  }while ((tiles->zlib.avail_in > 0) || (tiles->zlib.avail_out == 0));
+  tiles->packedSize = 0;
+  if ((finish) && (result != Z_STREAM_END))
+  {
+    mgl_xml_fail(builder,"compressed tile data ends early");
+  }
+}
+
+static void mgl_xml_tiles_byte(MglXmlBuilder *builder,MglUI8 byte)
+{
+  MglXmlTiles *tiles = &builder->tiles;
+  if (!tiles->compressed)
+  {
+    mgl_xml_tiles_bytes(builder,&byte,1);
+    return;
+  }
+  tiles->packed[tiles->packedSize++] = byte;
+  if (tiles->packedSize == MGL_XML_INFLATE_SIZE)mgl_xml_tiles_inflate(builder,MglFalse);
+}
+
+static int mgl_xml_base64_value(char c)
+{
+  if ((c >= 'A') && (c <= 'Z'))return c - 'A';
+  if ((c >= 'a') && (c <= 'z'))return c - 'a' + 26;
+  if ((c >= '0') && (c <= '9'))return c - '0' + 52;
+  if (c == '+')return 62;
+  if (c == '/')return 63;
+  return -1;
+}
+
+static void mgl_xml_tiles_text(MglXmlBuilder *builder,const char *text,int length)
+{
+  MglXmlTiles *tiles = &builder->tiles;
+  int i,value;
+  char c;
+  for (i = 0;(i < length) && (!builder->error);i++)
+  {
+    c = text[i];
+    if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+    {
+      if ((!tiles->base64) && (tiles->inNumber))
+      {
+        mgl_xml_tiles_add(builder,(MglUI32)tiles->value);
+        tiles->inNumber = MglFalse;
+        tiles->value = 0;
+      }
+      continue;
+    }
+    if (!tiles->base64)
+    {
+      if ((c >= '0') && (c <= '9'))
+      {
+        tiles->value = tiles->value * 10 + (c - '0');
+        if (tiles->value > 0xFFFFFFFF)mgl_xml_fail(builder,"tile id out of range");
+        tiles->inNumber = MglTrue;
+      }
+      else if (c == ',')
+      {
+        if (tiles->inNumber)mgl_xml_tiles_add(builder,(MglUI32)tiles->value);
+        tiles->inNumber = MglFalse;
+        tiles->value = 0;
+      }
+      else mgl_xml_fail(builder,"unexpected character in csv tile data");
+      continue;
+    }
+    if (c == '=')
+    {
+      tiles->padded = MglTrue;
+      continue;
+    }
+    value = mgl_xml_base64_value(c);
+    if ((value < 0) || (tiles->padded))
+    {
+      mgl_xml_fail(builder,"unexpected character in base64 tile data");
+      continue;
+    }
+    tiles->bits = (tiles->bits << 6) | (MglUI32)value;
+    tiles->bitCount += 6;
+    if (tiles->bitCount >= 8)
+    {
+      tiles->bitCount -= 8;
+      mgl_xml_tiles_byte(builder,(MglUI8)(tiles->bits >> tiles->bitCount));
+      tiles->bits &= (1 << tiles->bitCount) - 1;
+    }
+  }
+}
+
+static void mgl_xml_tiles_end(MglXmlBuilder *builder,MglDict *element)
+{
+  MglXmlTiles *tiles = &builder->tiles;
+  if (!tiles->active)return;
+  if ((!tiles->base64) && (tiles->inNumber))
+  {
+    mgl_xml_tiles_add(builder,(MglUI32)tiles->value);
+  }
+  if ((tiles->compressed) && (!builder->error))
+  {
+    mgl_xml_tiles_inflate(builder,MglTrue);
+  }
+  if (tiles->compressed)inflateEnd(&tiles->zlib);
+  if ((tiles->wordSize != 0) && (!builder->error))
+  {
+    mgl_xml_fail(builder,"tile data is not a whole number of tiles");
+  }
+  if ((tiles->tiles) && (!builder->error))
+  {
+    mgl_dict_hash_insert_key(element,builder->tilesKey,tiles->tiles);
+  }
+  memset(tiles,0,sizeof(MglXmlTiles));
+}
+
+static void mgl_xml_tiles_begin(MglXmlBuilder *builder,const char *encoding,const char *compression)
+{
+  MglXmlTiles *tiles = &builder->tiles;
+  memset(tiles,0,sizeof(MglXmlTiles));
+  if (strcmp(encoding,"base64") == 0)
+  {
+    tiles->base64 = MglTrue;
+    if ((compression != NULL) && (compression[0] != '\0'))
+    {
+      if ((strcmp(compression,"zlib") != 0) && (strcmp(compression,"gzip") != 0))
+      {
+        mgl_xml_fail(builder,"unsupported tile data compression");
+        return;
+      }
+      /*+32 picks zlib or gzip from the header*/
+      if (inflateInit2(&tiles->zlib,15 + 32) != Z_OK)
+      {
+        mgl_xml_fail(builder,"failed to start inflating tile data");
+        return;
+      }
+      tiles->compressed = MglTrue;
+    }
+  }
+  else if (strcmp(encoding,"csv") != 0)
+  {
+    mgl_xml_fail(builder,"unsupported tile data encoding");
+    return;
+  }
+  tiles->active = MglTrue;
+  tiles->depth = builder->depth;
+}
+
+static void XMLCALL mgl_xml_start(void *data,const XML_Char *name,const XML_Char **attributes)
+{
+  MglXmlBuilder *builder = (MglXmlBuilder *)data;
+  MglXmlLevel *levels;
+  MglXmlLevel *level;
+  MglXmlLevel *parent;
+  const char *encoding = NULL;
+  const char *compression = NULL;
+  int i;
+  if (builder->error)return;
+  if (builder->depth >= MGL_XML_MAX_DEPTH)
+  {
+    mgl_xml_fail(builder,"elements nested too deeply");
+    return;
+  }
+  if (builder->depth == builder->levelCount)
+  {
+    levels = realloc(builder->levels,sizeof(MglXmlLevel) * (builder->levelCount?builder->levelCount * 2:16));
+    if (!levels)
+    {
+      mgl_xml_fail(builder,"out of memory");
+      return;
+    }
+    builder->levels = levels;
+    builder->levelCount = builder->levelCount?builder->levelCount * 2:16;
+  }
+  parent = builder->depth?&builder->levels[builder->depth - 1]:NULL;
+  level = &builder->levels[builder->depth];
+  memset(level,0,sizeof(MglXmlLevel));
+  level->element = mgl_dict_new_hash();
+  level->name = mgl_dict_key_intern((char *)name);
+  level->textStart = builder->textSize;
+  for (i = 0;(attributes[i] != NULL) && (attributes[i + 1] != NULL);i += 2)
+  {
+    mgl_dict_hash_insert_key(level->element,mgl_dict_key_intern((char *)attributes[i]),mgl_dict_new_string((char *)attributes[i + 1]));
+    if (strcmp(attributes[i],"encoding") == 0)encoding = attributes[i + 1];
+    else if (strcmp(attributes[i],"compression") == 0)compression = attributes[i + 1];
+  }
+  builder->depth++;
+  if ((strcmp(name,"data") == 0) && (encoding != NULL))
+  {
+    level->tileData = MglTrue;
+    mgl_xml_tiles_begin(builder,encoding,compression);
+  }
+  else if ((strcmp(name,"chunk") == 0) && (parent != NULL) && (parent->tileData))
+  {
+    /*infinite maps split the layer into chunks, each decoded the way the layer says*/
+    encoding = mgl_dict_get_string(mgl_dict_get_hash_value(parent->element,"encoding"));
+    compression = mgl_dict_get_string(mgl_dict_get_hash_value(parent->element,"compression"));
+    if (builder->tiles.compressed)inflateEnd(&builder->tiles.zlib);
+    mgl_xml_tiles_begin(builder,encoding?encoding:"csv",compression);
+  }
+}
+
+static void XMLCALL mgl_xml_text(void *data,const XML_Char *text,int length)
+{
+  MglXmlBuilder *builder = (MglXmlBuilder *)data;
+  char *buffer;
+  size_t capacity;
+  if (builder->error)return;
+  if ((builder->tiles.active) && (builder->tiles.depth == builder->depth))
+  {
+    /*tile data never makes it into a string*/
+    mgl_xml_tiles_text(builder,text,length);
+    return;
+  }
+  if (builder->textSize + length + 1 > builder->textCapacity)
+  {
+    capacity = builder->textCapacity?builder->textCapacity:256;
+    while (capacity < builder->textSize + length + 1)capacity *= 2;
+    buffer = realloc(builder->text,capacity);
+    if (!buffer)
+    {
+      mgl_xml_fail(builder,"out of memory");
+      return;
+    }
+    builder->text = buffer;
+    builder->textCapacity = capacity;
+  }
+  memcpy(&builder->text[builder->textSize],text,length);
+  builder->textSize += length;
+}
+
+static void XMLCALL mgl_xml_end(void *data,const XML_Char *name)
+{
+  MglXmlBuilder *builder = (MglXmlBuilder *)data;
+  MglXmlLevel *level;
+  MglDict *value;
+  size_t start,end;
+  if (builder->error)return;
+  level = &builder->levels[builder->depth - 1];
+  if ((builder->tiles.active) && (builder->tiles.depth == builder->depth))
+  {
+    mgl_xml_tiles_end(builder,level->element);
+    if (builder->error)return;
+  }
+  value = level->element;
+  start = level->textStart;
+  end = builder->textSize;
+  while ((start < end) && (strchr(" \t\r\n",builder->text[start]) != NULL))start++;
+  while ((end > start) && (strchr(" \t\r\n",builder->text[end - 1]) != NULL))end--;
+  if (start < end)
+  {
+    builder->text[end] = '\0';
+    if (mgl_dict_get_hash_count(level->element) == 0)
+    {
+      value = mgl_dict_new_string(&builder->text[start]);
+    }
+    else
+    {
+      mgl_dict_hash_insert_key(level->element,builder->textKey,mgl_dict_new_string(&builder->text[start]));
+    }
+  }
+  builder->textSize = level->textStart;
+  builder->depth--;
+  if (builder->depth == 0)
+  {
+    builder->root = mgl_dict_new_hash();
+    mgl_dict_hash_insert_key(builder->root,level->name,value);
+    return;
+  }
+  mgl_xml_attach(builder->levels[builder->depth - 1].element,level->name,value);
+}
+
+static MglBool mgl_xml_builder_init(MglXmlBuilder *builder)
+{
+  memset(builder,0,sizeof(MglXmlBuilder));
+  builder->parser = XML_ParserCreate(NULL);
+  if (!builder->parser)return MglFalse;
+  builder->textKey = mgl_dict_key_intern("text");
+  builder->tilesKey = mgl_dict_key_intern("tiles");
+  XML_SetUserData(builder->parser,builder);
+  XML_SetElementHandler(builder->parser,mgl_xml_start,mgl_xml_end);
+  XML_SetCharacterDataHandler(builder->parser,mgl_xml_text);
+  return MglTrue;
+}
+
+static void mgl_xml_log_error(MglXmlBuilder *builder,const char *source)
+{
+  mgl_logger_error("mgl_config: xml error: %s in %s at (line: %lu, col: %lu)",
+                   builder->error?builder->error:XML_ErrorString(XML_GetErrorCode(builder->parser)),
+                   source,
+                   (unsigned long)XML_GetCurrentLineNumber(builder->parser),
+                   (unsigned long)XML_GetCurrentColumnNumber(builder->parser) + 1);
+}
+
+/*ok is MglFalse if parsing failed, the arena and anything in it are freed*/
+static MglDict *mgl_xml_builder_finish(MglXmlBuilder *builder,MglDictArena *arena,MglBool ok,const char *source)
+{
+  MglDict *root = NULL;
+  if ((ok) && (!builder->error))root = builder->root;
+  else mgl_xml_log_error(builder,source);
+  if (builder->tiles.compressed)inflateEnd(&builder->tiles.zlib);
+  XML_ParserFree(builder->parser);
+  free(builder->levels);
+  free(builder->text);
+  /*the whole tree goes in one arena so it is freed in one go*/
+  return mgl_dict_arena_end(arena,root);
+}
+
+MglDict *mgl_xml_parse_buffer(const char *buffer,size_t size)
+{
+  MglXmlBuilder builder;
+  MglDictArena *arena;
+  MglBool ok = MglTrue;
+  size_t offset = 0,block;
+  if (!buffer)return NULL;
+  if (!mgl_xml_builder_init(&builder))return NULL;
+  arena = mgl_dict_arena_new(0);
+  mgl_dict_arena_begin(arena);
+  do
+  {
+    block = size - offset;
+    if (block > MGL_XML_BLOCK_SIZE)block = MGL_XML_BLOCK_SIZE;
+    if (XML_Parse(builder.parser,&buffer[offset],(int)block,offset + block == size) != XML_STATUS_OK)
+    {
+      ok = MglFalse;
+      break;
+    }
+    offset += block;
+  }while (offset < size);
+  return mgl_xml_builder_finish(&builder,arena,ok,"<buffer>");
+}
+
+MglDict *mgl_xml_parse(char *filename)
+{
+  MglXmlBuilder builder;
+  MglDictArena *arena;
+  MglBool ok = MglTrue;
+  FILE *file;
+  void *block;
+  size_t size;
+  if (!filename)return NULL;
+  file = fopen(filename,"rb");
+  if (!file)
+  {
+    mgl_logger_error("failed to open input file for parsing: %s",filename);
+    return NULL;
+  }
+  if (!mgl_xml_builder_init(&builder))
+  {
+    fclose(file);
+    return NULL;
+  }
+  arena = mgl_dict_arena_new(0);
+  mgl_dict_arena_begin(arena);
+  do
+  {
+    /*read straight into expat's own buffer*/
+    block = XML_GetBuffer(builder.parser,MGL_XML_BLOCK_SIZE);
+    if (!block)
+    {
+      ok = MglFalse;
+      break;
+    }
+    size = fread(block,1,MGL_XML_BLOCK_SIZE,file);
+    if (XML_ParseBuffer(builder.parser,(int)size,size == 0) != XML_STATUS_OK)
+    {
+      ok = MglFalse;
+      break;
+    }
+  }while (size > 0);
+  fclose(file);
+  return mgl_xml_builder_finish(&builder,arena,ok,filename);
+}
+
+/*eol@eof*/
@@ -2,11 +2,21 @@
 #include "mgl_logger.h"
 #include "mgl_dict.h"
 #include <yaml.h>
+#include <stdlib.h>
 
+static MglDict *mgl_yaml_build(yaml_parser_t *parser);
 
-enum MglConfigState { KEY, VAL, SEQ };
-
-void mgl_config_parse_tier(yaml_parser_t *parser, MglDict *chain);
+/*the whole tree goes in one arena so it is freed in one go*/
+static MglDict *mgl_yaml_parse_to_arena(yaml_parser_t *parser)
+{
+  MglDictArena *arena;
+  MglDict *data;
+  arena = mgl_dict_arena_new(0);
+  mgl_dict_arena_begin(arena);
+  data = mgl_yaml_build(parser);
+  /*on error the partial tree has no root and goes with the arena*/
+  return mgl_dict_arena_end(arena,data);
+}
 
 MglDict *mgl_yaml_parse(char* filename)
 {
@@ -22,13 +32,13 @@ MglDict *mgl_yaml_parse(char* filename)
   if (!file)
   {
     mgl_logger_error("failed to open input file for parsing: %s",filename);
+    yaml_parser_delete(&parser);
     return NULL;
   }
     
   yaml_parser_set_input_file(&parser, file);
   
-  data = mgl_dict_new_hash();
-  mgl_config_parse_tier(&parser, data);
+  data = mgl_yaml_parse_to_arena(&parser);
 
   yaml_parser_delete(&parser);
   fclose(file);
@@ -36,112 +46,158 @@ MglDict *mgl_yaml_parse(char* filename)
   return data;
 }
 
-void mgl_config_parse_sequence(yaml_parser_t *parser, MglDict *chain)
+MglDict *mgl_yaml_parse_buffer(const char *buffer,size_t size)
 {
-  int done = 0;
-  MglDict *next = NULL;
-  yaml_event_t event;
-  /* First element must be a variable, or we'll change states to SEQ */
-  int state = KEY;
-  do
+  yaml_parser_t parser;
+  MglDict *data;
+  
+  if (!buffer)return NULL;
+  if(!yaml_parser_initialize(&parser))
   {
-    yaml_parser_parse(parser, &event);
-    switch(event.type)
-    {
-      case YAML_MAPPING_START_EVENT:
-        next = mgl_dict_new_hash();
-        mgl_dict_list_append(chain,next);
-        state ^= VAL;
-        mgl_config_parse_tier(parser, next);
-        break;
-      case YAML_SEQUENCE_END_EVENT:
-      case YAML_MAPPING_END_EVENT:
-      case YAML_STREAM_END_EVENT:
-        done = 1;
-        /* terminate the while loop, see below */
-        break;
-      case YAML_STREAM_START_EVENT:
-      case YAML_DOCUMENT_START_EVENT:
-        /*ignored*/
-        break;
-      default:
-        mgl_logger_info( "mgl_config: unhandled YAML event %d\n", event.type);
-    }
-    if(parser->error != YAML_NO_ERROR)
-    {
-      mgl_logger_error( "mgl_config: yaml_error_type_e %d: %s %s at (line: %lu, col: %lu)\n",
-                          parser->error, parser->context, parser->problem, parser->problem_mark.line,
-                          parser->problem_mark.column);
-                          return;
-    }
-    yaml_event_delete(&event);
-  }while (!done);
+    return NULL;
+  }
+  yaml_parser_set_input_string(&parser, (const unsigned char *)buffer, size);
+  
+  data = mgl_yaml_parse_to_arena(&parser);
+
+  yaml_parser_delete(&parser);
+  
+  return data;
 }
 
-void mgl_config_parse_tier(yaml_parser_t *parser, MglDict *chain)
+/*deeper than this is taken to be a broken or hostile file*/
+#define MGL_YAML_MAX_DEPTH 512
+
+/**
+ * @brief an open mapping or sequence while building
+ */
+typedef struct
+{
+  MglDict    *container;
+  MglDictKey  key;        /**<for mappings, the key waiting for its value*/
+}MglYamlLevel;
+
+static void mgl_yaml_log_error(yaml_parser_t *parser)
+{
+  mgl_logger_error("mgl_config: yaml_error_type_e %d: %s %s at (line: %lu, col: %lu)",
+                   parser->error,
+                   parser->context?parser->context:"",
+                   parser->problem?parser->problem:"",
+                   (unsigned long)parser->problem_mark.line + 1,
+                   (unsigned long)parser->problem_mark.column + 1);
+}
+
+/**
+ * @brief add a finished node to whatever is open
+ * @return MglFalse if there is nowhere to put it
+ */
+static MglBool mgl_yaml_attach(MglYamlLevel *levels,MglUint depth,MglDict **root,MglDict *node)
 {
-  int done = 0;
-  MglLine last_key;
-  MglDict *next = NULL;
+  MglYamlLevel *level;
+  if (depth == 0)
+  {
+    if (*root != NULL)return MglFalse;
+    *root = node;
+    return MglTrue;
+  }
+  level = &levels[depth - 1];
+  if (level->container->keyType == MGL_DICT_LIST)
+  {
+    mgl_dict_list_append(level->container,node);
+    return MglTrue;
+  }
+  mgl_dict_hash_insert_key(level->container,level->key,node);
+  level->key = NULL;
+  return MglTrue;
+}
+
+/**
+ * @brief build dict nodes straight from the parser events of the first document
+ * Scalars are kept as strings, the typed getters parse them as needed.
+ * @return NULL on error, the root of the document otherwise
+ */
+static MglDict *mgl_yaml_build(yaml_parser_t *parser)
+{
+  MglYamlLevel *levels;
+  MglYamlLevel *level;
+  MglUint depth = 0;
+  MglDict *root = NULL;
+  MglDict *node;
   yaml_event_t event;
-  /* First element must be a variable, or we'll change states to SEQ */
-  int state = KEY;
-  mgl_line_cpy(last_key,"");
-  do
+  MglBool done = MglFalse;
+  MglBool ok = MglTrue;
+  levels = malloc(sizeof(MglYamlLevel) * MGL_YAML_MAX_DEPTH);
+  if (!levels)return NULL;
+  while ((!done) && (ok))
   {
-    yaml_parser_parse(parser, &event);
+    if (!yaml_parser_parse(parser, &event))
+    {
+      mgl_yaml_log_error(parser);
+      ok = MglFalse;
+      break;
+    }
+    level = depth?&levels[depth - 1]:NULL;
     switch(event.type)
     {
       case YAML_SCALAR_EVENT:
-        if (state == KEY)
+        if ((level) && (level->container->keyType == MGL_DICT_HASH) && (level->key == NULL))
         {
           /* new key, hold on to it until we get a value as well */
-          mgl_line_cpy(last_key,(char *)event.data.scalar.value);
+          level->key = mgl_dict_key_intern((char *)event.data.scalar.value);
+          break;
         }
-        else
-        {
-          /* state is VAL or SEQ */
-          /* TODO data type logic should go here */
-          mgl_logger_info( "mgl_config: adding key -> value (%s -> %s)\n", last_key, event.data.scalar.value);
-          next = mgl_dict_new_string((char *)event.data.scalar.value);
-          mgl_dict_hash_insert(chain,last_key,next);
-        }
-        state ^= VAL; /* Toggles KEY/VAL, avoids touching SEQ */
+        node = mgl_dict_new_string((char *)event.data.scalar.value);
+        ok = mgl_yaml_attach(levels,depth,&root,node);
         break;
       case YAML_SEQUENCE_START_EVENT:
-        mgl_logger_info("mgl_config: adding sequence %s...\n",last_key);
-        next = mgl_dict_new_list();
-        mgl_dict_hash_insert(chain,last_key,
-                                 next);
-        mgl_config_parse_sequence(parser, next);
-        break;
       case YAML_MAPPING_START_EVENT:
-        if (strlen(last_key) == 0)break;/*first level is implied hash.*/
-        mgl_logger_info("mgl_config: adding hash %s...\n",last_key);
-        next = mgl_dict_new_hash();
-        mgl_dict_hash_insert(chain,last_key,next);
-        state ^= VAL;
-        mgl_config_parse_tier(parser, next);
+        if ((level) && (level->container->keyType == MGL_DICT_HASH) && (level->key == NULL))
+        {
+          mgl_logger_error("mgl_config: yaml complex keys are not supported (line: %lu)",
+                           (unsigned long)event.start_mark.line + 1);
+          ok = MglFalse;
+          break;
+        }
+        if (depth >= MGL_YAML_MAX_DEPTH)
+        {
+          mgl_logger_error("mgl_config: yaml nested too deeply (line: %lu)",
+                           (unsigned long)event.start_mark.line + 1);
+          ok = MglFalse;
+          break;
+        }
+        if (event.type == YAML_MAPPING_START_EVENT)node = mgl_dict_new_hash();
+        else node = mgl_dict_new_list();
+        ok = mgl_yaml_attach(levels,depth,&root,node);
+        levels[depth].container = node;
+        levels[depth].key = NULL;
+        depth++;
         break;
+      case YAML_SEQUENCE_END_EVENT:
       case YAML_MAPPING_END_EVENT:
+        if (depth)depth--;
+        break;
+      case YAML_ALIAS_EVENT:
+        mgl_logger_warn("mgl_config: yaml aliases are not supported, skipping *%s (line: %lu)",
+                        (char *)event.data.alias.anchor,
+                        (unsigned long)event.start_mark.line + 1);
+        if ((level) && (level->container->keyType == MGL_DICT_HASH))level->key = NULL;
+        break;
+      case YAML_DOCUMENT_END_EVENT:
       case YAML_STREAM_END_EVENT:
-      case YAML_SEQUENCE_END_EVENT:
-        done = 1;
-        /* terminate the while loop, see below */
+        /*only the first document is read*/
+        done = MglTrue;
         break;
       default:
-        mgl_logger_info("mgl_config: unhandled YAML event %d\n", event.type);
-    }
-    if(parser->error != YAML_NO_ERROR)
-    {
-      mgl_logger_info( "mgl_config: yaml_error_type_e %d: %s %s at (line: %lu, col: %lu)\n",
-                          parser->error, parser->context, parser->problem, parser->problem_mark.line,
-                          parser->problem_mark.column);
-                          return;
+        /*stream and document start*/
+        break;
     }
     yaml_event_delete(&event);
   }
-  while (!done);
+  free(levels);
+  if (!ok)return NULL;
+  /*an empty document is an empty config*/
+  if (!root)root = mgl_dict_new_hash();
+  return root;
 }
 
 /*eol@eof*/
@@ -1,15 +1,32 @@
 #include "mgl_config.h"
 #include "mgl_json_parse.h"
+#include "mgl_yaml_parse.h"
+#include "mgl_xml_parse.h"
 #include "mgl_save.h"
+#include "mgl_config_view.h"
 #include "mgl_dict.h"
 #include "mgl_logger.h"
 #include <string.h>
+#include <jansson.h>
+#include <zlib.h>
 
 /**
  * @purpose mgl_resource_test is meant to test the abstract resource manager system
  */
 
 void init_all();
+void test_scalars();
+void test_arena(int count);
+void test_containers(int count);
+void test_keys(int count);
+void test_binary(int count);
+void test_view(int count);
+void test_cache(char *filename,char *cacheDir);
+void test_stream(int rows);
+void test_xml(int rows);
+void test_fields(int count);
+void test_paths(int count);
+void test_clone(int count);
 
 int main(int argc,char *argv[])
 {
@@ -21,6 +38,78 @@ int main(int argc,char *argv[])
   {
     fprintf(stdout,"usage:\n");
     fprintf(stdout,"%s [config file]\n",argv[0]);
+    fprintf(stdout,"%s -s to check typed scalar values\n",argv[0]);
+    fprintf(stdout,"%s -a [COUNT] to compare building and freeing a tree on the heap and in an arena\n",argv[0]);
+    fprintf(stdout,"%s -l [COUNT] to check list and hash ordering and time indexed access\n",argv[0]);
+    fprintf(stdout,"%s -k [COUNT] to check a large hash and time lookups by text and by interned key\n",argv[0]);
+    fprintf(stdout,"%s -b [COUNT] to save and reload a tree as a binary config\n",argv[0]);
+    fprintf(stdout,"%s -v [COUNT] to compare loading a binary config with reading it through a view\n",argv[0]);
+    fprintf(stdout,"%s -c [config file] [CACHE DIR] to time a load through the config cache, run twice to see a cached load\n",argv[0]);
+    fprintf(stdout,"%s -t [ROWS] to time parsing a large tilemap definition from json and yaml\n",argv[0]);
+    fprintf(stdout,"%s -x [ROWS] to time parsing a large tiled xml map with csv and compressed layers\n",argv[0]);
+    fprintf(stdout,"%s -f [COUNT] to compare reading a def with per key getters and with a field table\n",argv[0]);
+    fprintf(stdout,"%s -p [COUNT] to compare deep lookups by chained getters, a compiled path and a memoized path\n",argv[0]);
+    fprintf(stdout,"%s -w [COUNT] to compare spawning from a template with deep copies and copy on write clones\n",argv[0]);
+    return 0;
+  }
+  if (strcmp(argv[1],"-s")==0)
+  {
+    test_scalars();
+    return 0;
+  }
+  if (strcmp(argv[1],"-a")==0)
+  {
+    test_arena((argc == 3)?atoi(argv[2]):10000);
+    return 0;
+  }
+  if (strcmp(argv[1],"-l")==0)
+  {
+    test_containers((argc == 3)?atoi(argv[2]):100000);
+    return 0;
+  }
+  if (strcmp(argv[1],"-k")==0)
+  {
+    test_keys((argc == 3)?atoi(argv[2]):1000);
+    return 0;
+  }
+  if (strcmp(argv[1],"-b")==0)
+  {
+    test_binary((argc == 3)?atoi(argv[2]):10000);
+    return 0;
+  }
+  if (strcmp(argv[1],"-v")==0)
+  {
+    test_view((argc == 3)?atoi(argv[2]):10000);
+    return 0;
+  }
+  if ((strcmp(argv[1],"-c")==0) && (argc >= 3))
+  {
+    test_cache(argv[2],(argc == 4)?argv[3]:"./config_cache");
+    return 0;
+  }
+  if (strcmp(argv[1],"-t")==0)
+  {
+    test_stream((argc == 3)?atoi(argv[2]):8192);
+    return 0;
+  }
+  if (strcmp(argv[1],"-x")==0)
+  {
+    test_xml((argc == 3)?atoi(argv[2]):8192);
+    return 0;
+  }
+  if (strcmp(argv[1],"-f")==0)
+  {
+    test_fields((argc == 3)?atoi(argv[2]):100000);
+    return 0;
+  }
+  if (strcmp(argv[1],"-p")==0)
+  {
+    test_paths((argc == 3)?atoi(argv[2]):1000000);
+    return 0;
+  }
+  if (strcmp(argv[1],"-w")==0)
+  {
+    test_clone((argc == 3)?atoi(argv[2]):100000);
     return 0;
   }
   mgl_logger_info("mgl_config_test begin\n");
@@ -57,6 +146,761 @@ int main(int argc,char *argv[])
 }
 
 
+/**
+ * @brief typed values read back natively, converted between types, and parsed from their text form
+ */
+void test_scalars()
+{
+  MglDict *hash,*text;
+  MglInt i = 0;
+  MglFloat f = 0;
+  MglBool b = MglFalse;
+  MglVec2D v2 = {0,0};
+  MglRect r = {0,0,0,0};
+  MglLine line;
+  char *json;
+  hash = mgl_dict_new_hash();
+  mgl_dict_hash_insert(hash,"int",mgl_dict_new_int(-42));
+  mgl_dict_hash_insert(hash,"float",mgl_dict_new_float(2.5));
+  mgl_dict_hash_insert(hash,"bool",mgl_dict_new_bool(MglTrue));
+  mgl_dict_hash_insert(hash,"vector",mgl_dict_new_vec3d(mgl_vec3d(1,2,3)));
+  mgl_dict_hash_insert(hash,"rect",mgl_dict_new_rectf(mgl_rectf(1.5,2.5,10,20)));
+  mgl_dict_get_hash_value_as_int(&i,hash,"int");
+  mgl_dict_get_hash_value_as_float(&f,hash,"float");
+  mgl_dict_get_hash_value_as_bool(&b,hash,"bool");
+  mgl_dict_get_hash_value_as_vec2d(&v2,hash,"vector");
+  mgl_dict_get_hash_value_as_rect(&r,hash,"rect");
+  fprintf(stdout,"native: %i %f %s (%f,%f) (%i,%i,%i,%i)\n",i,f,mgl_string_from_bool(b),v2.x,v2.y,r.x,r.y,r.w,r.h);
+  mgl_dict_get_hash_value_as_int(&i,hash,"float");
+  mgl_dict_get_hash_value_as_line(line,hash,"vector");
+  fprintf(stdout,"converted: float as int %i, vector as text %s\n",i,line);
+  mgl_dict_get_hash_value_as_float(&f,hash,"bool");
+  fprintf(stdout,"converted: bool as float %f, float as bool %s\n",f,
+          mgl_dict_get_hash_value_as_bool(&b,hash,"float")?"yes":"no");
+
+  text = mgl_dict_new_hash();
+  mgl_dict_hash_insert(text,"int",mgl_dict_new_string("7"));
+  mgl_dict_hash_insert(text,"vector",mgl_dict_new_string("4,5"));
+  mgl_dict_get_hash_value_as_int(&i,text,"int");
+  mgl_dict_get_hash_value_as_vec2d(&v2,text,"vector");
+  fprintf(stdout,"from text: %i (%f,%f)\n",i,v2.x,v2.y);
+
+  json = mgl_json_convert_dict_to_packed_string(hash);
+  fprintf(stdout,"json: %s\n",json);
+  if (json)free(json);
+  mgl_dict_free(&text);
+  mgl_dict_free(&hash);
+}
+
+/*a list of count objects shaped like level entities*/
+static MglDict *test_build_tree(int count)
+{
+  int i;
+  MglDict *root,*list,*item;
+  MglLine name;
+  root = mgl_dict_new_hash();
+  list = mgl_dict_new_list();
+  mgl_dict_hash_insert(root,"entities",list);
+  for (i = 0;i < count;i++)
+  {
+    snprintf(name,MGLLINELEN,"entity%i",i);
+    item = mgl_dict_new_hash();
+    mgl_dict_hash_insert(item,"name",mgl_dict_new_string(name));
+    mgl_dict_hash_insert(item,"sprite",mgl_dict_new_string("images/entity.png"));
+    mgl_dict_hash_insert(item,"position",mgl_dict_new_vec2d(mgl_vec2d(i,i * 2)));
+    mgl_dict_hash_insert(item,"frame",mgl_dict_new_int(i % 16));
+    mgl_dict_list_append(list,item);
+  }
+  return root;
+}
+
+static double test_elapsed_ms(Uint64 start)
+{
+  return (double)((SDL_GetPerformanceCounter() - start) * 1000) / SDL_GetPerformanceFrequency();
+}
+
+void test_arena(int count)
+{
+  MglDict *tree;
+  MglDictArena *arena;
+  MglInt frame = -1;
+  Uint64 start;
+  double build,teardown;
+  start = SDL_GetPerformanceCounter();
+  tree = test_build_tree(count);
+  build = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  mgl_dict_free(&tree);
+  teardown = test_elapsed_ms(start);
+  fprintf(stdout,"heap: %i entities built in %f ms, freed in %f ms\n",count,build,teardown);
+
+  start = SDL_GetPerformanceCounter();
+  arena = mgl_dict_arena_new(0);
+  mgl_dict_arena_begin(arena);
+  tree = mgl_dict_arena_end(arena,test_build_tree(count));
+  build = test_elapsed_ms(start);
+  /*a heap allocated value added afterwards is freed along with the arena*/
+  mgl_dict_hash_insert(tree,"extra",mgl_dict_new_string("outside the arena"));
+  mgl_dict_get_hash_value_as_int(&frame,mgl_dict_get_list_nth(mgl_dict_get_hash_value(tree,"entities"),count - 1),"frame");
+  start = SDL_GetPerformanceCounter();
+  mgl_dict_free(&tree);
+  teardown = test_elapsed_ms(start);
+  fprintf(stdout,"arena: %i entities built in %f ms, freed in %f ms, last frame %i\n",count,build,teardown,frame);
+}
+
+void test_containers(int count)
+{
+  MglDict *tree,*list,*hash,*value;
+  MglDictIter iter;
+  const char *key;
+  MglLine line;
+  MglInt frame,total = 0;
+  Uint64 start;
+  int i;
+  hash = mgl_dict_new_hash();
+  mgl_dict_hash_insert(hash,"zebra",mgl_dict_new_int(1));
+  mgl_dict_hash_insert(hash,"apple",mgl_dict_new_int(2));
+  mgl_dict_hash_insert(hash,"mango",mgl_dict_new_int(3));
+  mgl_dict_hash_insert(hash,"kiwi",mgl_dict_new_int(4));
+  mgl_dict_hash_remove(hash,"apple");
+  mgl_dict_hash_insert(hash,"zebra",mgl_dict_new_int(5));
+  fprintf(stdout,"hash in insertion order (expect zebra 5, mango 3, kiwi 4):");
+  mgl_dict_iter_init(&iter,hash);
+  while (mgl_dict_iter_next(&iter,&key,&value))
+  {
+    mgl_dict_get_line(line,value);
+    fprintf(stdout," %s %s,",key,line);
+  }
+  fprintf(stdout," count %i\n",mgl_dict_get_hash_count(hash));
+  mgl_dict_free(&hash);
+
+  list = mgl_dict_new_list();
+  for (i = 0;i < 5;i++)
+  {
+    mgl_dict_list_append(list,mgl_dict_new_int(i));
+  }
+  mgl_dict_list_insert(list,2,mgl_dict_new_int(9));
+  mgl_dict_list_remove_nth(list,0);
+  mgl_dict_list_move_nth_top(list,3);
+  mgl_dict_list_move_nth_bottom(list,1);
+  fprintf(stdout,"list (expect 3 9 2 4 1):");
+  for (i = 0;i < mgl_dict_get_list_count(list);i++)
+  {
+    mgl_dict_get_line(line,mgl_dict_get_list_nth(list,i));
+    fprintf(stdout," %s",line);
+  }
+  fprintf(stdout,"\n");
+  mgl_dict_free(&list);
+
+  tree = test_build_tree(count);
+  list = mgl_dict_get_hash_value(tree,"entities");
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < mgl_dict_get_list_count(list);i++)
+  {
+    frame = 0;
+    mgl_dict_get_hash_value_as_int(&frame,mgl_dict_get_list_nth(list,i),"frame");
+    mgl_dict_get_hash_nth(line,mgl_dict_get_list_nth(list,i),3);
+    total += frame;
+  }
+  fprintf(stdout,"%i entities walked by index in %f ms, frame total %i, last key %s\n",count,test_elapsed_ms(start),total,line);
+  mgl_dict_free(&tree);
+}
+
+void test_keys(int count)
+{
+  MglDict *hash,*other;
+  MglDictKey frameKey;
+  MglLine key;
+  MglInt value,errors = 0;
+  Uint64 start;
+  double byText,byKey;
+  int i,n;
+  hash = mgl_dict_new_hash();
+  for (i = 0;i < count;i++)
+  {
+    snprintf(key,MGLLINELEN,"key%i",i);
+    mgl_dict_hash_insert(hash,key,mgl_dict_new_int(i));
+  }
+  /*dropping every third key moves the rest down and reindexes*/
+  for (i = 0;i < count;i += 3)
+  {
+    snprintf(key,MGLLINELEN,"key%i",i);
+    mgl_dict_hash_remove(hash,key);
+  }
+  for (i = 0;i < count;i++)
+  {
+    snprintf(key,MGLLINELEN,"key%i",i);
+    value = -1;
+    mgl_dict_get_hash_value_as_int(&value,hash,key);
+    if (value != ((i % 3)?i:-1))errors++;
+  }
+  for (i = 0,n = 0;i < count;i++)
+  {
+    if ((i % 3) == 0)continue;
+    value = -1;
+    mgl_dict_get_value_as_int(&value,mgl_dict_get_hash_nth(key,hash,n++));
+    if (value != i)errors++;
+  }
+  fprintf(stdout,"%i keys, %i left, %i errors\n",count,mgl_dict_get_hash_count(hash),errors);
+
+  other = mgl_dict_new_hash();
+  mgl_dict_hash_insert(other,"frame",mgl_dict_new_int(3));
+  mgl_dict_hash_insert(hash,"frame",mgl_dict_new_int(4));
+  frameKey = mgl_dict_key_intern("frame");
+  mgl_dict_get_line(key,mgl_dict_get_hash_value_by_key(other,frameKey));
+  fprintf(stdout,"interned key shared: %s, value by key: %s\n",
+          mgl_string_from_bool(mgl_dict_key_intern("frame") == frameKey),key);
+
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < 1000000;i++)
+  {
+    mgl_dict_get_hash_value(hash,"frame");
+  }
+  byText = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < 1000000;i++)
+  {
+    mgl_dict_get_hash_value_by_key(hash,frameKey);
+  }
+  byKey = test_elapsed_ms(start);
+  fprintf(stdout,"1000000 lookups by text in %f ms, by interned key in %f ms\n",byText,byKey);
+  mgl_dict_free(&other);
+  mgl_dict_free(&hash);
+}
+
+void test_binary(int count)
+{
+  MglDict *tree,*loaded,*item;
+  MglVec2D position = {0};
+  MglRect rect = {0};
+  MglBool flag = MglFalse;
+  MglLine name = "";
+  Uint64 start;
+  double save,load;
+  FILE *file;
+  long size = 0;
+  tree = test_build_tree(count);
+  mgl_dict_hash_insert(tree,"bounds",mgl_dict_new_rect(mgl_rect(1,2,3,4)));
+  mgl_dict_hash_insert(tree,"visible",mgl_dict_new_bool(MglTrue));
+  start = SDL_GetPerformanceCounter();
+  mgl_save_dict_as_binary_config(tree,"./test_binary.mglbj");
+  save = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  loaded = mgl_save_binary_load_dict("./test_binary.mglbj");
+  load = test_elapsed_ms(start);
+  file = fopen("./test_binary.mglbj","rb");
+  if (file)
+  {
+    fseek(file,0,SEEK_END);
+    size = ftell(file);
+    fclose(file);
+  }
+  fprintf(stdout,"%i entities saved in %f ms, loaded in %f ms, %li bytes\n",count,save,load,size);
+  item = mgl_dict_get_list_nth(mgl_dict_get_hash_value(loaded,"entities"),count - 1);
+  mgl_dict_get_hash_value_as_line(name,item,"name");
+  mgl_dict_get_hash_value_as_vec2d(&position,item,"position");
+  mgl_dict_get_hash_value_as_rect(&rect,loaded,"bounds");
+  mgl_dict_get_hash_value_as_bool(&flag,loaded,"visible");
+  fprintf(stdout,"loaded %i entities, last %s at (%f,%f), bounds %i,%i,%i,%i, visible %s\n",
+          mgl_dict_get_list_count(mgl_dict_get_hash_value(loaded,"entities")),
+          name,position.x,position.y,rect.x,rect.y,rect.w,rect.h,mgl_string_from_bool(flag));
+  mgl_dict_free(&loaded);
+  mgl_dict_free(&tree);
+}
+
+void test_view(int count)
+{
+  MglDict *tree,*copy;
+  MglConfigView *view;
+  MglConfigValue entities,item;
+  MglVec2D position = {0};
+  MglInt frame = -1;
+  MglLine name = "";
+  Uint64 start;
+  double load,open;
+  tree = test_build_tree(count);
+  mgl_save_dict_as_binary_config(tree,"./test_view.mglbj");
+  mgl_dict_free(&tree);
+
+  start = SDL_GetPerformanceCounter();
+  tree = mgl_save_binary_load_dict("./test_view.mglbj");
+  mgl_dict_get_hash_value_as_int(&frame,mgl_dict_get_list_nth(mgl_dict_get_hash_value(tree,"entities"),count / 2),"frame");
+  load = test_elapsed_ms(start);
+  mgl_dict_free(&tree);
+
+  start = SDL_GetPerformanceCounter();
+  view = mgl_config_view_open("./test_view.mglbj");
+  entities = mgl_config_value_get_hash_value(mgl_config_view_get_root(view),"entities");
+  item = mgl_config_value_get_list_nth(entities,count / 2);
+  mgl_config_value_get_hash_value_as_int(&frame,item,"frame");
+  open = test_elapsed_ms(start);
+  fprintf(stdout,"%i entities: loading a dict took %f ms, opening a view took %f ms\n",count,load,open);
+
+  mgl_config_value_get_hash_value_as_line(name,item,"name");
+  mgl_config_value_get_hash_value_as_vec2d(&position,item,"position");
+  fprintf(stdout,"view: %i entities, %s at (%f,%f) frame %i, missing key found: %s\n",
+          mgl_config_value_get_count(entities),name,position.x,position.y,frame,
+          mgl_string_from_bool(mgl_config_value_get_type(mgl_config_value_get_hash_value(item,"missing")) != MGL_DICT_VOID));
+  copy = mgl_config_value_to_dict(item);
+  mgl_dict_print(copy);
+  mgl_dict_free(&copy);
+  mgl_config_view_close(&view);
+}
+
+void test_cache(char *filename,char *cacheDir)
+{
+  MglConfig *config;
+  Uint64 start;
+  double load;
+  mgl_config_init();
+  mgl_config_set_cache_dir(cacheDir);
+  start = SDL_GetPerformanceCounter();
+  config = mgl_config_load(filename);
+  load = test_elapsed_ms(start);
+  if (!config)
+  {
+    fprintf(stdout,"failed to load config file %s\n",filename);
+    return;
+  }
+  fprintf(stdout,"loaded %s in %f ms, %i top level keys\n",filename,load,mgl_dict_get_hash_count(mgl_config_get_dictionary(config)));
+  mgl_config_free(&config);
+}
+
+/**
+ * @brief write a tilemap definition of the given size in the layout mgl_tilemap reads
+ * @param yaml write yaml instead of json
+ * @return the text, free() it
+ */
+static char *test_tilemap_text(int rows,int width,MglBool yaml,size_t *size)
+{
+  char *text;
+  size_t capacity,length = 0;
+  int i,j;
+  capacity = 256 + (size_t)rows * (width * 4 + 32);
+  text = malloc(capacity);
+  if (!text)return NULL;
+  if (yaml)length += sprintf(&text[length],"tilemap:\n  tileSet: tileset.def\n  mapWidth: %i\n  mapHeight: %i\n  tileMap:\n",width,rows);
+  else length += sprintf(&text[length],"{\n    \"tilemap\":\n    {\n        \"tileSet\": \"tileset.def\",\n        \"mapWidth\": %i,\n        \"mapHeight\": %i,\n        \"tileMap\":\n        [\n",width,rows);
+  for (j = 0;j < rows;j++)
+  {
+    length += sprintf(&text[length],yaml?"    - row: \"":"            {\"row\": \"");
+    for (i = 0;i < width;i++)
+    {
+      length += sprintf(&text[length],(i + 1 < width)?"%i,":"%i",(i * 7 + j) % 9);
+    }
+    if (yaml)length += sprintf(&text[length],"\"\n");
+    else length += sprintf(&text[length],(j + 1 < rows)?"\"},\n":"\"}\n");
+  }
+  if (!yaml)length += sprintf(&text[length],"        ]\n    }\n}\n");
+  *size = length;
+  return text;
+}
+
+void test_stream(int rows)
+{
+  MglDict *def,*map;
+  MglUint width = 0,height = 0;
+  MglLine row = "";
+  json_t *json;
+  json_error_t jer;
+  char *text;
+  size_t size;
+  Uint64 start;
+  double parse;
+  text = test_tilemap_text(rows,256,MglFalse,&size);
+  if (!text)return;
+
+  /*what the old path paid before it even started converting to dicts*/
+  start = SDL_GetPerformanceCounter();
+  json = json_loadb(text,size,0,&jer);
+  json_decref(json);
+  parse = test_elapsed_ms(start);
+  fprintf(stdout,"%i rows, %lu bytes of json: jansson tree alone took %f ms\n",rows,(unsigned long)size,parse);
+
+  start = SDL_GetPerformanceCounter();
+  def = mgl_json_parse_buffer(text,size);
+  parse = test_elapsed_ms(start);
+  map = mgl_dict_get_hash_value(def,"tilemap");
+  mgl_dict_get_hash_value_as_uint(&width,map,"mapWidth");
+  mgl_dict_get_hash_value_as_uint(&height,map,"mapHeight");
+  mgl_dict_get_line(row,mgl_dict_get_hash_value(mgl_dict_get_list_nth(mgl_dict_get_hash_value(map,"tileMap"),rows - 1),"row"));
+  fprintf(stdout,"json streamed into dicts in %f ms: %u x %u, last row starts %.16s\n",parse,width,height,row);
+  mgl_dict_free(&def);
+
+  /*a cut off file is an error and leaves nothing behind*/
+  def = mgl_json_parse_buffer(text,size / 2);
+  fprintf(stdout,"truncated json rejected: %s\n",mgl_string_from_bool(def == NULL));
+  mgl_dict_free(&def);
+  free(text);
+
+  def = mgl_json_parse_string("{\"name\": \"tab\\there \\u00e9\\ud83d\\ude00\", \"list\": [1, -2.5e1, true, null, [\"nested\"]]}");
+  mgl_dict_print(def);
+  mgl_dict_free(&def);
+
+  text = test_tilemap_text(rows,256,MglTrue,&size);
+  if (!text)return;
+  width = height = 0;
+  start = SDL_GetPerformanceCounter();
+  def = mgl_yaml_parse_buffer(text,size);
+  parse = test_elapsed_ms(start);
+  map = mgl_dict_get_hash_value(def,"tilemap");
+  mgl_dict_get_hash_value_as_uint(&width,map,"mapWidth");
+  mgl_dict_get_hash_value_as_uint(&height,map,"mapHeight");
+  fprintf(stdout,"%lu bytes of yaml streamed into dicts in %f ms: %u x %u, %u rows\n",(unsigned long)size,parse,width,height,
+          mgl_dict_get_list_count(mgl_dict_get_hash_value(map,"tileMap")));
+  mgl_dict_free(&def);
+  free(text);
+
+  /*scalars in sequences and nested sequences are kept*/
+  text = "list:\n  - 1\n  - [2, 3]\n  - key: value\n";
+  def = mgl_yaml_parse_buffer(text,strlen(text));
+  mgl_dict_print(def);
+  mgl_dict_free(&def);
+}
+
+static size_t test_base64(char *out,const unsigned char *data,size_t size)
+{
+  static const char *digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  size_t i,length = 0;
+  unsigned int bits;
+  for (i = 0;i < size;i += 3)
+  {
+    bits = data[i] << 16;
+    if (i + 1 < size)bits |= data[i + 1] << 8;
+    if (i + 2 < size)bits |= data[i + 2];
+    out[length++] = digits[(bits >> 18) & 63];
+    out[length++] = digits[(bits >> 12) & 63];
+    out[length++] = (i + 1 < size)?digits[(bits >> 6) & 63]:'=';
+    out[length++] = (i + 2 < size)?digits[bits & 63]:'=';
+  }
+  return length;
+}
+
+void test_xml(int rows)
+{
+  MglDict *map,*layers,*csv,*zlib;
+  MglUint width = 256,i,count,tile = 0,mismatch = 0,csvCount,zlibCount;
+  const MglUI32 *csvTiles,*zlibTiles;
+  unsigned char *raw,*packed;
+  uLongf packedSize;
+  char *text;
+  size_t size = 0;
+  Uint64 start;
+  double parse;
+  const char *document = "<?xml version=\"1.0\"?>\n<map width=\"2\" height=\"2\">\n"
+    " <properties><property name=\"music\" value=\"town.ogg\"/></properties>\n"
+    " <layer name=\"ground\"><data encoding=\"csv\">1,2,\n3,2147483649</data></layer>\n"
+    " <layer name=\"infinite\"><data encoding=\"csv\"><chunk x=\"0\" y=\"0\">4,5</chunk><chunk x=\"16\" y=\"0\">6</chunk></data></layer>\n"
+    " <objectgroup><object id=\"1\"><text>Hello &amp; welcome</text></object></objectgroup>\n</map>\n";
+
+  map = mgl_xml_parse_buffer(document,strlen(document));
+  mgl_dict_print(map);
+  mgl_dict_free(&map);
+
+  count = rows * width;
+  raw = malloc(count * 4);
+  packedSize = compressBound(count * 4);
+  packed = malloc(packedSize);
+  text = malloc(256 + count * 12 + packedSize * 2);
+  if ((!raw) || (!packed) || (!text))
+  {
+    free(raw);
+    free(packed);
+    free(text);
+    return;
+  }
+  size += sprintf(&text[size],"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<map version=\"1.10\" orientation=\"orthogonal\" width=\"%u\" height=\"%i\" tilewidth=\"32\" tileheight=\"32\">\n",width,rows);
+  size += sprintf(&text[size]," <tileset firstgid=\"1\" source=\"tileset.tsx\"/>\n <layer id=\"1\" name=\"csv\" width=\"%u\" height=\"%i\">\n  <data encoding=\"csv\">\n",width,rows);
+  for (i = 0;i < count;i++)
+  {
+    tile = (i * 7 + i / width) % 9;
+    raw[i * 4] = tile;
+    raw[i * 4 + 1] = raw[i * 4 + 2] = raw[i * 4 + 3] = 0;
+    size += sprintf(&text[size],(i + 1 < count)?(((i + 1) % width)?"%u,":"%u,\n"):"%u\n",tile);
+  }
+  compress2(packed,&packedSize,raw,count * 4,Z_DEFAULT_COMPRESSION);
+  size += sprintf(&text[size],"</data>\n </layer>\n <layer id=\"2\" name=\"zlib\" width=\"%u\" height=\"%i\">\n  <data encoding=\"base64\" compression=\"zlib\">\n   ",width,rows);
+  size += test_base64(&text[size],packed,packedSize);
+  size += sprintf(&text[size],"\n  </data>\n </layer>\n</map>\n");
+
+  start = SDL_GetPerformanceCounter();
+  map = mgl_xml_parse_buffer(text,size);
+  parse = test_elapsed_ms(start);
+  layers = mgl_dict_get_hash_value(mgl_dict_get_hash_value(map,"map"),"layer");
+  csv = mgl_dict_get_hash_value(mgl_dict_get_hash_value(mgl_dict_get_list_nth(layers,0),"data"),"tiles");
+  zlib = mgl_dict_get_hash_value(mgl_dict_get_hash_value(mgl_dict_get_list_nth(layers,1),"data"),"tiles");
+  csvTiles = mgl_dict_get_ui32_array(csv,&csvCount);
+  zlibTiles = mgl_dict_get_ui32_array(zlib,&zlibCount);
+  if ((csvCount != count) || (zlibCount != count))mismatch++;
+  for (i = 0;(i < csvCount) && (i < zlibCount);i++)
+  {
+    if (csvTiles[i] != raw[i * 4])mismatch++;
+    if (zlibTiles[i] != raw[i * 4])mismatch++;
+  }
+  fprintf(stdout,"%i rows, %lu bytes of xml (%lu compressed) parsed in %f ms: %u layers, %u tiles each, %u mismatches\n",
+          rows,(unsigned long)size,(unsigned long)packedSize,parse,mgl_dict_get_list_count(layers),
+          zlibCount,mismatch);
+  mgl_dict_free(&map);
+
+  /*a cut off file is an error and leaves nothing behind*/
+  map = mgl_xml_parse_buffer(text,size - size / 4);
+  fprintf(stdout,"truncated xml rejected: %s\n",mgl_string_from_bool(map == NULL));
+  mgl_dict_free(&map);
+  free(raw);
+  free(packed);
+  free(text);
+}
+
+typedef struct
+{
+  MglLine  image;
+  MglBool  solid;
+  MglUint  frame;
+  MglVec2D scale;
+  MglVec2D footprint;
+  MglVec4D color;
+  MglRect  bounds;
+  MglDict *info;
+}TestTileDef;
+
+/*the bit mgl_dict_decode_hash sets for each field, so checks do not depend on the table order*/
+typedef enum
+{
+  TestTileImage,
+  TestTileSolid,
+  TestTileFrame,
+  TestTileScale,
+  TestTileFootprint,
+  TestTileColor,
+  TestTileBounds,
+  TestTileInfo,
+  TestTileFieldCount
+}TestTileField;
+
+static MglDictField test_tile_fields[TestTileFieldCount] =
+{
+  [TestTileImage] = mgl_dict_field(TestTileDef,image,"image",MGL_DICT_STRING),
+  [TestTileSolid] = mgl_dict_field(TestTileDef,solid,"solid",MGL_DICT_BOOL),
+  [TestTileFrame] = mgl_dict_field(TestTileDef,frame,"frame",MGL_DICT_UINT),
+  [TestTileScale] = mgl_dict_field_default(TestTileDef,scale,"scale",MGL_DICT_VEC2D,{.v2 = {1,1}}),
+  [TestTileFootprint] = mgl_dict_field_default(TestTileDef,footprint,"footprint",MGL_DICT_VEC2D,{.v2 = {1,1}}),
+  [TestTileColor] = mgl_dict_field_default(TestTileDef,color,"color",MGL_DICT_VEC4D,{.v4 = {255,255,255,255}}),
+  [TestTileBounds] = mgl_dict_field(TestTileDef,bounds,"bounds",MGL_DICT_RECT),
+  [TestTileInfo] = mgl_dict_field(TestTileDef,info,"info",MGL_DICT_HASH)
+};
+
+void test_fields(int count)
+{
+  MglDict *def;
+  TestTileDef tile;
+  MglUI64 found = 0;
+  Uint64 start;
+  double getters,table;
+  int i;
+  def = mgl_json_parse_string("{\"image\": \"tile05.png\", \"solid\": \"true\", \"frame\": 3, \"scale\": \"0.25,0.25\","
+                              " \"color\": \"255,128,64,255\", \"bounds\": \"0,0,32,32\", \"info\": {\"customData\": \"anything\"}}");
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)
+  {
+    memset(&tile,0,sizeof(TestTileDef));
+    mgl_dict_get_hash_value_as_line(tile.image,def,"image");
+    mgl_dict_get_hash_value_as_bool(&tile.solid,def,"solid");
+    mgl_dict_get_hash_value_as_uint(&tile.frame,def,"frame");
+    if (!mgl_dict_get_hash_value_as_vec2d(&tile.scale,def,"scale"))tile.scale = mgl_vec2d(1,1);
+    if (!mgl_dict_get_hash_value_as_vec2d(&tile.footprint,def,"footprint"))tile.footprint = mgl_vec2d(1,1);
+    if (!mgl_dict_get_hash_value_as_vec4d(&tile.color,def,"color"))tile.color = mgl_vec4d(255,255,255,255);
+    mgl_dict_get_hash_value_as_rect(&tile.bounds,def,"bounds");
+    tile.info = mgl_dict_get_hash_value(def,"info");
+  }
+  getters = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)
+  {
+    found = mgl_dict_decode_hash(&tile,def,test_tile_fields,TestTileFieldCount);
+  }
+  table = test_elapsed_ms(start);
+  fprintf(stdout,"%i tile defs: getters took %f ms, the field table took %f ms\n",count,getters,table);
+  fprintf(stdout,"image %s solid %s frame %u scale %f,%f footprint %f,%f color %f,%f,%f,%f bounds %i,%i,%i,%i info %s, footprint found %s\n",
+          tile.image,mgl_string_from_bool(tile.solid),tile.frame,tile.scale.x,tile.scale.y,tile.footprint.x,tile.footprint.y,
+          tile.color.x,tile.color.y,tile.color.z,tile.color.w,tile.bounds.x,tile.bounds.y,tile.bounds.w,tile.bounds.h,
+          mgl_string_from_bool(tile.info != NULL),mgl_string_from_bool(mgl_dict_field_found(found,TestTileFootprint)));
+  mgl_dict_free(&def);
+}
+
+/*a level with a few layers, each naming its tileset*/
+static char *test_level_text(int layers)
+{
+  char *text;
+  size_t size,used = 0;
+  int i;
+  size = 128 + layers * 160;
+  text = (char *)malloc(size);
+  if (!text)return NULL;
+  used += snprintf(text + used,size - used,"{\"name\": \"level\", \"layers\": [");
+  for (i = 0;i < layers;i++)
+  {
+    used += snprintf(text + used,size - used,"%s{\"name\": \"layer%i\", \"tileset\": {\"image\": \"tiles%i.png\", \"tileSize\": \"%i,%i\"}}",
+                     i?", ":"",i,i,16 * (i + 1),16 * (i + 1));
+  }
+  snprintf(text + used,size - used,"]}");
+  return text;
+}
+
+void test_paths(int count)
+{
+  MglDict *level,*result = NULL,*layer;
+  MglDictPath *path,*memo,*last;
+  MglVec2D size = {0,0};
+  Uint64 start;
+  double getters,compiled,memoized;
+  char *text;
+  int i;
+  text = test_level_text(8);
+  level = mgl_json_parse_string(text);
+  free(text);
+  if (!level)return;
+  path = mgl_dict_path_new("layers/3/tileset/tileSize",MglFalse);
+  memo = mgl_dict_path_new("/layers/3/tileset/tileSize",MglTrue);
+  last = mgl_dict_path_new("layers/-1/tileset/tileSize",MglTrue);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)
+  {
+    result = mgl_dict_get_hash_value(mgl_dict_get_hash_value(mgl_dict_get_list_nth(mgl_dict_get_hash_value(level,"layers"),3),"tileset"),"tileSize");
+  }
+  getters = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)
+  {
+    result = mgl_dict_path_get(path,level);
+  }
+  compiled = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)
+  {
+    result = mgl_dict_path_get(memo,level);
+  }
+  memoized = test_elapsed_ms(start);
+  fprintf(stdout,"%i lookups: chained getters took %f ms, the compiled path %f ms, the memoized path %f ms\n",count,getters,compiled,memoized);
+  mgl_dict_get_value_as_vec2d(&size,result);
+  fprintf(stdout,"layers/3/tileset/tileSize: %f,%f, all agree: %s, one shot agrees: %s\n",size.x,size.y,
+          mgl_string_from_bool((result == mgl_dict_path_get(path,level)) && (result == mgl_dict_path_get(memo,level))),
+          mgl_string_from_bool(result == mgl_dict_get_path(level,"layers/3/tileset/tileSize")));
+  fprintf(stdout,"missing paths: %s %s %s\n",
+          mgl_string_from_bool(mgl_dict_get_path(level,"layers/8/tileset") == NULL),
+          mgl_string_from_bool(mgl_dict_get_path(level,"layers/tileset") == NULL),
+          mgl_string_from_bool(mgl_dict_get_path(level,"name/0") == NULL));
+
+  /*changing the tree has to forget what the memo found*/
+  mgl_dict_get_value_as_vec2d(&size,mgl_dict_path_get(last,level));
+  fprintf(stdout,"last layer tileSize before: %f,%f\n",size.x,size.y);
+  layer = mgl_dict_new_hash();
+  mgl_dict_hash_insert(layer,"tileset",mgl_dict_new_hash());
+  mgl_dict_hash_insert(mgl_dict_get_hash_value(layer,"tileset"),"tileSize",mgl_dict_new_vec2d(mgl_vec2d(64,64)));
+  mgl_dict_list_append(mgl_dict_get_hash_value(level,"layers"),layer);
+  mgl_dict_get_value_as_vec2d(&size,mgl_dict_path_get(last,level));
+  fprintf(stdout,"last layer tileSize after append: %f,%f\n",size.x,size.y);
+  mgl_dict_list_remove_nth(mgl_dict_get_hash_value(level,"layers"),3);
+  mgl_dict_get_value_as_vec2d(&size,mgl_dict_path_get(memo,level));
+  fprintf(stdout,"layer 3 tileSize after removing it: %f,%f, matches a walk: %s\n",size.x,size.y,
+          mgl_string_from_bool(mgl_dict_path_get(memo,level) == mgl_dict_path_get(path,level)));
+  mgl_dict_path_free(&path);
+  mgl_dict_path_free(&memo);
+  mgl_dict_path_free(&last);
+  mgl_dict_free(&level);
+}
+
+/*what mgl_dict_clone used to do, every container and string copied*/
+static MglDict *test_deep_copy(MglDict *src)
+{
+  MglDictIter iter;
+  MglDict *copy,*value;
+  const char *key;
+  if (!src)return NULL;
+  if ((src->keyType != MGL_DICT_LIST) && (src->keyType != MGL_DICT_HASH))return src->keyClone(src);
+  copy = (src->keyType == MGL_DICT_LIST)?mgl_dict_new_list():mgl_dict_new_hash();
+  mgl_dict_iter_init(&iter,src);
+  while (mgl_dict_iter_next(&iter,&key,&value))
+  {
+    if (key)mgl_dict_hash_insert(copy,(char *)key,test_deep_copy(value));
+    else mgl_dict_list_append(copy,test_deep_copy(value));
+  }
+  return copy;
+}
+
+static MglBool test_same_json(MglDict *a,MglDict *b)
+{
+  char *ja,*jb;
+  MglBool same;
+  ja = mgl_json_convert_dict_to_packed_string(a);
+  jb = mgl_json_convert_dict_to_packed_string(b);
+  same = (ja != NULL) && (jb != NULL) && (strcmp(ja,jb) == 0);
+  if (ja)free(ja);
+  if (jb)free(jb);
+  return same;
+}
+
+void test_clone(int count)
+{
+  MglDict *template,*expected,*clone,*stats,*held;
+  MglDict **clones;
+  Uint64 start;
+  double deep,shared,written;
+  MglInt health = 0;
+  int i;
+  template = mgl_json_parse_string("{\"name\": \"goblin\", \"sprite\": \"images/goblin.png\", \"frameSize\": \"32,32\","
+                                   " \"stats\": {\"health\": 10, \"speed\": 2.5, \"armor\": 1},"
+                                   " \"inventory\": [\"club\", \"rags\", {\"item\": \"coin\", \"count\": 3}],"
+                                   " \"ai\": {\"state\": \"idle\", \"sight\": 128, \"waypoints\": [\"0,0\", \"32,0\", \"32,32\", \"0,32\"]},"
+                                   " \"sounds\": {\"hurt\": \"sounds/hurt.wav\", \"die\": \"sounds/die.wav\", \"attack\": \"sounds/swing.wav\"}}");
+  if (!template)return;
+  expected = test_deep_copy(template);
+  clones = (MglDict **)malloc(sizeof(MglDict *) * count);
+  if (!clones)return;
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)clones[i] = test_deep_copy(template);
+  for (i = 0;i < count;i++)mgl_dict_free(&clones[i]);
+  deep = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)clones[i] = mgl_dict_clone(template);
+  for (i = 0;i < count;i++)mgl_dict_free(&clones[i]);
+  shared = test_elapsed_ms(start);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < count;i++)
+  {
+    clones[i] = mgl_dict_clone(template);
+    mgl_dict_hash_insert(mgl_dict_get_hash_value(clones[i],"stats"),"health",mgl_dict_new_int(i));
+  }
+  for (i = 0;i < count;i++)mgl_dict_free(&clones[i]);
+  written = test_elapsed_ms(start);
+  fprintf(stdout,"%i spawns: deep copies took %f ms, clones %f ms, clones changing stats/health %f ms\n",count,deep,shared,written);
+
+  /*changes on either side stay on that side*/
+  clone = mgl_dict_clone(template);
+  mgl_dict_hash_insert(mgl_dict_get_hash_value(clone,"stats"),"health",mgl_dict_new_int(99));
+  mgl_dict_list_append(mgl_dict_get_hash_value(clone,"inventory"),mgl_dict_new_string("key"));
+  fprintf(stdout,"template untouched by clone changes: %s\n",mgl_string_from_bool(test_same_json(template,expected)));
+  mgl_dict_free(&clone);
+  /*including changes made through children handed out before the clone*/
+  held = mgl_dict_get_hash_value(template,"ai");
+  clone = mgl_dict_clone(template);
+  mgl_dict_hash_insert(held,"state",mgl_dict_new_string("hunting"));
+  mgl_dict_list_append(mgl_dict_get_hash_value(held,"waypoints"),mgl_dict_new_string("64,64"));
+  mgl_dict_hash_remove(template,"sounds");
+  fprintf(stdout,"clone untouched by template changes: %s\n",mgl_string_from_bool(test_same_json(clone,expected)));
+  mgl_dict_hash_insert(held,"state",mgl_dict_new_string("idle"));
+  fprintf(stdout,"handed out dicts stay with the template: %s\n",
+          mgl_string_from_bool(held == mgl_dict_get_hash_value(template,"ai")));
+
+  /*the template's arena lives on while the clone shares it*/
+  mgl_dict_free(&template);
+  stats = mgl_dict_get_hash_value(clone,"stats");
+  mgl_dict_get_hash_value_as_int(&health,stats,"health");
+  fprintf(stdout,"clone after the template is freed: health %i, matches: %s\n",health,mgl_string_from_bool(test_same_json(clone,expected)));
+  mgl_dict_free(&clone);
+  mgl_dict_free(&expected);
+  free(clones);
+}
+
 void init_all()
 {
   mgl_logger_init();
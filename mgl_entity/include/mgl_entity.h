@@ -54,6 +54,20 @@ MglEntity *mgl_entity_new();
  */
 MglBool mgl_entity_validate(void *data);
 
+/**
+ * @brief get a handle to keep in place of an entity pointer.  It stops resolving once the entity is freed
+ * @param ent the entity to get a handle for
+ * @return the handle or 0 on error
+ */
+MglUint mgl_entity_get_handle(MglEntity *ent);
+
+/**
+ * @brief resolve an entity handle.  This is cheap enough to do every frame
+ * @param handle a handle from mgl_entity_get_handle
+ * @return the entity or NULL if it has since been freed
+ */
+MglEntity *mgl_entity_get_by_handle(MglUint handle);
+
 /**
  * @brief register the entity callback functions for a draw list level layer
  * @param level the level to register for
@@ -107,6 +121,7 @@ MglDict * mgl_entity_get_custom_dict(MglEntity *ent);
 /**
  * @brief copy the dictionary data to the entity
  * NOTE: The data is copied from the dictionary provided, so feel free to clean that up as needed
+ * The copy shares the template's strings and numbers and only copies the lists and hashes, so spawning many entities from one template is cheap
  * @param ent the entity to add data to
  * @param dict the data definition dictionary to copy the data from
  */
@@ -5,6 +5,9 @@
 #include "mgl_level.h"
 #include <chipmunk/chipmunk.h>
 
+/*entities are allocated this many at a time, up to maxEntities*/
+#define MGL_ENTITY_SLAB_SIZE 128
+
 static MglResourceManager * __mgl_entity_resource_manager = NULL;
 static MglBool              __mgl_entity_use_custom_data = MglFalse;
 static MglCallback          __mgl_entity_custom_delete = {NULL,NULL};
@@ -28,8 +31,9 @@ void mgl_entity_init(
                    )
 {
     if (!useCustomData)customDataSize = 0;
-    __mgl_entity_resource_manager = mgl_resource_manager_init(
+    __mgl_entity_resource_manager = mgl_resource_manager_init_growable(
         "mgl entity",
+        MIN(maxEntities,MGL_ENTITY_SLAB_SIZE),
         maxEntities,
         sizeof(struct MglEntity_S) + customDataSize,
         MglTrue,
@@ -225,17 +229,16 @@ void mgl_entity_update(MglEntity *ent)
     }
 }
 
+static void mgl_entity_update_callback(void *data,void *context)
+{
+    mgl_entity_update((MglEntity *)context);
+}
+
 void mgl_entity_update_all()
 {
-    MglEntity *ent;
-    for (
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,NULL);
-        ent != NULL;
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,ent)
-    )
-    {
-        mgl_entity_update(ent);
-    }
+    mgl_resource_manager_foreach(
+        __mgl_entity_resource_manager,
+        mgl_callback(mgl_entity_update_callback,NULL));
 }
 
 MglBool mgl_entity_validate(void *data)
@@ -247,6 +250,16 @@ MglBool mgl_entity_validate(void *data)
     return MglTrue;
 }
 
+MglUint mgl_entity_get_handle(MglEntity *ent)
+{
+    return mgl_resource_element_get_handle(__mgl_entity_resource_manager,ent);
+}
+
+MglEntity *mgl_entity_get_by_handle(MglUint handle)
+{
+    return (MglEntity *)mgl_resource_get_data_by_handle(__mgl_entity_resource_manager,handle);
+}
+
 void mgl_entity_update_layer_entities(void *data,void *context)
 {
     MglLayer *layer;
@@ -441,17 +454,16 @@ void mgl_entity_think(MglEntity *ent)
     }
 }
 
+static void mgl_entity_think_callback(void *data,void *context)
+{
+    mgl_entity_think((MglEntity *)context);
+}
+
 void mgl_entity_think_all()
 {
-    MglEntity *ent = NULL;
-    for (
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,NULL);
-        ent != NULL;
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,ent)
-    )
-    {
-        mgl_entity_think(ent);
-    }
+    mgl_resource_manager_foreach(
+        __mgl_entity_resource_manager,
+        mgl_callback(mgl_entity_think_callback,NULL));
 }
 
 void mgl_entity_pre_physics(MglEntity *ent)
@@ -466,17 +478,16 @@ void mgl_entity_pre_physics(MglEntity *ent)
     }
 }
 
+static void mgl_entity_pre_physics_callback(void *data,void *context)
+{
+    mgl_entity_pre_physics((MglEntity *)context);
+}
+
 void mgl_entity_pre_physics_all()
 {
-    MglEntity *ent;
-    for (
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,NULL);
-        ent != NULL;
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,ent)
-    )
-    {
-        mgl_entity_pre_physics(ent);
-    }
+    mgl_resource_manager_foreach(
+        __mgl_entity_resource_manager,
+        mgl_callback(mgl_entity_pre_physics_callback,NULL));
 }
 
 void mgl_entity_post_physics(MglEntity *ent)
@@ -494,17 +505,16 @@ void mgl_entity_post_physics(MglEntity *ent)
     }
 }
 
+static void mgl_entity_post_physics_callback(void *data,void *context)
+{
+    mgl_entity_post_physics((MglEntity *)context);
+}
+
 void mgl_entity_post_physics_all()
 {
-    MglEntity *ent;
-    for (
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,NULL);
-        ent != NULL;
-        ent = mgl_resource_get_next_data(__mgl_entity_resource_manager,ent)
-    )
-    {
-        mgl_entity_post_physics(ent);
-    }
+    mgl_resource_manager_foreach(
+        __mgl_entity_resource_manager,
+        mgl_callback(mgl_entity_post_physics_callback,NULL));
 }
 
 void mgl_entity_assign_tilemap(MglEntity *ent,MglTileMap *map)
@@ -23,6 +23,7 @@
 
 #include "mgl_types.h"
 #include "mgl_vector.h"
+#include "mgl_callback.h"
 
 typedef enum {
     MglSpriteSurface = 1,
@@ -65,6 +66,7 @@ MglSprite *mgl_sprite_load_image(char *imageFile);
 
 /**
  * @brief loads a sprite based on the parameters specified
+ * If the same sprite is still loading asynchronously, this waits for its image.
  * @param filename the name of the image file to load as a sprite
  * @param frameWidth the width of a frame in pixels
  * @param frameHeight the height of a frame in pixels
@@ -85,6 +87,31 @@ MglSprite *mgl_sprite_load_from_image(
     MglVec4D *blueSwap,
     MglVec4D *colorKey);
 
+/**
+ * @brief starts loading a sprite in the background.  The image file is read on a loader thread
+ * and the sprite is finished by mgl_resource_async_update on the main thread.
+ * Parameters match mgl_sprite_load_from_image.
+ * @param onLoaded optional, called with the sprite as context once loading completes
+ * @return NULL on error, or a sprite pointer that must not be drawn until mgl_sprite_is_loaded returns true
+ */
+MglSprite *mgl_sprite_load_from_image_async(
+    char *filename,
+    MglInt frameWidth,
+    MglInt frameHeight,
+    MglUint framesPerLine,
+    MglVec4D *redSwap,
+    MglVec4D *greenSwap,
+    MglVec4D *blueSwap,
+    MglVec4D *colorKey,
+    MglCallback *onLoaded);
+
+/**
+ * @brief check if a sprite has finished loading
+ * @param sprite the sprite to check
+ * @return MglTrue if the sprite is ready to draw, MglFalse if still loading or failed
+ */
+MglBool mgl_sprite_is_loaded(MglSprite *sprite);
+
 /**
  * @brief frees a sprite no longer in use.  Sets your pointer to it to NULL.
  * Frequently accessed sprites are kept in memory for speed of loading
@@ -160,6 +187,7 @@ void mgl_sprite_draw_to_surface(
 
 /**
  * @brief get a sprite's frame width and height
+ * @note both are 0 while an asynchronously loaded sprite's image is still pending
  * @param sprite the sprite to check
  * @param w [output] optional if provided this will be populated with the sprite's width
  * @param h [output] optional if provided this will be populated with the sprite's height
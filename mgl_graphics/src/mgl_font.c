@@ -3,6 +3,7 @@
 #include "mgl_text.h"
 #include "mgl_graphics.h"
 #include "mgl_resource.h"
+#include "mgl_pack.h"
 #include "mgl_logger.h"
 #include <SDL.h>
 #include <SDL_ttf.h>
@@ -68,6 +69,8 @@ MglBool mgl_font_load_resource(char *filename,void *data)
     MglFont *font;
     MglLine fname;
     MglUint pointSize;
+    SDL_RWops *rw;
+    Sint64 size;
     char ** strings;
     if (!data)return MglFalse;
     font = (MglFont *)data;
@@ -77,13 +80,18 @@ MglBool mgl_font_load_resource(char *filename,void *data)
     mgl_line_cpy(fname,strings[0]);
     pointSize = atoi(strings[1]);
     g_strfreev (strings);
-    font->font = TTF_OpenFont(fname, pointSize);
+    rw = mgl_pack_open_rw(fname);
+    if (!rw)return MglFalse;
+    size = SDL_RWsize(rw);
+    font->font = TTF_OpenFontRW(rw, 1, pointSize);
     if (!font->font)
     {
         mgl_logger_error("failed to load font: %s, re: %s",fname,SDL_GetError());
         return MglFalse;
     }
     font->pointSize = pointSize;
+    /*the glyph cache is not exposed, so the font file size stands in for it*/
+    mgl_resource_element_set_size(__mgl_font_resource_manager,font,size > 0 ? (size_t)size : 0);
     return MglTrue;
 }
 
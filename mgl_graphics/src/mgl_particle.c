@@ -3,6 +3,9 @@
 #include "mgl_draw.h"
 #include "mgl_resource.h"
 
+/*particles are allocated this many at a time, up to maxParticles*/
+#define MGL_PARTICLE_SLAB_SIZE 512
+
 static MglVec2D __mgl_particle_scale = {0,0};
 static MglResourceManager * __mgl_particle_resource_manager = NULL;
 static MglParticleZHandler __mgl_particle_z_strategy = MglParticleZNone;
@@ -17,8 +20,9 @@ void mgl_particle_init(
     MglVec2D *scale
 )
 {
-    __mgl_particle_resource_manager = mgl_resource_manager_init(
+    __mgl_particle_resource_manager = mgl_resource_manager_init_growable(
         "mgl particle",
+        MIN(maxParticles,MGL_PARTICLE_SLAB_SIZE),
         maxParticles,
         sizeof(MglParticle),
         MglTrue,
@@ -60,41 +64,43 @@ MglParticle * mgl_particle_new(MglUint lifeSpan)
     return particle;
 }
 
-void mgl_particle_update()
+static void mgl_particle_update_particle(void *data,void *context)
 {
-    MglParticle *particle,*tmp;
+    MglParticle *particle;
     float factor;
-    for (particle = mgl_resource_get_next_data(__mgl_particle_resource_manager,NULL);
-         particle != NULL;
-         particle = mgl_resource_get_next_data(__mgl_particle_resource_manager,particle))
+    particle = (MglParticle *)context;
+    particle->timeToLive--;
+    if (particle->timeToLive <= 0)
     {
-        particle->timeToLive--;
-        if (particle->timeToLive <= 0)
-        {
-            tmp = particle;
-            mgl_resource_free_element(__mgl_particle_resource_manager,(void **)&tmp);
-            continue;
-        }
-        mgl_vec2d_add(particle->position,particle->position,particle->velocity);
-        mgl_vec2d_add(particle->velocity,particle->acceleration,particle->velocity);
-        if (particle->useColorVec)
-        {
-            mgl_vec2d_add(particle->color,particle->colorVec,particle->color);
-            mgl_color_clamp(particle->color);
-        }
-        if ((particle->useColorTarget)&&(particle->lifeSpan > 0))
-        {
-            factor = (particle->timeToLive/(float)particle->lifeSpan);
-            particle->color.x = (particle->color.x * factor) + (particle->colorTarget.x * (1 - factor) );
-            particle->color.y = (particle->color.x * factor) + (particle->colorTarget.y * (1 - factor) );
-            particle->color.z = (particle->color.x * factor) + (particle->colorTarget.z * (1 - factor) );
-            particle->color.w = (particle->color.x * factor) + (particle->colorTarget.w * (1 - factor) );
-        }
-        if (particle->actor)
-        {
-            mgl_actor_next_frame(particle->actor);
-        }
+        mgl_resource_free_element(__mgl_particle_resource_manager,(void **)&particle);
+        return;
+    }
+    mgl_vec2d_add(particle->position,particle->position,particle->velocity);
+    mgl_vec2d_add(particle->velocity,particle->acceleration,particle->velocity);
+    if (particle->useColorVec)
+    {
+        mgl_vec2d_add(particle->color,particle->colorVec,particle->color);
+        mgl_color_clamp(particle->color);
+    }
+    if ((particle->useColorTarget)&&(particle->lifeSpan > 0))
+    {
+        factor = (particle->timeToLive/(float)particle->lifeSpan);
+        particle->color.x = (particle->color.x * factor) + (particle->colorTarget.x * (1 - factor) );
+        particle->color.y = (particle->color.x * factor) + (particle->colorTarget.y * (1 - factor) );
+        particle->color.z = (particle->color.x * factor) + (particle->colorTarget.z * (1 - factor) );
+        particle->color.w = (particle->color.x * factor) + (particle->colorTarget.w * (1 - factor) );
     }
+    if (particle->actor)
+    {
+        mgl_actor_next_frame(particle->actor);
+    }
+}
+
+void mgl_particle_update()
+{
+    mgl_resource_manager_foreach(
+        __mgl_particle_resource_manager,
+        mgl_callback(mgl_particle_update_particle,NULL));
 }
 
 void mgl_particle_draw()
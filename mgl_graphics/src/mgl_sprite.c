@@ -3,27 +3,35 @@
 #include "mgl_logger.h"
 #include "mgl_config.h"
 #include "mgl_resource.h"
+#include "mgl_pack.h"
 #include "mgl_graphics.h"
 
 #include <SDL.h>
 #include <SDL_image.h>
 
 static MglResourceManager * __mgl_sprite_resource_manager = NULL;
+static MglResourceManager * __mgl_sprite_image_manager = NULL;
 static MglUint __mgl_sprite_default_fpl = 16;
 static MglSpriteMode __mgl_sprite_mode = MglSpriteBoth;
 
-struct MglSprite_S
+/*decoded pixels, shared by every sprite made from the same file with the same colors*/
+typedef struct
 {
     SDL_Texture *texture;
-    SDL_Surface *image;
+    SDL_Surface *surface;
+}MglSpriteImage;
+
+/*a view into a shared image, sprites only differ by how the image is cut into frames*/
+struct MglSprite_S
+{
+    MglSpriteImage *source;     /**<reference to the shared image, it may still be loading*/
+    GList *onLoaded;            /**<MglCallback * waiting on the image to finish loading*/
     
+    MglInt cellWidth;           /**<requested frame width, -1 for the whole image*/
+    MglInt cellHeight;          /**<requested frame height, -1 for the whole image*/
     MglUint frameWidth;
     MglUint frameHeight;
     MglUint framesPerLine;
-    
-    MglSI64 redSwap;
-    MglSI64 greenSwap;
-    MglSI64 blueSwap;
 };
 
 #define SPRITE(data) (MglSprite*)data
@@ -31,7 +39,27 @@ struct MglSprite_S
 void mgl_sprite_close();
 MglBool mgl_sprite_load_resource(char *filename,void *data);
 void mgl_sprite_delete(void *data);
-static void mgl_sprite_swap_colors(MglSprite *sprite);
+static void mgl_sprite_swap_colors(SDL_Surface *image,MglSI64 redSwap,MglSI64 greenSwap,MglSI64 blueSwap);
+static MglBool mgl_sprite_image_load_resource(char *filename,void *data);
+static void mgl_sprite_image_delete(void *data);
+static void *mgl_sprite_image_prepare(char *filename);
+static MglBool mgl_sprite_image_finalize(void *prepared,void *data);
+static void mgl_sprite_image_prepared_free(void *prepared);
+static void *mgl_sprite_image_detach(void *data);
+static void mgl_sprite_image_detached_free(void *detached);
+static void mgl_sprite_image_loaded(void *data,void *context);
+static void mgl_sprite_load_source(MglSprite *sprite,char *filenamePacked,MglBool async);
+static void mgl_sprite_set_frames(MglSprite *sprite);
+static MglBool mgl_sprite_frames_ready(MglSprite *sprite);
+static char *mgl_sprite_pack_filename(
+    char *filename,
+    MglInt frameWidth,
+    MglInt frameHeight,
+    MglUint framesPerLine,
+    MglVec4D *redSwap,
+    MglVec4D *greenSwap,
+    MglVec4D *blueSwap,
+    MglVec4D *colorKey);
 
 void mgl_sprite_init_from_config(char * configFile)
 {
@@ -69,6 +97,23 @@ void mgl_sprite_init(
         mgl_logger_error("mgl_sprite_init: failed to init image: %s",SDL_GetError());
     }
     atexit(IMG_Quit);
+    __mgl_sprite_image_manager = mgl_resource_manager_init(
+        "mgl sprite image",
+        maxSprites,
+        sizeof(MglSpriteImage),
+        MglFalse,
+        mgl_sprite_image_delete,
+        mgl_sprite_image_load_resource
+    );
+    mgl_resource_manager_set_async_loader(
+        __mgl_sprite_image_manager,
+        mgl_sprite_image_prepare,
+        mgl_sprite_image_finalize,
+        mgl_sprite_image_prepared_free);
+    mgl_resource_manager_set_async_delete(
+        __mgl_sprite_image_manager,
+        mgl_sprite_image_detach,
+        mgl_sprite_image_detached_free);
     __mgl_sprite_resource_manager = mgl_resource_manager_init(
         "mgl sprite",
         maxSprites,
@@ -83,153 +128,322 @@ void mgl_sprite_init(
 
 void mgl_sprite_close()
 {
+    /*sprites hold references to the images, so they go first*/
     mgl_resource_manager_free(&__mgl_sprite_resource_manager);
+    mgl_resource_manager_free(&__mgl_sprite_image_manager);
 }
 
-MglBool mgl_sprite_load_resource(char *filename,void *data)
+/*everything that can be done off the main thread, the image is converted in finalize*/
+typedef struct
 {
     SDL_Surface *image;
-    MglSprite *sprite;
+    MglSI64 red,green,blue,colorKey;
+}MglSpritePrepared;
+
+/*image files are packed as "file|red|green|blue|colorKey", only what changes the pixels*/
+static void *mgl_sprite_image_prepare(char *filename)
+{
+    MglSpritePrepared *prepared;
     char ** strings;
     MglLine fname;
-    MglUint fw,fh,fpl;
-    MglSI64 red,green,blue,colorKey;
-    sprite = SPRITE(data);
-    if (!sprite)
+    prepared = (MglSpritePrepared *)malloc(sizeof(MglSpritePrepared));
+    if (!prepared)
     {
-        mgl_logger_error("mgl_sprite_load_resource: NULL data provided for sprite %s",filename);
-        return MglFalse;
+        mgl_logger_error("mgl_sprite_image_prepare: failed to allocate data for image %s",filename);
+        return NULL;
     }
-    /*parse parameters packed with sprite*/
+    memset(prepared,0,sizeof(MglSpritePrepared));
     strings = g_strsplit_set (filename,
                     "|",
                     0);
     mgl_line_cpy(fname,strings[0]);
-    fw = atoi(strings[1]);
-    fh = atoi(strings[2]);
-    fpl = atoi(strings[3]);
-    red = atoi(strings[4]);
-    green = atoi(strings[5]);
-    blue = atoi(strings[6]);
-    colorKey = atoi(strings[7]);
+    prepared->red = atoi(strings[1]);
+    prepared->green = atoi(strings[2]);
+    prepared->blue = atoi(strings[3]);
+    prepared->colorKey = atoi(strings[4]);
     g_strfreev (strings);
-    
 
-    sprite->frameWidth = fw;
-    sprite->frameHeight = fh;
-    sprite->framesPerLine = fpl;
-    
-    sprite->redSwap = red;
-    sprite->greenSwap = green;
-    sprite->blueSwap = blue;
-    
-    image = IMG_Load(fname);
-    if (!image)
+    prepared->image = IMG_Load_RW(mgl_pack_open_rw(fname),1);
+    if (!prepared->image)
     {
         mgl_logger_warn("mgl_sprite_load_resource:failed to load sprite image file: %s, re: %s",fname, SDL_GetError());
-        return MglFalse;
+        free(prepared);
+        return NULL;
     }
-    if (colorKey != -1)
+    return prepared;
+}
+
+static void mgl_sprite_image_prepared_free(void *data)
+{
+    MglSpritePrepared *prepared;
+    prepared = (MglSpritePrepared *)data;
+    if (!prepared)return;
+    if (prepared->image)
     {
-        SDL_SetColorKey(image,
-                        SDL_TRUE,
-                        colorKey);
+        SDL_FreeSurface(prepared->image);
     }
-    sprite->image = mgl_graphics_screen_convert(&image);
-    if (!sprite->image)
+    free(prepared);
+}
+
+static MglBool mgl_sprite_image_finalize(void *data,void *imageData)
+{
+    MglSpritePrepared *prepared;
+    MglSpriteImage *source;
+    SDL_Surface *image;
+    prepared = (MglSpritePrepared *)data;
+    source = (MglSpriteImage *)imageData;
+    if (!prepared)return MglFalse;
+    if (!source)
     {
+        mgl_logger_error("mgl_sprite_load_resource: NULL data provided for sprite image");
+        mgl_sprite_image_prepared_free(prepared);
         return MglFalse;
     }
-    if (fw == -1)
+    image = prepared->image;
+    prepared->image = NULL;
+    if (prepared->colorKey != -1)
     {
-        sprite->frameWidth = sprite->image->w;
+        SDL_SetColorKey(image,
+                        SDL_TRUE,
+                        prepared->colorKey);
     }
-    if (fh == -1)
+    source->surface = mgl_graphics_screen_convert(&image);
+    if (!source->surface)
     {
-        sprite->frameHeight = sprite->image->h;
+        if (image)SDL_FreeSurface(image);
+        mgl_sprite_image_prepared_free(prepared);
+        return MglFalse;
     }
-    /*set the rest of the data*/
-    if ((red != -1)||
-        (green != -1)||
-        (blue != -1))
+    /*palette swaps are the only variants that need their own pixels*/
+    if ((prepared->red != -1)||
+        (prepared->green != -1)||
+        (prepared->blue != -1))
     {
-        mgl_sprite_swap_colors(sprite);
+        mgl_sprite_swap_colors(source->surface,prepared->red,prepared->green,prepared->blue);
     }
+    mgl_sprite_image_prepared_free(prepared);
     
     if (__mgl_sprite_mode & MglSpriteTexture)
     {
-        sprite->texture = SDL_CreateTextureFromSurface(mgl_graphics_get_renderer(),sprite->image);
-        if (sprite->texture)
+        source->texture = SDL_CreateTextureFromSurface(mgl_graphics_get_renderer(),source->surface);
+        if (source->texture)
         {
-            SDL_SetTextureBlendMode(sprite->texture,SDL_BLENDMODE_BLEND);        
-            SDL_UpdateTexture(sprite->texture,
+            SDL_SetTextureBlendMode(source->texture,SDL_BLENDMODE_BLEND);        
+            SDL_UpdateTexture(source->texture,
                             NULL,
-                            sprite->image->pixels,
-                            sprite->image->pitch);
+                            source->surface->pixels,
+                            source->surface->pitch);
         }
     }
+    mgl_resource_element_set_size(
+        __mgl_sprite_image_manager,
+        source,
+        (source->surface->pitch * source->surface->h) +
+        (source->texture?(source->surface->w * source->surface->h * 4):0));
     return MglTrue;
 }
 
-void mgl_sprite_delete(void *data)
+static MglBool mgl_sprite_image_load_resource(char *filename,void *data)
+{
+    if (!data)
+    {
+        mgl_logger_error("mgl_sprite_load_resource: NULL data provided for sprite image %s",filename);
+        return MglFalse;
+    }
+    return mgl_sprite_image_finalize(mgl_sprite_image_prepare(filename),data);
+}
+
+/*the texture has to go on the main thread, the surface can be freed by a loader thread*/
+static void *mgl_sprite_image_detach(void *data)
+{
+    MglSpriteImage *source;
+    SDL_Surface *image;
+    source = (MglSpriteImage *)data;
+    if (!source)return NULL;
+    if (source->texture)
+    {
+        SDL_DestroyTexture(source->texture);
+        source->texture = NULL;
+    }
+    image = source->surface;
+    source->surface = NULL;
+    return image;
+}
+
+static void mgl_sprite_image_detached_free(void *detached)
+{
+    SDL_FreeSurface((SDL_Surface *)detached);
+}
+
+static void mgl_sprite_image_delete(void *data)
+{
+    MglSpriteImage *source;
+    source = (MglSpriteImage *)data;
+    if (!source)return;
+    if (source->surface)
+    {
+        SDL_FreeSurface(source->surface);
+    }
+    source->surface = NULL;
+    if (source->texture)
+    {
+        SDL_DestroyTexture(source->texture);
+    }
+    source->texture = NULL;
+}
+
+/*sprite files are packed as "file|fw|fh|fpl|red|green|blue|colorKey".
+  Only the frame layout is read here, the caller loads the image the way it was asked to, see mgl_sprite_load_source*/
+MglBool mgl_sprite_load_resource(char *filename,void *data)
 {
     MglSprite *sprite;
-    sprite = (MglSprite *)data;
+    char ** strings;
+    if (!data)
+    {
+        mgl_logger_error("mgl_sprite_load_resource: NULL data provided for sprite %s",filename);
+        return MglFalse;
+    }
+    sprite = SPRITE(data);
+    strings = g_strsplit_set (filename,
+                    "|",
+                    0);
+    sprite->cellWidth = atoi(strings[1]);
+    sprite->cellHeight = atoi(strings[2]);
+    sprite->framesPerLine = atoi(strings[3]);
+    g_strfreev (strings);
+    return MglTrue;
+}
+
+/*starts the image of a sprite that does not have one yet.  The source stays NULL if a normal load fails*/
+static void mgl_sprite_load_source(MglSprite *sprite,char *filenamePacked,MglBool async)
+{
+    MglCallback callback;
+    char ** strings;
+    char *imageFilename;
+    strings = g_strsplit_set (filenamePacked,
+                    "|",
+                    0);
+    imageFilename = g_strdup_printf("%s|%s|%s|%s|%s",strings[0],strings[4],strings[5],strings[6],strings[7]);
+    g_strfreev (strings);
+    if (async)
+    {
+        /*the handle goes stale if the sprite is freed before its image is in*/
+        mgl_callback_set(
+            &callback,
+            mgl_sprite_image_loaded,
+            GUINT_TO_POINTER(mgl_resource_element_get_handle(__mgl_sprite_resource_manager,sprite)));
+        sprite->source = mgl_resource_manager_load_resource_async(__mgl_sprite_image_manager,imageFilename,&callback);
+    }
+    else
+    {
+        sprite->source = mgl_resource_manager_load_resource(__mgl_sprite_image_manager,imageFilename);
+        mgl_sprite_set_frames(sprite);
+    }
+    g_free(imageFilename);
+}
+
+static void mgl_sprite_set_frames(MglSprite *sprite)
+{
+    if ((!sprite->source)||(!sprite->source->surface))return;
+    sprite->frameWidth = (sprite->cellWidth == -1)?sprite->source->surface->w:sprite->cellWidth;
+    sprite->frameHeight = (sprite->cellHeight == -1)?sprite->source->surface->h:sprite->cellHeight;
+}
+
+/*the load callback is dropped if the sprite was freed while its image loaded, so frames are also cut on first use*/
+static MglBool mgl_sprite_frames_ready(MglSprite *sprite)
+{
+    if (sprite->frameWidth == 0)
+    {
+        mgl_sprite_set_frames(sprite);
+    }
+    return sprite->frameWidth != 0;
+}
+
+static void mgl_sprite_image_loaded(void *data,void *context)
+{
+    MglSprite *sprite;
+    MglCallback *callback;
+    GList *it;
+    sprite = (MglSprite *)mgl_resource_get_data_by_handle(__mgl_sprite_resource_manager,GPOINTER_TO_UINT(data));
     if (!sprite)return;
-    if (sprite->image)
+    if (mgl_resource_element_get_load_state(__mgl_sprite_image_manager,context) == MglResourceFailed)
     {
-        SDL_FreeSurface(sprite->image);
+        /*so the next load of this sprite tries its image again*/
+        mgl_resource_element_set_failed(__mgl_sprite_resource_manager,sprite);
     }
-    sprite->image = NULL;
-    if (sprite->texture)
+    /*may run before the loader has stored the image*/
+    sprite->source = (MglSpriteImage *)context;
+    mgl_sprite_set_frames(sprite);
+    for (it = sprite->onLoaded;it != NULL;it = it->next)
     {
-        SDL_DestroyTexture(sprite->texture);
+        callback = (MglCallback *)it->data;
+        callback->function(callback->data,sprite);
+        mgl_callback_free(&callback);
     }
+    g_list_free(sprite->onLoaded);
+    sprite->onLoaded = NULL;
+}
+
+void mgl_sprite_delete(void *data)
+{
+    MglSprite *sprite;
+    MglCallback *callback;
+    GList *it;
+    sprite = (MglSprite *)data;
+    if (!sprite)return;
+    for (it = sprite->onLoaded;it != NULL;it = it->next)
+    {
+        callback = (MglCallback *)it->data;
+        mgl_callback_free(&callback);
+    }
+    g_list_free(sprite->onLoaded);
+    sprite->onLoaded = NULL;
+    mgl_resource_free_element(__mgl_sprite_image_manager,(void **)&sprite->source);
 }
 
 
-static void mgl_sprite_swap_colors(MglSprite *sprite)
+static void mgl_sprite_swap_colors(SDL_Surface *image,MglSI64 redSwap,MglSI64 greenSwap,MglSI64 blueSwap)
 {
     int i,j;
     Uint8 r,g,b,a;
     MglUint color;
     MglFloat intensity;
     MglVec4D redShift,greenShift,blueShift;
-    if (SDL_MUSTLOCK(sprite->image))
+    if (SDL_MUSTLOCK(image))
     {
-        SDL_LockSurface(sprite->image);
+        SDL_LockSurface(image);
     }
-    SDL_GetRGBA(sprite->redSwap,
-                sprite->image->format,
+    SDL_GetRGBA(redSwap,
+                image->format,
                 &r,
                 &g,
                 &b,
                 &a);
     mgl_vec4d_set(redShift,r,g,b,a);
 
-    SDL_GetRGBA(sprite->greenSwap,
-                sprite->image->format,
+    SDL_GetRGBA(greenSwap,
+                image->format,
                 &r,
                 &g,
                 &b,
                 &a);
     mgl_vec4d_set(greenShift,r,g,b,a);
     
-    SDL_GetRGBA(sprite->blueSwap,
-                sprite->image->format,
+    SDL_GetRGBA(blueSwap,
+                image->format,
                 &r,
                 &g,
                 &b,
                 &a);
     mgl_vec4d_set(blueShift,r,g,b,a);
     
-    for (j = 0;j < sprite->image->h;j++)
+    for (j = 0;j < image->h;j++)
     {
-        for (i = 0;i < sprite->image->w;i++)
+        for (i = 0;i < image->w;i++)
         {
-            color = mgl_graphics_get_surface_pixel(sprite->image,mgl_vec2d(i,j));
+            color = mgl_graphics_get_surface_pixel(image,mgl_vec2d(i,j));
             SDL_GetRGBA(color,
-                        sprite->image->format,
+                        image->format,
                         &r,
                         &g,
                         &b,
@@ -237,7 +451,7 @@ static void mgl_sprite_swap_colors(MglSprite *sprite)
             if ((r != 0)&&
                 (g == 0)&&
                 (b == 0)&&
-                (sprite->redSwap != -1))
+                (redSwap != -1))
             {/*pure red*/
                 intensity = (MglFloat)r / 255;
                 r = (Uint8)intensity * redShift.x;
@@ -247,7 +461,7 @@ static void mgl_sprite_swap_colors(MglSprite *sprite)
             if ((r == 0)&&
                 (g != 0)&&
                 (b == 0)&&
-                (sprite->blueSwap != -1))
+                (blueSwap != -1))
             {/*pure red*/
                 intensity = (MglFloat)g / 255;
                 r = (Uint8)intensity * greenShift.x;
@@ -257,55 +471,85 @@ static void mgl_sprite_swap_colors(MglSprite *sprite)
             if ((r == 0)&&
                 (g == 0)&&
                 (b != 0)&&
-                (sprite->blueSwap != -1))
+                (blueSwap != -1))
             {/*pure red*/
                 intensity = (MglFloat)b / 255;
                 r = (Uint8)intensity * blueShift.x;
                 g = (Uint8)intensity * blueShift.y;
                 b = (Uint8)intensity * blueShift.z;
             }
-            color = SDL_MapRGBA(sprite->image->format,r,g,b,a);
-            mgl_graphics_set_surface_pixel(sprite->image,mgl_vec2d(i,j),color);
+            color = SDL_MapRGBA(image->format,r,g,b,a);
+            mgl_graphics_set_surface_pixel(image,mgl_vec2d(i,j),color);
         }
     }
-    if (SDL_MUSTLOCK(sprite->image))
+    if (SDL_MUSTLOCK(image))
     {
-        SDL_UnlockSurface(sprite->image);
+        SDL_UnlockSurface(image);
     }
 }
 
+/*what a sprite def file holds*/
+typedef struct
+{
+    MglLine  filename;
+    MglInt   frameWidth;
+    MglInt   frameHeight;
+    MglUint  framesPerLine;
+    MglVec4D redSwap;
+    MglVec4D greenSwap;
+    MglVec4D blueSwap;
+    MglVec4D colorKey;
+}MglSpriteDef;
+
+/*indices into the field table, for mgl_dict_field_found*/
+enum
+{
+    MglSpriteDefFilename,
+    MglSpriteDefFrameWidth,
+    MglSpriteDefFrameHeight,
+    MglSpriteDefFramesPerLine,
+    MglSpriteDefRedSwap,
+    MglSpriteDefGreenSwap,
+    MglSpriteDefBlueSwap,
+    MglSpriteDefColorKey,
+    MglSpriteDefFieldCount
+};
+
+static MglDictField __mgl_sprite_def_fields[MglSpriteDefFieldCount] =
+{
+    [MglSpriteDefFilename] = mgl_dict_field(MglSpriteDef,filename,"filename",MGL_DICT_STRING),
+    [MglSpriteDefFrameWidth] = mgl_dict_field_default(MglSpriteDef,frameWidth,"frameWidth",MGL_DICT_INT,{.i = -1}),
+    [MglSpriteDefFrameHeight] = mgl_dict_field_default(MglSpriteDef,frameHeight,"frameHeight",MGL_DICT_INT,{.i = -1}),
+    [MglSpriteDefFramesPerLine] = mgl_dict_field(MglSpriteDef,framesPerLine,"framesPerLine",MGL_DICT_UINT),
+    [MglSpriteDefRedSwap] = mgl_dict_field_default(MglSpriteDef,redSwap,"redSwap",MGL_DICT_VEC4D,{.v4 = {-1,-1,-1,-1}}),
+    [MglSpriteDefGreenSwap] = mgl_dict_field_default(MglSpriteDef,greenSwap,"greenSwap",MGL_DICT_VEC4D,{.v4 = {-1,-1,-1,-1}}),
+    [MglSpriteDefBlueSwap] = mgl_dict_field_default(MglSpriteDef,blueSwap,"blueSwap",MGL_DICT_VEC4D,{.v4 = {-1,-1,-1,-1}}),
+    [MglSpriteDefColorKey] = mgl_dict_field_default(MglSpriteDef,colorKey,"colorKey",MGL_DICT_VEC4D,{.v4 = {-1,-1,-1,-1}})
+};
+
 MglSprite *mgl_sprite_load_from_dict(MglDict *data)
 {
-    MglLine spriteFilename;
-    MglInt frameWidth = -1;
-    MglInt frameHeight = -1;
-    MglUint framesPerLine = __mgl_sprite_default_fpl;
-    MglVec4D redSwap = {-1,-1,-1,-1};
-    MglVec4D greenSwap = {-1,-1,-1,-1};
-    MglVec4D blueSwap = {-1,-1,-1,-1};
-    MglVec4D colorKey = {-1,-1,-1,-1};
+    MglSpriteDef def;
+    MglUI64 found;
     if (!data)
     {
         return NULL;
     }
-    mgl_dict_get_hash_value_as_line(spriteFilename,data,"filename");
-    mgl_dict_get_hash_value_as_int(&frameWidth,data,"frameWidth");
-    mgl_dict_get_hash_value_as_int(&frameHeight,data,"frameHeight");
-    mgl_dict_get_hash_value_as_uint(&framesPerLine,data,"framesPerLine");
-    
-    mgl_dict_get_hash_value_as_vec4d(&redSwap,data,"redSwap");
-    mgl_dict_get_hash_value_as_vec4d(&greenSwap,data,"greenSwap");
-    mgl_dict_get_hash_value_as_vec4d(&blueSwap,data,"blueSwap");
-    mgl_dict_get_hash_value_as_vec4d(&colorKey,data,"colorKey");
+    found = mgl_dict_decode_hash(&def,data,__mgl_sprite_def_fields,G_N_ELEMENTS(__mgl_sprite_def_fields));
+    if (!mgl_dict_field_found(found,MglSpriteDefFramesPerLine))
+    {
+        /*the default can be changed at run time*/
+        def.framesPerLine = __mgl_sprite_default_fpl;
+    }
     return mgl_sprite_load_from_image(
-        spriteFilename,
-        frameWidth,
-        frameHeight,
-        framesPerLine,
-        redSwap.x!=-1?&redSwap:NULL,
-        greenSwap.x!=-1?&greenSwap:NULL,
-        blueSwap.x!=-1?&blueSwap:NULL,
-        colorKey.x!=-1?&colorKey:NULL);
+        def.filename,
+        def.frameWidth,
+        def.frameHeight,
+        def.framesPerLine,
+        def.redSwap.x!=-1?&def.redSwap:NULL,
+        def.greenSwap.x!=-1?&def.greenSwap:NULL,
+        def.blueSwap.x!=-1?&def.blueSwap:NULL,
+        def.colorKey.x!=-1?&def.colorKey:NULL);
 }
 
 MglSprite *mgl_sprite_load_from_def(char *filename)
@@ -347,27 +591,118 @@ MglSprite *mgl_sprite_load_from_image(
 {
     char *filenamePacked;
     MglSprite *sprite = NULL;
-    filenamePacked = g_strdup_printf (
-        "%s|%i|%i|%i|%i|%i|%i|%i",
+    filenamePacked = mgl_sprite_pack_filename(
         filename,
         frameWidth,
         frameHeight,
         framesPerLine,
-        redSwap?mgl_graphics_vec_to_screen_color(*redSwap):-1,
-        greenSwap?mgl_graphics_vec_to_screen_color(*greenSwap):-1,
-        blueSwap?mgl_graphics_vec_to_screen_color(*blueSwap):-1,
-        colorKey?mgl_graphics_vec_to_screen_color(*colorKey):-1);
+        redSwap,
+        greenSwap,
+        blueSwap,
+        colorKey);
     sprite = mgl_resource_manager_load_resource(__mgl_sprite_resource_manager,filenamePacked);
-    free(filenamePacked);
+    if ((sprite != NULL) && (sprite->source == NULL))
+    {
+        mgl_sprite_load_source(sprite,filenamePacked,MglFalse);
+    }
+    g_free(filenamePacked);
     if (!sprite)
     {
         mgl_logger_warn("mgl_sprite_load_from_image: failed to load image:%s",filename);
         return NULL;
     }
-        
+    /*a sprite cached by an async load may still be waiting on its image*/
+    if ((sprite->source == NULL) ||
+        (mgl_resource_element_wait(__mgl_sprite_image_manager,sprite->source) == MglResourceFailed))
+    {
+        mgl_logger_warn("mgl_sprite_load_from_image: failed to load image:%s",filename);
+        mgl_resource_element_set_failed(__mgl_sprite_resource_manager,sprite);
+        mgl_sprite_free(&sprite);
+        return NULL;
+    }
     return sprite;
 }
 
+MglSprite *mgl_sprite_load_from_image_async(
+    char *filename,
+    MglInt frameWidth,
+    MglInt frameHeight,
+    MglUint framesPerLine,
+    MglVec4D *redSwap,
+    MglVec4D *greenSwap,
+    MglVec4D *blueSwap,
+    MglVec4D *colorKey,
+    MglCallback *onLoaded)
+{
+    char *filenamePacked;
+    MglSprite *sprite = NULL;
+    MglCallback *callback;
+    filenamePacked = mgl_sprite_pack_filename(
+        filename,
+        frameWidth,
+        frameHeight,
+        framesPerLine,
+        redSwap,
+        greenSwap,
+        blueSwap,
+        colorKey);
+    /*the sprite itself is cheap to set up, only its image is loaded in the background*/
+    sprite = mgl_resource_manager_load_resource(__mgl_sprite_resource_manager,filenamePacked);
+    if ((sprite != NULL) && (sprite->source == NULL))
+    {
+        mgl_sprite_load_source(sprite,filenamePacked,MglTrue);
+    }
+    g_free(filenamePacked);
+    if ((!sprite) || (!sprite->source))
+    {
+        if (sprite != NULL)mgl_resource_element_set_failed(__mgl_sprite_resource_manager,sprite);
+        mgl_sprite_free(&sprite);
+        mgl_logger_warn("mgl_sprite_load_from_image_async: failed to start loading image:%s",filename);
+        return NULL;
+    }
+    if (onLoaded != NULL)
+    {
+        if (mgl_resource_element_get_load_state(__mgl_sprite_image_manager,sprite->source) != MglResourcePending)
+        {
+            onLoaded->function(onLoaded->data,sprite);
+        }
+        else if ((callback = mgl_callback_new()) != NULL)
+        {
+            mgl_callback_copy(callback,*onLoaded);
+            sprite->onLoaded = g_list_append(sprite->onLoaded,callback);
+        }
+    }
+    return sprite;
+}
+
+MglBool mgl_sprite_is_loaded(MglSprite *sprite)
+{
+    if (!sprite)return MglFalse;
+    return mgl_resource_element_get_load_state(__mgl_sprite_image_manager,sprite->source) == MglResourceLoaded;
+}
+
+static char *mgl_sprite_pack_filename(
+    char *filename,
+    MglInt frameWidth,
+    MglInt frameHeight,
+    MglUint framesPerLine,
+    MglVec4D *redSwap,
+    MglVec4D *greenSwap,
+    MglVec4D *blueSwap,
+    MglVec4D *colorKey)
+{
+    return g_strdup_printf (
+        "%s|%i|%i|%i|%i|%i|%i|%i",
+        filename,
+        frameWidth,
+        frameHeight,
+        framesPerLine,
+        redSwap?mgl_graphics_vec_to_screen_color(*redSwap):-1,
+        greenSwap?mgl_graphics_vec_to_screen_color(*greenSwap):-1,
+        blueSwap?mgl_graphics_vec_to_screen_color(*blueSwap):-1,
+        colorKey?mgl_graphics_vec_to_screen_color(*colorKey):-1);
+}
+
 void mgl_sprite_draw_image(MglSprite *image,MglVec2D position)
 {
     mgl_sprite_draw(
@@ -417,7 +752,7 @@ void mgl_sprite_draw(
     SDL_Point r;
     MglVec2D scaleFactor = {1,1};
     MglVec2D scaleOffset = {0,0};
-    if (!sprite)
+    if ((!sprite)||(!sprite->source)||(!sprite->source->texture)||(!mgl_sprite_frames_ready(sprite)))
     {
         return;
     }
@@ -444,12 +779,12 @@ void mgl_sprite_draw(
     if (colorShift)
     {
         SDL_SetTextureColorMod(
-            sprite->texture,
+            sprite->source->texture,
             colorShift->x,
             colorShift->y,
             colorShift->z);
         SDL_SetTextureAlphaMod(
-            sprite->texture,
+            sprite->source->texture,
             colorShift->w);
     }
     
@@ -466,7 +801,7 @@ void mgl_sprite_draw(
         sprite->frameWidth * scaleFactor.x,
         sprite->frameHeight * scaleFactor.y);
     SDL_RenderCopyEx(mgl_graphics_get_renderer(),
-                     sprite->texture,
+                     sprite->source->texture,
                      &cell,
                      &target,
                      rotation?rotation->z:0,
@@ -475,12 +810,12 @@ void mgl_sprite_draw(
     if (colorShift)
     {
         SDL_SetTextureColorMod(
-            sprite->texture,
+            sprite->source->texture,
             255,
             255,
             255);
         SDL_SetTextureAlphaMod(
-            sprite->texture,
+            sprite->source->texture,
             255);
     }
 }
@@ -498,6 +833,10 @@ void mgl_sprite_draw_to_surface(
     MglVec2D scaleOffset = {0,0};
     MglVec2D scaleFactor = {1,1};
 
+    if ((!sprite)||(!sprite->source)||(!sprite->source->surface)||(!mgl_sprite_frames_ready(sprite)))
+    {
+        return;
+    }
     if (scale)
     {
         mgl_vec2d_copy(scaleFactor,(*scale));
@@ -523,24 +862,24 @@ void mgl_sprite_draw_to_surface(
     if (color)
     {
         SDL_SetSurfaceColorMod(
-            sprite->image,
+            sprite->source->surface,
             color->x,
             color->y,
             color->z);
         SDL_SetSurfaceAlphaMod(
-            sprite->image,
+            sprite->source->surface,
             color->w);
     }
-    SDL_BlitScaled(sprite->image,&cell,surface,&target);
+    SDL_BlitScaled(sprite->source->surface,&cell,surface,&target);
     if (color)
     {
         SDL_SetSurfaceColorMod(
-            sprite->image,
+            sprite->source->surface,
             255,
             255,
             255);
         SDL_SetSurfaceAlphaMod(
-            sprite->image,
+            sprite->source->surface,
             255);
     }
 }
@@ -554,6 +893,7 @@ void mgl_sprite_free(MglSprite **sprite)
 void mgl_sprite_get_size(MglSprite *sprite,MglUint *w,MglUint *h)
 {
     if (!sprite)return;
+    mgl_sprite_frames_ready(sprite);
     if (w)
     {
         *w = sprite->frameWidth;
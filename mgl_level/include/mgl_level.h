@@ -24,6 +24,7 @@
 #include "mgl_camera.h"
 #include "mgl_tilemap.h"
 #include "mgl_parallax.h"
+#include "mgl_resource.h"
 
 /**
  * @brief the level structure keeps a context for rendering a single game level.
@@ -60,6 +61,15 @@ void mgl_level_free(MglLevel **level);
  */
 MglLevel *mgl_level_load(char *filename);
 
+/**
+ * @brief start loading everything a level is known to depend on, in parallel where possible.
+ * Dependencies are recorded whenever a level loads, or read with mgl_resource_load_dependencies.
+ * Keep calling mgl_resource_batch_update until it returns MglTrue, then mgl_level_load finds them all loaded.
+ * @param filename the level file to preload for
+ * @return NULL on error or a batch holding the dependencies.  Free it after the level with mgl_resource_batch_free
+ */
+MglResourceBatch *mgl_level_preload(char *filename);
+
 /**
  * @brief draw the level
  * @param level the level to draw
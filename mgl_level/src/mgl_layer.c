@@ -45,79 +45,113 @@ MglLayer *mgl_layer_new()
     return layer;
 }
 
+/*what a layer entry in a level def holds*/
+typedef struct
+{
+    MglUint  bglayer;
+    MglLine  name;
+    MglBool  useParallax;
+    MglColor color;
+    MglLine  layerType;
+    MglLine  spaceConfig;
+    MglDict *parallax;
+    MglDict *tilemap;
+    MglDict *space;
+}MglLayerDef;
+
+/*indices into the field table, for mgl_dict_field_found*/
+enum
+{
+    MglLayerDefBglayer,
+    MglLayerDefName,
+    MglLayerDefUseParallax,
+    MglLayerDefColor,
+    MglLayerDefLayerType,
+    MglLayerDefSpaceConfig,
+    MglLayerDefParallax,
+    MglLayerDefTilemap,
+    MglLayerDefSpace,
+    MglLayerDefFieldCount
+};
+
+static MglDictField __mgl_layer_def_fields[MglLayerDefFieldCount] =
+{
+    [MglLayerDefBglayer] = mgl_dict_field(MglLayerDef,bglayer,"bglayer",MGL_DICT_UINT),
+    [MglLayerDefName] = mgl_dict_field(MglLayerDef,name,"name",MGL_DICT_STRING),
+    [MglLayerDefUseParallax] = mgl_dict_field(MglLayerDef,useParallax,"useParallax",MGL_DICT_BOOL),
+    [MglLayerDefColor] = mgl_dict_field_default(MglLayerDef,color,"color",MGL_DICT_VEC4D,{.v4 = {255,255,255,255}}),
+    [MglLayerDefLayerType] = mgl_dict_field(MglLayerDef,layerType,"layerType",MGL_DICT_STRING),
+    [MglLayerDefSpaceConfig] = mgl_dict_field(MglLayerDef,spaceConfig,"spaceConfig",MGL_DICT_STRING),
+    [MglLayerDefParallax] = mgl_dict_field(MglLayerDef,parallax,"parallax",MGL_DICT_HASH),
+    [MglLayerDefTilemap] = mgl_dict_field(MglLayerDef,tilemap,"tilemap",MGL_DICT_HASH),
+    [MglLayerDefSpace] = mgl_dict_field(MglLayerDef,space,"space",MGL_DICT_HASH)
+};
+
 MglLayer *mgl_layer_load_from_def(MglDict *def)
 {
-    MglLine layerType;
+    MglLayerDef layerDef;
+    MglUI64 found;
     MglParallax *par;
     MglTileMap *map;
-    MglLine name;
-    MglLine filename;
     MglUint     selection = MglLayerNone;
-    MglBool     useParallax = MglFalse;
-    MglUint     bglayer = 0;
-    MglColor color = {255,255,255,255};
     MglLayer *layer = NULL;
     MglDrawList *list= NULL;
     MglCollision *collision = NULL;
     if (!def)return NULL;
 
-    mgl_dict_get_hash_value_as_uint(&bglayer,def,"bglayer");
-    mgl_dict_get_hash_value_as_line(name,def,"name");
-    mgl_dict_get_hash_value_as_bool(&useParallax,def,"useParallax");
-    mgl_dict_get_hash_value_as_vec4d(&color,def,"color");
-
-    if (!mgl_dict_get_hash_value_as_line(layerType,def,"layerType"))
+    found = mgl_dict_decode_hash(&layerDef,def,__mgl_layer_def_fields,G_N_ELEMENTS(__mgl_layer_def_fields));
+    if (!mgl_dict_field_found(found,MglLayerDefLayerType))
     {
         return NULL;
     }
-    if (mgl_line_cmp(layerType,"parallax")==0)
+    if (mgl_line_cmp(layerDef.layerType,"parallax")==0)
     {
-        par = mgl_parallax_load_from_def(mgl_dict_get_hash_value(def,"parallax"));
+        par = mgl_parallax_load_from_def(layerDef.parallax);
         if (!par)
         {
             return NULL;
         }
-        layer = mgl_layer_new_parallax_layer(par,useParallax,bglayer,color);
-        mgl_line_cpy(layer->name,name);
+        layer = mgl_layer_new_parallax_layer(par,layerDef.useParallax,layerDef.bglayer,layerDef.color);
+        mgl_line_cpy(layer->name,layerDef.name);
         return layer;
     }
-    else if (mgl_line_cmp(layerType,"tilemap")==0)
+    else if (mgl_line_cmp(layerDef.layerType,"tilemap")==0)
     {
-        map = mgl_tilemap_load_from_def(mgl_dict_get_hash_value(def,"tilemap"));
+        map = mgl_tilemap_load_from_def(layerDef.tilemap);
         if (!map)
         {
             return NULL;
         }
-        layer = mgl_layer_new_tile_layer(map,useParallax,bglayer,color);
-        mgl_line_cpy(layer->name,name);
+        layer = mgl_layer_new_tile_layer(map,layerDef.useParallax,layerDef.bglayer,layerDef.color);
+        mgl_line_cpy(layer->name,layerDef.name);
         return layer;
     }
-    else if (mgl_line_cmp(layerType,"image")==0)
+    else if (mgl_line_cmp(layerDef.layerType,"image")==0)
     {
         selection = MglLayerImage;
     }
-    else if (mgl_line_cmp(layerType,"collision")==0)
+    else if (mgl_line_cmp(layerDef.layerType,"collision")==0)
     {
         layer = mgl_layer_new();
         if (!layer)return NULL;
         selection = MglLayerCollision;
-        if (mgl_dict_get_hash_value_as_line(filename, def,"spaceConfig"))
+        if (mgl_dict_field_found(found,MglLayerDefSpaceConfig))
         {
-            collision = mgl_collision_load_from_file(filename);
+            collision = mgl_collision_load_from_file(layerDef.spaceConfig);
             mgl_logger_debug("collision space returned");
         }
         else
         {
-            collision = mgl_collision_load_from_def(mgl_dict_get_hash_value(def,"space"));
+            collision = mgl_collision_load_from_def(layerDef.space);
         }
         layer->layer.collision = collision;
         layer->selection = selection;
-        layer->useParallax = useParallax;
-        layer->bglayer = bglayer;
-        mgl_line_cpy(layer->name,name);
+        layer->useParallax = layerDef.useParallax;
+        layer->bglayer = layerDef.bglayer;
+        mgl_line_cpy(layer->name,layerDef.name);
         return layer;
     }
-    else if (mgl_line_cmp(layerType,"drawlist")==0)
+    else if (mgl_line_cmp(layerDef.layerType,"drawlist")==0)
     {
         layer = mgl_layer_new();
         if (!layer)return NULL;
@@ -131,18 +165,18 @@ MglLayer *mgl_layer_load_from_def(MglDict *def)
         }
         memset(list,0,sizeof(MglDrawList));
         layer->selection = selection;
-        layer->useParallax = useParallax;
-        layer->bglayer = bglayer;
-        mgl_line_cpy(layer->name,name);
+        layer->useParallax = layerDef.useParallax;
+        layer->bglayer = layerDef.bglayer;
+        mgl_line_cpy(layer->name,layerDef.name);
         layer->layer.drawlist = list;
         return layer;
     }
     layer = mgl_layer_new();
     if (!layer)return NULL;
     layer->selection = selection;
-    layer->useParallax = useParallax;
-    layer->bglayer = bglayer;
-    mgl_line_cpy(layer->name,name);
+    layer->useParallax = layerDef.useParallax;
+    layer->bglayer = layerDef.bglayer;
+    mgl_line_cpy(layer->name,layerDef.name);
     return layer;
 }
 
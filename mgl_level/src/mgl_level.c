@@ -50,6 +50,18 @@ MglLevel *mgl_level_load(char *filename)
     return mgl_resource_manager_load_resource(__mgl_level_resource_manager,filename);
 }
 
+MglResourceBatch *mgl_level_preload(char *filename)
+{
+    MglResourceBatch *batch;
+    if (!filename)return NULL;
+    batch = mgl_resource_batch_new();
+    if (!batch)return NULL;
+    /*levels are unique, so the batch only loads what the level depends on*/
+    mgl_resource_batch_add(batch,__mgl_level_resource_manager,filename);
+    mgl_resource_batch_start(batch);
+    return batch;
+}
+
 MglBool mgl_level_create_from_def(MglLevel *level,MglDict *def)
 {
     MglDict *layers;
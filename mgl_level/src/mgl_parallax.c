@@ -106,10 +106,56 @@ MglParallax *mgl_parallax_new()
     return par;
 }
 
+/*what a layer entry in a parallax def holds*/
+typedef struct
+{
+    MglBool  placeholder;
+    MglLine  image;
+    MglLine  actor;
+    MglVec2D size;
+    MglVec2D flip;
+    MglVec3D rotation;
+    MglVec2D scale;
+    MglVec4D color;
+    MglVec2D offset;
+    MglBool  cameraPlane;
+}MglParallaxLayerDef;
+
+/*indices into the field table, for mgl_dict_field_found*/
+enum
+{
+    MglParallaxLayerDefPlaceholder,
+    MglParallaxLayerDefImage,
+    MglParallaxLayerDefActor,
+    MglParallaxLayerDefSize,
+    MglParallaxLayerDefFlip,
+    MglParallaxLayerDefRotation,
+    MglParallaxLayerDefScale,
+    MglParallaxLayerDefColor,
+    MglParallaxLayerDefOffset,
+    MglParallaxLayerDefCameraPlane,
+    MglParallaxLayerDefFieldCount
+};
+
+static MglDictField __mgl_parallax_layer_def_fields[MglParallaxLayerDefFieldCount] =
+{
+    [MglParallaxLayerDefPlaceholder] = mgl_dict_field(MglParallaxLayerDef,placeholder,"placeholder",MGL_DICT_BOOL),
+    [MglParallaxLayerDefImage] = mgl_dict_field(MglParallaxLayerDef,image,"image",MGL_DICT_STRING),
+    [MglParallaxLayerDefActor] = mgl_dict_field(MglParallaxLayerDef,actor,"actor",MGL_DICT_STRING),
+    [MglParallaxLayerDefSize] = mgl_dict_field(MglParallaxLayerDef,size,"size",MGL_DICT_VEC2D),
+    [MglParallaxLayerDefFlip] = mgl_dict_field(MglParallaxLayerDef,flip,"flip",MGL_DICT_VEC2D),
+    [MglParallaxLayerDefRotation] = mgl_dict_field(MglParallaxLayerDef,rotation,"rotation",MGL_DICT_VEC3D),
+    [MglParallaxLayerDefScale] = mgl_dict_field_default(MglParallaxLayerDef,scale,"scale",MGL_DICT_VEC2D,{.v2 = {1,1}}),
+    [MglParallaxLayerDefColor] = mgl_dict_field_default(MglParallaxLayerDef,color,"color",MGL_DICT_VEC4D,{.v4 = {255,255,255,255}}),
+    [MglParallaxLayerDefOffset] = mgl_dict_field(MglParallaxLayerDef,offset,"offset",MGL_DICT_VEC2D),
+    [MglParallaxLayerDefCameraPlane] = mgl_dict_field(MglParallaxLayerDef,cameraPlane,"cameraPlane",MGL_DICT_BOOL)
+};
+
 MglLayer *mgl_parallax_load_layer(MglDict *data)
 {
     MglLayer *layer;
-    MglLine file;
+    MglParallaxLayerDef def;
+    MglUI64 found;
     MglUint sw,sh;
     if (!data)return NULL;
     layer = (MglLayer *)malloc(sizeof(MglLayer));
@@ -120,41 +166,38 @@ MglLayer *mgl_parallax_load_layer(MglDict *data)
     }
     memset(layer,0,sizeof(MglLayer));
     
-    mgl_dict_get_hash_value_as_bool(&layer->placeholder,data,"placeholder");
+    found = mgl_dict_decode_hash(&def,data,__mgl_parallax_layer_def_fields,G_N_ELEMENTS(__mgl_parallax_layer_def_fields));
+    layer->placeholder = def.placeholder;
     if (!layer->placeholder)
     {
-        if (mgl_dict_get_hash_value_as_line(file, data, "image"))
+        if (def.image[0] != '\0')
         {
-            mgl_logger_info("loading layer image: %s",file);
-            layer->image = mgl_sprite_load_image(file);
+            mgl_logger_info("loading layer image: %s",def.image);
+            layer->image = mgl_sprite_load_image(def.image);
             mgl_sprite_get_size(layer->image,&sw,&sh);
             layer->size.x = sw;
             layer->size.y = sh;
         }
-        if (mgl_dict_get_hash_value_as_line(file, data, "actor"))
+        if (def.actor[0] != '\0')
         {
-            mgl_logger_info("loading layer actor: %s",file);
-            layer->actor =  mgl_actor_load(file);
+            mgl_logger_info("loading layer actor: %s",def.actor);
+            layer->actor =  mgl_actor_load(def.actor);
             mgl_actor_get_size(layer->actor,&sw,&sh);
             layer->size.x = sw;
             layer->size.y = sh;
         }
     }
     /*if size is specified, it will override the image/actor size*/
-    mgl_dict_get_hash_value_as_vec2d(&layer->size, data, "size");
-    mgl_dict_get_hash_value_as_vec2d(&layer->flip, data, "flip");
-    mgl_dict_get_hash_value_as_vec3d(&layer->rotation, data, "rotation");
-    mgl_dict_get_hash_value_as_vec3d(&layer->rotation, data, "rotation");
-    if (!mgl_dict_get_hash_value_as_vec2d(&layer->scale, data, "scale"))
-    {
-        layer->scale = mgl_vec2d(1,1);
-    }
-    if (!mgl_dict_get_hash_value_as_vec4d(&layer->color, data, "color"))
+    if (mgl_dict_field_found(found,MglParallaxLayerDefSize))
     {
-        layer->color = mgl_vec4d(255,255,255,255);
+        layer->size = def.size;
     }
-    mgl_dict_get_hash_value_as_vec2d(&layer->offset, data, "offset");
-    mgl_dict_get_hash_value_as_bool(&layer->cameraPlane, data, "cameraPlane");
+    layer->flip = def.flip;
+    layer->rotation = def.rotation;
+    layer->scale = def.scale;
+    layer->color = def.color;
+    layer->offset = def.offset;
+    layer->cameraPlane = def.cameraPlane;
     return layer;
 }
 
@@ -245,11 +288,10 @@ MglBool mgl_parallax_create_from_def(MglParallax *par,MglDict *def)
 MglParallax * mgl_parallax_load_from_def(MglDict *def)
 {
     MglParallax * par;
-    const char *filename;
-    filename = mgl_dict_get_string(def);
-    if (filename != NULL)
+    MglLine filename;
+    if (mgl_dict_get_line(filename,def))
     {
-        return mgl_parallax_load((char *)filename,NULL);
+        return mgl_parallax_load(filename,NULL);
     }
     par = mgl_parallax_new();
     if (!par)return NULL;
@@ -29,6 +29,7 @@ void mgl_tilemap_close();
 MglBool mgl_tilemap_load_resource(char *filename,void *data);
 void mgl_tilemap_delete(void *data);
 MglInt mgl_tilemap_get_tile_index_by_tile_position(MglTileMap *map,MglVec2D tilepos);
+static void mgl_tilemap_update_size(MglTileMap *tilemap);
 
 void mgl_tilemap_init(
     MglUint maxMaps,
@@ -186,6 +187,24 @@ void mgl_tilemap_render(MglTileMap *tilemap)
         SDL_FreeSurface(tilemap->surface);
         tilemap->surface = NULL;
     }
+    mgl_tilemap_update_size(tilemap);
+}
+
+static void mgl_tilemap_update_size(MglTileMap *tilemap)
+{
+    size_t size;
+    int w,h;
+    size = sizeof(MglInt) * tilemap->mapWidth * tilemap->mapHeight;
+    if (tilemap->surface)
+    {
+        size += tilemap->surface->pitch * tilemap->surface->h;
+    }
+    if ((tilemap->texture)&&
+        (SDL_QueryTexture(tilemap->texture,NULL,NULL,&w,&h) == 0))
+    {
+        size += w * h * 4;
+    }
+    mgl_resource_element_set_size(__mgl_tilemap_resource_manager,tilemap,size);
 }
 
 MglInt *mgl_tilemap_new_mapdata(MglUint width,MglUint height)
@@ -215,6 +234,7 @@ MglTileMap *mgl_tilemap_load_from_dict(MglTileMap *tilemap,MglDict *def)
     MglUint mapWidth,mapHeight;
     MglInt *tileData;
     const char *tiles;
+    MglLine cell;
     if (!def)
     {
         return NULL;
@@ -287,7 +307,12 @@ MglTileMap *mgl_tilemap_load_from_dict(MglTileMap *tilemap,MglDict *def)
         row = mgl_dict_get_hash_value(mgl_dict_get_list_nth(map,j),"row");
         if (!row)continue;
         tiles = mgl_dict_get_string(row);
-        if (!tiles)continue;
+        if (!tiles)
+        {
+            /*a one column row parses to a number*/
+            if (!mgl_dict_get_line(cell,row))continue;
+            tiles = cell;
+        }
         for (i = 0;i < tilemap->mapWidth;i++)
         {
             sscanf(tiles,"%i",&tileData[(j*mapWidth)+i]);
@@ -305,11 +330,10 @@ MglTileMap *mgl_tilemap_load_from_dict(MglTileMap *tilemap,MglDict *def)
 MglTileMap *mgl_tilemap_load_from_def(MglDict *def)
 {
     MglTileMap * map;
-    const char *filename;
-    filename = mgl_dict_get_string(def);
-    if (filename != NULL)
+    MglLine filename;
+    if (mgl_dict_get_line(filename,def))
     {
-        return mgl_tilemap_load((char *)filename);
+        return mgl_tilemap_load(filename);
     }
     map = mgl_resource_new_element(__mgl_tilemap_resource_manager);
     if (!map)return NULL;
@@ -338,6 +362,7 @@ MglTileMap *mgl_tilemap_new(
         mgl_resource_free_element(__mgl_tilemap_resource_manager,(void **)tilemap);
         return NULL;
     }
+    mgl_tilemap_update_size(tilemap);
     return tilemap;
 }
 
@@ -83,11 +83,55 @@ void mgl_tileset_delete(void *data)
     mgl_dict_free(&set->info);
 }
 
+/*what a tile entry in a tileset def holds*/
+typedef struct
+{
+    MglVec2D scale;
+    MglBool  solid;
+    MglVec2D footprint;
+    MglVec4D color;
+    MglLine  image;
+    MglLine  sprite;
+    MglLine  actor;
+    MglLine  action;
+    MglUint  frame;
+    MglDict *info;
+}MglTileInfoDef;
+
+/*indices into the field table, for mgl_dict_field_found*/
+enum
+{
+    MglTileInfoDefScale,
+    MglTileInfoDefSolid,
+    MglTileInfoDefFootprint,
+    MglTileInfoDefColor,
+    MglTileInfoDefImage,
+    MglTileInfoDefSprite,
+    MglTileInfoDefActor,
+    MglTileInfoDefAction,
+    MglTileInfoDefFrame,
+    MglTileInfoDefInfo,
+    MglTileInfoDefFieldCount
+};
+
+static MglDictField __mgl_tileinfo_def_fields[MglTileInfoDefFieldCount] =
+{
+    [MglTileInfoDefScale] = mgl_dict_field_default(MglTileInfoDef,scale,"scale",MGL_DICT_VEC2D,{.v2 = {1,1}}),
+    [MglTileInfoDefSolid] = mgl_dict_field(MglTileInfoDef,solid,"solid",MGL_DICT_BOOL),
+    [MglTileInfoDefFootprint] = mgl_dict_field_default(MglTileInfoDef,footprint,"footprint",MGL_DICT_VEC2D,{.v2 = {1,1}}),
+    [MglTileInfoDefColor] = mgl_dict_field_default(MglTileInfoDef,color,"color",MGL_DICT_VEC4D,{.v4 = {255,255,255,255}}),
+    [MglTileInfoDefImage] = mgl_dict_field(MglTileInfoDef,image,"image",MGL_DICT_STRING),
+    [MglTileInfoDefSprite] = mgl_dict_field(MglTileInfoDef,sprite,"sprite",MGL_DICT_STRING),
+    [MglTileInfoDefActor] = mgl_dict_field(MglTileInfoDef,actor,"actor",MGL_DICT_STRING),
+    [MglTileInfoDefAction] = mgl_dict_field(MglTileInfoDef,action,"action",MGL_DICT_STRING),
+    [MglTileInfoDefFrame] = mgl_dict_field(MglTileInfoDef,frame,"frame",MGL_DICT_UINT),
+    [MglTileInfoDefInfo] = mgl_dict_field(MglTileInfoDef,info,"info",MGL_DICT_HASH)
+};
+
 MglTileInfo *mgl_tileset_load_info_from_dict(MglDict *def)
 {
     MglTileInfo *tileInfo;
-    MglLine filename;
-    MglDict *info;
+    MglTileInfoDef tileDef;
     if (!def)return NULL;
     tileInfo = g_new(MglTileInfo,1);
     if (!tileInfo)
@@ -96,42 +140,33 @@ MglTileInfo *mgl_tileset_load_info_from_dict(MglDict *def)
         return NULL;
     }
     memset(tileInfo,0,sizeof(MglTileInfo));
-    if (!mgl_dict_get_hash_value_as_vec2d(&tileInfo->scale, def, "scale"))
-    {
-        mgl_vec2d_set(tileInfo->scale,1,1);
-    }
-    mgl_dict_get_hash_value_as_bool(&tileInfo->solid,def,"solid");
-    if (!mgl_dict_get_hash_value_as_vec2d(&tileInfo->footprint, def, "footprint"))
-    {
-        mgl_vec2d_set(tileInfo->footprint,1,1);
-    }
-    if (!mgl_dict_get_hash_value_as_vec4d(&tileInfo->color, def, "color"))
+    mgl_dict_decode_hash(&tileDef,def,__mgl_tileinfo_def_fields,G_N_ELEMENTS(__mgl_tileinfo_def_fields));
+    tileInfo->scale = tileDef.scale;
+    tileInfo->solid = tileDef.solid;
+    tileInfo->footprint = tileDef.footprint;
+    tileInfo->color = tileDef.color;
+    if (tileDef.image[0] != '\0')
     {
-        mgl_vec4d_set(tileInfo->color,255,255,255,255);
+        tileInfo->sprite = mgl_sprite_load_image(tileDef.image);
+        tileInfo->frame = tileDef.frame;
     }
-    if (mgl_dict_get_hash_value_as_line(filename, def, "image"))
+    if (tileDef.sprite[0] != '\0')
     {
-        tileInfo->sprite = mgl_sprite_load_image(filename);
-        mgl_dict_get_hash_value_as_uint(&tileInfo->frame, def, "frame");
+        tileInfo->sprite = mgl_sprite_load_from_def(tileDef.sprite);
+        tileInfo->frame = tileDef.frame;
     }
-    if (mgl_dict_get_hash_value_as_line(filename, def, "sprite"))
+    else if (tileDef.actor[0] != '\0')
     {
-        tileInfo->sprite = mgl_sprite_load_from_def(filename);
-        mgl_dict_get_hash_value_as_uint(&tileInfo->frame, def, "frame");
-    }
-    else if (mgl_dict_get_hash_value_as_line(filename, def, "actor"))
-    {
-        tileInfo->actor = mgl_actor_load(filename);
-        if (mgl_dict_get_hash_value_as_line(filename, def, "action"))
+        tileInfo->actor = mgl_actor_load(tileDef.actor);
+        if (tileDef.action[0] != '\0')
         {
-            mgl_actor_set_action(tileInfo->actor,filename);
+            mgl_actor_set_action(tileInfo->actor,tileDef.action);
         }
     }
 
-    info = mgl_dict_get_hash_value(def,"info");
-    if (info)
+    if (tileDef.info)
     {
-        tileInfo->info = mgl_dict_clone(info);
+        tileInfo->info = mgl_dict_clone(tileDef.info);
     }
     return tileInfo;
 }
@@ -0,0 +1,81 @@
+#ifndef __MGL_PACK_H__
+#define __MGL_PACK_H__
+/**
+ * mgl_pack
+ * @license The MIT License (MIT)
+   @copyright Copyright (c) 2015 EngineerOfLies
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+ */
+
+#include "mgl_types.h"
+#include <SDL.h>
+
+/**
+ * @purpose packs bundle many asset files into one archive that is mapped into memory.
+ * Loaders ask for files through mgl_pack so that packed files are served from memory
+ * and anything not in a mounted pack is read from disk as a loose file.
+ */
+
+/**
+ * @brief map a pack file into memory and add its files to the search.
+ * Packs mounted later take priority over earlier ones.  Everything is unmounted on exit.
+ * Mount packs before loading starts, lookups are not guarded against a concurrent mount.
+ * @param filename the pack file to mount
+ * @return MglTrue on success, MglFalse on error.  See logs for errors.
+ */
+MglBool mgl_pack_mount(char *filename);
+
+/**
+ * @brief unmount every pack.  Any data previously returned by mgl_pack_get is invalid afterwards.
+ * A pack with rw handles still open from mgl_pack_open_rw stays mapped until the last of them is closed.
+ */
+void mgl_pack_unmount_all();
+
+/**
+ * @brief find a file in the mounted packs
+ * @param filename the path of the file, as it was given to the pack builder
+ * @param size output, the size of the file in bytes.  May be NULL
+ * @return a pointer to the file's bytes in the mapped pack or NULL if no mounted pack has the file
+ */
+const void *mgl_pack_get(const char *filename,size_t *size);
+
+/**
+ * @brief open a file for reading from the mounted packs, or from disk if no pack has it
+ * @param filename the path of the file to open
+ * @return an SDL_RWops to read the file with or NULL on error.  Close it with SDL_RWclose or pass it to an SDL loader that frees it.
+ * A packed file's rw keeps its pack mapped, so it can be streamed from after the pack is unmounted
+ */
+SDL_RWops *mgl_pack_open_rw(const char *filename);
+
+/**
+ * @brief read a whole file from the mounted packs, or from disk if no pack has it
+ * @param filename the path of the file to read
+ * @param size output, the size of the file in bytes.  May be NULL
+ * @return a buffer holding the file followed by a terminating 0, or NULL on error.  It must be free()d
+ */
+char *mgl_pack_load_file(const char *filename,size_t *size);
+
+/**
+ * @brief write a pack file from a list of loose files
+ * @param packname the pack file to write.  Overwritten if it exists
+ * @param filenames the files to add.  They are stored under the path given here
+ * @param count how many files are in the list
+ * @return MglTrue on success, MglFalse on error.  See logs for errors.
+ */
+MglBool mgl_pack_build(char *packname,char **filenames,MglUint count);
+
+#endif
@@ -23,6 +23,7 @@
 
 #include "mgl_types.h"
 #include "mgl_text.h"
+#include "mgl_callback.h"
 #include <glib.h>
 
 /**
@@ -32,6 +33,52 @@
 
 typedef struct MglResourceManager_S MglResourceManager;
 
+/**
+ * @brief a set of resources loaded and released together, along with everything they depend on
+ */
+typedef struct MglResourceBatch_S MglResourceBatch;
+
+/**
+ * @brief a compact reference to a resource element: slot index in the low bits, generation in the high bits.
+ * Resolving one is an array lookup.  Once the element is freed and its slot reused, old handles stop resolving.
+ * The generation wraps after 4095 reuses of the same slot.
+ */
+typedef MglUint MglResourceHandle;
+
+#define MGL_RESOURCE_HANDLE_NONE 0        /**<never resolves to an element*/
+#define MGL_RESOURCE_HANDLE_INDEX_BITS 20 /**<a manager holds at most 1 << MGL_RESOURCE_HANDLE_INDEX_BITS elements*/
+
+#define MGL_RESOURCE_HISTOGRAM_BUCKETS 16 /**<number of load time buckets kept per manager*/
+#define MGL_RESOURCE_HISTOGRAM_BASE 64    /**<upper bound of the first bucket in microseconds, each following bucket doubles*/
+
+/**
+ * @brief counters kept by every resource manager.  Updating them costs a few additions per load.
+ */
+typedef struct
+{
+  MglUint loads;         /**<calls to the manager's load or finalize function*/
+  MglUint loadFailures;  /**<loads that did not succeed*/
+  MglUint hits;          /**<loads answered by an already loaded resource*/
+  MglUint misses;        /**<loads that had to load from file*/
+  MglUint liveCount;     /**<elements currently in use*/
+  MglUint peakLiveCount; /**<most elements in use at once*/
+  MglUint capacity;      /**<slots currently allocated*/
+  MglUint reclaims;      /**<slots reused while still holding unreferenced data*/
+  MglUint evictions;     /**<unreferenced resources deleted to meet the memory budget*/
+  size_t  residentBytes; /**<bytes reported for loaded resources*/
+  size_t  cachedBytes;   /**<bytes held by unreferenced resources*/
+  MglUI64 loadTimeTotal; /**<microseconds spent loading, asynchronous loads count from the request*/
+  MglUint loadTimeMax;   /**<longest load in microseconds*/
+  MglUint loadTimeHistogram[MGL_RESOURCE_HISTOGRAM_BUCKETS];/**<count of loads by duration, see MGL_RESOURCE_HISTOGRAM_BASE*/
+}MglResourceStats;
+
+typedef enum
+{
+  MglResourceLoaded,  /**<the resource is ready to use*/
+  MglResourcePending, /**<an asynchronous load has not finished yet*/
+  MglResourceFailed   /**<the asynchronous load failed or was abandoned*/
+}MglResourceLoadState;
+
 /**
  * @brief initializes the resource manager for a type of resource
  * @param managerName the name this resource manager should be known as
@@ -50,6 +97,66 @@ MglResourceManager * mgl_resource_manager_init(
     MglBool (*data_load)(char *filename,void *data)
     );
 
+/**
+ * @brief initializes a resource manager that allocates its elements in slabs as they are needed
+ * Elements never move once allocated, growing only adds a new slab.
+ * @param managerName the name this resource manager should be known as
+ * @param slabSize how many elements to allocate at a time.  The first slab is allocated right away
+ * @param max the hard limit on the number of elements, 0 for no limit
+ * @param dataSize the sizeof() of the data you intend to keep track of with this resource manager
+ * @param dataUnique set to true if the resource elements should be kept unique, false if you allow multiple references to the same resource
+ * @param data_delete provide the function to be called when a resource is deleted.  It should take a pointer to the data that will be deleted.
+ * @param data_load provide the function to be called when a resource is loaded from file.  This should take a pointer to a filename and a pointer to the allocated data
+ */
+MglResourceManager * mgl_resource_manager_init_growable(
+    MglLine managerName,
+    MglUint slabSize,
+    MglUint max,
+    MglUint dataSize,
+    MglBool dataUnique,
+    void    (*data_delete)(void *data),
+    MglBool (*data_load)(char *filename,void *data)
+    );
+
+/**
+ * @brief initializes a growable resource manager that can be used from several threads at once
+ * Every call on the manager takes its lock, and data_load runs outside of it so loads of different
+ * files proceed in parallel.  A thread asking for a file another thread is loading waits for that load.
+ * Managers are still created and freed, and asynchronous loads finished, on the main thread.
+ * A delete function should not free elements of another concurrent manager that could free back into this one.
+ * @param managerName the name this resource manager should be known as
+ * @param slabSize how many elements to allocate at a time.  The first slab is allocated right away
+ * @param max the hard limit on the number of elements, 0 for no limit
+ * @param dataSize the sizeof() of the data you intend to keep track of with this resource manager
+ * @param dataUnique set to true if the resource elements should be kept unique, false if you allow multiple references to the same resource
+ * @param data_delete provide the function to be called when a resource is deleted.  It should take a pointer to the data that will be deleted.
+ * @param data_load provide the function to be called when a resource is loaded from file.  It must be thread safe
+ * @return NULL on error, or the new manager
+ */
+MglResourceManager * mgl_resource_manager_init_concurrent(
+    MglLine managerName,
+    MglUint slabSize,
+    MglUint max,
+    MglUint dataSize,
+    MglBool dataUnique,
+    void    (*data_delete)(void *data),
+    MglBool (*data_load)(char *filename,void *data)
+    );
+
+/**
+ * @brief release trailing slabs that hold no referenced elements.
+ * Unreferenced data in those slabs is deleted.  The first slab is always kept.
+ * @param manager the resource manager to trim
+ */
+void mgl_resource_manager_trim(MglResourceManager *manager);
+
+/**
+ * @brief Gets the number of elements currently allocated for the resource manager
+ * @param manager to resource manager to check
+ * @return the number of slots, used or not
+ */
+MglUint mgl_resource_manager_get_capacity(MglResourceManager *manager);
+
 /**
  * @brief returns a pointer to a new allocated element or NULL on error
  *
@@ -82,12 +189,49 @@ void mgl_resource_manager_clean(MglResourceManager *manager);
 
 /**
 * @brief delete ALL allocated resources.
-*        a delete function must be set.
+*        a delete function must be set.  Any pointers to the resources are invalid afterwards.
 *
 * @param manager the resource manager to be cleared.
 */
 void mgl_resource_manager_clear(MglResourceManager *manager);
 
+/**
+ * @brief like mgl_resource_manager_clean, but the deletes are spread over calls to mgl_resource_collect_update.
+ * Only resources already unreferenced when this is called are collected.
+ * @param manager the resource manager to be cleaned.
+ */
+void mgl_resource_manager_clean_incremental(MglResourceManager *manager);
+
+/**
+ * @brief delete some of the resources waiting on mgl_resource_manager_clean_incremental.  Call once per frame.
+ * At least one resource is deleted per call if any are waiting.
+ * @param maxCount the most resources to delete this call, 0 for no limit
+ * @param budget time in microseconds to spend deleting, 0 for no limit
+ * @return the number of resources deleted
+ */
+MglUint mgl_resource_collect_update(MglUint maxCount,MglUint budget);
+
+/**
+ * @brief check if an incremental clean is still in progress
+ * @return MglTrue if mgl_resource_collect_update has work left
+ */
+MglBool mgl_resource_collect_pending();
+
+/**
+ * @brief let a resource manager free part of each deleted resource on a loader thread.
+ * Whenever a resource is deleted, data_detach is called first on the main thread.  It should release anything
+ * that must stay on the main thread (textures), and take the rest out of the data, returning it.  Then data_delete
+ * is called as usual and the returned pointer is passed to detached_free on a loader thread.
+ * @param manager the resource manager to set up
+ * @param data_detach returns what can be freed off thread, or NULL for nothing
+ * @param detached_free frees what data_detach returned.  It must be thread safe
+ */
+void mgl_resource_manager_set_async_delete(
+    MglResourceManager *manager,
+    void *(*data_detach)(void *data),
+    void (*detached_free)(void *detached)
+    );
+
 /**
  * @brief Allocates and loads a resource from file.  Calls the manager's data load
  * function pointer.
@@ -97,6 +241,67 @@ void mgl_resource_manager_clear(MglResourceManager *manager);
  */
 void *mgl_resource_manager_load_resource(MglResourceManager *manager,char *filename);
 
+/**
+ * @brief split the manager's loading into a part that can run on a loader thread and a part
+ * that must run on the main thread.  Without these, async loads call data_load from mgl_resource_async_update.
+ * @param manager the resource manager to set up
+ * @param data_prepare called on a loader thread with the filename, returns prepared data or NULL on error.
+ * It must not touch the resource manager or anything that is not thread safe.
+ * @param data_finalize called on the main thread to turn the prepared data into the resource.
+ * It takes ownership of prepared, even when passed NULL or when it fails.
+ * @param prepared_free used to discard prepared data for a load that was abandoned.  May be NULL
+ */
+void mgl_resource_manager_set_async_loader(
+    MglResourceManager *manager,
+    void *(*data_prepare)(char *filename),
+    MglBool (*data_finalize)(void *prepared,void *data),
+    void (*prepared_free)(void *prepared)
+    );
+
+/**
+ * @brief starts loading a resource without waiting for it.
+ * The returned element is reserved right away, but must not be used until its load state is MglResourceLoaded.
+ * If the resource is already loaded, onLoaded is called before this returns.
+ * Freeing the element before the load completes abandons the load and onLoaded is never called.
+ * @param manager to load a resource for
+ * @param filename the file to load the resource from
+ * @param onLoaded optional, called with the element as context once the load completes, successful or not.  It is copied.
+ * @return a pointer to the reserved resource or NULL on error
+ */
+void *mgl_resource_manager_load_resource_async(MglResourceManager *manager,char *filename,MglCallback *onLoaded);
+
+/**
+ * @brief check if an asynchronously loaded resource is ready
+ * @param manager the resource manager for which this element is a member
+ * @param data the element in question
+ * @return the load state.  Elements loaded normally are always MglResourceLoaded
+ */
+MglResourceLoadState mgl_resource_element_get_load_state(MglResourceManager *manager,void *data);
+
+/**
+ * @brief mark an element whose load failed after its own load function returned, such as a resource waiting
+ * on another that failed.  It is dropped from the filename cache so the next load of the file tries again.
+ * @param manager the resource manager for which this element is a member
+ * @param data the element in question
+ */
+void mgl_resource_element_set_failed(MglResourceManager *manager,void *data);
+
+/**
+ * @brief block until an asynchronously loaded element is done, the way a normal load of the same file would.
+ * Its onLoaded callbacks run before this returns.  Elements that are not pending return right away.
+ * @param manager the resource manager for which this element is a member
+ * @param data the element in question
+ * @return the load state after waiting, MglResourcePending only if this thread is the one loading it
+ */
+MglResourceLoadState mgl_resource_element_wait(MglResourceManager *manager,void *data);
+
+/**
+ * @brief finish asynchronous loads that are ready.  Call once per frame from the main thread.
+ * At least one finished load is handled per call, even if it takes longer than the budget.
+ * @param budget time in microseconds to spend finishing loads
+ */
+void mgl_resource_async_update(MglUint budget);
+
 /**
  * @brief Gets the count of active elements in the resource manager.
  * @param manager to resource manager to check
@@ -104,6 +309,181 @@ void *mgl_resource_manager_load_resource(MglResourceManager *manager,char *filen
  */
 MglUint mgl_resource_manager_get_element_count(MglResourceManager *manager);
 
+/**
+ * @brief get the filename cache statistics for a non-unique resource manager
+ * @param manager the resource manager to check
+ * @param hits output, number of loads answered by an already loaded resource.  May be NULL
+ * @param misses output, number of loads that had to load from file.  May be NULL
+ */
+void mgl_resource_manager_get_filename_stats(MglResourceManager *manager,MglUint *hits,MglUint *misses);
+
+/**
+ * @brief get a snapshot of the statistics for a resource manager
+ * @param manager the resource manager to check
+ * @param stats output, filled in with the manager's counters
+ */
+void mgl_resource_manager_get_stats(MglResourceManager *manager,MglResourceStats *stats);
+
+/**
+ * @brief zero a resource manager's counters.  The peak starts over from the current live count
+ * @param manager the resource manager to reset
+ */
+void mgl_resource_manager_reset_stats(MglResourceManager *manager);
+
+/**
+ * @brief write a resource manager's statistics to the log at info level
+ * @param manager the resource manager to dump
+ */
+void mgl_resource_manager_dump_stats(MglResourceManager *manager);
+
+/**
+ * @brief write the statistics of every resource manager to the log at info level
+ */
+void mgl_resource_dump_stats();
+
+/**
+ * @brief call once per frame to dump the statistics of every resource manager every so often
+ * @param interval milliseconds between dumps
+ */
+void mgl_resource_dump_stats_periodic(MglUint interval);
+
+/**
+ * @brief record how much memory an element holds.  Loaders call this once the resource is loaded.
+ * The size is forgotten when the element's data is deleted.
+ * @param manager the resource manager for which this element is a member
+ * @param data the element in question
+ * @param bytes the number of bytes the resource keeps resident, including surfaces, textures and buffers
+ */
+void mgl_resource_element_set_size(MglResourceManager *manager,void *data,size_t bytes);
+
+/**
+ * @brief get the size last reported for an element
+ * @param manager the resource manager for which this element is a member
+ * @param data the element in question
+ * @return the size in bytes, 0 if never reported
+ */
+size_t mgl_resource_element_get_size(MglResourceManager *manager,void *data);
+
+/**
+ * @brief limit the memory held by all resource managers together.
+ * When over budget, unreferenced resources that are still loaded are deleted, least recently freed first,
+ * whichever manager they belong to.  Referenced resources are never evicted, so the budget can still be exceeded.
+ * Evictions only happen on the main thread.  Going over budget on another thread is handled by the next
+ * mgl_resource_async_update or mgl_resource_collect_update.
+ * @param bytes the budget in bytes, 0 for no limit
+ */
+void mgl_resource_set_memory_budget(size_t bytes);
+
+/**
+ * @brief get the memory budget for all resource managers
+ * @return the budget in bytes, 0 for no limit
+ */
+size_t mgl_resource_get_memory_budget();
+
+/**
+ * @brief get the memory held by all resource managers together
+ * @return the number of bytes reported for every loaded resource
+ */
+size_t mgl_resource_get_resident_bytes();
+
+/**
+ * @brief get the memory held by one resource manager
+ * @param manager the resource manager to check
+ * @param resident output, bytes reported for every loaded resource.  May be NULL
+ * @param cached output, the part of resident held by unreferenced resources that can be evicted.  May be NULL
+ */
+void mgl_resource_manager_get_memory_stats(MglResourceManager *manager,size_t *resident,size_t *cached);
+
+/**
+ * @brief record that a resource needs another resource to load.
+ * Any resource loaded while a loader is running is recorded as its dependency automatically,
+ * this is only needed for dependencies that are known without loading.
+ * The dependency graph is only kept on the main thread.
+ * @param manager the manager of the resource that has the dependency
+ * @param filename the file of the resource that has the dependency
+ * @param dependencyManager the manager of the resource that is needed
+ * @param dependencyFilename the file of the resource that is needed
+ */
+void mgl_resource_add_dependency(
+  MglResourceManager *manager,
+  char *filename,
+  MglResourceManager *dependencyManager,
+  char *dependencyFilename);
+
+/**
+ * @brief get how many direct dependencies have been recorded for a resource
+ * @param manager the manager of the resource
+ * @param filename the file of the resource
+ * @return the number of recorded dependencies, 0 if none are known
+ */
+MglUint mgl_resource_get_dependency_count(MglResourceManager *manager,char *filename);
+
+/**
+ * @brief write every recorded dependency to file so a later run can expand batches before loading anything
+ * @param filename the file to write, overwritten if it exists
+ * @return MglTrue on success, MglFalse on error.  See logs for errors.
+ */
+MglBool mgl_resource_save_dependencies(char *filename);
+
+/**
+ * @brief add the dependencies from a file written by mgl_resource_save_dependencies to the graph
+ * @param filename the file to read, it may be in a mounted pack
+ * @return MglTrue on success, MglFalse on error.  See logs for errors.
+ */
+MglBool mgl_resource_load_dependencies(char *filename);
+
+/**
+ * @brief make a new, empty batch
+ * @return NULL on error or a batch to add resources to.  Free it with mgl_resource_batch_free
+ */
+MglResourceBatch *mgl_resource_batch_new();
+
+/**
+ * @brief add a resource to a batch before it is started
+ * @param batch the batch to add to
+ * @param manager the manager of the resource
+ * @param filename the file of the resource
+ */
+void mgl_resource_batch_add(MglResourceBatch *batch,MglResourceManager *manager,char *filename);
+
+/**
+ * @brief expand the batch through the recorded dependencies and start loading it.
+ * The deepest dependencies are requested first, all at once through the asynchronous loader,
+ * and each shallower level is requested when the one below it has finished.
+ * Resources from unique managers are not loaded, only their dependencies are.
+ * @param batch the batch to start
+ */
+void mgl_resource_batch_start(MglResourceBatch *batch);
+
+/**
+ * @brief move a started batch along, call once per frame after mgl_resource_async_update
+ * @param batch the batch to update
+ * @return MglTrue once every resource in the batch has loaded or failed, MglFalse while it is still loading
+ */
+MglBool mgl_resource_batch_update(MglResourceBatch *batch);
+
+/**
+ * @brief start the batch if needed and block until everything in it has loaded or failed
+ * @param batch the batch to load
+ */
+void mgl_resource_batch_wait(MglResourceBatch *batch);
+
+/**
+ * @brief get how far along a batch is
+ * @param batch the batch to check
+ * @param done output, resources that have loaded or failed.  May be NULL
+ * @param total output, resources in the expanded batch.  May be NULL
+ */
+void mgl_resource_batch_get_progress(MglResourceBatch *batch,MglUint *done,MglUint *total);
+
+/**
+ * @brief release every resource the batch holds, the ones that depend on others first
+ * @param batch a pointer to the batch to free, it is set to NULL
+ * @param unload if MglTrue, resources left unreferenced are deleted right away instead of staying cached,
+ * which cascades down the dependencies.  Resources still used elsewhere are kept.
+ */
+void mgl_resource_batch_free(MglResourceBatch **batch,MglBool unload);
+
 /**
  * @brief returns the index of the element passed.
  * @param manager the resource manager to check
@@ -113,15 +493,42 @@ MglUint mgl_resource_manager_get_element_count(MglResourceManager *manager);
 MglInt mgl_resource_element_get_index(MglResourceManager *manager,void *element);
 
 /**
-* @brief returns the id of the element passed.
+* @brief returns the id of the element passed.  Ids are the element's handle.
 * @param manager the resource manager to check
 * @param data the resource data pointer to check
-* @return the unsigned integer id of the element, or -1 on error
+* @return the unsigned integer id of the element, or MGL_RESOURCE_HANDLE_NONE on error
 */
 unsigned long int mgl_resource_element_get_id(MglResourceManager *manager,void *element);
 
+/**
+ * @brief get a handle that can be kept in place of a pointer to the element
+ * @param manager the resource manager to check
+ * @param element the resource data pointer to check
+ * @return the handle or MGL_RESOURCE_HANDLE_NONE if the element is not in use or on error
+ */
+MglResourceHandle mgl_resource_element_get_handle(MglResourceManager *manager,void *element);
+
+/**
+ * @brief resolve a handle to its element in constant time
+ * @param manager the resource manager the handle came from
+ * @param handle the handle to resolve
+ * @return a pointer to the element data or NULL if the element has since been freed
+ */
+void * mgl_resource_get_data_by_handle(MglResourceManager *manager,MglResourceHandle handle);
+
+/**
+ * @brief check if a handle still refers to a live element
+ * @param manager the resource manager the handle came from
+ * @param handle the handle to check
+ * @return MglTrue if the handle resolves, MglFalse otherwise
+ */
+MglBool mgl_resource_handle_valid(MglResourceManager *manager,MglResourceHandle handle);
+
 /**
  * @brief iterates through the resource list
+ * Only elements in use are visited, in no particular order.  The element last
+ * returned may be freed before asking for the next one.  Freeing any other
+ * element mid iteration may cause one element to be skipped for that pass.
  *
  * @param manager the resource manager to iterate through
  * @param data the position to iterate from.  If passed NULL, it will
@@ -132,6 +539,18 @@ unsigned long int mgl_resource_element_get_id(MglResourceManager *manager,void *
  */
 void * mgl_resource_get_next_data(MglResourceManager *manager,void *data);
 
+/**
+ * @brief calls a function for every element in use in the resource manager
+ * The cost scales with the number of elements in use, not the size of the manager.
+ * The callback may free any element, its own or another.  Every element that was in use when the pass started
+ * and is still in use when the pass reaches it is visited exactly once, in order.
+ * Elements created during the pass are visited at the end of it.
+ *
+ * @param manager the resource manager to iterate through
+ * @param callback function will be called with the callback data and a pointer to the element as context
+ */
+void mgl_resource_manager_foreach(MglResourceManager *manager,MglCallback callback);
+
 /**
  * @brief confirms that the resource pointed at by element is the one expected based
  * on the id.
@@ -140,7 +559,7 @@ void * mgl_resource_get_next_data(MglResourceManager *manager,void *data);
  * @param id the expected id of the element
  * @return MglTrue if the id's match or MglFalse on error or mismatch.
  */
-MglBool mgl_resource_element_id_valid(MglResourceManager *manager,void *element,MglUint id);
+MglBool mgl_resource_element_id_valid(MglResourceManager *manager,void *element,unsigned long int id);
 
 
 /**
@@ -160,7 +579,7 @@ MglUint mgl_resource_element_get_refcount(MglResourceManager *manager,void *elem
 void mgl_resource_element_get_filename(MglLine filename, MglResourceManager *manager,void *element);
 
 /**
- * @brief given an unique identifier, get a pointer to the data if it is still active
+ * @brief given an id, get a pointer to the data if it is still active.  Same as mgl_resource_get_data_by_handle
  * @param manager the resource manager for which to search
  * @param id the unique id to search by
  * @return NULL if not found or no longer valid, a valid pointer to element data otherwise
@@ -0,0 +1,507 @@
+#include "mgl_pack.h"
+#include "mgl_logger.h"
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/*
+  pack layout, all integers little endian:
+  header: 8 byte magic, Uint32 version, Uint32 file count, Uint64 offset of the table of contents
+  file data, each file starting on a MGL_PACK_ALIGN boundary
+  table of contents: for each file Uint64 offset, Uint64 size, Uint32 name length, name bytes without a terminator
+*/
+#define MGL_PACK_MAGIC "MGLPACK"
+#define MGL_PACK_VERSION 1
+#define MGL_PACK_HEADER_SIZE 24
+#define MGL_PACK_ALIGN 16
+
+typedef struct
+{
+  void        *map;    /**<the whole pack file in memory*/
+  size_t       size;   /**<size of the mapping*/
+  SDL_atomic_t refs;   /**<one for the mount plus one per open rw, the last unref unmaps it*/
+}MglPack;
+
+typedef struct
+{
+  MglPack    *pack;/**<the pack the file lives in*/
+  const void *data;/**<start of the file inside a mapped pack*/
+  size_t      size;
+}MglPackEntry;
+
+/*read position of an rw opened on a packed file, it holds a reference to the pack*/
+typedef struct
+{
+  MglPack     *pack;
+  const Uint8 *base;
+  const Uint8 *here;
+  const Uint8 *stop;
+}MglPackStream;
+
+static GList      * __mgl_pack_list = NULL;  /**<mounted packs, most recent last*/
+static GHashTable * __mgl_pack_files = NULL; /**<path to MglPackEntry across every mounted pack*/
+
+static void *mgl_pack_map_file(char *filename,size_t *size);
+static void mgl_pack_unmap(MglPack *pack);
+static void mgl_pack_unref(MglPack *pack);
+static SDL_RWops *mgl_pack_rw_new(MglPackEntry *entry);
+static const char *mgl_pack_normalize(const char *filename);
+static Uint32 mgl_pack_read_32(const Uint8 *data);
+static Uint64 mgl_pack_read_64(const Uint8 *data);
+
+MglBool mgl_pack_mount(char *filename)
+{
+  MglPack *pack;
+  MglPackEntry *entry;
+  const Uint8 *data,*toc;
+  Uint32 version,count,i,nameLength;
+  Uint64 tocOffset,offset,size;
+  if (!filename)return MglFalse;
+  pack = (MglPack *)malloc(sizeof(MglPack));
+  if (!pack)
+  {
+    mgl_logger_error("mgl_pack: failed to allocate pack for %s",filename);
+    return MglFalse;
+  }
+  memset(pack,0,sizeof(MglPack));
+  SDL_AtomicSet(&pack->refs,1);
+  pack->map = mgl_pack_map_file(filename,&pack->size);
+  if (!pack->map)
+  {
+    free(pack);
+    return MglFalse;
+  }
+  data = (const Uint8 *)pack->map;
+  if ((pack->size < MGL_PACK_HEADER_SIZE) || (memcmp(data,MGL_PACK_MAGIC,8) != 0))
+  {
+    mgl_logger_error("mgl_pack: %s is not a pack file",filename);
+    mgl_pack_unmap(pack);
+    return MglFalse;
+  }
+  version = mgl_pack_read_32(&data[8]);
+  count = mgl_pack_read_32(&data[12]);
+  tocOffset = mgl_pack_read_64(&data[16]);
+  if (version != MGL_PACK_VERSION)
+  {
+    mgl_logger_error("mgl_pack: %s has unsupported version %u",filename,version);
+    mgl_pack_unmap(pack);
+    return MglFalse;
+  }
+  if (tocOffset > pack->size)
+  {
+    mgl_logger_error("mgl_pack: %s is truncated",filename);
+    mgl_pack_unmap(pack);
+    return MglFalse;
+  }
+  if (__mgl_pack_files == NULL)
+  {
+    __mgl_pack_files = g_hash_table_new_full(g_str_hash,g_str_equal,g_free,free);
+    atexit(mgl_pack_unmount_all);
+  }
+  toc = &data[tocOffset];
+  for (i = 0;i < count;i++)
+  {
+    if (toc + 20 > data + pack->size)break;
+    offset = mgl_pack_read_64(toc);
+    size = mgl_pack_read_64(&toc[8]);
+    nameLength = mgl_pack_read_32(&toc[16]);
+    toc += 20;
+    if ((toc + nameLength > data + pack->size) || (offset + size > pack->size))break;
+    entry = (MglPackEntry *)malloc(sizeof(MglPackEntry));
+    if (!entry)break;
+    entry->pack = pack;
+    entry->data = &data[offset];
+    entry->size = size;
+    /*a later pack replaces any earlier entry for the same path*/
+    g_hash_table_replace(__mgl_pack_files,g_strndup((const char *)toc,nameLength),entry);
+    toc += nameLength;
+  }
+  if (i < count)
+  {
+    mgl_logger_warn("mgl_pack: %s has a damaged table of contents, only %u of %u files mounted",filename,i,count);
+  }
+  __mgl_pack_list = g_list_append(__mgl_pack_list,pack);
+  mgl_logger_info("mgl_pack: mounted %s with %u files",filename,i);
+  return MglTrue;
+}
+
+void mgl_pack_unmount_all()
+{
+  GList *it;
+  if (__mgl_pack_files != NULL)
+  {
+    g_hash_table_destroy(__mgl_pack_files);
+    __mgl_pack_files = NULL;
+  }
+  for (it = __mgl_pack_list;it != NULL;it = it->next)
+  {
+    /*packs with open rw handles stay mapped until the last one is closed*/
+    mgl_pack_unref((MglPack *)it->data);
+  }
+  g_list_free(__mgl_pack_list);
+  __mgl_pack_list = NULL;
+}
+
+const void *mgl_pack_get(const char *filename,size_t *size)
+{
+  MglPackEntry *entry;
+  if ((!filename)||(__mgl_pack_files == NULL))return NULL;
+  entry = (MglPackEntry *)g_hash_table_lookup(__mgl_pack_files,mgl_pack_normalize(filename));
+  if (!entry)return NULL;
+  if (size)*size = entry->size;
+  return entry->data;
+}
+
+SDL_RWops *mgl_pack_open_rw(const char *filename)
+{
+  MglPackEntry *entry = NULL;
+  SDL_RWops *rw;
+  if (!filename)return NULL;
+  if (__mgl_pack_files != NULL)
+  {
+    entry = (MglPackEntry *)g_hash_table_lookup(__mgl_pack_files,mgl_pack_normalize(filename));
+  }
+  if (entry != NULL)
+  {
+    return mgl_pack_rw_new(entry);
+  }
+  rw = SDL_RWFromFile(filename,"rb");
+  if (!rw)
+  {
+    mgl_logger_warn("mgl_pack: failed to open %s, re: %s",filename,SDL_GetError());
+  }
+  return rw;
+}
+
+char *mgl_pack_load_file(const char *filename,size_t *size)
+{
+  const void *data;
+  size_t length = 0;
+  long position;
+  char *buffer;
+  FILE *file;
+  if (!filename)return NULL;
+  data = mgl_pack_get(filename,&length);
+  if (data == NULL)
+  {
+    file = fopen(filename,"rb");
+    if (!file)
+    {
+      mgl_logger_debug("mgl_pack: failed to open %s",filename);
+      return NULL;
+    }
+    if ((fseek(file,0,SEEK_END) != 0) || ((position = ftell(file)) < 0) || (fseek(file,0,SEEK_SET) != 0))
+    {
+      mgl_logger_error("mgl_pack: failed to get the size of %s",filename);
+      fclose(file);
+      return NULL;
+    }
+    length = (size_t)position;
+  }
+  buffer = (char *)malloc(length + 1);
+  if (!buffer)
+  {
+    mgl_logger_error("mgl_pack: failed to allocate %lu bytes for %s",(unsigned long)length,filename);
+    if (data == NULL)fclose(file);
+    return NULL;
+  }
+  if (data != NULL)
+  {
+    memcpy(buffer,data,length);
+  }
+  else
+  {
+    length = fread(buffer,1,length,file);
+    fclose(file);
+  }
+  buffer[length] = '\0';
+  if (size)*size = length;
+  return buffer;
+}
+
+MglBool mgl_pack_build(char *packname,char **filenames,MglUint count)
+{
+  FILE *pack;
+  char *buffer;
+  const char *name;
+  Uint8 header[MGL_PACK_HEADER_SIZE];
+  Uint64 *offsets,*sizes;
+  Uint64 value64,position;
+  Uint32 value32,i;
+  size_t size;
+  MglBool written;
+  static const Uint8 padding[MGL_PACK_ALIGN] = {0};
+  if ((!packname)||(!filenames))return MglFalse;
+  pack = fopen(packname,"wb");
+  if (!pack)
+  {
+    mgl_logger_error("mgl_pack: failed to open %s for writing",packname);
+    return MglFalse;
+  }
+  offsets = (Uint64 *)malloc(sizeof(Uint64) * (count + 1));
+  sizes = (Uint64 *)malloc(sizeof(Uint64) * (count + 1));
+  if ((!offsets)||(!sizes))
+  {
+    mgl_logger_error("mgl_pack: failed to allocate table of contents for %u files",count);
+    free(offsets);
+    free(sizes);
+    fclose(pack);
+    return MglFalse;
+  }
+  memset(header,0,sizeof(header));
+  /*the header is written again once the table of contents is placed*/
+  written = (fwrite(header,sizeof(header),1,pack) == 1);
+  position = MGL_PACK_HEADER_SIZE;
+  for (i = 0;i < count;i++)
+  {
+    /*read from disk even if a pack with the file is mounted*/
+    buffer = NULL;
+    size = 0;
+    if (mgl_pack_get(filenames[i],NULL) == NULL)
+    {
+      buffer = mgl_pack_load_file(filenames[i],&size);
+    }
+    else
+    {
+      mgl_logger_warn("mgl_pack: %s is already in a mounted pack, unmount before building",filenames[i]);
+    }
+    if (!buffer)
+    {
+      mgl_logger_error("mgl_pack: failed to read %s",filenames[i]);
+      free(offsets);
+      free(sizes);
+      fclose(pack);
+      remove(packname);
+      return MglFalse;
+    }
+    if (position % MGL_PACK_ALIGN)
+    {
+      if (fwrite(padding,MGL_PACK_ALIGN - (position % MGL_PACK_ALIGN),1,pack) != 1)written = MglFalse;
+      position += MGL_PACK_ALIGN - (position % MGL_PACK_ALIGN);
+    }
+    offsets[i] = position;
+    sizes[i] = size;
+    if ((size)&&(fwrite(buffer,size,1,pack) != 1))written = MglFalse;
+    position += size;
+    free(buffer);
+  }
+  /*the header points at the table of contents by the count above, so it has to match the file*/
+  if (ftell(pack) != (long)position)written = MglFalse;
+  for (i = 0;i < count;i++)
+  {
+    name = mgl_pack_normalize(filenames[i]);
+    value64 = SDL_SwapLE64(offsets[i]);
+    if (fwrite(&value64,sizeof(Uint64),1,pack) != 1)written = MglFalse;
+    value64 = SDL_SwapLE64(sizes[i]);
+    if (fwrite(&value64,sizeof(Uint64),1,pack) != 1)written = MglFalse;
+    value32 = SDL_SwapLE32((Uint32)strlen(name));
+    if (fwrite(&value32,sizeof(Uint32),1,pack) != 1)written = MglFalse;
+    if ((strlen(name))&&(fwrite(name,strlen(name),1,pack) != 1))written = MglFalse;
+  }
+  memcpy(header,MGL_PACK_MAGIC,strlen(MGL_PACK_MAGIC));
+  value32 = SDL_SwapLE32(MGL_PACK_VERSION);
+  memcpy(&header[8],&value32,sizeof(Uint32));
+  value32 = SDL_SwapLE32(count);
+  memcpy(&header[12],&value32,sizeof(Uint32));
+  value64 = SDL_SwapLE64(position);
+  memcpy(&header[16],&value64,sizeof(Uint64));
+  if ((fseek(pack,0,SEEK_SET) != 0) || (fwrite(header,sizeof(header),1,pack) != 1))written = MglFalse;
+  if (fclose(pack) != 0)written = MglFalse;
+  free(offsets);
+  free(sizes);
+  if (!written)
+  {
+    mgl_logger_error("mgl_pack: failed to write %s",packname);
+    remove(packname);
+    return MglFalse;
+  }
+  return MglTrue;
+}
+
+static const char *mgl_pack_normalize(const char *filename)
+{
+  while ((filename[0] == '.') && (filename[1] == '/'))
+  {
+    filename += 2;
+  }
+  return filename;
+}
+
+static Uint32 mgl_pack_read_32(const Uint8 *data)
+{
+  Uint32 value;
+  memcpy(&value,data,sizeof(Uint32));
+  return SDL_SwapLE32(value);
+}
+
+static Uint64 mgl_pack_read_64(const Uint8 *data)
+{
+  Uint64 value;
+  memcpy(&value,data,sizeof(Uint64));
+  return SDL_SwapLE64(value);
+}
+
+static void mgl_pack_unref(MglPack *pack)
+{
+  if (!pack)return;
+  if (SDL_AtomicAdd(&pack->refs,-1) == 1)
+  {
+    mgl_pack_unmap(pack);
+  }
+}
+
+static Sint64 mgl_pack_rw_size(SDL_RWops *rw)
+{
+  MglPackStream *stream;
+  stream = (MglPackStream *)rw->hidden.unknown.data1;
+  return (Sint64)(stream->stop - stream->base);
+}
+
+static Sint64 mgl_pack_rw_seek(SDL_RWops *rw,Sint64 offset,int whence)
+{
+  MglPackStream *stream;
+  const Uint8 *from;
+  stream = (MglPackStream *)rw->hidden.unknown.data1;
+  switch (whence)
+  {
+    case RW_SEEK_SET:
+      from = stream->base;
+      break;
+    case RW_SEEK_CUR:
+      from = stream->here;
+      break;
+    case RW_SEEK_END:
+      from = stream->stop;
+      break;
+    default:
+      return SDL_SetError("mgl_pack: unknown seek origin %i",whence);
+  }
+  /*clamped to the file the same way SDL's memory rw does*/
+  if (offset < (Sint64)(stream->base - from))offset = (Sint64)(stream->base - from);
+  if (offset > (Sint64)(stream->stop - from))offset = (Sint64)(stream->stop - from);
+  stream->here = from + offset;
+  return (Sint64)(stream->here - stream->base);
+}
+
+static size_t mgl_pack_rw_read(SDL_RWops *rw,void *ptr,size_t size,size_t maxnum)
+{
+  MglPackStream *stream;
+  size_t count;
+  stream = (MglPackStream *)rw->hidden.unknown.data1;
+  if ((size == 0)||(maxnum == 0))return 0;
+  count = (size_t)(stream->stop - stream->here) / size;
+  if (count > maxnum)count = maxnum;
+  memcpy(ptr,stream->here,count * size);
+  stream->here += count * size;
+  return count;
+}
+
+static size_t mgl_pack_rw_write(SDL_RWops *rw,const void *ptr,size_t size,size_t num)
+{
+  SDL_SetError("mgl_pack: packed files are read only");
+  return 0;
+}
+
+static int mgl_pack_rw_close(SDL_RWops *rw)
+{
+  MglPackStream *stream;
+  if (!rw)return 0;
+  stream = (MglPackStream *)rw->hidden.unknown.data1;
+  mgl_pack_unref(stream->pack);
+  free(stream);
+  SDL_FreeRW(rw);
+  return 0;
+}
+
+/*like SDL_RWFromConstMem, but the pack stays mapped until the rw is closed*/
+static SDL_RWops *mgl_pack_rw_new(MglPackEntry *entry)
+{
+  MglPackStream *stream;
+  SDL_RWops *rw;
+  stream = (MglPackStream *)malloc(sizeof(MglPackStream));
+  if (!stream)
+  {
+    mgl_logger_error("mgl_pack: failed to allocate a stream");
+    return NULL;
+  }
+  rw = SDL_AllocRW();
+  if (!rw)
+  {
+    mgl_logger_error("mgl_pack: failed to allocate an rw, re: %s",SDL_GetError());
+    free(stream);
+    return NULL;
+  }
+  SDL_AtomicAdd(&entry->pack->refs,1);
+  stream->pack = entry->pack;
+  stream->base = (const Uint8 *)entry->data;
+  stream->here = stream->base;
+  stream->stop = stream->base + entry->size;
+  rw->size = mgl_pack_rw_size;
+  rw->seek = mgl_pack_rw_seek;
+  rw->read = mgl_pack_rw_read;
+  rw->write = mgl_pack_rw_write;
+  rw->close = mgl_pack_rw_close;
+  rw->type = SDL_RWOPS_UNKNOWN;
+  rw->hidden.unknown.data1 = stream;
+  return rw;
+}
+
+#ifndef _WIN32
+static void *mgl_pack_map_file(char *filename,size_t *size)
+{
+  int fd;
+  struct stat info;
+  void *map;
+  fd = open(filename,O_RDONLY);
+  if (fd == -1)
+  {
+    mgl_logger_error("mgl_pack: failed to open %s",filename);
+    return NULL;
+  }
+  if ((fstat(fd,&info) == -1) || (info.st_size == 0))
+  {
+    mgl_logger_error("mgl_pack: failed to get the size of %s",filename);
+    close(fd);
+    return NULL;
+  }
+  map = mmap(NULL,info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  /*the mapping holds its own reference to the file*/
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    mgl_logger_error("mgl_pack: failed to map %s",filename);
+    return NULL;
+  }
+  *size = info.st_size;
+  return map;
+}
+
+static void mgl_pack_unmap(MglPack *pack)
+{
+  if (!pack)return;
+  if (pack->map)munmap(pack->map,pack->size);
+  free(pack);
+}
+#else
+/*no mmap, the pack is read into memory in one go instead*/
+static void *mgl_pack_map_file(char *filename,size_t *size)
+{
+  return mgl_pack_load_file(filename,size);
+}
+
+static void mgl_pack_unmap(MglPack *pack)
+{
+  if (!pack)return;
+  free(pack->map);
+  free(pack);
+}
+#endif
+
+/*eol@eof*/
@@ -1,40 +1,136 @@
 #include "mgl_resource.h"
 #include "mgl_logger.h"
+#include "mgl_pack.h"
 #include <assert.h>
 
-/*TODO make loading a resource a threaded option.  Ie: for non-critical resources
-  it can be loaded in a separate thread
-  re-evaluate how the memory is packed.
-  provide an ID-based hash access to the data.*/
+#define MGL_RESOURCE_MAX_WORKERS 4
+#define MGL_RESOURCE_HANDLE_INDEX_MASK ((1 << MGL_RESOURCE_HANDLE_INDEX_BITS) - 1)
+#define MGL_RESOURCE_HANDLE_GENERATION_MASK ((1 << (32 - MGL_RESOURCE_HANDLE_INDEX_BITS)) - 1)
+
+/*TODO re-evaluate how the memory is packed.*/
+
+typedef struct MglResourceHeader_S MglResourceHeader;
+
+/*an asynchronous load in flight.  Workers only touch filename, data_prepare and prepared*/
+typedef struct
+{
+  MglResourceManager *manager;
+  MglResourceHeader  *element;
+  MglLine             filename;
+  void *(*data_prepare)(char *filename);/**<copy of the manager's prepare function, run on a worker*/
+  void  (*prepared_free)(void *prepared);/**<copy of the manager's function to discard prepared data*/
+  void               *prepared;   /**<result of data_prepare, handed to data_finalize on the main thread*/
+  MglBool             cancelled;  /**<the element was freed before the load finished*/
+  MglBool             quit;       /**<tells the worker that pops it to exit*/
+  MglBool             release;    /**<not a load, the worker only frees prepared with prepared_free*/
+  GList              *callbacks;  /**<list of MglCallback * to call once the load is complete*/
+  Uint64              startTime;  /**<performance counter when the load was requested*/
+}MglResourceLoadJob;
+
+/*a resource in the dependency graph.  Named rather than pointed at so it outlives the elements and managers it describes*/
+typedef struct MglResourceNode_S
+{
+  MglLine managerName;
+  MglLine filename;
+  GList  *dependencies;/**<MglResourceNode * that this resource loads while it loads*/
+  MglInt  depth;       /**<scratch space for batch expansion, -1 when not in use*/
+  MglBool visiting;    /**<scratch space for batch expansion, stops dependency cycles*/
+}MglResourceNode;
+
+typedef struct
+{
+  MglResourceManager *manager;
+  MglLine             filename;
+  MglInt              depth;    /**<longest chain of dependents above this resource in the batch*/
+  void               *data;     /**<the reference held by the batch, NULL until requested or if skipped*/
+  MglBool             requested;
+}MglResourceBatchEntry;
+
+struct MglResourceBatch_S
+{
+  GList  *entries; /**<MglResourceBatchEntry *, the roots until started, then the whole expansion deepest first*/
+  GList  *level;   /**<first entry of the depth currently loading, NULL once everything is requested and done*/
+  MglBool started;
+};
 
 struct MglResourceManager_S
 {
   MglBool      _initialized;/**<true after setup, if false, don't touch*/
   MglLine      name;        /**<name of the resource manager, used in debugging*/
   MglUint      _data_count; /**<how many resources are currently alive*/
-  MglUint      _data_max;   /**<hard limit on the number of resources that can be managed*/
+  MglUint      _data_max;   /**<number of slots currently allocated*/
+  MglUint      _data_cap;   /**<hard limit on the number of slots, 0 for no limit*/
+  MglUint      _slab_size;  /**<number of slots allocated together whenever the manager grows*/
+  MglUint      _slab_count; /**<how many slabs are allocated*/
+  MglUint      _generation_seed;/**<starting generation for new slots, so handles into trimmed slabs stay stale*/
   MglUint      _data_size;  /**<size of the data resource being managed*/
   MglBool      _data_unique;/**<if true, duplicates are not allowed, if false, subsequent requests for the same resource will be given a reference to an existing element*/
-  unsigned long int _data_id_pool;/**<increments with every allocated resource.*/
-  GHashTable * _data_hash;   /**<hash from unique id to resource*/
-  char       * _data_list;   /**<character buffer of data*/
+  GHashTable * _filename_hash;/**<hash from filename to resource header, only kept for non-unique managers*/
+  MglResourceStats _stats;   /**<counters kept as the manager is used, sizes are filled in when queried*/
+  char      ** _data_slabs;  /**<list of character buffers of data, each _slab_size slots long*/
+  MglResourceHeader * _free_head;/**<unreferenced element to be reclaimed next (oldest free)*/
+  MglResourceHeader * _free_tail;/**<most recently freed element*/
+  MglResourceHeader **_live_list;/**<packed list of referenced elements, used for iteration*/
+  MglUint      _live_count;  /**<how many elements are in the live list*/
+  MglUint      _live_max;    /**<how many elements the live list has room for*/
+  MglUint      _live_passes; /**<foreach passes running, removals leave a NULL until the last one ends*/
+  MglBool      _live_holes;  /**<the live list has NULLs to pack out*/
+  GList      * _pending_jobs;/**<asynchronous loads in flight for this manager*/
   void (*data_delete)(void *data);/**<function pointer to the delete function for the resource*/
   MglBool (*data_load)(char *filename,void *data);/**<function pointer to the loading function*/
+  void *(*data_prepare)(char *filename);/**<optional thread safe part of loading*/
+  MglBool (*data_finalize)(void *prepared,void *data);/**<main thread part of loading, takes ownership of prepared*/
+  void (*prepared_free)(void *prepared);/**<discards prepared data if the load is abandoned*/
+  void *(*data_detach)(void *data);/**<optional, pulls out the parts of the data that can be freed on another thread*/
+  void (*detached_free)(void *detached);/**<frees what data_detach returned, on a loader thread*/
+  MglUint      _collect_before;/**<unreferenced elements freed up to this time are waiting on the collector*/
+  MglBool      _collect_pending;/**<mgl_resource_collect_update still has work for this manager*/
+  size_t       _resident_bytes;/**<bytes reported by the loader for every element still holding data*/
+  size_t       _cached_bytes;  /**<the part of _resident_bytes held by unreferenced elements*/
+  MglResourceHeader *_cache_head;/**<oldest unreferenced element still holding data*/
+  MglResourceHeader *_cache_tail;/**<newest unreferenced element still holding data*/
+  SDL_mutex   *_lock;        /**<only set for concurrent managers, guards everything above it*/
+  SDL_cond    *_load_done;   /**<signalled under _lock whenever a load running on some thread finishes*/
 };
 
 /*All resources managed by this system must contain this header structure.*/
-typedef struct
+struct MglResourceHeader_S
 {
   MglUint refCount;
   MglLine filename;
   MglUint index;
-  unsigned long int id;/**<unique identifier.  In case of a memory re-use it can be
-  compared with expected for validity*/
+  MglUint generation;/**<bumped every time the slot is handed out, never 0 for an allocated element*/
   MglUint timeFree; /**<time when free was called on resource.  Oldest get reclaimed first*/
+  MglResourceHeader *freeNext;/**<next element in the free list, more recently freed*/
+  MglResourceHeader *freePrev;/**<previous element in the free list, less recently freed*/
+  MglUint liveIndex;/**<position in the live list.  After removal, the position it vacated*/
+  MglResourceLoadJob *loadJob;/**<set while an asynchronous load is pending*/
+  MglBool loadFailed;/**<an asynchronous load did not succeed*/
+  size_t size;/**<bytes reported by the loader*/
+  MglBool cached;/**<unreferenced but still holding data, it can be evicted*/
+  MglResourceHeader *cacheNext;/**<next element in the eviction list, more recently freed*/
+  MglResourceHeader *cachePrev;/**<previous element in the eviction list, less recently freed*/
+  MglBool loading;/**<concurrent managers only, data_load is running outside the manager lock*/
+  SDL_threadID loadingThread;/**<the thread running that data_load*/
   MglUint underflowprot;
-}MglResourceHeader;
+};
 
 /*local variables*/
+static GAsyncQueue  * __mgl_resource_job_queue = NULL; /**<loads waiting for a worker*/
+static GAsyncQueue  * __mgl_resource_done_queue = NULL;/**<loads waiting to be finalized on the main thread*/
+static SDL_Thread  ** __mgl_resource_workers = NULL;
+static MglUint        __mgl_resource_worker_count = 0;
+static GList        * __mgl_resource_managers = NULL;     /**<every live manager, for budget enforcement and stats*/
+static MglUint        __mgl_resource_stats_last_dump = 0;
+static size_t         __mgl_resource_budget = 0;          /**<0 for no limit*/
+static size_t         __mgl_resource_resident_bytes = 0;
+static SDL_SpinLock   __mgl_resource_evicting = 0;        /**<held while an eviction is deleting, nested or concurrent frees leave the budget to it*/
+static SDL_atomic_t   __mgl_resource_evict_deferred = {0};/**<set when another thread went over budget, the main thread evicts on its next update*/
+static SDL_SpinLock   __mgl_resource_bytes_lock = 0;      /**<guards __mgl_resource_resident_bytes for concurrent managers*/
+static SDL_SpinLock   __mgl_resource_async_lock = 0;      /**<guards starting the loader threads*/
+static SDL_threadID   __mgl_resource_main_thread = 0;     /**<the thread that set up the first manager*/
+static GHashTable   * __mgl_resource_graph = NULL;        /**<"manager|filename" to MglResourceNode, main thread only*/
+static GList        * __mgl_resource_loading = NULL;      /**<MglResourceNode * for each load running on the main thread, innermost first*/
 
 /*local function prototypes*/
 static void mgl_resource_delete_element(MglResourceManager *manager,MglResourceHeader *element);
@@ -44,22 +140,94 @@ static MglResourceHeader *mgl_resource_get_header_by_data(void *data);
 static MglResourceHeader * mgl_resource_get_next_element(MglResourceManager *manager,MglResourceHeader *element);
 static MglBool mgl_resource_validate_header_range(MglResourceManager *manager,MglResourceHeader *element);
 static MglResourceManager *mgl_resource_manager_new();
+static MglBool mgl_resource_manager_grow(MglResourceManager *manager);
 
-static MglBool mgl_resource_initialize_hash(MglResourceManager *manager);
-static MglBool mgl_resource_hash_element(MglResourceManager *manager,MglResourceHeader *element);
-static MglBool mgl_resource_hash_clear_element(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_free_list_push_front(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_free_list_push_back(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_free_list_unlink(MglResourceManager *manager,MglResourceHeader *element);
+static MglResourceHeader *mgl_resource_free_list_pop(MglResourceManager *manager);
+static void mgl_resource_live_list_add(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_live_list_pack(MglResourceManager *manager);
+static void mgl_resource_live_list_remove(MglResourceManager *manager,MglResourceHeader *element);
+
+static void mgl_resource_filename_hash_insert(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_filename_hash_remove(MglResourceManager *manager,MglResourceHeader *element);
+
+static void mgl_resource_cache_push_back(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_cache_unlink(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_enforce_budget();
+static void mgl_resource_enforce_deferred_budget();
+static void mgl_resource_element_release(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_stats_record_load(MglResourceManager *manager,Uint64 start,MglBool loaded);
+
+static void mgl_resource_element_reference(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_manager_lock(MglResourceManager *manager);
+static void mgl_resource_manager_unlock(MglResourceManager *manager);
+static MglBool mgl_resource_manager_try_lock(MglResourceManager *manager);
+static MglBool mgl_resource_on_main_thread();
+static void mgl_resource_resident_bytes_add(size_t add,size_t sub);
+static void mgl_resource_async_start();
+static void mgl_resource_async_close();
+static int mgl_resource_async_worker(void *data);
+static void mgl_resource_job_finish(MglResourceLoadJob *job);
+static void mgl_resource_job_cancel(MglResourceLoadJob *job);
+static void mgl_resource_job_free(MglResourceLoadJob *job);
+static void mgl_resource_job_wait(MglResourceManager *manager,MglResourceHeader *element);
+static void mgl_resource_release_detached(MglResourceManager *manager,void *detached);
+
+static MglResourceNode *mgl_resource_graph_get_node(const char *managerName,const char *filename);
+static void mgl_resource_graph_add_edge(MglResourceNode *node,MglResourceNode *dependency);
+static void mgl_resource_graph_free();
+static void mgl_resource_record_dependency(MglResourceManager *manager,char *filename);
+static void mgl_resource_loading_push(MglResourceManager *manager,char *filename);
+static void mgl_resource_loading_pop();
+static void mgl_resource_batch_request_level(MglResourceBatch *batch);
 
 
 MglResourceHeader *mgl_resource_get_header_by_index(MglResourceManager *manager,MglUint i)
 {
   if (!manager)return NULL;
   if (i >= manager->_data_max)return NULL;
-  return (MglResourceHeader *)&manager->_data_list[(i * manager->_data_size)];
+  return (MglResourceHeader *)&manager->_data_slabs[i / manager->_slab_size][(i % manager->_slab_size) * manager->_data_size];
+}
+
+/*called with the manager locked, returns with it unlocked*/
+static void *mgl_resource_load_concurrent(MglResourceManager *manager,MglResourceHeader *element,char *filename)
+{
+  void *data;
+  Uint64 start;
+  MglBool loaded;
+  mgl_line_cpy(element->filename,filename);
+  mgl_resource_filename_hash_insert(manager,element);
+  element->loading = MglTrue;
+  element->loadingThread = SDL_ThreadID();
+  mgl_resource_manager_unlock(manager);
+  start = SDL_GetPerformanceCounter();
+  mgl_resource_loading_push(manager,filename);
+  loaded = manager->data_load(filename,mgl_resource_get_data_by_header(element));
+  mgl_resource_loading_pop();
+  mgl_resource_manager_lock(manager);
+  mgl_resource_stats_record_load(manager,start,loaded);
+  element->loading = MglFalse;
+  SDL_CondBroadcast(manager->_load_done);
+  data = mgl_resource_get_data_by_header(element);
+  if (!loaded)
+  {
+    /*threads that found it while it was loading see the failure and drop their references*/
+    element->loadFailed = MglTrue;
+    mgl_resource_filename_hash_remove(manager,element);
+    mgl_resource_free_element(manager,&data);
+  }
+  mgl_resource_manager_unlock(manager);
+  return data;
 }
 
 void *mgl_resource_manager_load_resource(MglResourceManager *manager,char *filename)
 {
   MglResourceHeader * element = NULL;
+  void *data = NULL;
+  Uint64 start;
+  MglBool loaded;
   if ((!filename)||(strlen(filename) <= 0))return NULL;
   if (!manager)
   {
@@ -72,34 +240,74 @@ void *mgl_resource_manager_load_resource(MglResourceManager *manager,char *filen
   {
     return NULL;
   }
+  mgl_resource_record_dependency(manager,filename);
+  mgl_resource_manager_lock(manager);
   if (manager->_data_unique == MglFalse)
   {
     element = mgl_resource_find_element_by_filename(manager,filename);
     if (element != NULL)
     {
-      if (element->refCount == 0)
+      manager->_stats.hits++;
+      mgl_resource_element_reference(manager,element);
+      if ((element->loading) && (element->loadingThread == SDL_ThreadID()))
+      {
+        mgl_logger_error(
+          "mgl_resource: manager %s: %s depends on itself\n",
+          manager->name,
+          filename);
+        element->refCount--;
+        mgl_resource_manager_unlock(manager);
+        return NULL;
+      }
+      while (element->loading)
+      {
+        /*another thread is loading it, the hash entry was added early so it is only loaded once*/
+        SDL_CondWait(manager->_load_done,manager->_lock);
+      }
+      if (element->loadJob != NULL)
+      {
+        /*the caller expects a loaded resource, so finish it now*/
+        mgl_resource_job_wait(manager,element);
+      }
+      data = mgl_resource_get_data_by_header(element);
+      if (element->loadFailed)
       {
-        manager->_data_count++;
+        mgl_resource_free_element(manager,&data);
       }
-      element->refCount++;
-      return mgl_resource_get_data_by_header(element);
+      mgl_resource_manager_unlock(manager);
+      return data;
     }
   }
+  manager->_stats.misses++;
   element = mgl_resource_get_header_by_data(mgl_resource_new_element(manager));
   if (element == NULL)
   {
+    mgl_resource_manager_unlock(manager);
     return NULL;
   }
+  if (manager->_lock != NULL)
+  {
+    return mgl_resource_load_concurrent(manager,element,filename);
+  }
   
   if (manager->data_load != NULL)
   {
-    if (!manager->data_load(filename,mgl_resource_get_data_by_header(element)))
+    start = SDL_GetPerformanceCounter();
+    mgl_resource_loading_push(manager,filename);
+    loaded = manager->data_load(filename,mgl_resource_get_data_by_header(element));
+    mgl_resource_loading_pop();
+    mgl_resource_stats_record_load(manager,start,loaded);
+    if (!loaded)
     {
+      mgl_resource_live_list_remove(manager,element);
       mgl_resource_delete_element(manager,element);
+      manager->_data_count--;
+      mgl_resource_free_list_push_front(manager,element);
       return NULL;
     }
   }
   mgl_line_cpy(element->filename,filename);
+  mgl_resource_filename_hash_insert(manager,element);
   return mgl_resource_get_data_by_header(element);
 }
 
@@ -111,6 +319,10 @@ void mgl_resource_manager_free(MglResourceManager **manager_pp)
   if (!manager_pp)return;
   if (!*manager_pp)return;
   manager = *manager_pp;
+  while (manager->_pending_jobs != NULL)
+  {
+    mgl_resource_job_cancel((MglResourceLoadJob *)manager->_pending_jobs->data);
+  }
   if (manager->data_delete != NULL)
   {
     for (i = 0 ; i < manager->_data_max;i++)
@@ -119,7 +331,26 @@ void mgl_resource_manager_free(MglResourceManager **manager_pp)
       manager->data_delete(mgl_resource_get_data_by_header(element));
     }
   }
-  free(manager->_data_list);
+  if (manager->_filename_hash != NULL)
+  {
+    g_hash_table_destroy(manager->_filename_hash);
+  }
+  mgl_resource_resident_bytes_add(0,manager->_resident_bytes);
+  __mgl_resource_managers = g_list_remove(__mgl_resource_managers,manager);
+  if (manager->_lock != NULL)
+  {
+    SDL_DestroyMutex(manager->_lock);
+  }
+  if (manager->_load_done != NULL)
+  {
+    SDL_DestroyCond(manager->_load_done);
+  }
+  for (i = 0; i < manager->_slab_count;i++)
+  {
+    free(manager->_data_slabs[i]);
+  }
+  free(manager->_data_slabs);
+  free(manager->_live_list);
   free(manager);
   *manager_pp = NULL;
 }
@@ -147,9 +378,34 @@ MglResourceManager * mgl_resource_manager_init(
     MglBool (*data_load)(char *filename,void *data)
   )
 {
-  int i;
-  MglResourceHeader * element = NULL;
+  return mgl_resource_manager_init_growable(
+    managerName,
+    max,
+    max,
+    dataSize,
+    dataUnique,
+    data_delete,
+    data_load);
+}
+
+MglResourceManager * mgl_resource_manager_init_growable(
+    MglLine managerName,
+    MglUint slabSize,
+    MglUint max,
+    MglUint dataSize,
+    MglBool dataUnique,
+    void    (*data_delete)(void *data),
+    MglBool (*data_load)(char *filename,void *data)
+  )
+{
   MglResourceManager *manager = NULL;
+  if (slabSize == 0)
+  {
+    mgl_logger_error(
+      "mgl_resource:manager %s needs a slab size of at least one element\n",
+      managerName);
+    return NULL;
+  }
   manager = mgl_resource_manager_new();
   if (manager == NULL)
   {
@@ -157,34 +413,103 @@ MglResourceManager * mgl_resource_manager_init(
   }
   strncpy(manager->name,managerName,MGLLINELEN);
   manager->_data_count = 0;
-  manager->_data_id_pool = 0;
-  manager->_data_max = max;
+  manager->_data_max = 0;
+  /*handles can only address so many slots*/
+  if ((max == 0) || (max > MGL_RESOURCE_HANDLE_INDEX_MASK + 1))
+  {
+    max = MGL_RESOURCE_HANDLE_INDEX_MASK + 1;
+  }
+  manager->_data_cap = max;
+  manager->_slab_size = slabSize;
   manager->_data_unique = dataUnique;
   manager->_data_size = dataSize + sizeof(MglResourceHeader);
-  manager->_data_list = malloc(manager->_data_size * max);
+  manager->_live_count = 0;
   manager->data_delete = data_delete;
   manager->data_load = data_load;
-  if (manager->_data_list == NULL)
+  if (!mgl_resource_manager_grow(manager))
   {
-    mgl_logger_error(
-      "mgl_resource:unable to allocate resource list\n"
-    );
+    free(manager->_data_slabs);
+    free(manager->_live_list);
     free(manager);
-    return NULL;    
+    return NULL;
   }
-  memset(manager->_data_list,0,manager->_data_size * max);
-  for (i = 0 ; i < manager->_data_max;i++)
+  if (!dataUnique)
   {
-    element = mgl_resource_get_header_by_index(manager,i);
-    element->index = i;
-    element->refCount = 0;
-    element->timeFree = 0;
+    manager->_filename_hash = g_hash_table_new(g_str_hash, g_str_equal);
+  }
+  if (__mgl_resource_managers == NULL)
+  {
+    __mgl_resource_main_thread = SDL_ThreadID();
   }
-  mgl_resource_initialize_hash(manager);
+  __mgl_resource_managers = g_list_append(__mgl_resource_managers,manager);
   manager->_initialized = MglTrue;
   return manager;
 }
 
+MglResourceManager * mgl_resource_manager_init_concurrent(
+    MglLine managerName,
+    MglUint slabSize,
+    MglUint max,
+    MglUint dataSize,
+    MglBool dataUnique,
+    void    (*data_delete)(void *data),
+    MglBool (*data_load)(char *filename,void *data)
+  )
+{
+  MglResourceManager *manager;
+  manager = mgl_resource_manager_init_growable(
+    managerName,
+    slabSize,
+    max,
+    dataSize,
+    dataUnique,
+    data_delete,
+    data_load);
+  if (manager == NULL)return NULL;
+  manager->_lock = SDL_CreateMutex();
+  manager->_load_done = SDL_CreateCond();
+  if ((manager->_lock == NULL) || (manager->_load_done == NULL))
+  {
+    mgl_logger_error(
+      "mgl_resource: failed to create the lock for manager %s: %s\n",
+      managerName,
+      SDL_GetError());
+    mgl_resource_manager_free(&manager);
+    return NULL;
+  }
+  return manager;
+}
+
+static void mgl_resource_manager_lock(MglResourceManager *manager)
+{
+  if (manager->_lock == NULL)return;
+  SDL_LockMutex(manager->_lock);
+}
+
+static void mgl_resource_manager_unlock(MglResourceManager *manager)
+{
+  if (manager->_lock == NULL)return;
+  SDL_UnlockMutex(manager->_lock);
+}
+
+static MglBool mgl_resource_manager_try_lock(MglResourceManager *manager)
+{
+  if (manager->_lock == NULL)return MglTrue;
+  return (SDL_TryLockMutex(manager->_lock) == 0);
+}
+
+static MglBool mgl_resource_on_main_thread()
+{
+  return (__mgl_resource_main_thread == 0) || (SDL_ThreadID() == __mgl_resource_main_thread);
+}
+
+static void mgl_resource_resident_bytes_add(size_t add,size_t sub)
+{
+  SDL_AtomicLock(&__mgl_resource_bytes_lock);
+  __mgl_resource_resident_bytes = __mgl_resource_resident_bytes + add - sub;
+  SDL_AtomicUnlock(&__mgl_resource_bytes_lock);
+}
+
 MglUint mgl_resource_manager_get_element_count(MglResourceManager *manager)
 {
   if (!manager)return 0;
@@ -204,7 +529,8 @@ void * mgl_resource_get_next_data(MglResourceManager *manager,void *data)
 
 MglResourceHeader * mgl_resource_get_next_element(MglResourceManager *manager,MglResourceHeader *element)
 {
-  int index = 0;
+  MglResourceHeader *next = NULL;
+  MglUint position = 0;
   if (manager == NULL)
   {
     mgl_logger_warn(
@@ -218,29 +544,58 @@ MglResourceHeader * mgl_resource_get_next_element(MglResourceManager *manager,Mg
       manager->name);
     return NULL;
   }
-  if (element == NULL)
+  mgl_resource_manager_lock(manager);
+  if (element != NULL)
   {
-    index = 0;
+    position = element->liveIndex;
+    if ((position < manager->_live_count) && (manager->_live_list[position] == element))
+    {
+      position++;
+    }
+    /*otherwise the element was freed and the last live element was swapped into its place*/
   }
-  else
+  /*elements freed during a foreach pass leave a hole until the pass ends*/
+  while ((position < manager->_live_count) && (manager->_live_list[position] == NULL))position++;
+  if (position < manager->_live_count)
   {
-    index = element->index + 1;
+    next = manager->_live_list[position];
   }
-  for ( ; index < manager->_data_max;index++)
+  mgl_resource_manager_unlock(manager);
+  return next;
+}
+
+void mgl_resource_manager_foreach(MglResourceManager *manager,MglCallback callback)
+{
+  MglUint position = 0;
+  MglResourceHeader *element;
+  if (manager == NULL)
   {
-    element = (MglResourceHeader *)&manager->_data_list[(index * manager->_data_size)];
-    if (element->refCount > 0)
-    {
-      return element;
-    }
+    mgl_logger_warn(
+      "mgl_resource:passed a NULL manager\n");
+    return;
   }
-  return NULL;
+  if (callback.function == NULL)return;
+  mgl_resource_manager_lock(manager);
+  /*nothing moves while the pass runs, freed elements leave a hole and new ones go on the end*/
+  manager->_live_passes++;
+  for (position = 0;position < manager->_live_count;position++)
+  {
+    element = manager->_live_list[position];
+    if (element == NULL)continue;
+    callback.function(callback.data,mgl_resource_get_data_by_header(element));
+  }
+  manager->_live_passes--;
+  if ((manager->_live_passes == 0) && (manager->_live_holes))
+  {
+    mgl_resource_live_list_pack(manager);
+  }
+  mgl_resource_manager_unlock(manager);
 }
 
 MglResourceHeader * mgl_resource_find_element_by_filename(MglResourceManager *manager,char *filename)
 {
-  MglResourceHeader *element = NULL;
-  int i = 0;
+  MglResourceHeader *element;
+  MglLine key;
   if (manager == NULL)
   {
     mgl_logger_warn(
@@ -254,23 +609,19 @@ MglResourceHeader * mgl_resource_find_element_by_filename(MglResourceManager *ma
       manager->name);
     return NULL;
   }
-  for (i = 0 ; i < manager->_data_max;i++)
-  {
-    element = mgl_resource_get_header_by_index(manager,i);
-    if (strncmp(filename,element->filename,MGLLINELEN) == 0)
-    {
-      return element;
-    }
-  }
-  return NULL;
+  if (manager->_filename_hash == NULL)return NULL;
+  /*stored filenames are truncated to MglLine, so look up by the same key*/
+  mgl_line_cpy(key,filename);
+  key[MGLLINELEN - 1] = '\0';
+  mgl_resource_manager_lock(manager);
+  element = (MglResourceHeader *)g_hash_table_lookup(manager->_filename_hash,key);
+  mgl_resource_manager_unlock(manager);
+  return element;
 }
 
 void * mgl_resource_new_element(MglResourceManager *manager)
 {
-  int i = 0;
   MglResourceHeader *element = NULL;
-  MglResourceHeader *oldest = NULL;
-  MglUint            oldestTime = SDL_GetTicks() + 1;
   if (manager == NULL)
   {
     mgl_logger_warn(
@@ -284,34 +635,29 @@ void * mgl_resource_new_element(MglResourceManager *manager)
       manager->name);
     return NULL;
   }
-
-  for (i = 0 ; i < manager->_data_max;i++)
+  mgl_resource_manager_lock(manager);
+  /*the head of the free list is always the oldest unreferenced element*/
+  element = mgl_resource_free_list_pop(manager);
+  if ((element == NULL) && (mgl_resource_manager_grow(manager)))
   {
-    element = mgl_resource_get_header_by_index(manager,i);
-    if (element->refCount == 0)
-    {
-      if (element->timeFree <= oldestTime)
-      {
-        oldest = element;
-        oldestTime = element->timeFree;
-        if (element->timeFree == 0)
-        {
-          /*cant get older than never used*/
-          break;
-        }
-      }
-    }
+    element = mgl_resource_free_list_pop(manager);
   }
-  if (oldest != NULL)
+  if (element != NULL)
   {
-    element = oldest;
+    if (element->cached)
+    {
+      manager->_stats.reclaims++;
+    }
     mgl_resource_delete_element(manager,element);
-    element->id = manager->_data_id_pool++;
+    element->generation = (element->generation + 1) & MGL_RESOURCE_HANDLE_GENERATION_MASK;
+    if (element->generation == 0)element->generation = 1;
     element->refCount = 1;
     manager->_data_count++;
-    mgl_resource_hash_element(manager,element);
+    mgl_resource_live_list_add(manager,element);
+    mgl_resource_manager_unlock(manager);
     return mgl_resource_get_data_by_header(element);
   }
+  mgl_resource_manager_unlock(manager);
 
   mgl_logger_error(
     "mgl_resource: manager %s has no room left for new elements!\n",
@@ -326,29 +672,52 @@ void mgl_resource_free_element(MglResourceManager *manager,void **data)
   if (!data)return;
   if (!*data)return;
   element = mgl_resource_get_header_by_data(*data);
+  mgl_resource_manager_lock(manager);
+  if (element->refCount == 0)
+  {
+    mgl_resource_manager_unlock(manager);
+    mgl_logger_warn(
+      "mgl_resource: manager %s asked to free an unreferenced element\n",
+      manager->name);
+    *data = NULL;
+    return;
+  }
+  if ((element->loadJob != NULL) && ((manager->_data_unique) || (element->refCount == 1)))
+  {
+    /*nobody is left waiting on the load*/
+    mgl_resource_job_cancel(element->loadJob);
+  }
   if (manager->_data_unique)
   {
+    mgl_resource_live_list_remove(manager,element);
     mgl_resource_delete_element(manager,element);
-    element->timeFree = 0;
+    element->timeFree = SDL_GetTicks();
     manager->_data_count--;
     element->refCount = 0;
+    /*queued behind older slots so an iteration still positioned on it does not see it reused right away*/
+    mgl_resource_free_list_push_back(manager,element);
   }
   else
   {
     element->refCount--;
     if (element->refCount == 0)
     {
+      mgl_resource_live_list_remove(manager,element);
       manager->_data_count--;
+      element->timeFree = SDL_GetTicks();
+      mgl_resource_free_list_push_back(manager,element);
+      /*the data stays loaded for reuse until the slot is needed or the budget evicts it*/
+      mgl_resource_cache_push_back(manager,element);
+      mgl_resource_enforce_budget();
     }
-    element->timeFree = SDL_GetTicks();
   }
+  mgl_resource_manager_unlock(manager);
   *data = NULL;
 }
 
 void mgl_resource_manager_clear(MglResourceManager *manager)
 {
   MglResourceHeader *element = NULL;
-  int i = 0;
   if (manager == NULL)
   {
     mgl_logger_warn(
@@ -369,18 +738,28 @@ void mgl_resource_manager_clear(MglResourceManager *manager)
       manager->name);
     return;
   }
-  for (i = 0 ; i < manager->_data_max;i++)
+  mgl_resource_manager_lock(manager);
+  while (manager->_pending_jobs != NULL)
   {
-    element = mgl_resource_get_header_by_index(manager,i);
-    manager->data_delete(&element[1]);
+    mgl_resource_job_cancel((MglResourceLoadJob *)manager->_pending_jobs->data);
+  }
+  /*every element goes through delete once, any references still held are now invalid*/
+  while (manager->_live_count > 0)
+  {
+    element = manager->_live_list[--manager->_live_count];
+    if (element == NULL)continue;/*freed during a foreach pass*/
+    mgl_resource_delete_element(manager,element);
+    element->refCount = 0;
+    element->timeFree = SDL_GetTicks();
+    mgl_resource_free_list_push_front(manager,element);
   }
   manager->_data_count = 0;
+  mgl_resource_manager_clean(manager);
+  mgl_resource_manager_unlock(manager);
 }
 
 void mgl_resource_manager_clean(MglResourceManager *manager)
 {
-  MglResourceHeader *element = NULL;
-  int i = 0;
   if (manager == NULL)
   {
     mgl_logger_warn(
@@ -401,29 +780,155 @@ void mgl_resource_manager_clean(MglResourceManager *manager)
       manager->name);
     return;
   }
-  for (i = 0 ; i < manager->_data_max;i++)
+  mgl_resource_manager_lock(manager);
+  /*only unreferenced elements still holding data are on the cache list*/
+  while (manager->_cache_head != NULL)
   {
-    element = mgl_resource_get_header_by_index(manager,i);
-    if (element->refCount == 0)
+    mgl_resource_element_release(manager,manager->_cache_head);
+  }
+  manager->_collect_pending = MglFalse;
+  mgl_resource_manager_unlock(manager);
+}
+
+void mgl_resource_manager_clean_incremental(MglResourceManager *manager)
+{
+  if (manager == NULL)
+  {
+    mgl_logger_warn(
+      "mgl_resource:passed a NULL manager\n");
+    return;
+  }
+  mgl_resource_manager_lock(manager);
+  manager->_collect_before = SDL_GetTicks();
+  manager->_collect_pending = MglTrue;
+  mgl_resource_manager_unlock(manager);
+}
+
+MglUint mgl_resource_collect_update(MglUint maxCount,MglUint budget)
+{
+  GList *it;
+  MglResourceManager *manager;
+  MglResourceHeader *element;
+  MglUint count = 0;
+  Uint64 start,limit;
+  mgl_resource_enforce_deferred_budget();
+  start = SDL_GetPerformanceCounter();
+  limit = (SDL_GetPerformanceFrequency() * budget) / 1000000;
+  for (it = __mgl_resource_managers;it != NULL;it = it->next)
+  {
+    manager = (MglResourceManager *)it->data;
+    if (!manager->_collect_pending)continue;
+    mgl_resource_manager_lock(manager);
+    while (1)
     {
-      manager->data_delete(&element[1]);
+      element = manager->_cache_head;
+      /*the list is ordered by free time, anything newer was freed after the clean was asked for*/
+      if ((element == NULL) || (element->timeFree > manager->_collect_before))
+      {
+        manager->_collect_pending = MglFalse;
+        break;
+      }
+      /*always make some progress, even on a tiny budget*/
+      if (((count > 0) && (maxCount) && (count >= maxCount)) ||
+          ((count > 0) && (budget) && ((SDL_GetPerformanceCounter() - start) >= limit)))
+      {
+        mgl_resource_manager_unlock(manager);
+        return count;
+      }
+      mgl_resource_element_release(manager,element);
+      count++;
     }
+    mgl_resource_manager_unlock(manager);
+  }
+  return count;
+}
+
+MglBool mgl_resource_collect_pending()
+{
+  GList *it;
+  for (it = __mgl_resource_managers;it != NULL;it = it->next)
+  {
+    if (((MglResourceManager *)it->data)->_collect_pending)return MglTrue;
+  }
+  return MglFalse;
+}
+
+void mgl_resource_manager_set_async_delete(
+  MglResourceManager *manager,
+  void *(*data_detach)(void *data),
+  void (*detached_free)(void *detached))
+{
+  if (!manager)return;
+  if ((data_detach == NULL) != (detached_free == NULL))
+  {
+    mgl_logger_warn(
+      "mgl_resource: manager %s needs both a detach and a free function for background deletes\n",
+      manager->name);
+    return;
+  }
+  manager->data_detach = data_detach;
+  manager->detached_free = detached_free;
+  if (data_detach != NULL)
+  {
+    mgl_resource_async_start();
+  }
+}
+
+static void mgl_resource_release_detached(MglResourceManager *manager,void *detached)
+{
+  MglResourceLoadJob *job;
+  if (detached == NULL)return;
+  if (__mgl_resource_worker_count == 0)
+  {
+    manager->detached_free(detached);
+    return;
+  }
+  job = (MglResourceLoadJob *)malloc(sizeof(MglResourceLoadJob));
+  if (job == NULL)
+  {
+    manager->detached_free(detached);
+    return;
   }
+  memset(job,0,sizeof(MglResourceLoadJob));
+  job->release = MglTrue;
+  job->prepared = detached;
+  job->prepared_free = manager->detached_free;
+  g_async_queue_push(__mgl_resource_job_queue,job);
+}
+
+static void mgl_resource_element_release(MglResourceManager *manager,MglResourceHeader *element)
+{
+  /*an empty slot is the cheapest to hand out next*/
+  mgl_resource_free_list_unlink(manager,element);
+  mgl_resource_delete_element(manager,element);
+  mgl_resource_free_list_push_front(manager,element);
 }
 
 void mgl_resource_delete_element(MglResourceManager *manager,MglResourceHeader *element)
 {
-  MglUint index;
+  MglUint index,liveIndex,generation;
   if (!manager)return;
   if (!element)return;
+  /*unlinked first, deleting may free references into other managers and start an eviction*/
+  mgl_resource_filename_hash_remove(manager,element);
+  mgl_resource_cache_unlink(manager,element);
+  if (manager->data_detach != NULL)
+  {
+    mgl_resource_release_detached(manager,manager->data_detach(&element[1]));
+  }
   if (manager->data_delete != NULL)
   {
     manager->data_delete(&element[1]);
   }
   index = element->index;
-  mgl_resource_hash_clear_element(manager,element);
+  liveIndex = element->liveIndex;
+  generation = element->generation;
+  manager->_resident_bytes -= element->size;
+  mgl_resource_resident_bytes_add(0,element->size);
   memset(element,0,manager->_data_size);
   element->index = index;
+  element->liveIndex = liveIndex;
+  element->generation = generation;
 }
 
 MglResourceHeader *mgl_resource_get_header_by_data(void *data)
@@ -441,40 +946,52 @@ void *mgl_resource_get_data_by_header(MglResourceHeader *resource)
   return (void *)((char *)resource + sizeof(MglResourceHeader));
 }
 
-MglBool mgl_resource_element_id_valid(MglResourceManager *manager,void *element,MglUint id)
+MglBool mgl_resource_element_id_valid(MglResourceManager *manager,void *element,unsigned long int id)
 {
-  if (mgl_resource_element_get_id(manager,element) == id)return MglTrue;
+  if (!element)return MglFalse;
+  if (mgl_resource_get_data_by_handle(manager,(MglResourceHandle)id) == element)return MglTrue;
   return MglFalse;
 }
 
 unsigned long int mgl_resource_element_get_id(MglResourceManager *manager,void *element)
+{
+  return mgl_resource_element_get_handle(manager,element);
+}
+
+MglResourceHandle mgl_resource_element_get_handle(MglResourceManager *manager,void *element)
 {
   MglResourceHeader *header;
+  MglResourceHandle handle;
   if (!manager)
   {
     mgl_logger_info(
       "mgl_resource:passed a NULL manager\n");
 
-    return -1;
+    return MGL_RESOURCE_HANDLE_NONE;
   }
   if (!element)
   {
     mgl_logger_info(
       "mgl_resource:passed a NULL element\n");
-    return -1;
+    return MGL_RESOURCE_HANDLE_NONE;
   }
   header = mgl_resource_get_header_by_data(element);
+  mgl_resource_manager_lock(manager);
   /*range verification*/
-  if (!mgl_resource_validate_header_range(manager,header))
+  if ((!mgl_resource_validate_header_range(manager,header)) || (header->refCount == 0))
   {
-    return -1;
+    mgl_resource_manager_unlock(manager);
+    return MGL_RESOURCE_HANDLE_NONE;
   }
-  return header->id;
+  handle = (header->generation << MGL_RESOURCE_HANDLE_INDEX_BITS) | header->index;
+  mgl_resource_manager_unlock(manager);
+  return handle;
 }
 
 MglUint mgl_resource_element_get_refcount(MglResourceManager *manager,void *element)
 {
   MglResourceHeader *header;
+  MglUint refCount = 0;
   if (!manager)
   {
     mgl_logger_info(
@@ -488,12 +1005,14 @@ MglUint mgl_resource_element_get_refcount(MglResourceManager *manager,void *elem
     return 0;
   }
   header = mgl_resource_get_header_by_data(element);
+  mgl_resource_manager_lock(manager);
   /*range verification*/
-  if (!mgl_resource_validate_header_range(manager,header))
+  if (mgl_resource_validate_header_range(manager,header))
   {
-    return 0;
+    refCount = header->refCount;
   }
-  return header->refCount;
+  mgl_resource_manager_unlock(manager);
+  return refCount;
 }
 
 void mgl_resource_element_get_filename(MglLine filename, MglResourceManager *manager,void *element)
@@ -512,12 +1031,13 @@ void mgl_resource_element_get_filename(MglLine filename, MglResourceManager *man
     return ;
   }
   header = mgl_resource_get_header_by_data(element);
+  mgl_resource_manager_lock(manager);
   /*range verification*/
-  if (!mgl_resource_validate_header_range(manager,header))
+  if (mgl_resource_validate_header_range(manager,header))
   {
-    return;
+    mgl_line_cpy(filename,header->filename);
   }
-  mgl_line_cpy(filename,header->filename);
+  mgl_resource_manager_unlock(manager);
 }
 
 MglInt mgl_resource_element_get_index(MglResourceManager *manager,void *element)
@@ -537,79 +1057,1347 @@ MglInt mgl_resource_element_get_index(MglResourceManager *manager,void *element)
     return -1;
   }
   header = mgl_resource_get_header_by_data(element);
+  mgl_resource_manager_lock(manager);
   /*range verification*/
   if (!mgl_resource_validate_header_range(manager,header))
   {
+    mgl_resource_manager_unlock(manager);
     return -1;
   }
+  mgl_resource_manager_unlock(manager);
   return header->index;
 }
 
 MglBool mgl_resource_validate_header_range(MglResourceManager *manager,MglResourceHeader *element)
 {
+  MglUint i,length;
+  char *slab;
   if (!manager)return MglFalse;
   if (!element)return MglFalse;
-  if ((void *)element < (void *)manager->_data_list)
+  for (i = 0; i < manager->_slab_count;i++)
+  {
+    slab = manager->_data_slabs[i];
+    length = MIN(manager->_slab_size,manager->_data_max - (i * manager->_slab_size));
+    if (((char *)element >= slab) && ((char *)element < &slab[length * manager->_data_size]))
+    {
+      return MglTrue;
+    }
+  }
+  mgl_logger_error(
+    "mgl_resource: element is not in the data list of manager %s.\n",
+    manager->name);
+  return MglFalse;
+}
+
+static MglBool mgl_resource_manager_grow(MglResourceManager *manager)
+{
+  MglUint i,slabSize,liveMax;
+  char **slabs;
+  MglResourceHeader **liveList;
+  MglResourceHeader *element;
+  slabSize = manager->_slab_size;
+  if (manager->_data_cap != 0)
+  {
+    if (manager->_data_max >= manager->_data_cap)return MglFalse;
+    /*the last slab may be cut short to respect the cap*/
+    slabSize = MIN(slabSize,manager->_data_cap - manager->_data_max);
+  }
+  slabs = (char **)realloc(manager->_data_slabs,sizeof(char *) * (manager->_slab_count + 1));
+  if (slabs == NULL)
   {
     mgl_logger_error(
-      "mgl_resource: underseeking in data list.\n");
+      "mgl_resource:unable to grow slab list for manager %s\n",
+      manager->name);
     return MglFalse;
   }
-  if ((void *)element > (void *)&manager->_data_list[manager->_data_max * manager->_data_size])
+  manager->_data_slabs = slabs;
+  /*only the lists of pointers move, element data never does*/
+  liveMax = MAX(manager->_live_max,manager->_data_max + slabSize);
+  liveList = (MglResourceHeader **)realloc(manager->_live_list,sizeof(MglResourceHeader *) * liveMax);
+  if (liveList == NULL)
   {
     mgl_logger_error(
-      "mgl_resource: overseeking in data list.\n");
+      "mgl_resource:unable to grow live list for manager %s\n",
+      manager->name);
     return MglFalse;
   }
+  manager->_live_list = liveList;
+  manager->_live_max = liveMax;
+  slabs[manager->_slab_count] = (char *)malloc(manager->_data_size * slabSize);
+  if (slabs[manager->_slab_count] == NULL)
+  {
+    mgl_logger_error(
+      "mgl_resource:unable to allocate resource list for manager %s\n",
+      manager->name);
+    return MglFalse;
+  }
+  memset(slabs[manager->_slab_count],0,manager->_data_size * slabSize);
+  manager->_slab_count++;
+  manager->_data_max += slabSize;
+  for (i = manager->_data_max - slabSize; i < manager->_data_max;i++)
+  {
+    element = mgl_resource_get_header_by_index(manager,i);
+    element->index = i;
+    element->generation = manager->_generation_seed;
+    element->refCount = 0;
+    element->timeFree = 0;
+    mgl_resource_free_list_push_back(manager,element);
+  }
   return MglTrue;
 }
 
-static MglBool mgl_resource_hash_element(MglResourceManager *manager,MglResourceHeader *element)
-{
-  void *data = NULL;
-  if (!manager)return MglFalse;
-  if (!element)return MglFalse;
-  data = (void *)(element+1);
-  g_hash_table_insert (manager->_data_hash,
-                       (gpointer)element->id,
-                       (gpointer)data);
-  return MglTrue;
-}
-
-static MglBool mgl_resource_hash_clear_element(MglResourceManager *manager,MglResourceHeader *element)
+void mgl_resource_manager_trim(MglResourceManager *manager)
 {
-  if (!manager)return MglFalse;
-  if (!element)return MglFalse;
-  g_hash_table_insert (manager->_data_hash,
-                       (gpointer)element->id,
-                       (gpointer)NULL);
-  return MglTrue;
+  MglUint i,first;
+  MglResourceHeader *element;
+  if (!manager)return;
+  mgl_resource_manager_lock(manager);
+  /*only the last slab can go, so that indices stay contiguous*/
+  while (manager->_slab_count > 1)
+  {
+    first = (manager->_slab_count - 1) * manager->_slab_size;
+    for (i = first; i < manager->_data_max;i++)
+    {
+      if (mgl_resource_get_header_by_index(manager,i)->refCount > 0)
+      {
+        mgl_resource_manager_unlock(manager);
+        return;
+      }
+    }
+    for (i = first; i < manager->_data_max;i++)
+    {
+      element = mgl_resource_get_header_by_index(manager,i);
+      mgl_resource_free_list_unlink(manager,element);
+      mgl_resource_delete_element(manager,element);
+      manager->_generation_seed = MAX(manager->_generation_seed,element->generation);
+    }
+    manager->_slab_count--;
+    free(manager->_data_slabs[manager->_slab_count]);
+    manager->_data_slabs[manager->_slab_count] = NULL;
+    manager->_data_max = first;
+  }
+  mgl_resource_manager_unlock(manager);
 }
 
-static MglBool mgl_resource_initialize_hash(MglResourceManager *manager)
+MglUint mgl_resource_manager_get_capacity(MglResourceManager *manager)
 {
-  if (!manager)return MglFalse;
-  if (manager->_data_hash != NULL)
+  if (!manager)return 0;
+  return manager->_data_max;
+}
+
+static void mgl_resource_free_list_push_front(MglResourceManager *manager,MglResourceHeader *element)
+{
+  element->freePrev = NULL;
+  element->freeNext = manager->_free_head;
+  if (manager->_free_head != NULL)
   {
-    mgl_logger_warn(
-      "mgl_resource: hash already initialized.\n");
-    return MglFalse;
+    manager->_free_head->freePrev = element;
   }
-  manager->_data_hash = g_hash_table_new(g_direct_hash, g_direct_equal);
-  return MglTrue;
+  else
+  {
+    manager->_free_tail = element;
+  }
+  manager->_free_head = element;
+}
+
+static void mgl_resource_free_list_push_back(MglResourceManager *manager,MglResourceHeader *element)
+{
+  element->freeNext = NULL;
+  element->freePrev = manager->_free_tail;
+  if (manager->_free_tail != NULL)
+  {
+    manager->_free_tail->freeNext = element;
+  }
+  else
+  {
+    manager->_free_head = element;
+  }
+  manager->_free_tail = element;
+}
+
+static void mgl_resource_free_list_unlink(MglResourceManager *manager,MglResourceHeader *element)
+{
+  if (element->freePrev != NULL)
+  {
+    element->freePrev->freeNext = element->freeNext;
+  }
+  else
+  {
+    manager->_free_head = element->freeNext;
+  }
+  if (element->freeNext != NULL)
+  {
+    element->freeNext->freePrev = element->freePrev;
+  }
+  else
+  {
+    manager->_free_tail = element->freePrev;
+  }
+  element->freeNext = NULL;
+  element->freePrev = NULL;
+}
+
+static MglResourceHeader *mgl_resource_free_list_pop(MglResourceManager *manager)
+{
+  MglResourceHeader *element;
+  element = manager->_free_head;
+  if (element == NULL)return NULL;
+  mgl_resource_free_list_unlink(manager,element);
+  return element;
+}
+
+static void mgl_resource_live_list_add(MglResourceManager *manager,MglResourceHeader *element)
+{
+  MglResourceHeader **liveList;
+  if (manager->_live_count >= manager->_live_max)
+  {
+    /*only holes left by a foreach pass can fill the list past the element count*/
+    liveList = (MglResourceHeader **)realloc(manager->_live_list,sizeof(MglResourceHeader *) * manager->_live_max * 2);
+    if (liveList == NULL)
+    {
+      mgl_logger_error(
+        "mgl_resource:unable to grow live list for manager %s\n",
+        manager->name);
+      return;
+    }
+    manager->_live_list = liveList;
+    manager->_live_max *= 2;
+  }
+  element->liveIndex = manager->_live_count;
+  manager->_live_list[manager->_live_count++] = element;
+  if (manager->_live_count > manager->_stats.peakLiveCount)
+  {
+    manager->_stats.peakLiveCount = manager->_live_count;
+  }
+}
+
+static void mgl_resource_live_list_remove(MglResourceManager *manager,MglResourceHeader *element)
+{
+  MglResourceHeader *last;
+  MglUint position;
+  position = element->liveIndex;
+  if ((position >= manager->_live_count) || (manager->_live_list[position] != element))return;
+  if (manager->_live_passes > 0)
+  {
+    /*swapping would move an element the pass has not reached behind it*/
+    manager->_live_list[position] = NULL;
+    manager->_live_holes = MglTrue;
+    return;
+  }
+  last = manager->_live_list[--manager->_live_count];
+  manager->_live_list[position] = last;
+  last->liveIndex = position;
+  /*element keeps the vacated position so iteration can resume from it*/
+}
+
+static void mgl_resource_live_list_pack(MglResourceManager *manager)
+{
+  MglUint i,count = 0;
+  for (i = 0;i < manager->_live_count;i++)
+  {
+    if (manager->_live_list[i] == NULL)continue;
+    manager->_live_list[count] = manager->_live_list[i];
+    manager->_live_list[count]->liveIndex = count;
+    count++;
+  }
+  manager->_live_count = count;
+  manager->_live_holes = MglFalse;
+}
+
+static void mgl_resource_filename_hash_insert(MglResourceManager *manager,MglResourceHeader *element)
+{
+  if (manager->_filename_hash == NULL)return;
+  /*the key lives in the header, so it must be removed before the header is cleared*/
+  element->filename[MGLLINELEN - 1] = '\0';
+  g_hash_table_insert(manager->_filename_hash,element->filename,element);
+}
+
+static void mgl_resource_filename_hash_remove(MglResourceManager *manager,MglResourceHeader *element)
+{
+  if (manager->_filename_hash == NULL)return;
+  if (element->filename[0] == '\0')return;
+  if (g_hash_table_lookup(manager->_filename_hash,element->filename) != element)return;
+  g_hash_table_remove(manager->_filename_hash,element->filename);
+}
+
+void mgl_resource_manager_get_filename_stats(MglResourceManager *manager,MglUint *hits,MglUint *misses)
+{
+  if (!manager)return;
+  if (hits)*hits = manager->_stats.hits;
+  if (misses)*misses = manager->_stats.misses;
 }
 
 void * mgl_resource_get_data_by_id(MglResourceManager *manager,unsigned long int id)
 {
+  return mgl_resource_get_data_by_handle(manager,(MglResourceHandle)id);
+}
+
+void * mgl_resource_get_data_by_handle(MglResourceManager *manager,MglResourceHandle handle)
+{
+  MglResourceHeader *element;
+  MglUint index;
+  void *data = NULL;
   if (!manager)return NULL;
-  if (!manager->_data_hash)
+  index = handle & MGL_RESOURCE_HANDLE_INDEX_MASK;
+  mgl_resource_manager_lock(manager);
+  if (index < manager->_data_max)
+  {
+    element = mgl_resource_get_header_by_index(manager,index);
+    if ((element->refCount > 0) && (element->generation == (handle >> MGL_RESOURCE_HANDLE_INDEX_BITS)))
+    {
+      data = mgl_resource_get_data_by_header(element);
+    }
+  }
+  mgl_resource_manager_unlock(manager);
+  return data;
+}
+
+MglBool mgl_resource_handle_valid(MglResourceManager *manager,MglResourceHandle handle)
+{
+  return mgl_resource_get_data_by_handle(manager,handle) != NULL;
+}
+
+static void mgl_resource_element_reference(MglResourceManager *manager,MglResourceHeader *element)
+{
+  if (element->refCount == 0)
+  {
+    mgl_resource_free_list_unlink(manager,element);
+    mgl_resource_cache_unlink(manager,element);
+    mgl_resource_live_list_add(manager,element);
+    manager->_data_count++;
+  }
+  element->refCount++;
+}
+
+void mgl_resource_manager_set_async_loader(
+  MglResourceManager *manager,
+  void *(*data_prepare)(char *filename),
+  MglBool (*data_finalize)(void *prepared,void *data),
+  void (*prepared_free)(void *prepared))
+{
+  if (!manager)return;
+  if ((data_prepare == NULL) != (data_finalize == NULL))
+  {
+    mgl_logger_warn(
+      "mgl_resource: manager %s needs both a prepare and a finalize function for async loading\n",
+      manager->name);
+    return;
+  }
+  manager->data_prepare = data_prepare;
+  manager->data_finalize = data_finalize;
+  manager->prepared_free = prepared_free;
+}
+
+void *mgl_resource_manager_load_resource_async(MglResourceManager *manager,char *filename,MglCallback *onLoaded)
+{
+  MglResourceHeader * element = NULL;
+  MglResourceLoadJob *job = NULL;
+  MglCallback *callback = NULL;
+  void *data = NULL;
+  if ((!filename)||(strlen(filename) <= 0))return NULL;
+  if (!manager)
+  {
+    mgl_logger_error(
+      "mgl_resource:passed in NULL resource manager for loading resource file: %s\n",
+      filename);
+    return NULL;
+  }
+  if (manager->data_load == NULL)
+  {
+    return NULL;
+  }
+  mgl_resource_record_dependency(manager,filename);
+  if (onLoaded != NULL)
+  {
+    callback = mgl_callback_new();
+    if (callback == NULL)return NULL;
+    mgl_callback_copy(callback,*onLoaded);
+  }
+  mgl_resource_manager_lock(manager);
+  if (manager->_data_unique == MglFalse)
+  {
+    element = mgl_resource_find_element_by_filename(manager,filename);
+    if (element != NULL)
+    {
+      manager->_stats.hits++;
+      mgl_resource_element_reference(manager,element);
+      data = mgl_resource_get_data_by_header(element);
+      while ((element->loading) && (element->loadingThread != SDL_ThreadID()))
+      {
+        SDL_CondWait(manager->_load_done,manager->_lock);
+      }
+      if (element->loadJob != NULL)
+      {
+        if (callback != NULL)
+        {
+          element->loadJob->callbacks = g_list_append(element->loadJob->callbacks,callback);
+        }
+        mgl_resource_manager_unlock(manager);
+        return data;
+      }
+      if (callback != NULL)
+      {
+        callback->function(callback->data,data);
+        mgl_callback_free(&callback);
+      }
+      mgl_resource_manager_unlock(manager);
+      return data;
+    }
+  }
+  manager->_stats.misses++;
+  data = mgl_resource_new_element(manager);
+  element = mgl_resource_get_header_by_data(data);
+  if (element == NULL)
+  {
+    mgl_resource_manager_unlock(manager);
+    mgl_callback_free(&callback);
+    return NULL;
+  }
+  job = (MglResourceLoadJob *)malloc(sizeof(MglResourceLoadJob));
+  if (job == NULL)
+  {
+    mgl_logger_error(
+      "mgl_resource: failed to allocate a load job for %s\n",
+      filename);
+    mgl_callback_free(&callback);
+    mgl_resource_free_element(manager,&data);
+    mgl_resource_manager_unlock(manager);
+    return NULL;
+  }
+  memset(job,0,sizeof(MglResourceLoadJob));
+  job->manager = manager;
+  job->element = element;
+  mgl_line_cpy(job->filename,filename);
+  job->data_prepare = manager->data_prepare;
+  job->prepared_free = manager->prepared_free;
+  job->startTime = SDL_GetPerformanceCounter();
+  if (callback != NULL)
+  {
+    job->callbacks = g_list_append(job->callbacks,callback);
+  }
+  element->loadJob = job;
+  manager->_pending_jobs = g_list_append(manager->_pending_jobs,job);
+  mgl_line_cpy(element->filename,filename);
+  mgl_resource_filename_hash_insert(manager,element);
+
+  mgl_resource_async_start();
+  if ((job->data_prepare != NULL) && (__mgl_resource_worker_count > 0))
+  {
+    g_async_queue_push(__mgl_resource_job_queue,job);
+  }
+  else
+  {
+    /*nothing can be done off thread, the whole load happens in the update*/
+    job->data_prepare = NULL;
+    g_async_queue_push(__mgl_resource_done_queue,job);
+  }
+  mgl_resource_manager_unlock(manager);
+  return data;
+}
+
+MglResourceLoadState mgl_resource_element_get_load_state(MglResourceManager *manager,void *data)
+{
+  MglResourceHeader *element;
+  MglResourceLoadState state = MglResourceLoaded;
+  if ((!manager)||(!data))return MglResourceFailed;
+  element = mgl_resource_get_header_by_data(data);
+  mgl_resource_manager_lock(manager);
+  if ((element->loadJob != NULL) || (element->loading))state = MglResourcePending;
+  else if (element->loadFailed)state = MglResourceFailed;
+  mgl_resource_manager_unlock(manager);
+  return state;
+}
+
+void mgl_resource_element_set_failed(MglResourceManager *manager,void *data)
+{
+  MglResourceHeader *element;
+  if ((!manager)||(!data))return;
+  element = mgl_resource_get_header_by_data(data);
+  mgl_resource_manager_lock(manager);
+  /*references already handed out stay valid, the next load of the file starts over*/
+  element->loadFailed = MglTrue;
+  mgl_resource_filename_hash_remove(manager,element);
+  mgl_resource_manager_unlock(manager);
+}
+
+MglResourceLoadState mgl_resource_element_wait(MglResourceManager *manager,void *data)
+{
+  MglResourceHeader *element;
+  MglResourceLoadState state = MglResourceLoaded;
+  if ((!manager)||(!data))return MglResourceFailed;
+  element = mgl_resource_get_header_by_data(data);
+  mgl_resource_manager_lock(manager);
+  if ((element->loading) && (element->loadingThread == SDL_ThreadID()))
+  {
+    mgl_resource_manager_unlock(manager);
+    return MglResourcePending;
+  }
+  while (element->loading)
+  {
+    SDL_CondWait(manager->_load_done,manager->_lock);
+  }
+  if (element->loadJob != NULL)
+  {
+    mgl_resource_job_wait(manager,element);
+  }
+  if (element->loadFailed)state = MglResourceFailed;
+  mgl_resource_manager_unlock(manager);
+  return state;
+}
+
+void mgl_resource_async_update(MglUint budget)
+{
+  MglResourceLoadJob *job;
+  Uint64 start,limit;
+  mgl_resource_enforce_deferred_budget();
+  if (__mgl_resource_done_queue == NULL)return;
+  start = SDL_GetPerformanceCounter();
+  limit = (SDL_GetPerformanceFrequency() * budget) / 1000000;
+  /*always finish at least one job so a tiny budget still makes progress*/
+  do
+  {
+    job = (MglResourceLoadJob *)g_async_queue_try_pop(__mgl_resource_done_queue);
+    if (job == NULL)break;
+    mgl_resource_job_finish(job);
+  }
+  while ((SDL_GetPerformanceCounter() - start) < limit);
+}
+
+static void mgl_resource_job_finish(MglResourceLoadJob *job)
+{
+  MglResourceManager *manager;
+  MglResourceHeader *element;
+  MglCallback *callback;
+  GList *it;
+  void *data;
+  MglBool loaded;
+  if (job->cancelled)
+  {
+    mgl_resource_job_free(job);
+    return;
+  }
+  manager = job->manager;
+  mgl_resource_manager_lock(manager);
+  if (job->cancelled)
+  {
+    /*freed by another thread since the check above*/
+    mgl_resource_manager_unlock(manager);
+    mgl_resource_job_free(job);
+    return;
+  }
+  element = job->element;
+  data = mgl_resource_get_data_by_header(element);
+  mgl_resource_loading_push(manager,job->filename);
+  if (job->data_prepare != NULL)
+  {
+    /*finalize takes ownership of the prepared data, even on failure*/
+    loaded = manager->data_finalize(job->prepared,data);
+    job->prepared = NULL;
+  }
+  else
+  {
+    loaded = manager->data_load(job->filename,data);
+  }
+  mgl_resource_loading_pop();
+  /*counted from the request, so time spent queued for a loader thread is included*/
+  mgl_resource_stats_record_load(manager,job->startTime,loaded);
+  if (!loaded)
   {
     mgl_logger_warn(
-      "mgl_resource: hash not setup.\n");
+      "mgl_resource: manager %s failed to load %s\n",
+      manager->name,
+      job->filename);
+    element->loadFailed = MglTrue;
+    mgl_resource_filename_hash_remove(manager,element);
+  }
+  element->loadJob = NULL;
+  manager->_pending_jobs = g_list_remove(manager->_pending_jobs,job);
+  if (manager->_load_done != NULL)
+  {
+    SDL_CondBroadcast(manager->_load_done);
+  }
+  for (it = job->callbacks;it != NULL;it = it->next)
+  {
+    callback = (MglCallback *)it->data;
+    if (callback->function != NULL)
+    {
+      callback->function(callback->data,data);
+    }
+  }
+  mgl_resource_manager_unlock(manager);
+  mgl_resource_job_free(job);
+}
+
+static void mgl_resource_job_cancel(MglResourceLoadJob *job)
+{
+  if (!job)return;
+  /*a worker may still hold the job, it is freed once it comes back through the done queue*/
+  job->cancelled = MglTrue;
+  job->element->loadJob = NULL;
+  job->element->loadFailed = MglTrue;
+  mgl_resource_filename_hash_remove(job->manager,job->element);
+  job->manager->_pending_jobs = g_list_remove(job->manager->_pending_jobs,job);
+}
+
+static void mgl_resource_job_free(MglResourceLoadJob *job)
+{
+  GList *it;
+  MglCallback *callback;
+  if (!job)return;
+  if ((job->prepared != NULL) && (job->prepared_free != NULL))
+  {
+    job->prepared_free(job->prepared);
+  }
+  for (it = job->callbacks;it != NULL;it = it->next)
+  {
+    callback = (MglCallback *)it->data;
+    mgl_callback_free(&callback);
+  }
+  g_list_free(job->callbacks);
+  free(job);
+}
+
+static void mgl_resource_job_wait(MglResourceManager *manager,MglResourceHeader *element)
+{
+  MglResourceLoadJob *job,*wanted;
+  GList *held = NULL,*it;
+  if ((manager->_lock != NULL) && (!mgl_resource_on_main_thread()))
+  {
+    /*only the main thread finishes jobs, the others wait for it to get to this one*/
+    while (element->loadJob != NULL)
+    {
+      SDL_CondWait(manager->_load_done,manager->_lock);
+    }
+    return;
+  }
+  /*a loader thread may need this manager to prepare the job, so let go of it while blocked*/
+  wanted = element->loadJob;
+  mgl_resource_manager_unlock(manager);
+  do
+  {
+    job = (MglResourceLoadJob *)g_async_queue_pop(__mgl_resource_done_queue);
+    if (job != wanted)
+    {
+      /*other jobs wait for the update, their callbacks must not run inside this caller*/
+      held = g_list_prepend(held,job);
+    }
+  }
+  while (job != wanted);
+  mgl_resource_job_finish(job);
+  for (it = held;it != NULL;it = it->next)
+  {
+    g_async_queue_push_front(__mgl_resource_done_queue,it->data);
+  }
+  g_list_free(held);
+  mgl_resource_manager_lock(manager);
+}
+
+static int mgl_resource_async_worker(void *data)
+{
+  MglResourceLoadJob *job;
+  while (1)
+  {
+    job = (MglResourceLoadJob *)g_async_queue_pop(__mgl_resource_job_queue);
+    if (job->quit)
+    {
+      free(job);
+      return 0;
+    }
+    if (job->release)
+    {
+      mgl_resource_job_free(job);
+      continue;
+    }
+    job->prepared = job->data_prepare(job->filename);
+    g_async_queue_push(__mgl_resource_done_queue,job);
+  }
+  return 0;
+}
+
+static void mgl_resource_async_start()
+{
+  int i,count;
+  SDL_AtomicLock(&__mgl_resource_async_lock);
+  if (__mgl_resource_done_queue != NULL)
+  {
+    SDL_AtomicUnlock(&__mgl_resource_async_lock);
+    return;
+  }
+  __mgl_resource_job_queue = g_async_queue_new();
+  __mgl_resource_done_queue = g_async_queue_new();
+  /*leave a core for the main thread*/
+  count = SDL_GetCPUCount() - 1;
+  if (count > MGL_RESOURCE_MAX_WORKERS)count = MGL_RESOURCE_MAX_WORKERS;
+  if (count < 1)count = 1;
+  __mgl_resource_workers = (SDL_Thread **)malloc(sizeof(SDL_Thread *) * count);
+  if (__mgl_resource_workers == NULL)
+  {
+    mgl_logger_error(
+      "mgl_resource: failed to allocate loader threads, loading on the main thread\n");
+    atexit(mgl_resource_async_close);
+    SDL_AtomicUnlock(&__mgl_resource_async_lock);
+    return;
+  }
+  for (i = 0;i < count;i++)
+  {
+    __mgl_resource_workers[i] = SDL_CreateThread(mgl_resource_async_worker,"mgl_resource_loader",NULL);
+    if (__mgl_resource_workers[i] == NULL)
+    {
+      mgl_logger_error(
+        "mgl_resource: failed to start loader thread: %s\n",
+        SDL_GetError());
+      break;
+    }
+    __mgl_resource_worker_count++;
+  }
+  atexit(mgl_resource_async_close);
+  SDL_AtomicUnlock(&__mgl_resource_async_lock);
+}
+
+static void mgl_resource_async_close()
+{
+  MglUint i;
+  MglResourceLoadJob *job;
+  for (i = 0;i < __mgl_resource_worker_count;i++)
+  {
+    job = (MglResourceLoadJob *)malloc(sizeof(MglResourceLoadJob));
+    if (job == NULL)continue;
+    memset(job,0,sizeof(MglResourceLoadJob));
+    job->quit = MglTrue;
+    g_async_queue_push(__mgl_resource_job_queue,job);
+  }
+  for (i = 0;i < __mgl_resource_worker_count;i++)
+  {
+    SDL_WaitThread(__mgl_resource_workers[i],NULL);
+  }
+  free(__mgl_resource_workers);
+  __mgl_resource_workers = NULL;
+  __mgl_resource_worker_count = 0;
+  while ((job = (MglResourceLoadJob *)g_async_queue_try_pop(__mgl_resource_job_queue)) != NULL)
+  {
+    if ((!job->cancelled) && (!job->release))mgl_resource_job_cancel(job);
+    mgl_resource_job_free(job);
+  }
+  while ((job = (MglResourceLoadJob *)g_async_queue_try_pop(__mgl_resource_done_queue)) != NULL)
+  {
+    if (!job->cancelled)mgl_resource_job_cancel(job);
+    mgl_resource_job_free(job);
+  }
+  g_async_queue_unref(__mgl_resource_job_queue);
+  g_async_queue_unref(__mgl_resource_done_queue);
+  __mgl_resource_job_queue = NULL;
+  __mgl_resource_done_queue = NULL;
+}
+
+void mgl_resource_element_set_size(MglResourceManager *manager,void *data,size_t bytes)
+{
+  MglResourceHeader *element;
+  if ((!manager)||(!data))return;
+  element = mgl_resource_get_header_by_data(data);
+  mgl_resource_manager_lock(manager);
+  manager->_resident_bytes = manager->_resident_bytes - element->size + bytes;
+  mgl_resource_resident_bytes_add(bytes,element->size);
+  if (element->cached)
+  {
+    manager->_cached_bytes = manager->_cached_bytes - element->size + bytes;
+  }
+  element->size = bytes;
+  mgl_resource_enforce_budget();
+  mgl_resource_manager_unlock(manager);
+}
+
+size_t mgl_resource_element_get_size(MglResourceManager *manager,void *data)
+{
+  if ((!manager)||(!data))return 0;
+  return mgl_resource_get_header_by_data(data)->size;
+}
+
+void mgl_resource_set_memory_budget(size_t bytes)
+{
+  __mgl_resource_budget = bytes;
+  mgl_resource_enforce_budget();
+}
+
+size_t mgl_resource_get_memory_budget()
+{
+  return __mgl_resource_budget;
+}
+
+size_t mgl_resource_get_resident_bytes()
+{
+  size_t bytes;
+  SDL_AtomicLock(&__mgl_resource_bytes_lock);
+  bytes = __mgl_resource_resident_bytes;
+  SDL_AtomicUnlock(&__mgl_resource_bytes_lock);
+  return bytes;
+}
+
+void mgl_resource_manager_get_memory_stats(MglResourceManager *manager,size_t *resident,size_t *cached)
+{
+  if (!manager)return;
+  mgl_resource_manager_lock(manager);
+  if (resident)*resident = manager->_resident_bytes;
+  if (cached)*cached = manager->_cached_bytes;
+  mgl_resource_manager_unlock(manager);
+}
+
+static void mgl_resource_enforce_budget()
+{
+  GList *it;
+  MglResourceManager *manager,*owner;
+  MglResourceHeader *oldest;
+  if (__mgl_resource_budget == 0)return;
+  if (!mgl_resource_on_main_thread())
+  {
+    /*deleting can destroy textures and touch managers that are not thread safe, so it waits for the main thread*/
+    if (mgl_resource_get_resident_bytes() > __mgl_resource_budget)
+    {
+      SDL_AtomicSet(&__mgl_resource_evict_deferred,1);
+    }
+    return;
+  }
+  if (!SDL_AtomicTryLock(&__mgl_resource_evicting))return;
+  while (mgl_resource_get_resident_bytes() > __mgl_resource_budget)
+  {
+    /*each manager's list is oldest first, so only the heads need comparing*/
+    oldest = NULL;
+    owner = NULL;
+    for (it = __mgl_resource_managers;it != NULL;it = it->next)
+    {
+      manager = (MglResourceManager *)it->data;
+      /*a concurrent manager busy on another thread is skipped, waiting on it could deadlock*/
+      if (!mgl_resource_manager_try_lock(manager))continue;
+      if ((manager->_cache_head != NULL) &&
+          ((oldest == NULL) || (manager->_cache_head->timeFree < oldest->timeFree)))
+      {
+        if (owner != NULL)mgl_resource_manager_unlock(owner);
+        oldest = manager->_cache_head;
+        owner = manager;
+        continue;/*stays locked until it is evicted from*/
+      }
+      mgl_resource_manager_unlock(manager);
+    }
+    if (oldest == NULL)break;/*everything left is in use*/
+    owner->_stats.evictions++;
+    mgl_resource_element_release(owner,oldest);
+    mgl_resource_manager_unlock(owner);
+  }
+  SDL_AtomicUnlock(&__mgl_resource_evicting);
+}
+
+static void mgl_resource_enforce_deferred_budget()
+{
+  if (SDL_AtomicCAS(&__mgl_resource_evict_deferred,1,0))
+  {
+    mgl_resource_enforce_budget();
+  }
+}
+
+static void mgl_resource_cache_push_back(MglResourceManager *manager,MglResourceHeader *element)
+{
+  if (element->cached)return;
+  element->cached = MglTrue;
+  element->cacheNext = NULL;
+  element->cachePrev = manager->_cache_tail;
+  if (manager->_cache_tail != NULL)
+  {
+    manager->_cache_tail->cacheNext = element;
+  }
+  else
+  {
+    manager->_cache_head = element;
+  }
+  manager->_cache_tail = element;
+  manager->_cached_bytes += element->size;
+}
+
+static void mgl_resource_cache_unlink(MglResourceManager *manager,MglResourceHeader *element)
+{
+  if (!element->cached)return;
+  if (element->cachePrev != NULL)
+  {
+    element->cachePrev->cacheNext = element->cacheNext;
+  }
+  else
+  {
+    manager->_cache_head = element->cacheNext;
+  }
+  if (element->cacheNext != NULL)
+  {
+    element->cacheNext->cachePrev = element->cachePrev;
+  }
+  else
+  {
+    manager->_cache_tail = element->cachePrev;
+  }
+  element->cacheNext = NULL;
+  element->cachePrev = NULL;
+  element->cached = MglFalse;
+  manager->_cached_bytes -= element->size;
+}
+
+static void mgl_resource_stats_record_load(MglResourceManager *manager,Uint64 start,MglBool loaded)
+{
+  MglUint micros,bucket;
+  micros = (MglUint)(((SDL_GetPerformanceCounter() - start) * 1000000) / SDL_GetPerformanceFrequency());
+  manager->_stats.loads++;
+  if (!loaded)manager->_stats.loadFailures++;
+  manager->_stats.loadTimeTotal += micros;
+  if (micros > manager->_stats.loadTimeMax)manager->_stats.loadTimeMax = micros;
+  /*bucket 0 is under MGL_RESOURCE_HISTOGRAM_BASE, each bucket after doubles*/
+  for (bucket = 0;bucket < MGL_RESOURCE_HISTOGRAM_BUCKETS - 1;bucket++)
+  {
+    if (micros < (MGL_RESOURCE_HISTOGRAM_BASE << bucket))break;
+  }
+  manager->_stats.loadTimeHistogram[bucket]++;
+}
+
+void mgl_resource_manager_get_stats(MglResourceManager *manager,MglResourceStats *stats)
+{
+  if ((!manager)||(!stats))return;
+  mgl_resource_manager_lock(manager);
+  memcpy(stats,&manager->_stats,sizeof(MglResourceStats));
+  stats->liveCount = manager->_live_count;
+  stats->capacity = manager->_data_max;
+  stats->residentBytes = manager->_resident_bytes;
+  stats->cachedBytes = manager->_cached_bytes;
+  mgl_resource_manager_unlock(manager);
+}
+
+void mgl_resource_manager_reset_stats(MglResourceManager *manager)
+{
+  if (!manager)return;
+  mgl_resource_manager_lock(manager);
+  memset(&manager->_stats,0,sizeof(MglResourceStats));
+  manager->_stats.peakLiveCount = manager->_live_count;
+  mgl_resource_manager_unlock(manager);
+}
+
+void mgl_resource_manager_dump_stats(MglResourceManager *manager)
+{
+  MglResourceStats stats;
+  MglUint i;
+  GString *histogram;
+  if (!manager)return;
+  mgl_resource_manager_get_stats(manager,&stats);
+  mgl_logger_info(
+    "mgl_resource: %s: %u/%u live (peak %u), %u loads (%u failed), %u hits %u misses (%.1f%% hit), %u reclaims, %u evictions, %lu bytes resident, %lu cached\n",
+    manager->name,
+    stats.liveCount,
+    stats.capacity,
+    stats.peakLiveCount,
+    stats.loads,
+    stats.loadFailures,
+    stats.hits,
+    stats.misses,
+    (stats.hits + stats.misses)?(100.0 * stats.hits) / (stats.hits + stats.misses):0.0,
+    stats.reclaims,
+    stats.evictions,
+    (unsigned long)stats.residentBytes,
+    (unsigned long)stats.cachedBytes);
+  if (stats.loads == 0)return;
+  histogram = g_string_new("");
+  for (i = 0;i < MGL_RESOURCE_HISTOGRAM_BUCKETS;i++)
+  {
+    g_string_append_printf(histogram," %u",stats.loadTimeHistogram[i]);
+  }
+  mgl_logger_info(
+    "mgl_resource: %s: load time avg %lu us, max %u us, histogram (<%u us doubling):%s\n",
+    manager->name,
+    (unsigned long)(stats.loadTimeTotal / stats.loads),
+    stats.loadTimeMax,
+    MGL_RESOURCE_HISTOGRAM_BASE,
+    histogram->str);
+  g_string_free(histogram,TRUE);
+}
+
+void mgl_resource_dump_stats()
+{
+  GList *it;
+  for (it = __mgl_resource_managers;it != NULL;it = it->next)
+  {
+    mgl_resource_manager_dump_stats((MglResourceManager *)it->data);
+  }
+}
+
+void mgl_resource_dump_stats_periodic(MglUint interval)
+{
+  MglUint now;
+  now = SDL_GetTicks();
+  if ((now - __mgl_resource_stats_last_dump) < interval)return;
+  __mgl_resource_stats_last_dump = now;
+  mgl_resource_dump_stats();
+}
+
+static MglResourceNode *mgl_resource_graph_get_node(const char *managerName,const char *filename)
+{
+  MglResourceNode *node;
+  gchar *key;
+  if (__mgl_resource_graph == NULL)
+  {
+    __mgl_resource_graph = g_hash_table_new_full(g_str_hash,g_str_equal,g_free,NULL);
+    atexit(mgl_resource_graph_free);
+  }
+  key = g_strdup_printf("%s|%s",managerName,filename);
+  node = (MglResourceNode *)g_hash_table_lookup(__mgl_resource_graph,key);
+  if (node != NULL)
+  {
+    g_free(key);
+    return node;
+  }
+  node = (MglResourceNode *)malloc(sizeof(MglResourceNode));
+  if (!node)
+  {
+    mgl_logger_error("mgl_resource: failed to allocate a dependency node for %s",filename);
+    g_free(key);
+    return NULL;
+  }
+  memset(node,0,sizeof(MglResourceNode));
+  mgl_line_cpy(node->managerName,managerName);
+  mgl_line_cpy(node->filename,filename);
+  node->depth = -1;
+  g_hash_table_insert(__mgl_resource_graph,key,node);
+  return node;
+}
+
+static void mgl_resource_graph_add_edge(MglResourceNode *node,MglResourceNode *dependency)
+{
+  if ((!node)||(!dependency)||(node == dependency))return;
+  if (g_list_find(node->dependencies,dependency) != NULL)return;
+  node->dependencies = g_list_append(node->dependencies,dependency);
+}
+
+static void mgl_resource_graph_free()
+{
+  GHashTableIter iter;
+  gpointer key,value;
+  MglResourceNode *node;
+  if (__mgl_resource_graph == NULL)return;
+  g_hash_table_iter_init(&iter,__mgl_resource_graph);
+  while (g_hash_table_iter_next(&iter,&key,&value))
+  {
+    node = (MglResourceNode *)value;
+    g_list_free(node->dependencies);
+    free(node);
+  }
+  g_hash_table_destroy(__mgl_resource_graph);
+  __mgl_resource_graph = NULL;
+}
+
+static void mgl_resource_record_dependency(MglResourceManager *manager,char *filename)
+{
+  if (!mgl_resource_on_main_thread())return;
+  if (__mgl_resource_loading == NULL)return;
+  mgl_resource_graph_add_edge(
+    (MglResourceNode *)__mgl_resource_loading->data,
+    mgl_resource_graph_get_node(manager->name,filename));
+}
+
+static void mgl_resource_loading_push(MglResourceManager *manager,char *filename)
+{
+  /*the graph is only kept for loads on the main thread*/
+  if (!mgl_resource_on_main_thread())return;
+  /*pushed even if NULL so the pop always matches*/
+  __mgl_resource_loading = g_list_prepend(__mgl_resource_loading,mgl_resource_graph_get_node(manager->name,filename));
+}
+
+static void mgl_resource_loading_pop()
+{
+  if (!mgl_resource_on_main_thread())return;
+  if (__mgl_resource_loading == NULL)return;
+  __mgl_resource_loading = g_list_delete_link(__mgl_resource_loading,__mgl_resource_loading);
+}
+
+void mgl_resource_add_dependency(
+  MglResourceManager *manager,
+  char *filename,
+  MglResourceManager *dependencyManager,
+  char *dependencyFilename)
+{
+  if ((!manager)||(!filename)||(!dependencyManager)||(!dependencyFilename))return;
+  mgl_resource_graph_add_edge(
+    mgl_resource_graph_get_node(manager->name,filename),
+    mgl_resource_graph_get_node(dependencyManager->name,dependencyFilename));
+}
+
+MglUint mgl_resource_get_dependency_count(MglResourceManager *manager,char *filename)
+{
+  MglResourceNode *node;
+  gchar *key;
+  if ((!manager)||(!filename)||(__mgl_resource_graph == NULL))return 0;
+  key = g_strdup_printf("%s|%s",manager->name,filename);
+  node = (MglResourceNode *)g_hash_table_lookup(__mgl_resource_graph,key);
+  g_free(key);
+  if (!node)return 0;
+  return g_list_length(node->dependencies);
+}
+
+MglBool mgl_resource_save_dependencies(char *filename)
+{
+  FILE *file;
+  GHashTableIter iter;
+  gpointer key,value;
+  GList *it;
+  MglResourceNode *node,*dependency;
+  if (!filename)return MglFalse;
+  file = fopen(filename,"w");
+  if (!file)
+  {
+    mgl_logger_error("mgl_resource: failed to open %s for writing",filename);
+    return MglFalse;
+  }
+  if (__mgl_resource_graph != NULL)
+  {
+    g_hash_table_iter_init(&iter,__mgl_resource_graph);
+    while (g_hash_table_iter_next(&iter,&key,&value))
+    {
+      node = (MglResourceNode *)value;
+      for (it = node->dependencies;it != NULL;it = it->next)
+      {
+        dependency = (MglResourceNode *)it->data;
+        fprintf(file,"%s\t%s\t%s\t%s\n",node->managerName,node->filename,dependency->managerName,dependency->filename);
+      }
+    }
+  }
+  fclose(file);
+  return MglTrue;
+}
+
+MglBool mgl_resource_load_dependencies(char *filename)
+{
+  char *buffer;
+  gchar **lines,**fields;
+  MglUint i;
+  buffer = mgl_pack_load_file(filename,NULL);
+  if (!buffer)
+  {
+    mgl_logger_warn("mgl_resource: failed to read dependencies from %s",filename);
+    return MglFalse;
+  }
+  /*one edge per line: manager, filename, dependency manager, dependency filename, separated by tabs*/
+  lines = g_strsplit(buffer,"\n",0);
+  free(buffer);
+  for (i = 0;lines[i] != NULL;i++)
+  {
+    fields = g_strsplit(lines[i],"\t",4);
+    if ((fields[0] != NULL) && (fields[1] != NULL) && (fields[2] != NULL) && (fields[3] != NULL))
+    {
+      g_strchomp(fields[3]);
+      mgl_resource_graph_add_edge(
+        mgl_resource_graph_get_node(fields[0],fields[1]),
+        mgl_resource_graph_get_node(fields[2],fields[3]));
+    }
+    g_strfreev(fields);
+  }
+  g_strfreev(lines);
+  return MglTrue;
+}
+
+MglResourceBatch *mgl_resource_batch_new()
+{
+  MglResourceBatch *batch;
+  batch = (MglResourceBatch *)malloc(sizeof(MglResourceBatch));
+  if (!batch)
+  {
+    mgl_logger_error("mgl_resource: failed to allocate a batch");
     return NULL;
   }
-  return g_hash_table_lookup (manager->_data_hash,
-                              (gconstpointer)id);
+  memset(batch,0,sizeof(MglResourceBatch));
+  return batch;
 }
+
+void mgl_resource_batch_add(MglResourceBatch *batch,MglResourceManager *manager,char *filename)
+{
+  MglResourceBatchEntry *entry;
+  if ((!batch)||(!manager)||(!filename))return;
+  if (batch->started)
+  {
+    mgl_logger_warn("mgl_resource: cannot add %s to a batch that has already started",filename);
+    return;
+  }
+  entry = (MglResourceBatchEntry *)malloc(sizeof(MglResourceBatchEntry));
+  if (!entry)return;
+  memset(entry,0,sizeof(MglResourceBatchEntry));
+  entry->manager = manager;
+  mgl_line_cpy(entry->filename,filename);
+  batch->entries = g_list_append(batch->entries,entry);
+}
+
+static MglResourceManager *mgl_resource_manager_find(const char *name)
+{
+  GList *it;
+  for (it = __mgl_resource_managers;it != NULL;it = it->next)
+  {
+    if (mgl_line_cmp(((MglResourceManager *)it->data)->name,name) == 0)return (MglResourceManager *)it->data;
+  }
+  return NULL;
+}
+
+/*place each node at the end of the longest chain that reaches it, so its dependencies always sit deeper*/
+static void mgl_resource_node_place(MglResourceNode *node,MglInt depth,GList **reached)
+{
+  GList *it;
+  if ((!node)||(node->visiting)||(node->depth >= depth))return;
+  if (node->depth < 0)*reached = g_list_prepend(*reached,node);
+  node->depth = depth;
+  node->visiting = MglTrue;
+  for (it = node->dependencies;it != NULL;it = it->next)
+  {
+    mgl_resource_node_place((MglResourceNode *)it->data,depth + 1,reached);
+  }
+  node->visiting = MglFalse;
+}
+
+static gint mgl_resource_batch_entry_compare(gconstpointer a,gconstpointer b)
+{
+  return ((const MglResourceBatchEntry *)b)->depth - ((const MglResourceBatchEntry *)a)->depth;
+}
+
+void mgl_resource_batch_start(MglResourceBatch *batch)
+{
+  GList *it,*reached = NULL;
+  MglResourceBatchEntry *entry;
+  MglResourceManager *manager;
+  MglResourceNode *node;
+  if ((!batch)||(batch->started))return;
+  batch->started = MglTrue;
+  for (it = batch->entries;it != NULL;it = it->next)
+  {
+    entry = (MglResourceBatchEntry *)it->data;
+    mgl_resource_node_place(mgl_resource_graph_get_node(entry->manager->name,entry->filename),0,&reached);
+    free(entry);
+  }
+  g_list_free(batch->entries);
+  batch->entries = NULL;
+  for (it = reached;it != NULL;it = it->next)
+  {
+    node = (MglResourceNode *)it->data;
+    manager = mgl_resource_manager_find(node->managerName);
+    if (manager == NULL)
+    {
+      mgl_logger_warn("mgl_resource: batch skipping %s, no manager named %s",node->filename,node->managerName);
+    }
+    else if ((entry = (MglResourceBatchEntry *)malloc(sizeof(MglResourceBatchEntry))) != NULL)
+    {
+      memset(entry,0,sizeof(MglResourceBatchEntry));
+      entry->manager = manager;
+      mgl_line_cpy(entry->filename,node->filename);
+      entry->depth = node->depth;
+      batch->entries = g_list_prepend(batch->entries,entry);
+    }
+    node->depth = -1;
+  }
+  g_list_free(reached);
+  batch->entries = g_list_sort(batch->entries,mgl_resource_batch_entry_compare);
+  batch->level = batch->entries;
+  mgl_resource_batch_request_level(batch);
+}
+
+static void mgl_resource_batch_request_level(MglResourceBatch *batch)
+{
+  GList *it;
+  MglResourceBatchEntry *entry;
+  if (batch->level == NULL)return;
+  for (it = batch->level;it != NULL;it = it->next)
+  {
+    entry = (MglResourceBatchEntry *)it->data;
+    if (entry->depth != ((MglResourceBatchEntry *)batch->level->data)->depth)break;
+    entry->requested = MglTrue;
+    /*a unique resource is never shared, loading it early would not help whoever loads it later*/
+    if (entry->manager->_data_unique)continue;
+    entry->data = mgl_resource_manager_load_resource_async(entry->manager,entry->filename,NULL);
+  }
+}
+
+MglBool mgl_resource_batch_update(MglResourceBatch *batch)
+{
+  GList *it;
+  MglResourceBatchEntry *entry;
+  MglInt depth;
+  if (!batch)return MglTrue;
+  if (!batch->started)return MglFalse;
+  while (batch->level != NULL)
+  {
+    depth = ((MglResourceBatchEntry *)batch->level->data)->depth;
+    for (it = batch->level;it != NULL;it = it->next)
+    {
+      entry = (MglResourceBatchEntry *)it->data;
+      if (entry->depth != depth)break;
+      if ((entry->data != NULL) &&
+          (mgl_resource_element_get_load_state(entry->manager,entry->data) == MglResourcePending))
+      {
+        return MglFalse;
+      }
+    }
+    /*everything at this depth is in, so the resources that depend on it can go*/
+    batch->level = it;
+    mgl_resource_batch_request_level(batch);
+  }
+  return MglTrue;
+}
+
+void mgl_resource_batch_wait(MglResourceBatch *batch)
+{
+  if (!batch)return;
+  mgl_resource_batch_start(batch);
+  while (!mgl_resource_batch_update(batch))
+  {
+    mgl_resource_async_update(1000);
+    if (mgl_resource_batch_update(batch))break;
+    SDL_Delay(1);
+  }
+}
+
+void mgl_resource_batch_get_progress(MglResourceBatch *batch,MglUint *done,MglUint *total)
+{
+  GList *it;
+  MglResourceBatchEntry *entry;
+  MglUint count = 0,finished = 0;
+  if (batch)
+  {
+    for (it = batch->entries;it != NULL;it = it->next)
+    {
+      entry = (MglResourceBatchEntry *)it->data;
+      count++;
+      if ((!entry->requested) || (!batch->started))continue;
+      if ((entry->data == NULL) ||
+          (mgl_resource_element_get_load_state(entry->manager,entry->data) != MglResourcePending))
+      {
+        finished++;
+      }
+    }
+  }
+  if (done)*done = finished;
+  if (total)*total = count;
+}
+
+void mgl_resource_batch_free(MglResourceBatch **batch,MglBool unload)
+{
+  GList *it;
+  MglResourceBatchEntry *entry;
+  MglResourceHeader *element;
+  MglUint generation;
+  if ((!batch)||(!*batch))return;
+  /*dependents are released before their dependencies, so an unload can cascade down*/
+  for (it = g_list_last((*batch)->entries);it != NULL;it = it->prev)
+  {
+    entry = (MglResourceBatchEntry *)it->data;
+    if (entry->data != NULL)
+    {
+      element = mgl_resource_get_header_by_data(entry->data);
+      generation = element->generation;
+      mgl_resource_free_element(entry->manager,&entry->data);
+      if ((unload) && (element->generation == generation) && (element->refCount == 0) && (element->cached))
+      {
+        mgl_resource_element_release(entry->manager,element);
+      }
+    }
+    free(entry);
+  }
+  g_list_free((*batch)->entries);
+  free(*batch);
+  *batch = NULL;
+}
+
 /*eol@eof*/
 
@@ -1,4 +1,5 @@
 #include "mgl_resource.h"
+#include "mgl_pack.h"
 #include <string.h>
 
 /**
@@ -14,16 +15,74 @@ typedef struct
 
 void test_delete(void *data);
 MglBool test_load(char *filename,void *data);
+void test_benchmark(MglUint count);
+void test_async(int count,char *filenames[]);
+void test_budget();
+void test_collect();
+void test_pack(int count,char *filenames[]);
+void test_dependencies();
+void test_threads(int threads);
+void test_foreach();
 
 MglResourceManager * manager = NULL;
 
 int main(int argc,char *argv[])
 {
   int i;
+  MglUint hits = 0,misses = 0;
+  MglResourceStats stats;
   if ((argc == 2) && (strcmp(argv[1],"-h")==0))
   {
     fprintf(stdout,"usage:\n");
     fprintf(stdout,"%s [FILES]\n",argv[0]);
+    fprintf(stdout,"%s -b [COUNT] to benchmark allocation\n",argv[0]);
+    fprintf(stdout,"%s -a [FILES] to load the files asynchronously\n",argv[0]);
+    fprintf(stdout,"%s -m to check eviction against a memory budget\n",argv[0]);
+    fprintf(stdout,"%s -c to check incremental cleanup\n",argv[0]);
+    fprintf(stdout,"%s -p [FILES] to pack the files and compare them with the loose copies\n",argv[0]);
+    fprintf(stdout,"%s -d to check batch loading through recorded dependencies\n",argv[0]);
+    fprintf(stdout,"%s -t [THREADS] to hammer concurrent managers from several threads\n",argv[0]);
+    fprintf(stdout,"%s -f to free other elements from inside a foreach pass\n",argv[0]);
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-b")==0))
+  {
+    test_benchmark((argc == 3)?atoi(argv[2]):100000);
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-a")==0))
+  {
+    test_async(argc - 2,&argv[2]);
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-m")==0))
+  {
+    test_budget();
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-c")==0))
+  {
+    test_collect();
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-p")==0))
+  {
+    test_pack(argc - 2,&argv[2]);
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-d")==0))
+  {
+    test_dependencies();
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-t")==0))
+  {
+    test_threads((argc == 3)?atoi(argv[2]):8);
+    return 0;
+  }
+  if ((argc >= 2) && (strcmp(argv[1],"-f")==0))
+  {
+    test_foreach();
     return 0;
   }
   fprintf(stdout,"mgl_resource_test begin\n");
@@ -43,11 +102,726 @@ int main(int argc,char *argv[])
     mgl_resource_manager_load_resource(manager,argv[i]);
   }
   fprintf(stdout,"resource manage has %i elements\n",mgl_resource_manager_get_element_count(manager));
+  mgl_resource_manager_get_filename_stats(manager,&hits,&misses);
+  fprintf(stdout,"filename lookups: %u hits, %u misses\n",hits,misses);
+  mgl_resource_manager_get_stats(manager,&stats);
+  fprintf(stdout,"%u loads, peak of %u live elements\n",stats.loads,stats.peakLiveCount);
+  mgl_resource_dump_stats();
   fprintf(stdout,"freeing resource manager...\n");
   
   fprintf(stdout,"mgl_resource_test end\n");
 }
 
+static void test_count_element(void *data,void *context)
+{
+  (*(MglUint *)data)++;
+}
+
+static double test_elapsed_ms(Uint64 start)
+{
+  return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/**
+ * @brief allocation / free timing for a pool of count slots.  Every phase
+ * should scale with the number of operations performed, not the pool size
+ */
+void test_benchmark(MglUint count)
+{
+  MglUint i,burst,visited = 0;
+  Uint64 start;
+  void *it;
+  void **elements;
+  MglResourceHandle *handles;
+  MglResourceManager *bench;
+  bench = mgl_resource_manager_init(
+    "bench manager",
+    count,
+    sizeof(TestElement),
+    MglTrue,
+    NULL,
+    NULL
+  );
+  elements = (void **)malloc(sizeof(void *)*count);
+  handles = (MglResourceHandle *)malloc(sizeof(MglResourceHandle)*count);
+  if ((!bench)||(!elements)||(!handles))
+  {
+    fprintf(stdout,"failed to set up benchmark\n");
+    return;
+  }
+  fprintf(stdout,"benchmarking %u slot pool\n",count);
+
+  start = SDL_GetPerformanceCounter();
+  for (i = 0; i < count;i++)
+  {
+    elements[i] = mgl_resource_new_element(bench);
+  }
+  fprintf(stdout,"fill %u elements: %f ms\n",count,test_elapsed_ms(start));
+  for (i = 0; i < count;i++)
+  {
+    handles[i] = mgl_resource_element_get_handle(bench,elements[i]);
+  }
+
+  start = SDL_GetPerformanceCounter();
+  for (i = 0; i < count;i += 2)
+  {
+    mgl_resource_free_element(bench,&elements[i]);
+  }
+  fprintf(stdout,"free every other element: %f ms\n",test_elapsed_ms(start));
+
+  /*particle style bursts against a nearly full pool*/
+  burst = MIN(1000,count / 2);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0; i < burst;i++)
+  {
+    elements[i * 2] = mgl_resource_new_element(bench);
+  }
+  for (i = 0; i < burst;i++)
+  {
+    mgl_resource_free_element(bench,&elements[i * 2]);
+  }
+  fprintf(stdout,"burst of %u new / free: %f ms\n",burst,test_elapsed_ms(start));
+  fprintf(stdout,"elements in use: %u\n",mgl_resource_manager_get_element_count(bench));
+
+  start = SDL_GetPerformanceCounter();
+  mgl_resource_manager_foreach(bench,mgl_callback(test_count_element,&visited));
+  for (it = mgl_resource_get_next_data(bench,NULL);it != NULL;it = mgl_resource_get_next_data(bench,it))
+  {
+    visited++;
+  }
+  fprintf(stdout,"two passes over %u live elements: %f ms\n",visited / 2,test_elapsed_ms(start));
+
+  /*every even element has been freed since its handle was taken, only the odd ones should resolve*/
+  visited = 0;
+  start = SDL_GetPerformanceCounter();
+  for (i = 0; i < count;i++)
+  {
+    if (mgl_resource_handle_valid(bench,handles[i]))visited++;
+  }
+  fprintf(stdout,"resolve %u handles, %u still valid: %f ms\n",count,visited,test_elapsed_ms(start));
+
+  mgl_resource_manager_free(&bench);
+
+  bench = mgl_resource_manager_init_growable(
+    "growable bench manager",
+    1024,
+    count,
+    sizeof(TestElement),
+    MglTrue,
+    NULL,
+    NULL
+  );
+  if (!bench)
+  {
+    fprintf(stdout,"failed to set up growable benchmark\n");
+    free(elements);
+    free(handles);
+    return;
+  }
+  start = SDL_GetPerformanceCounter();
+  for (i = 0; i < count;i++)
+  {
+    elements[i] = mgl_resource_new_element(bench);
+  }
+  fprintf(stdout,"growable fill %u elements: %f ms, capacity %u\n",count,test_elapsed_ms(start),mgl_resource_manager_get_capacity(bench));
+  for (i = count / 10; i < count;i++)
+  {
+    mgl_resource_free_element(bench,&elements[i]);
+  }
+  start = SDL_GetPerformanceCounter();
+  mgl_resource_manager_trim(bench);
+  fprintf(stdout,"trim to %u live elements: %f ms, capacity %u\n",
+          mgl_resource_manager_get_element_count(bench),
+          test_elapsed_ms(start),
+          mgl_resource_manager_get_capacity(bench));
+
+  free(elements);
+  free(handles);
+  mgl_resource_manager_free(&bench);
+}
+
+static void *test_prepare(char *filename)
+{
+  return g_strdup(filename);
+}
+
+static MglBool test_finalize(void *prepared,void *data)
+{
+  TestElement *element;
+  element = (TestElement *)data;
+  if (!prepared)return MglFalse;
+  element->id = mgl_resource_element_get_id(manager,data);
+  element->string = g_string_new((char *)prepared);
+  g_free(prepared);
+  return MglTrue;
+}
+
+static void test_loaded(void *data,void *context)
+{
+  TestElement *element;
+  element = (TestElement *)context;
+  (*(MglUint *)data)++;
+  fprintf(stdout,"loaded: %s\n",(element->string != NULL)?element->string->str:"(failed)");
+}
+
+/**
+ * @brief load every file twice asynchronously.  Each request should get exactly one callback
+ */
+void test_async(int count,char *filenames[])
+{
+  int i;
+  MglUint loaded = 0,requested = 0;
+  MglCallback onLoaded;
+  void *data,*first = NULL,*last = NULL;
+  MglResourceLoadState state;
+  manager = mgl_resource_manager_init(
+    "async manager",
+    10,
+    sizeof(TestElement),
+    MglFalse,
+    test_delete,
+    test_load
+  );
+  mgl_resource_manager_set_async_loader(manager,test_prepare,test_finalize,g_free);
+  onLoaded = mgl_callback(test_loaded,&loaded);
+  for (i = 0;i < count * 2;i++)
+  {
+    if ((data = mgl_resource_manager_load_resource_async(manager,filenames[i % count],&onLoaded)) != NULL)
+    {
+      if (first == NULL)first = data;
+      last = data;
+      requested++;
+    }
+  }
+  if (last != NULL)
+  {
+    /*waiting on one element finishes it and runs its two callbacks, the rest stay pending*/
+    state = mgl_resource_element_wait(manager,last);
+    fprintf(stdout,"waited on last request: %s, %u callbacks run\n",
+            (state == MglResourceLoaded)?"loaded":"not loaded",
+            loaded);
+  }
+  while (loaded < requested)
+  {
+    mgl_resource_async_update(1000);
+    SDL_Delay(1);
+  }
+  fprintf(stdout,"%u of %u async requests completed, %u elements\n",
+          loaded,
+          requested,
+          mgl_resource_manager_get_element_count(manager));
+  if (first != NULL)
+  {
+    /*a failed element leaves the filename cache, so the next load starts over*/
+    mgl_resource_element_set_failed(manager,first);
+    data = mgl_resource_manager_load_resource(manager,filenames[0]);
+    fprintf(stdout,"failed element loaded again: %s\n",((data != NULL) && (data != first))?"true":"false");
+  }
+  mgl_resource_manager_free(&manager);
+}
+
+/**
+ * @brief load ten 1000 byte resources, release them and shrink the budget.
+ * The most recently released should survive, the oldest should be evicted
+ */
+void test_budget()
+{
+  int i;
+  MglLine filename;
+  MglUint hits = 0,misses = 0;
+  size_t resident = 0,cached = 0;
+  void *data;
+  manager = mgl_resource_manager_init(
+    "budget manager",
+    20,
+    sizeof(TestElement),
+    MglFalse,
+    test_delete,
+    test_load
+  );
+  for (i = 0;i < 10;i++)
+  {
+    snprintf(filename,MGLLINELEN,"resource%i",i);
+    data = mgl_resource_manager_load_resource(manager,filename);
+    mgl_resource_element_set_size(manager,data,1000);
+    mgl_resource_free_element(manager,&data);
+  }
+  mgl_resource_manager_get_memory_stats(manager,&resident,&cached);
+  fprintf(stdout,"before budget: %lu resident, %lu cached\n",(unsigned long)resident,(unsigned long)cached);
+  mgl_resource_set_memory_budget(5000);
+  mgl_resource_manager_get_memory_stats(manager,&resident,&cached);
+  fprintf(stdout,"after 5000 byte budget: %lu resident, %lu cached\n",(unsigned long)resident,(unsigned long)cached);
+  data = mgl_resource_manager_load_resource(manager,"resource9");
+  mgl_resource_free_element(manager,&data);
+  data = mgl_resource_manager_load_resource(manager,"resource0");
+  mgl_resource_free_element(manager,&data);
+  mgl_resource_manager_get_filename_stats(manager,&hits,&misses);
+  fprintf(stdout,"newest reloaded from memory: %s, oldest reloaded from file: %s\n",
+          (hits == 1)?"yes":"no",
+          (misses == 11)?"yes":"no");
+  mgl_resource_set_memory_budget(0);
+  mgl_resource_manager_free(&manager);
+  fprintf(stdout,"resident after free: %lu\n",(unsigned long)mgl_resource_get_resident_bytes());
+}
+
+static MglUint test_delete_count = 0;
+
+static void *test_detach(void *data)
+{
+  TestElement *element;
+  GString *string;
+  element = (TestElement *)data;
+  string = element->string;
+  element->string = NULL;
+  if (string != NULL)test_delete_count++;
+  return string;
+}
+
+static void test_detached_free(void *detached)
+{
+  g_string_free((GString *)detached,TRUE);
+}
+
+/**
+ * @brief release ten resources and clean them three per update.  Then clear a full
+ * manager and make sure every element was deleted exactly once
+ */
+void test_collect()
+{
+  int i;
+  MglUint updates = 0;
+  MglLine filename;
+  void *data[10];
+  manager = mgl_resource_manager_init(
+    "collect manager",
+    10,
+    sizeof(TestElement),
+    MglFalse,
+    test_delete,
+    test_load
+  );
+  mgl_resource_manager_set_async_delete(manager,test_detach,test_detached_free);
+  for (i = 0;i < 10;i++)
+  {
+    snprintf(filename,MGLLINELEN,"resource%i",i);
+    data[i] = mgl_resource_manager_load_resource(manager,filename);
+    mgl_resource_element_set_size(manager,data[i],100);
+    mgl_resource_free_element(manager,&data[i]);
+  }
+  mgl_resource_manager_clean_incremental(manager);
+  while (mgl_resource_collect_pending())
+  {
+    mgl_resource_collect_update(3,0);
+    updates++;
+  }
+  fprintf(stdout,"collected in %u updates, %lu bytes left, %u of 10 deleted\n",
+          updates,
+          (unsigned long)mgl_resource_get_resident_bytes(),
+          test_delete_count);
+  test_delete_count = 0;
+  for (i = 0;i < 10;i++)
+  {
+    snprintf(filename,MGLLINELEN,"resource%i",i);
+    data[i] = mgl_resource_manager_load_resource(manager,filename);
+    if (i % 2)mgl_resource_free_element(manager,&data[i]);
+  }
+  mgl_resource_manager_clear(manager);
+  fprintf(stdout,"clear: %u elements left, %u of 10 deleted\n",
+          mgl_resource_manager_get_element_count(manager),
+          test_delete_count);
+  mgl_resource_manager_free(&manager);
+}
+
+void test_pack(int count,char *filenames[])
+{
+  int i;
+  MglUint matched = 0;
+  char *loose,*streamed;
+  const void *packed;
+  size_t looseSize,packedSize;
+  SDL_RWops *rw = NULL;
+  if (!mgl_pack_build("mgl_resource_test.pak",filenames,count))
+  {
+    fprintf(stdout,"failed to build the test pack\n");
+    return;
+  }
+  if (!mgl_pack_mount("mgl_resource_test.pak"))
+  {
+    fprintf(stdout,"failed to mount the test pack\n");
+    return;
+  }
+  for (i = 0;i < count;i++)
+  {
+    packed = mgl_pack_get(filenames[i],&packedSize);
+    /*mgl_pack_load_file would be served from the pack, so read the loose copy directly*/
+    loose = NULL;
+    if (!g_file_get_contents(filenames[i],&loose,&looseSize,NULL))
+    {
+      fprintf(stdout,"failed to read %s from disk\n",filenames[i]);
+      continue;
+    }
+    if ((packed != NULL) && (packedSize == looseSize) && (memcmp(packed,loose,looseSize) == 0))
+    {
+      matched++;
+    }
+    else
+    {
+      fprintf(stdout,"%s does not match its packed copy\n",filenames[i]);
+    }
+    g_free(loose);
+  }
+  fprintf(stdout,"%u of %i packed files match\n",matched,count);
+  if (count > 0)rw = mgl_pack_open_rw(filenames[0]);
+  mgl_pack_unmount_all();
+  if (rw != NULL)
+  {
+    /*an open rw keeps its pack mapped past the unmount*/
+    packedSize = (size_t)SDL_RWsize(rw);
+    streamed = (char *)malloc(packedSize + 1);
+    if ((streamed != NULL) && (g_file_get_contents(filenames[0],&loose,&looseSize,NULL)))
+    {
+      fprintf(stdout,"read after unmount: %s\n",
+              ((looseSize == packedSize) && (SDL_RWread(rw,streamed,1,packedSize) == packedSize) && (memcmp(streamed,loose,looseSize) == 0))?"matches":"differs");
+      g_free(loose);
+    }
+    free(streamed);
+    SDL_RWclose(rw);
+  }
+  remove("mgl_resource_test.pak");
+}
+
+typedef struct
+{
+  MglBool loaded;
+  GList *children;/**<references to the elements this one loaded*/
+}TestDependent;
+
+/*level -> map1, map2 -> tiles -> sprite*/
+static const char *test_dependency_table[][3] =
+{
+  {"level","map1","map2"},
+  {"map1","tiles",NULL},
+  {"map2","tiles",NULL},
+  {"tiles","sprite",NULL}
+};
+static GString *test_load_order = NULL;
+
+static MglBool test_dependent_load(char *filename,void *data)
+{
+  TestDependent *element;
+  int i,j;
+  element = (TestDependent *)data;
+  element->loaded = MglTrue;
+  g_string_append_printf(test_load_order,"%s ",filename);
+  for (i = 0;i < sizeof(test_dependency_table) / sizeof(test_dependency_table[0]);i++)
+  {
+    if (strcmp(test_dependency_table[i][0],filename) != 0)continue;
+    for (j = 1;j < 3;j++)
+    {
+      if (test_dependency_table[i][j] == NULL)continue;
+      element->children = g_list_append(
+        element->children,
+        mgl_resource_manager_load_resource(manager,(char *)test_dependency_table[i][j]));
+    }
+  }
+  return MglTrue;
+}
+
+static void test_dependent_delete(void *data)
+{
+  TestDependent *element;
+  GList *it;
+  void *child;
+  element = (TestDependent *)data;
+  if (!element->loaded)return;
+  for (it = element->children;it != NULL;it = it->next)
+  {
+    child = it->data;
+    mgl_resource_free_element(manager,&child);
+  }
+  g_list_free(element->children);
+  element->children = NULL;
+  element->loaded = MglFalse;
+  test_delete_count++;
+}
+
+void test_dependencies()
+{
+  void *level;
+  MglUint done,total;
+  MglResourceBatch *batch;
+  manager = mgl_resource_manager_init(
+    "dependency manager",
+    10,
+    sizeof(TestDependent),
+    MglFalse,
+    test_dependent_delete,
+    test_dependent_load
+  );
+  test_load_order = g_string_new("");
+  /*the first, serial load records the graph*/
+  level = mgl_resource_manager_load_resource(manager,"level");
+  fprintf(stdout,"recorded: level %u, map1 %u, tiles %u, sprite %u dependencies\n",
+          mgl_resource_get_dependency_count(manager,"level"),
+          mgl_resource_get_dependency_count(manager,"map1"),
+          mgl_resource_get_dependency_count(manager,"tiles"),
+          mgl_resource_get_dependency_count(manager,"sprite"));
+  fprintf(stdout,"serial load order: %s\n",test_load_order->str);
+  mgl_resource_free_element(manager,&level);
+  mgl_resource_manager_clean(manager);
+  fprintf(stdout,"after clean: %u elements, %u of 5 deleted\n",
+          mgl_resource_manager_get_element_count(manager),
+          test_delete_count);
+
+  g_string_truncate(test_load_order,0);
+  test_delete_count = 0;
+  batch = mgl_resource_batch_new();
+  mgl_resource_batch_add(batch,manager,"level");
+  mgl_resource_batch_wait(batch);
+  mgl_resource_batch_get_progress(batch,&done,&total);
+  fprintf(stdout,"batch load order: %s\n",test_load_order->str);
+  fprintf(stdout,"batch: %u of %u done, %u elements live\n",
+          done,
+          total,
+          mgl_resource_manager_get_element_count(manager));
+  mgl_resource_batch_free(&batch,MglTrue);
+  fprintf(stdout,"after unload: %u elements, %u of 5 deleted\n",
+          mgl_resource_manager_get_element_count(manager),
+          test_delete_count);
+
+  mgl_resource_save_dependencies("mgl_resource_test.dep");
+  mgl_resource_load_dependencies("mgl_resource_test.dep");
+  fprintf(stdout,"reloaded graph: level %u dependencies\n",mgl_resource_get_dependency_count(manager,"level"));
+  remove("mgl_resource_test.dep");
+  g_string_free(test_load_order,TRUE);
+  mgl_resource_manager_free(&manager);
+}
+
+#define TEST_STRESS_ITERATIONS 20000
+#define TEST_STRESS_FILES 32
+
+static MglResourceManager *test_shared = NULL;
+static MglResourceManager *test_unique = NULL;
+static SDL_atomic_t test_stress_loads;
+static SDL_atomic_t test_stress_deletes;
+static SDL_atomic_t test_stress_errors;
+static SDL_atomic_t test_stress_finished;
+
+static MglBool test_stress_load(char *filename,void *data)
+{
+  TestElement *element;
+  element = (TestElement *)data;
+  element->string = g_string_new(filename);
+  SDL_AtomicIncRef(&test_stress_loads);
+  return MglTrue;
+}
+
+static void test_stress_delete(void *data)
+{
+  TestElement *element;
+  element = (TestElement *)data;
+  if (element->string == NULL)return;
+  g_string_free(element->string,TRUE);
+  element->string = NULL;
+  SDL_AtomicIncRef(&test_stress_deletes);
+}
+
+static int test_stress_worker(void *data)
+{
+  int i,seed;
+  MglLine filename;
+  MglResourceHandle handle;
+  TestElement *shared,*unique;
+  seed = *(int *)data;
+  for (i = 0;i < TEST_STRESS_ITERATIONS;i++)
+  {
+    snprintf(filename,MGLLINELEN,"stress%i",((i * 7) + seed) % TEST_STRESS_FILES);
+    shared = mgl_resource_manager_load_resource(test_shared,filename);
+    if ((shared == NULL) || (shared->string == NULL) || (strcmp(shared->string->str,filename) != 0))
+    {
+      SDL_AtomicIncRef(&test_stress_errors);
+      continue;
+    }
+    mgl_resource_element_set_size(test_shared,shared,100);
+    handle = mgl_resource_element_get_handle(test_shared,shared);
+    if (mgl_resource_get_data_by_handle(test_shared,handle) != shared)
+    {
+      SDL_AtomicIncRef(&test_stress_errors);
+    }
+    unique = mgl_resource_new_element(test_unique);
+    if (unique == NULL)
+    {
+      SDL_AtomicIncRef(&test_stress_errors);
+    }
+    else
+    {
+      unique->id = mgl_resource_element_get_handle(test_unique,unique);
+      if (mgl_resource_get_data_by_handle(test_unique,unique->id) != unique)
+      {
+        SDL_AtomicIncRef(&test_stress_errors);
+      }
+      mgl_resource_free_element(test_unique,(void **)&unique);
+    }
+    mgl_resource_free_element(test_shared,(void **)&shared);
+  }
+  SDL_AtomicIncRef(&test_stress_finished);
+  return 0;
+}
+
+/**
+ * @brief every thread loads and frees from a shared pool of files while allocating from a unique manager.
+ * The main thread keeps evicting the cached files to the budget, so loads, reuse and eviction all race each other
+ */
+void test_threads(int threads)
+{
+  int i;
+  int *seeds;
+  SDL_Thread **workers;
+  MglResourceStats stats;
+  Uint64 start;
+  if (threads < 1)threads = 1;
+  test_shared = mgl_resource_manager_init_concurrent(
+    "shared stress manager",
+    16,
+    0,
+    sizeof(TestElement),
+    MglFalse,
+    test_stress_delete,
+    test_stress_load
+  );
+  test_unique = mgl_resource_manager_init_concurrent(
+    "unique stress manager",
+    16,
+    0,
+    sizeof(TestElement),
+    MglTrue,
+    test_stress_delete,
+    NULL
+  );
+  if ((!test_shared)||(!test_unique))return;
+  SDL_AtomicSet(&test_stress_loads,0);
+  SDL_AtomicSet(&test_stress_deletes,0);
+  SDL_AtomicSet(&test_stress_errors,0);
+  SDL_AtomicSet(&test_stress_finished,0);
+  mgl_resource_set_memory_budget(100 * (TEST_STRESS_FILES / 4));
+  seeds = (int *)malloc(sizeof(int) * threads);
+  workers = (SDL_Thread **)malloc(sizeof(SDL_Thread *) * threads);
+  start = SDL_GetPerformanceCounter();
+  for (i = 0;i < threads;i++)
+  {
+    seeds[i] = i;
+    workers[i] = SDL_CreateThread(test_stress_worker,"mgl_resource_test",&seeds[i]);
+  }
+  while (SDL_AtomicGet(&test_stress_finished) < threads)
+  {
+    /*workers going over budget leave the eviction to the main thread's update*/
+    mgl_resource_async_update(1000);
+  }
+  for (i = 0;i < threads;i++)
+  {
+    SDL_WaitThread(workers[i],NULL);
+  }
+  fprintf(stdout,"%i threads x %i iterations in %.2f ms\n",
+          threads,
+          TEST_STRESS_ITERATIONS,
+          test_elapsed_ms(start));
+  mgl_resource_manager_get_stats(test_shared,&stats);
+  fprintf(stdout,"shared: %u live, %u loads, %u hits, %u reclaims, %u evictions\n",
+          stats.liveCount,
+          stats.loads,
+          stats.hits,
+          stats.reclaims,
+          stats.evictions);
+  fprintf(stdout,"unique: %u live, %u slots\n",
+          mgl_resource_manager_get_element_count(test_unique),
+          mgl_resource_manager_get_capacity(test_unique));
+  mgl_resource_set_memory_budget(0);
+  mgl_resource_manager_clean(test_shared);
+  fprintf(stdout,"after clean: %i loads, %i deletes, %i errors\n",
+          SDL_AtomicGet(&test_stress_loads),
+          SDL_AtomicGet(&test_stress_deletes),
+          SDL_AtomicGet(&test_stress_errors));
+  mgl_resource_manager_free(&test_unique);
+  mgl_resource_manager_free(&test_shared);
+  free(workers);
+  free(seeds);
+}
+
+#define TEST_FOREACH_COUNT 16
+
+static TestElement *test_foreach_elements[TEST_FOREACH_COUNT];
+static MglUint test_foreach_visits[TEST_FOREACH_COUNT];
+static MglUint test_foreach_spawned = 0;
+static MglUint test_foreach_created = 0;
+
+static void test_foreach_visit(void *data,void *context)
+{
+  TestElement *element = (TestElement *)context;
+  TestElement *spawn;
+  if (element->id >= TEST_FOREACH_COUNT)
+  {
+    test_foreach_spawned++;
+    return;
+  }
+  test_foreach_visits[element->id]++;
+  /*every third element frees one the pass has already seen, which used to pull the last element behind the pass*/
+  if (((element->id % 3) == 0) && (element->id >= 3))
+  {
+    mgl_resource_free_element(manager,(void **)&test_foreach_elements[element->id - 3]);
+    /*and a new one takes the slot while the pass is running*/
+    spawn = mgl_resource_new_element(manager);
+    if (spawn)
+    {
+      spawn->id = TEST_FOREACH_COUNT + element->id;
+      test_foreach_created++;
+    }
+  }
+  if (element->id == 1)
+  {
+    /*freeing itself*/
+    mgl_resource_free_element(manager,(void **)&test_foreach_elements[1]);
+  }
+}
+
+void test_foreach()
+{
+  MglUint i,visited,expected,errors = 0;
+  manager = mgl_resource_manager_init(
+    "foreach manager",
+    TEST_FOREACH_COUNT * 2,
+    sizeof(TestElement),
+    MglTrue,
+    NULL,
+    NULL
+  );
+  for (i = 0;i < TEST_FOREACH_COUNT;i++)
+  {
+    test_foreach_elements[i] = mgl_resource_new_element(manager);
+    test_foreach_elements[i]->id = i;
+  }
+  expected = mgl_resource_manager_get_element_count(manager);
+  mgl_resource_manager_foreach(manager,mgl_callback(test_foreach_visit,NULL));
+  for (i = 0;i < TEST_FOREACH_COUNT;i++)
+  {
+    /*anything still alive after the pass must have been seen exactly once*/
+    if ((test_foreach_elements[i] != NULL) && (test_foreach_visits[i] != 1))
+    {
+      fprintf(stdout,"element %u visited %u times\n",i,test_foreach_visits[i]);
+      errors++;
+    }
+  }
+  /*elements created during the pass are seen at the end of it*/
+  if (test_foreach_spawned != test_foreach_created)errors++;
+  /*and the list is packed again once the pass is over*/
+  visited = 0;
+  mgl_resource_manager_foreach(manager,mgl_callback(test_count_element,&visited));
+  if (visited != mgl_resource_manager_get_element_count(manager))errors++;
+  fprintf(stdout,"%u elements at the start, %u of %u spawned elements visited, %u left\n",
+          expected,test_foreach_spawned,test_foreach_created,visited);
+  fprintf(stdout,"foreach visits: %s\n",errors?"FAILED":"ok");
+  mgl_resource_manager_free(&manager);
+}
+
 void test_delete(void *data)
 {
   TestElement *element;
@@ -56,6 +830,8 @@ void test_delete(void *data)
   if (element->string != NULL)
   {
     g_string_free(element->string,TRUE);
+    element->string = NULL;
+    test_delete_count++;
   }
 }
 
@@ -0,0 +1,59 @@
+#include "mgl_pack.h"
+#include "mgl_logger.h"
+#include <glib.h>
+#include <string.h>
+
+/**
+ * @purpose mgl_pack_builder bundles loose asset files into a pack that mgl_pack_mount can serve
+ */
+
+int main(int argc,char *argv[])
+{
+  GPtrArray *files;
+  char line[1024];
+  size_t length;
+  int i;
+  MglBool result;
+  if ((argc < 3) || (strcmp(argv[1],"-h")==0))
+  {
+    fprintf(stdout,"usage:\n");
+    fprintf(stdout,"%s [PACK] [FILES] to write the files into PACK\n",argv[0]);
+    fprintf(stdout,"%s [PACK] - to read the list of files from stdin, one per line\n",argv[0]);
+    return (argc < 3)?1:0;
+  }
+  mgl_logger_init();
+  files = g_ptr_array_new_with_free_func(g_free);
+  if ((argc == 3) && (strcmp(argv[2],"-")==0))
+  {
+    while (fgets(line,sizeof(line),stdin) != NULL)
+    {
+      length = strlen(line);
+      while ((length > 0) && ((line[length - 1] == '\n') || (line[length - 1] == '\r')))
+      {
+        line[--length] = '\0';
+      }
+      if (length == 0)continue;
+      g_ptr_array_add(files,g_strdup(line));
+    }
+  }
+  else
+  {
+    for (i = 2;i < argc;i++)
+    {
+      g_ptr_array_add(files,g_strdup(argv[i]));
+    }
+  }
+  result = mgl_pack_build(argv[1],(char **)files->pdata,files->len);
+  if (result)
+  {
+    fprintf(stdout,"packed %u files into %s\n",files->len,argv[1]);
+  }
+  else
+  {
+    fprintf(stdout,"failed to build %s\n",argv[1]);
+  }
+  g_ptr_array_free(files,TRUE);
+  return result?0:1;
+}
+
+/*eol@eof*/
@@ -26,6 +26,7 @@
 #include "mgl_vector.h"
 #include "mgl_rect.h"
 #include <glib.h>
+#include <stddef.h>
 
 /**
  * @brief the typed pointer is a pointer to a very limited subset of types.  It packs
@@ -35,17 +36,60 @@
 
 typedef enum mglDictTypes {
   MGL_DICT_VOID,   /**<custom data*/
-  MGL_DICT_INT,
-  MGL_DICT_UINT,
-  MGL_DICT_FLOAT,
-  MGL_DICT_STRING, /**<GString*/
-  MGL_DICT_LIST,   /**<GList of something*/
-  MGL_DICT_HASH,   /**<GHashTable of something*/
+  MGL_DICT_INT,    /**<scalar, stored in place*/
+  MGL_DICT_UINT,   /**<scalar, stored in place*/
+  MGL_DICT_FLOAT,  /**<scalar, stored in place*/
+  MGL_DICT_STRING, /**<char *, from g_strdup or the dict's arena*/
+  MGL_DICT_LIST,   /**<growable array of dicts*/
+  MGL_DICT_HASH,   /**<hash of dicts by interned key, kept in insertion order*/
+  MGL_DICT_BOOL,   /**<scalar, stored in place*/
+  MGL_DICT_VEC2D,  /**<scalar, stored in place*/
+  MGL_DICT_VEC3D,  /**<scalar, stored in place*/
+  MGL_DICT_VEC4D,  /**<scalar, stored in place*/
+  MGL_DICT_RECT,   /**<scalar, stored in place*/
+  MGL_DICT_RECTF,  /**<scalar, stored in place*/
+  MGL_DICT_UI32_ARRAY,/**<packed array of MglUI32, for bulk numbers like tile ids*/
   MGL_DICT_CUSTOM0 /**<for user defined types.  MGL will not use Custom0 or after.*/
 }MglDictTypes;
 
 typedef void (*MglDictFree)(void *data);
 
+/**
+ * @brief binary storage for the scalar dict types.  They are only converted to text when printed or saved.
+ */
+typedef union
+{
+  MglBool      b;
+  MglInt       i;
+  MglUint      u;
+  MglFloat     f;
+  MglVec2D     v2;
+  MglVec3D     v3;
+  MglVec4D     v4;
+  MglRect      r;
+  MglRectFloat rf;
+}MglDictScalar;
+
+/**
+ * @brief an interned hash key.  Equal keys are always the same pointer, so they can be compared directly
+ */
+typedef const char *MglDictKey;
+
+/**
+ * @brief a set of memory blocks that a whole dict tree can be allocated from and freed with at once
+ */
+typedef struct MglDictArena_S MglDictArena;
+
+/**
+ * @brief walks the items of a list or the keys of a hash in order.
+ * Adding or removing items while iterating is not supported.
+ */
+typedef struct
+{
+  struct MglDict_S *container;
+  MglUint           index;
+}MglDictIter;
+
 /**
 * @brief this structure wraps description information for a pointer to a container type
 * it will be used in spawn and config types where we deal with pointers to unknown types.
@@ -56,9 +100,36 @@ typedef struct MglDict_S
   MglUint itemCount;  /*in the case of list or hash*/
   MglDictFree keyFree;
   struct MglDict_S * (*keyClone)(struct MglDict_S *src);
-  void *keyValue;
+  void *keyValue;     /*NULL for scalar types*/
+  MglDictScalar scalar;/*value of scalar types*/
+  MglDictArena *arena;/*set if this dict lives in an arena, then it is only freed along with its root*/
+  SDL_atomic_t shares;/*how many more containers hold this string or scalar, clones share them*/
 }MglDict;
 
+/**
+ * @brief create an arena for building dict trees
+ * @param blockSize how many bytes to allocate at a time, 0 for the default
+ * @return NULL on allocation error or the new arena
+ */
+MglDictArena *mgl_dict_arena_new(size_t blockSize);
+
+/**
+ * @brief until mgl_dict_arena_end, every dict created on this thread is allocated from the arena.
+ * Strings, hash keys and the nodes themselves all live in its blocks.
+ * @param arena the arena to build in
+ */
+void mgl_dict_arena_begin(MglDictArena *arena);
+
+/**
+ * @brief stop building in the arena and hand it to the root of the tree built in it.
+ * Freeing the root frees the whole arena.  Freeing any other dict in the arena does nothing.
+ * Dicts allocated outside the arena can still be added to the tree, they are freed with it.
+ * @param arena the arena passed to mgl_dict_arena_begin
+ * @param root the root of the tree.  If NULL or not in the arena, the arena is freed
+ * @return root
+ */
+MglDict *mgl_dict_arena_end(MglDictArena *arena,MglDict *root);
+
 /**
 * @brief frees the MglDict and sets the passed in pointer to NULL
 * @param a pointer to a pointer to a typed pointer.
@@ -79,19 +150,27 @@ MglDict *mgl_dict_new();
 
 /**
  * @brief duplicate a dict
+ * Clone only shares levels that hold nothing but strings and scalars: their items are shared with the original
+ * until either side changes them.  Every list and hash that holds another list, hash or custom dict is copied
+ * when cloned, so the cost of a clone grows with the number of lists and hashes in the tree, not with what is
+ * changed later.  Strings and scalars are never copied.
+ * Changes made to the original after the clone, including through children it handed out before, never show in
+ * the clone and the other way around.  Reading never copies, so any number of threads can read either tree.
+ * An arena stays allocated after its root is freed for as long as clones share any of its storage.
+ * While an arena is current on this thread the dict is copied in full into it.
  * @param src the original dict to be duplicated
  * @return a pointer to the duplicated dict or NULL on error
  */
 MglDict *mgl_dict_clone(MglDict *src);
 
 /**
-* @brief allocated and sets up a pointer to a GString filled with the default text
+* @brief allocate a string dict holding a copy of the text
 * @param text starting text.  May be empty
-* @return NULL on allocation error or a set up MglDict of a GString
+* @return NULL on allocation error or a set up MglDict of a char *, copied with g_strdup or into the current arena
 */
 MglDict *mgl_dict_new_string(char *text);
 
-/*creates new key values based on inputs of different types*/
+/*creates new key values based on inputs of different types.  The value is kept in binary form*/
 
 MglDict *mgl_dict_new_bool(MglBool n);
 MglDict *mgl_dict_new_int(MglInt n);
@@ -116,9 +195,54 @@ MglDict *mgl_dict_new_list();
 */
 MglDict *mgl_dict_new_hash();
 
+/**
+ * @brief creates a packed array of 32 bit values.  Large runs of numbers cost 4 bytes each instead of a dict each.
+ * @param values the values to start with, copied.  May be NULL if count is 0
+ * @param count how many values to copy
+ * @return NULL on allocation error or the new array dict
+ */
+MglDict *mgl_dict_new_ui32_array(const MglUI32 *values,MglUint count);
+
+/**
+ * @brief adds a value to the end of a packed array
+ * @param array the MGL_DICT_UI32_ARRAY to add to
+ * @param value the value to add
+ * @return MglFalse if not an array or on allocation error
+ */
+MglBool mgl_dict_ui32_array_append(MglDict *array,MglUI32 value);
+
+/**
+ * @brief get direct access to the values of a packed array
+ * @param array the MGL_DICT_UI32_ARRAY to read
+ * @param count [output] optional, set to the number of values
+ * @return NULL if not an array or empty, the values otherwise.  Appending may move them
+ */
+const MglUI32 *mgl_dict_get_ui32_array(MglDict *array,MglUint *count);
+
+/**
+ * @brief check if a dict holds one of the scalar types stored in place
+ * @param dict the dict to check
+ * @return MglTrue if it is a bool, number, vector or rect, MglFalse otherwise
+ */
+MglBool mgl_dict_is_scalar(MglDict *dict);
+
+/*read a single dict value, from either a scalar or a string holding the text form of the value.
+  Numbers convert to each other, bools read as 0 and 1, and only 0 and 1 read as bools.
+  Return MglFalse and leave output untouched if the value cannot be converted*/
+MglBool mgl_dict_get_value_as_bool(MglBool *output, MglDict *value);
+MglBool mgl_dict_get_value_as_uint(MglUint *output, MglDict *value);
+MglBool mgl_dict_get_value_as_int(MglInt *output, MglDict *value);
+MglBool mgl_dict_get_value_as_float(MglFloat *output, MglDict *value);
+MglBool mgl_dict_get_value_as_vec2d(MglVec2D *output, MglDict *value);
+MglBool mgl_dict_get_value_as_vec3d(MglVec3D *output, MglDict *value);
+MglBool mgl_dict_get_value_as_vec4d(MglVec4D *output, MglDict *value);
+MglBool mgl_dict_get_value_as_rect(MglRect *output, MglDict *value);
+MglBool mgl_dict_get_value_as_rectfloat(MglRectFloat *output, MglDict *value);
+
 /**
 * @brief Retrieves the string information for a string dict.
-* if its not a pointer to a string, it will return without doing anything.
+* scalars are written out in their text form.
+* if its not a pointer to a string or scalar, it will return without doing anything.
 * @param output the output MglLine.  Untouched on error
 * @param key the MglDict string to retrieve
 * @return MglTrue if found and returned correctly, MglFalse otherwise
@@ -129,7 +253,7 @@ MglBool mgl_dict_get_line(MglLine output,MglDict *key);
  * @brief returns the direct pointer to the string data
  * NOTE: this is the direct pointer to the string data
  * @param string the dictionary containing the string data
- * @return NULL if not a string or on error, the string data otherwise
+ * @return NULL if not a string or on error, the string data otherwise.  Scalars have no string data, see mgl_dict_get_line
  */
 const char * mgl_dict_get_string(MglDict *string);
 
@@ -159,6 +283,21 @@ void mgl_dict_list_insert(MglDict *list,MglUint position,MglDict *item);
  */
 MglUint mgl_dict_get_hash_count(MglDict *hash);
 
+/**
+ * @brief get the interned key for the text.  Hashes intern every key inserted, so common keys are stored once.
+ * Interned keys live until the program exits.  Safe to call from any thread.
+ * @param text the key text
+ * @return NULL on error or the interned key
+ */
+MglDictKey mgl_dict_key_intern(const char *text);
+
+/**
+ * @brief get the nth key and value of a hash, in the order they were inserted
+ * @param key output the key is copied to.  Untouched if not found
+ * @param hash the dict hash to query
+ * @param n the index of the key
+ * @return NULL if not a hash or out of range, the value otherwise
+ */
 MglDict *mgl_dict_get_hash_nth(MglLine key, MglDict *hash, MglUint n);
 
 /**
@@ -170,6 +309,15 @@ MglDict *mgl_dict_get_hash_nth(MglLine key, MglDict *hash, MglUint n);
 */
 void mgl_dict_hash_insert(MglDict *hash,MglLine key,MglDict *value);
 
+/**
+ * @brief Insert or replace a key that is already interned, skipping the intern lookup.
+ * Parsers that intern each key once use this.
+ * @param hash the dict hash
+ * @param key a key returned by mgl_dict_key_intern
+ * @param value the MglDict to the item to be added to the hash.
+ */
+void mgl_dict_hash_insert_key(MglDict *hash,MglDictKey key,MglDict *value);
+
 /**
 * @brief Removes a key from the MglDict of a hash.
 * if it is not a pointer to a hash it will return without doing anything.
@@ -188,7 +336,16 @@ void mgl_dict_hash_remove(MglDict *hash,char *key);
  */
 MglDict *mgl_dict_get_hash_value(MglDict *hash,MglLine key);
 
-/*type value accessors*/
+/**
+ * @brief looks up an interned key in the hash without hashing or comparing the text again.
+ * Intern hot keys once with mgl_dict_key_intern and look them up with this.
+ * @param hash the dict hash to search
+ * @param key a key returned by mgl_dict_key_intern
+ * @return NULL if not a hash, or not found. The value otherwise
+ */
+MglDict *mgl_dict_get_hash_value_by_key(MglDict *hash,MglDictKey key);
+
+/*type value accessors, see mgl_dict_get_value_as_* */
 MglBool mgl_dict_get_hash_value_as_bool(MglBool *output, MglDict *hash, MglLine key);
 MglBool mgl_dict_get_hash_value_as_uint(MglUint *output, MglDict *hash, MglLine key);
 MglBool mgl_dict_get_hash_value_as_int(MglInt *output, MglDict *hash, MglLine key);
@@ -200,6 +357,90 @@ MglBool mgl_dict_get_hash_value_as_vec4d(MglVec4D *output, MglDict *hash, MglLin
 MglBool mgl_dict_get_hash_value_as_rect(MglRect *output, MglDict *hash, MglLine key);
 MglBool mgl_dict_get_hash_value_as_rectfloat(MglRectFloat *output, MglDict *hash, MglLine key);
 
+/**
+ * @brief describes one member of a C struct to fill from a hash key, see mgl_dict_decode_hash.
+ * Tables should be static and not const, the interned key is cached in the field on first use.
+ */
+typedef struct
+{
+  const char   *name;         /**<the hash key*/
+  MglDictTypes  type;         /**<scalar types read as mgl_dict_get_value_as_* does,
+                                  STRING into an MglLine, HASH or LIST into a borrowed MglDict pointer*/
+  size_t        offset;       /**<offsetof the member in the struct*/
+  MglDictScalar defaultValue; /**<written when the key is missing or does not convert.  Strings default to "", dicts to NULL*/
+  MglDictKey    key;          /**<leave NULL*/
+}MglDictField;
+
+/**
+ * @brief build an MglDictField for a member of a struct
+ * @param type the struct type
+ * @param member the member to fill
+ * @param name the hash key
+ * @param dictType how to read the member
+ */
+#define mgl_dict_field(type,member,name,dictType) {name,dictType,offsetof(type,member),{0},NULL}
+
+/**
+ * @brief build an MglDictField with a default, given as an MglDictScalar initializer such as {.v2 = {1,1}}
+ */
+#define mgl_dict_field_default(type,member,name,dictType,...) {name,dictType,offsetof(type,member),__VA_ARGS__,NULL}
+
+/**
+ * @brief true if the index'th field was found by mgl_dict_decode_hash
+ * Name the indices with an enum and fill the table with designated initializers, so the two cannot drift apart.
+ */
+#define mgl_dict_field_found(found,index) ((((MglUI64)(found)) >> (index)) & 1)
+
+/**
+ * @brief fill a struct from a hash in one pass over its entries.
+ * Every field gets its default first, then each key of the hash is matched against the fields by interned key.
+ * @param output the struct to fill
+ * @param hash the hash to read from
+ * @param fields the table describing the struct
+ * @param count how many fields are in the table
+ * @return a bit for each of the first 64 fields that was found and converted, see mgl_dict_field_found
+ */
+MglUI64 mgl_dict_decode_hash(void *output,MglDict *hash,MglDictField *fields,MglUint count);
+
+/**
+ * @brief a path into a dict tree, compiled once and resolved many times, see mgl_dict_path_new
+ */
+typedef struct MglDictPath_S MglDictPath;
+
+/**
+ * @brief compile a path such as "layers/3/tileset/tileSize" into a reusable query
+ * Segments are split on '/' and interned, so resolving never hashes or compares key text.
+ * On a list a numeric segment is an index, negative indices count back from the end.
+ * Segments are limited to the size of MglLine like any other key.
+ * @param text the path, an empty path resolves to the root itself
+ * @param memo if true results are remembered per tree, for hot paths into trees that are rarely changed.
+ *        Only trees built in an arena are memoized, and any change to the shape of a list or hash in that arena forgets them.
+ * @return NULL on error or the compiled path, free it with mgl_dict_path_free
+ */
+MglDictPath *mgl_dict_path_new(const char *text,MglBool memo);
+
+/**
+ * @brief free a compiled path and set the pointer to NULL
+ * @param path a pointer to the path to free
+ */
+void mgl_dict_path_free(MglDictPath **path);
+
+/**
+ * @brief resolve a compiled path against a tree
+ * @param path the compiled path
+ * @param root where the path starts
+ * @return NULL if any step is missing or the wrong type, the dict at the end of the path otherwise
+ */
+MglDict *mgl_dict_path_get(MglDictPath *path,MglDict *root);
+
+/**
+ * @brief resolve a path once without compiling it, see mgl_dict_path_new for the format
+ * @param root where the path starts
+ * @param path the path text
+ * @return NULL if any step is missing or the wrong type, the dict at the end of the path otherwise
+ */
+MglDict *mgl_dict_get_path(MglDict *root,const char *path);
+
 /**
 * @brief looks up the nth item in the list
 * checks type before any operation
@@ -247,13 +488,29 @@ void mgl_dict_list_move_nth_top(MglDict *list, MglUint n);
  */
 void mgl_dict_list_clear(MglDict *list);
 
+/**
+ * @brief start iterating over a list or hash
+ * @param iter the iterator to set up
+ * @param container the list or hash to walk
+ */
+void mgl_dict_iter_init(MglDictIter *iter,MglDict *container);
+
+/**
+ * @brief step to the next item of the container
+ * @param iter the iterator set up with mgl_dict_iter_init
+ * @param key [output] optional, set to the key for hashes or NULL for lists.  Owned by the hash
+ * @param value [output] optional, set to the item
+ * @return MglFalse once there are no more items or if the container is not a list or hash
+ */
+MglBool mgl_dict_iter_next(MglDictIter *iter,const char **key,MglDict **value);
+
 /**
  * @brief prints to terminal the dict specified
  */
 void mgl_dict_print(MglDict *chain);
 
 /**
-* @brief convenience function when working with GString types.
+* @brief free a string allocated with g_strdup, as held by string dicts outside an arena
 * @param string the string to free.
 */
 void mgl_g_string_free(char *string);
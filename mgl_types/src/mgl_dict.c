@@ -4,12 +4,121 @@
 #include "mgl_dict.h"
 
 #include <glib/gstring.h>
-#include <glib/glist.h>
 #include <glib/ghash.h>
+#include <stddef.h>
 #include <glib.h>
 
+#define MGL_DICT_ARENA_BLOCK_SIZE 65536
+#define MGL_DICT_ARENA_ALIGN 16
+#define MGL_DICT_HASH_LINEAR 8 /*hashes up to this size are searched without an index*/
+#define MGL_DICT_PATH_MEMO_SIZE 64 /*power of two, entries in each arena's path memo*/
+
+typedef struct MglDictArenaBlock_S
+{
+  struct MglDictArenaBlock_S *next;
+  size_t size;
+  size_t used;
+}MglDictArenaBlock;/*the block's memory follows the header*/
+
+typedef struct MglDictArenaContainer_S
+{
+  MglDict *dict;
+  struct MglDictArenaContainer_S *next;
+}MglDictArenaContainer;
+
+struct MglDictArena_S
+{
+  MglDictArenaBlock     *blocks;    /**<newest first, allocations come from the head*/
+  size_t                 blockSize;
+  MglDictArenaContainer *containers;/**<lists and hashes in the arena, their glib storage is not*/
+  MglUint                foreign;   /**<dicts from outside the arena that were added to its containers*/
+  MglDict               *root;      /**<freeing this frees the arena*/
+  MglDictArena          *previous;  /**<the arena that was current before mgl_dict_arena_begin*/
+  MglUint                generation;/**<bumped whenever a list or hash in the arena changes shape*/
+  struct MglDictPathMemo_S *memo;   /**<resolved path queries, allocated on first use*/
+  SDL_SpinLock           memoLock;
+  SDL_atomic_t           pins;      /**<one for the root plus one per hold from outside the arena, the last unpin frees it*/
+};
+
+typedef struct MglDictPathMemo_S
+{
+  MglUint  serial;    /**<of the query, 0 for an empty entry*/
+  MglUint  generation;/**<of the arena when the result was found*/
+  MglDict *root;
+  MglDict *result;
+}MglDictPathMemo;
+
+typedef struct
+{
+  MglDictKey key;     /**<interned segment, used on hashes*/
+  MglInt     index;   /**<used on lists, negative counts back from the end*/
+  MglBool    isIndex;
+}MglDictPathStep;
+
+struct MglDictPath_S
+{
+  MglUint          serial;
+  MglBool          memo;
+  MglUint          count;
+  MglDictPathStep *steps; /**<allocated along with the path*/
+};
+
+/**
+ * @brief the start of list and hash storage.  Clones share storage that holds only strings and scalars until
+ * one of them changes it, see mgl_dict_own
+ */
+typedef struct
+{
+  SDL_atomic_t  refs;    /**<how many more containers share this storage*/
+  MglUint       branches;/**<children that are not strings or scalars, storage is only shared while this is 0*/
+  MglDictArena *arena;   /**<set if the storage was allocated from an arena*/
+}MglDictShared;
+
+typedef struct
+{
+  MglDictShared shared;
+  MglDict     **items;
+  MglUint       capacity;
+}MglDictList;/*the item count is kept by the owning dict*/
+
+typedef struct
+{
+  MglUI32 hash;
+  MglUint length;
+  char    text[];
+}MglDictKeyAtom;/*interned keys point at text*/
+
+#define mgl_dict_key_atom(key) ((const MglDictKeyAtom *)((key) - offsetof(MglDictKeyAtom,text)))
+
+typedef struct
+{
+  MglDictKey key;
+  MglDict   *value;
+}MglDictHashEntry;
+
+typedef struct
+{
+  MglDictShared     shared;
+  MglDictHashEntry *entries;  /**<in insertion order*/
+  MglUint           capacity;
+  MglUint          *slots;    /**<open addressed index into entries plus one, 0 for empty.  NULL for small hashes*/
+  MglUint           slotCount;/**<power of two, at least twice the item count*/
+}MglDictHash;
+
+/*local variables*/
+static GPrivate __mgl_dict_arena_current = G_PRIVATE_INIT(NULL);
+static GHashTable *__mgl_dict_keys = NULL;       /*text to interned key, never freed*/
+static MglDictArena *__mgl_dict_keys_arena = NULL;
+static SDL_SpinLock __mgl_dict_keys_lock = 0;
+static SDL_atomic_t __mgl_dict_path_serial = {0};
+
 /*local prototypes*/
 void mgl_dict_print_link(MglDict *link,MglUint depth,MglBool listStart);
+static void mgl_dict_arena_free(MglDictArena *arena);
+static void *mgl_dict_arena_alloc(MglDictArena *arena,size_t size);
+static void mgl_dict_arena_touch(MglDict *container);
+static void mgl_dict_hash_reindex(MglDict *hash);
+static void mgl_dict_child_release(MglDict *child,MglDictArena *arena);
 
 /*function definitions*/
 
@@ -19,13 +128,152 @@ void mgl_g_string_free(char *string)
   g_free(string);
 }
 
-void mgl_dict_scalar_free(MglDict *scalar)
+static void mgl_dict_arena_touch(MglDict *container)
+{
+  /*anything memoized against this arena may now point somewhere else*/
+  if (container->arena)container->arena->generation++;
+}
+
+MglDictArena *mgl_dict_arena_new(size_t blockSize)
+{
+  MglDictArena *arena;
+  arena = (MglDictArena *)malloc(sizeof(MglDictArena));
+  if (!arena)return NULL;
+  memset(arena,0,sizeof(MglDictArena));
+  arena->blockSize = blockSize?blockSize:MGL_DICT_ARENA_BLOCK_SIZE;
+  return arena;
+}
+
+static void *mgl_dict_arena_alloc(MglDictArena *arena,size_t size)
+{
+  MglDictArenaBlock *block;
+  size_t blockSize,offset;
+  size = (size + MGL_DICT_ARENA_ALIGN - 1) & ~(size_t)(MGL_DICT_ARENA_ALIGN - 1);
+  offset = (sizeof(MglDictArenaBlock) + MGL_DICT_ARENA_ALIGN - 1) & ~(size_t)(MGL_DICT_ARENA_ALIGN - 1);
+  block = arena->blocks;
+  if ((block == NULL) || (block->used + size > block->size))
+  {
+    /*oversized requests get a block of their own*/
+    blockSize = MAX(arena->blockSize,size);
+    block = (MglDictArenaBlock *)malloc(offset + blockSize);
+    if (!block)return NULL;
+    block->size = blockSize;
+    block->used = 0;
+    block->next = arena->blocks;
+    arena->blocks = block;
+  }
+  block->used += size;
+  return (char *)block + offset + block->used - size;
+}
+
+static char *mgl_dict_arena_strdup(MglDictArena *arena,const char *text)
+{
+  char *copy;
+  size_t length;
+  length = strlen(text) + 1;
+  copy = (char *)mgl_dict_arena_alloc(arena,length);
+  if (!copy)return NULL;
+  memcpy(copy,text,length);
+  return copy;
+}
+
+static void mgl_dict_arena_add_container(MglDictArena *arena,MglDict *dict)
+{
+  MglDictArenaContainer *container;
+  container = (MglDictArenaContainer *)mgl_dict_arena_alloc(arena,sizeof(MglDictArenaContainer));
+  if (!container)return;
+  container->dict = dict;
+  container->next = arena->containers;
+  arena->containers = container;
+}
+
+/*called as a dict from outside is added to a container, so teardown knows to look for it*/
+static void mgl_dict_arena_check_foreign(MglDict *container,MglDict *item)
+{
+  if ((!container->arena) || (!item))return;
+  if (item->arena == container->arena)return;
+  container->arena->foreign++;
+}
+
+void mgl_dict_arena_begin(MglDictArena *arena)
+{
+  if (!arena)return;
+  arena->previous = (MglDictArena *)g_private_get(&__mgl_dict_arena_current);
+  g_private_set(&__mgl_dict_arena_current,arena);
+}
+
+MglDict *mgl_dict_arena_end(MglDictArena *arena,MglDict *root)
+{
+  if (!arena)return root;
+  g_private_set(&__mgl_dict_arena_current,arena->previous);
+  arena->previous = NULL;
+  if ((root == NULL) || (root->arena != arena))
+  {
+    mgl_dict_arena_free(arena);
+    return root;
+  }
+  arena->root = root;
+  SDL_AtomicAdd(&arena->pins,1);
+  return root;
+}
+
+static void mgl_dict_arena_free(MglDictArena *arena)
+{
+  MglDictArenaContainer *container;
+  MglDictArenaBlock *block,*next;
+  MglDictHash *hash;
+  MglDictList *list;
+  MglDict *dict;
+  MglUint i;
+  if (!arena)return;
+  arena->root = NULL;
+  /*everything lives in the blocks, so containers only need a look if dicts were added from outside*/
+  for (container = arena->foreign?arena->containers:NULL;container != NULL;container = container->next)
+  {
+    dict = container->dict;
+    if (dict->keyValue == NULL)continue;
+    if (dict->keyType == MGL_DICT_HASH)
+    {
+      /*arena values are left to the blocks, so only outside dicts are actually let go*/
+      hash = (MglDictHash *)dict->keyValue;
+      for (i = 0;i < dict->itemCount;i++)
+      {
+        mgl_dict_child_release(hash->entries[i].value,arena);
+      }
+    }
+    else if (dict->keyType == MGL_DICT_LIST)
+    {
+      list = (MglDictList *)dict->keyValue;
+      for (i = 0;i < dict->itemCount;i++)
+      {
+        mgl_dict_child_release(list->items[i],arena);
+      }
+    }
+    dict->keyValue = NULL;
+  }
+  for (block = arena->blocks;block != NULL;block = next)
+  {
+    next = block->next;
+    free(block);
+  }
+  free(arena->memo);
+  free(arena);
+}
+
+/*only the thread that takes the count to zero frees the arena*/
+static void mgl_dict_arena_unpin(MglDictArena *arena)
 {
-  if (!scalar)return;
-  if (scalar->keyType != MGL_DICT_LIST)return;
-  if (scalar->keyValue == NULL)return;
-  free(scalar->keyValue);
-  scalar->keyValue = NULL;
+  if (SDL_AtomicAdd(&arena->pins,-1) == 1)
+  {
+    mgl_dict_arena_free(arena);
+  }
+}
+
+/*drops the root's pin, the arena goes with it unless clones still share some of its storage*/
+static void mgl_dict_arena_release(MglDictArena *arena)
+{
+  arena->root = NULL;
+  mgl_dict_arena_unpin(arena);
 }
 
 void mgl_dict_destroy(MglDict *link)
@@ -33,47 +281,300 @@ void mgl_dict_destroy(MglDict *link)
   mgl_dict_free(&link);
 }
 
-void mgl_dict_hash_free(MglDict *hash)
+/*allocates zeroed storage for a container, from its arena if it has one*/
+static void *mgl_dict_storage_new(MglDict *dict,size_t size)
 {
-  if (!hash)return;
-  if (hash->keyType != MGL_DICT_HASH)return;
-  g_hash_table_destroy(hash->keyValue);
-  free(hash);
+  void *storage;
+  if (dict->arena != NULL)
+  {
+    storage = mgl_dict_arena_alloc(dict->arena,size);
+  }
+  else
+  {
+    storage = malloc(size);
+  }
+  if (!storage)return NULL;
+  memset(storage,0,size);
+  ((MglDictShared *)storage)->arena = dict->arena;
+  return storage;
 }
 
-void mgl_dict_list_free(MglDict *list)
+/*makes room for count elements, doubling the capacity.  Outgrown arena arrays are left to the arena*/
+static void *mgl_dict_array_grow(MglDict *dict,void *array,MglUint *capacity,MglUint count,size_t size)
 {
-  GList *it = NULL;
-  if (!list)return;
-  if (list->keyType != MGL_DICT_LIST)return;
-  for (it = list->keyValue;it != NULL;it = it->next)
+  void *grown;
+  MglUint newCapacity;
+  if (count <= *capacity)return array;
+  newCapacity = (*capacity)?*capacity:8;
+  while (newCapacity < count)newCapacity *= 2;
+  if (dict->arena != NULL)
+  {
+    grown = mgl_dict_arena_alloc(dict->arena,newCapacity * size);
+    if ((grown != NULL) && (array != NULL))
+    {
+      memcpy(grown,array,*capacity * size);
+    }
+  }
+  else
+  {
+    grown = realloc(array,newCapacity * size);
+  }
+  if (!grown)return NULL;
+  *capacity = newCapacity;
+  return grown;
+}
+
+/*1 for children that keep their level from being shared, anything but strings and scalars*/
+static inline MglUint mgl_dict_branch(MglDict *dict)
+{
+  if ((!dict) || (dict->keyType == MGL_DICT_STRING) || (mgl_dict_is_scalar(dict)))return 0;
+  return 1;
+}
+
+/*takes another hold on a string or scalar for storage from arena.  They cannot be changed, so any number of
+  containers can point at the same one*/
+static void mgl_dict_leaf_hold(MglDict *leaf,MglDictArena *arena)
+{
+  if (!leaf)return;
+  if ((leaf->arena != NULL) && (leaf->arena == arena))return;/*lives as long as the storage does*/
+  SDL_AtomicAdd(&leaf->shares,1);
+  if (leaf->arena != NULL)SDL_AtomicAdd(&leaf->arena->pins,1);
+}
+
+/*lets go of a child of storage from arena.  Heap dicts are freed once nothing else holds them, dicts from
+  another arena only give back the pin a clone took on it*/
+static void mgl_dict_child_release(MglDict *child,MglDictArena *arena)
+{
+  int shares;
+  if (!child)return;
+  if (child->arena == NULL)
+  {
+    mgl_dict_destroy(child);
+    return;
+  }
+  if (child->arena == arena)return;/*freed along with the arena*/
+  do
+  {
+    shares = SDL_AtomicGet(&child->shares);
+    if (shares <= 0)return;
+  }while (!SDL_AtomicCAS(&child->shares,shares,shares - 1));
+  mgl_dict_arena_unpin(child->arena);
+}
+
+/*the children of a list or hash, and how many there are with the stride between them*/
+static MglDict **mgl_dict_storage_children(MglDict *dict,size_t *stride)
+{
+  if (dict->keyType == MGL_DICT_LIST)
+  {
+    *stride = sizeof(MglDict *);
+    return ((MglDictList *)dict->keyValue)->items;
+  }
+  *stride = sizeof(MglDictHashEntry);
+  if (((MglDictHash *)dict->keyValue)->entries == NULL)return NULL;
+  return &((MglDictHash *)dict->keyValue)->entries[0].value;
+}
+
+#define mgl_dict_child(children,stride,i) (*(MglDict **)((char *)(children) + (i) * (stride)))
+
+/*drops a container's hold on its storage.  The last one to let go takes the children with it*/
+static void mgl_dict_storage_release(MglDict *dict)
+{
+  MglDictShared *shared;
+  MglDictArena *arena;
+  MglDict **children;
+  size_t stride;
+  MglUint i;
+  shared = (MglDictShared *)dict->keyValue;
+  if (!shared)return;
+  arena = shared->arena;
+  if (SDL_AtomicAdd(&shared->refs,-1) == 0)
+  {
+    children = mgl_dict_storage_children(dict,&stride);
+    for (i = 0;i < dict->itemCount;i++)
+    {
+      mgl_dict_child_release(mgl_dict_child(children,stride,i),arena);
+    }
+    if (arena == NULL)
+    {
+      if (dict->keyType == MGL_DICT_HASH)
+      {
+        free(((MglDictHash *)shared)->entries);
+        free(((MglDictHash *)shared)->slots);
+      }
+      else free(((MglDictList *)shared)->items);
+      free(shared);
+    }
+  }
+  dict->keyValue = NULL;
+  if ((arena != NULL) && (arena != dict->arena))mgl_dict_arena_unpin(arena);
+}
+
+/*new storage for dict with the same children as src.  Strings and scalars get another hold, with deep set
+  everything else is cloned, otherwise src may only hold strings and scalars*/
+static void *mgl_dict_storage_copy(MglDict *dict,MglDict *src,MglBool deep)
+{
+  MglDictShared *copy;
+  MglDict **children,**copies,*child;
+  MglDictList *list;
+  MglDictHash *hash;
+  size_t stride;
+  MglUint i;
+  children = mgl_dict_storage_children(src,&stride);
+  if (src->keyType == MGL_DICT_LIST)
+  {
+    list = (MglDictList *)mgl_dict_storage_new(dict,sizeof(MglDictList));
+    if (!list)return NULL;
+    list->items = (MglDict **)mgl_dict_array_grow(dict,NULL,&list->capacity,src->itemCount,sizeof(MglDict *));
+    if ((!list->items) && (src->itemCount))
+    {
+      if (!dict->arena)free(list);
+      return NULL;
+    }
+    copies = list->items;
+    copy = &list->shared;
+  }
+  else
+  {
+    hash = (MglDictHash *)mgl_dict_storage_new(dict,sizeof(MglDictHash));
+    if (!hash)return NULL;
+    hash->entries = (MglDictHashEntry *)mgl_dict_array_grow(dict,NULL,&hash->capacity,src->itemCount,sizeof(MglDictHashEntry));
+    if ((!hash->entries) && (src->itemCount))
+    {
+      if (!dict->arena)free(hash);
+      return NULL;
+    }
+    if (src->itemCount)memcpy(hash->entries,((MglDictHash *)src->keyValue)->entries,src->itemCount * sizeof(MglDictHashEntry));
+    copies = hash->entries?&hash->entries[0].value:NULL;
+    copy = &hash->shared;
+  }
+  copy->branches = ((MglDictShared *)src->keyValue)->branches;
+  for (i = 0;i < src->itemCount;i++)
+  {
+    child = mgl_dict_child(children,stride,i);
+    if ((deep) && (mgl_dict_branch(child)))
+    {
+      child = mgl_dict_clone(child);
+    }
+    else
+    {
+      mgl_dict_leaf_hold(child,dict->arena);
+    }
+    mgl_dict_arena_check_foreign(dict,child);
+    mgl_dict_child(copies,stride,i) = child;
+  }
+  return copy;
+}
+
+/*the clone of a list or hash, always on the heap.  A level holding only strings and scalars shares its storage,
+  any level above one gets storage of its own, so no container is ever reachable from two trees*/
+static MglDict *mgl_dict_clone_container(MglDict *src)
+{
+  MglDict *link;
+  MglDictShared *shared;
+  link = (MglDict *)malloc(sizeof(MglDict));
+  if (!link)return NULL;
+  memcpy(link,src,sizeof(MglDict));
+  link->arena = NULL;
+  SDL_AtomicSet(&link->shares,0);
+  shared = (MglDictShared *)src->keyValue;
+  if (shared == NULL)return link;
+  if (shared->branches == 0)
+  {
+    SDL_AtomicAdd(&shared->refs,1);
+    if (shared->arena != NULL)SDL_AtomicAdd(&shared->arena->pins,1);
+    return link;
+  }
+  link->keyValue = mgl_dict_storage_copy(link,src,MglTrue);
+  if (!link->keyValue)
   {
-    mgl_dict_destroy(it->data);
+    free(link);
+    return NULL;
   }
-  free(list);
+  if (link->keyType == MGL_DICT_HASH)mgl_dict_hash_reindex(link);
+  return link;
+}
+
+/*a container about to change its children makes sure nothing else shares its storage.
+  storage from another arena is never changed in place.  Only the mutators come through here, reads never copy*/
+static MglBool mgl_dict_own(MglDict *dict)
+{
+  MglDictShared *shared;
+  void *storage;
+  shared = (MglDictShared *)dict->keyValue;
+  if (!shared)return MglTrue;
+  if ((SDL_AtomicGet(&shared->refs) == 0) && (shared->arena == dict->arena))return MglTrue;
+  storage = mgl_dict_storage_copy(dict,dict,MglFalse);
+  if (!storage)return MglFalse;
+  mgl_dict_storage_release(dict);
+  dict->keyValue = storage;
+  if (dict->keyType == MGL_DICT_HASH)mgl_dict_hash_reindex(dict);
+  mgl_dict_arena_touch(dict);
+  return MglTrue;
+}
+
+void mgl_dict_list_free_items(MglDict *list)
+{
+  mgl_dict_storage_release(list);
+}
+
+void mgl_dict_hash_free_entries(MglDict *hash)
+{
+  mgl_dict_storage_release(hash);
 }
 
 void mgl_dict_list_clear(MglDict *list)
 {
-  GList *it = NULL;
+  MglDictList *storage;
+  MglUint i;
   if (!list)return;
   if (list->keyType != MGL_DICT_LIST)return;
-  for (it = list->keyValue;it != NULL;it = it->next)
+  storage = (MglDictList *)list->keyValue;
+  if ((storage != NULL) && ((SDL_AtomicGet(&storage->shared.refs) > 0) || (storage->shared.arena != list->arena)))
+  {
+    /*clones sharing the items keep them, this list starts over with storage of its own*/
+    mgl_dict_storage_release(list);
+    storage = NULL;
+  }
+  if (storage != NULL)
   {
-    mgl_dict_destroy(it->data);
+    /*the array is kept for reuse*/
+    for (i = 0;i < list->itemCount;i++)
+    {
+      mgl_dict_child_release(storage->items[i],list->arena);
+    }
+    storage->shared.branches = 0;
   }
-  g_list_free(list->keyValue);
-  list->keyValue = NULL;
   list->itemCount = 0;
+  mgl_dict_arena_touch(list);
 }
 
 void mgl_dict_free(MglDict **link)
 {
   if (!link)return;
   if (!*link)return;
+  if ((*link)->arena != NULL)
+  {
+    if ((*link)->arena->root == *link)
+    {
+      mgl_dict_arena_release((*link)->arena);
+    }
+    *link = NULL;
+    return;
+  }
+  if ((SDL_AtomicGet(&(*link)->shares) != 0) && (SDL_AtomicAdd(&(*link)->shares,-1) > 0))
+  {
+    /*a string or scalar that clones still hold*/
+    *link = NULL;
+    return;
+  }
   if ((*link)->keyValue != NULL)
   {
-    if ((*link)->keyFree != NULL)
+    if (((*link)->keyType == MGL_DICT_LIST) || ((*link)->keyType == MGL_DICT_HASH))
+    {
+      /*containers need their item count to free their storage*/
+      (*link)->keyFree(*link);
+    }
+    else if ((*link)->keyFree != NULL)
     {
       (*link)->keyFree((*link)->keyValue);
     }
@@ -89,6 +590,13 @@ void mgl_dict_free(MglDict **link)
 MglDict *mgl_dict_clone(MglDict *src)
 {
   if (!src)return NULL;
+  if (((src->keyType == MGL_DICT_LIST) || (src->keyType == MGL_DICT_HASH)) &&
+      (g_private_get(&__mgl_dict_arena_current) == NULL))
+  {
+    /*every list and hash gets a new dict, levels holding only strings and scalars share storage until one side
+      changes it.  While an arena is current on this thread the clone is copied in full into it instead*/
+    return mgl_dict_clone_container(src);
+  }
   if (!src->keyClone)return NULL;
   return src->keyClone(src);
 }
@@ -118,20 +626,19 @@ MglDict *mgl_dict_clone_list(MglDict *src)
 
 MglDict *mgl_dict_clone_hash(MglDict *src)
 {
-  MglUint count,i;
+  MglDictIter iter;
   MglDict *hash;
-  MglLine keystring;
+  const char *key;
   MglDict * value, *newValue;
   if (!src)return NULL;
   hash = mgl_dict_new_hash();
   if (!hash)return NULL;
-  count = mgl_dict_get_hash_count(src);
-  for (i = 0;i < count;i++)
+  mgl_dict_iter_init(&iter,src);
+  while (mgl_dict_iter_next(&iter,&key,&value))
   {
-    value = mgl_dict_get_hash_nth(keystring,src, i);
     if (!value)continue;
     newValue = mgl_dict_clone(value);
-    mgl_dict_hash_insert(hash,keystring,newValue);
+    mgl_dict_hash_insert(hash,(char *)key,newValue);
   }
   return hash;
 }
@@ -139,135 +646,148 @@ MglDict *mgl_dict_clone_hash(MglDict *src)
 MglDict *mgl_dict_new()
 {
   MglDict *link = NULL;
-  link = (MglDict *)malloc(sizeof(MglDict));
+  MglDictArena *arena;
+  arena = (MglDictArena *)g_private_get(&__mgl_dict_arena_current);
+  if (arena != NULL)
+  {
+    link = (MglDict *)mgl_dict_arena_alloc(arena,sizeof(MglDict));
+  }
+  else
+  {
+    link = (MglDict *)malloc(sizeof(MglDict));
+  }
   if (link == NULL)
   {
     return NULL;
   }
   memset(link,0,sizeof(MglDict));
+  link->arena = arena;
   return link;
 }
 
 
 
-MglDict *mgl_dict_new_int_scaler(MglInt value)
+MglDict *mgl_dict_clone_scalar(MglDict *src)
 {
-  MglInt *cast;
   MglDict *link;
+  if (!src)return NULL;
   link = mgl_dict_new();
   if (!link)return NULL;
-  link->keyType = MGL_DICT_INT;
-  link->keyFree = (MglDictFree)mgl_dict_scalar_free;
-  link->keyValue = malloc(sizeof(MglInt));
-  if (link->keyValue == NULL)
-  {
-    free (link);
-    return NULL;
-  }
-  cast = (MglInt *)link->keyValue;
-  *cast = value;
+  link->keyType = src->keyType;
+  link->keyClone = src->keyClone;
+  link->scalar = src->scalar;
   return link;
 }
 
-MglDict *mgl_dict_new_uint_scaler(MglUint value)
+MglDict *mgl_dict_new_scalar(MglDictTypes keyType)
 {
-  MglUint *cast;
   MglDict *link;
   link = mgl_dict_new();
   if (!link)return NULL;
-  link->keyType = MGL_DICT_UINT;
-  link->keyFree = (MglDictFree)mgl_dict_scalar_free;
-  link->keyValue = malloc(sizeof(MglUint));
-  if (link->keyValue == NULL)
-  {
-    free (link);
-    return NULL;
-  }
-  cast = (MglUint *)link->keyValue;
-  *cast = value;
+  link->keyType = keyType;
+  link->keyClone = mgl_dict_clone_scalar;
   return link;
 }
 
-MglDict *mgl_dict_new_float_scaler(MglFloat value)
+MglBool mgl_dict_is_scalar(MglDict *dict)
 {
-  MglFloat *cast;
-  MglDict *link;
-  link = mgl_dict_new();
-  if (!link)return NULL;
-  link->keyType = MGL_DICT_FLOAT;
-  link->keyFree = (MglDictFree)mgl_dict_scalar_free;
-  link->keyValue = malloc(sizeof(MglFloat));
-  if (link->keyValue == NULL)
+  if (!dict)return MglFalse;
+  switch (dict->keyType)
   {
-    free (link);
-    return NULL;
+    case MGL_DICT_INT:
+    case MGL_DICT_UINT:
+    case MGL_DICT_FLOAT:
+    case MGL_DICT_BOOL:
+    case MGL_DICT_VEC2D:
+    case MGL_DICT_VEC3D:
+    case MGL_DICT_VEC4D:
+    case MGL_DICT_RECT:
+    case MGL_DICT_RECTF:
+      return MglTrue;
+    default:
+      return MglFalse;
   }
-  cast = (MglFloat *)link->keyValue;
-  *cast = value;
-  return link;
 }
 
 MglDict *mgl_dict_new_bool(MglBool n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%s",mgl_string_from_bool(n));
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_BOOL);
+  if (!link)return NULL;
+  link->scalar.b = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_int(MglInt n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%i",n);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_INT);
+  if (!link)return NULL;
+  link->scalar.i = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_uint(MglInt n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%u",n);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_UINT);
+  if (!link)return NULL;
+  link->scalar.u = (MglUint)n;
+  return link;
 }
 
 MglDict *mgl_dict_new_float(MglFloat n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%f",n);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_FLOAT);
+  if (!link)return NULL;
+  link->scalar.f = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_vec2d(MglVec2D n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%f,%f",n.x,n.y);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_VEC2D);
+  if (!link)return NULL;
+  link->scalar.v2 = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_vec3d(MglVec3D n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%f,%f,%f",n.x,n.y,n.z);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_VEC3D);
+  if (!link)return NULL;
+  link->scalar.v3 = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_vec4d(MglVec4D n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%f,%f,%f,%f",n.x,n.y,n.z,n.w);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_VEC4D);
+  if (!link)return NULL;
+  link->scalar.v4 = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_rect(MglRect n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%i,%i,%i,%i",n.x,n.y,n.w,n.h);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_RECT);
+  if (!link)return NULL;
+  link->scalar.r = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_rectf(MglRectFloat n)
 {
-  MglLine text;
-  snprintf(text,MGLLINELEN,"%f,%f,%f,%f",n.x,n.y,n.w,n.h);
-  return mgl_dict_new_string(text);
+  MglDict *link;
+  link = mgl_dict_new_scalar(MGL_DICT_RECTF);
+  if (!link)return NULL;
+  link->scalar.rf = n;
+  return link;
 }
 
 MglDict *mgl_dict_new_string(char *text)
@@ -277,8 +797,13 @@ MglDict *mgl_dict_new_string(char *text)
   if (!link)return NULL;
   link->keyType = MGL_DICT_STRING;
   link->itemCount = strlen(text);
-  link->keyFree = (MglDictFree)mgl_g_string_free;
   link->keyClone = mgl_dict_clone_string;
+  if (link->arena != NULL)
+  {
+    link->keyValue = mgl_dict_arena_strdup(link->arena,text);
+    return link;
+  }
+  link->keyFree = (MglDictFree)mgl_g_string_free;
   link->keyValue = g_strdup(text);
   return link;
 }
@@ -290,85 +815,365 @@ MglDict *mgl_dict_new_list()
   if (!link)return NULL;
   link->keyType = MGL_DICT_LIST;
   link->itemCount = 0;
-  link->keyFree = (MglDictFree)mgl_dict_list_free;
+  link->keyFree = (MglDictFree)mgl_dict_list_free_items;
   link->keyClone = mgl_dict_clone_list;
-  link->keyValue = NULL;
+  link->keyValue = NULL;/*the array is allocated with the first item*/
+  if (link->arena != NULL)
+  {
+    mgl_dict_arena_add_container(link->arena,link);
+  }
   return link;
 }
 
 MglDict *mgl_dict_new_hash()
 {
   MglDict *link;
+  MglDictHash *storage;
   link = mgl_dict_new();
   if (!link)return NULL;
   link->keyType = MGL_DICT_HASH;
   link->itemCount = 0;
-  link->keyFree = (MglDictFree)mgl_dict_hash_free;
+  link->keyFree = (MglDictFree)mgl_dict_hash_free_entries;
   link->keyClone = mgl_dict_clone_hash;
-  link->keyValue =
-    g_hash_table_new_full(g_str_hash,
-                          g_str_equal,
-                          (GDestroyNotify)mgl_g_string_free,
-                          (GDestroyNotify)mgl_dict_destroy);
+  storage = (MglDictHash *)mgl_dict_storage_new(link,sizeof(MglDictHash));
+  if (!storage)
+  {
+    mgl_dict_destroy(link);
+    return NULL;
+  }
+  link->keyValue = storage;
+  if (link->arena != NULL)
+  {
+    mgl_dict_arena_add_container(link->arena,link);
+  }
   return link;
 }
 
-MglBool mgl_dict_get_line(MglLine output,MglDict *key)
+MglDict *mgl_dict_clone_ui32_array(MglDict *src)
 {
-  if (!key)return MglFalse;
-  if (key->keyType != MGL_DICT_STRING)return MglFalse;
-  if (key->keyValue == NULL)return MglFalse;
-  mgl_line_cpy(output,key->keyValue);
-  return MglTrue;
+  return mgl_dict_new_ui32_array((const MglUI32 *)src->keyValue,src->itemCount);
 }
 
-void mgl_dict_hash_remove(MglDict *hash,char *key)
+MglDict *mgl_dict_new_ui32_array(const MglUI32 *values,MglUint count)
 {
-  GHashTable*hashtable = NULL;
-  if (!hash)return;
-  if (hash->keyType != MGL_DICT_HASH)return;
-  if (hash->keyValue == NULL)return;
-  hashtable = (GHashTable*)hash->keyValue;
-  g_hash_table_remove(hashtable,key);
+  MglDict *link;
+  link = mgl_dict_new();
+  if (!link)return NULL;
+  link->keyType = MGL_DICT_UI32_ARRAY;
+  link->keyClone = mgl_dict_clone_ui32_array;
+  /*the capacity is kept in scalar.u, the values are freed with free() or with the arena*/
+  if (count == 0)return link;
+  link->keyValue = mgl_dict_array_grow(link,NULL,&link->scalar.u,count,sizeof(MglUI32));
+  if (!link->keyValue)
+  {
+    mgl_dict_destroy(link);
+    return NULL;
+  }
+  if (values)memcpy(link->keyValue,values,count * sizeof(MglUI32));
+  else memset(link->keyValue,0,count * sizeof(MglUI32));
+  link->itemCount = count;
+  return link;
 }
 
-void mgl_dict_hash_insert(MglDict *hash,char *key,MglDict *value)
+MglBool mgl_dict_ui32_array_append(MglDict *array,MglUI32 value)
 {
-  GHashTable*hashtable = NULL;
-  if (!hash)return;
-  if (hash->keyType != MGL_DICT_HASH)return;
-  if (hash->keyValue == NULL)return;
-  hashtable = (GHashTable*)hash->keyValue;
-  if (g_hash_table_lookup(hashtable,key) != NULL)
-  {
-    g_hash_table_replace(hashtable,g_strdup(key),value);
-  }
-  else
+  MglUI32 *values;
+  if ((!array) || (array->keyType != MGL_DICT_UI32_ARRAY))return MglFalse;
+  values = (MglUI32 *)mgl_dict_array_grow(array,array->keyValue,&array->scalar.u,array->itemCount + 1,sizeof(MglUI32));
+  if (!values)return MglFalse;
+  array->keyValue = values;
+  values[array->itemCount++] = value;
+  return MglTrue;
+}
+
+const MglUI32 *mgl_dict_get_ui32_array(MglDict *array,MglUint *count)
+{
+  if ((!array) || (array->keyType != MGL_DICT_UI32_ARRAY))
+  {
+    if (count)*count = 0;
+    return NULL;
+  }
+  if (count)*count = array->itemCount;
+  return (const MglUI32 *)array->keyValue;
+}
+
+/*the text form of a scalar, the same as what the getters parse back from a string*/
+MglBool mgl_dict_scalar_to_line(MglLine output,MglDict *key)
+{
+  MglDictScalar *s;
+  s = &key->scalar;
+  switch (key->keyType)
+  {
+    case MGL_DICT_BOOL:
+      snprintf(output,MGLLINELEN,"%s",mgl_string_from_bool(s->b));
+      return MglTrue;
+    case MGL_DICT_INT:
+      snprintf(output,MGLLINELEN,"%i",s->i);
+      return MglTrue;
+    case MGL_DICT_UINT:
+      snprintf(output,MGLLINELEN,"%u",s->u);
+      return MglTrue;
+    case MGL_DICT_FLOAT:
+      snprintf(output,MGLLINELEN,"%f",s->f);
+      return MglTrue;
+    case MGL_DICT_VEC2D:
+      snprintf(output,MGLLINELEN,"%f,%f",s->v2.x,s->v2.y);
+      return MglTrue;
+    case MGL_DICT_VEC3D:
+      snprintf(output,MGLLINELEN,"%f,%f,%f",s->v3.x,s->v3.y,s->v3.z);
+      return MglTrue;
+    case MGL_DICT_VEC4D:
+      snprintf(output,MGLLINELEN,"%f,%f,%f,%f",s->v4.x,s->v4.y,s->v4.z,s->v4.w);
+      return MglTrue;
+    case MGL_DICT_RECT:
+      snprintf(output,MGLLINELEN,"%i,%i,%i,%i",s->r.x,s->r.y,s->r.w,s->r.h);
+      return MglTrue;
+    case MGL_DICT_RECTF:
+      snprintf(output,MGLLINELEN,"%f,%f,%f,%f",s->rf.x,s->rf.y,s->rf.w,s->rf.h);
+      return MglTrue;
+    default:
+      return MglFalse;
+  }
+}
+
+MglBool mgl_dict_get_line(MglLine output,MglDict *key)
+{
+  if (!key)return MglFalse;
+  if (mgl_dict_is_scalar(key))return mgl_dict_scalar_to_line(output,key);
+  if (key->keyType != MGL_DICT_STRING)return MglFalse;
+  if (key->keyValue == NULL)return MglFalse;
+  mgl_line_cpy(output,key->keyValue);
+  return MglTrue;
+}
+
+static MglUI32 mgl_dict_key_hash(const char *key)
+{
+  MglUI32 hash = 2166136261u;
+  for (;*key != '\0';key++)
+  {
+    hash = (hash ^ (unsigned char)*key) * 16777619u;
+  }
+  return hash;
+}
+
+MglDictKey mgl_dict_key_intern(const char *text)
+{
+  MglDictKeyAtom *atom;
+  MglDictKey key;
+  size_t length;
+  if (!text)return NULL;
+  SDL_AtomicLock(&__mgl_dict_keys_lock);
+  if (__mgl_dict_keys == NULL)
+  {
+    __mgl_dict_keys = g_hash_table_new(g_str_hash,g_str_equal);
+    __mgl_dict_keys_arena = mgl_dict_arena_new(0);
+  }
+  key = (MglDictKey)g_hash_table_lookup(__mgl_dict_keys,text);
+  if ((key == NULL) && (__mgl_dict_keys_arena != NULL))
+  {
+    length = strlen(text);
+    atom = (MglDictKeyAtom *)mgl_dict_arena_alloc(__mgl_dict_keys_arena,sizeof(MglDictKeyAtom) + length + 1);
+    if (atom != NULL)
+    {
+      atom->hash = mgl_dict_key_hash(text);
+      atom->length = length;
+      memcpy(atom->text,text,length + 1);
+      key = atom->text;
+      g_hash_table_insert(__mgl_dict_keys,(gpointer)key,(gpointer)key);
+    }
+  }
+  SDL_AtomicUnlock(&__mgl_dict_keys_lock);
+  return key;
+}
+
+/*index of the key in the entries or -1.  interned keys only need a pointer compare*/
+static MglInt mgl_dict_hash_find(MglDict *hash,const char *key,MglUI32 keyHash,MglBool interned)
+{
+  MglDictHash *storage;
+  MglDictHashEntry *entry;
+  MglUint i,slot,mask;
+  storage = (MglDictHash *)hash->keyValue;
+  if (storage->slots == NULL)
+  {
+    for (i = 0;i < hash->itemCount;i++)
+    {
+      entry = &storage->entries[i];
+      if (entry->key == key)return i;
+      if ((!interned) && (mgl_dict_key_atom(entry->key)->hash == keyHash) && (strcmp(entry->key,key) == 0))return i;
+    }
+    return -1;
+  }
+  mask = storage->slotCount - 1;
+  for (slot = keyHash & mask;storage->slots[slot] != 0;slot = (slot + 1) & mask)
+  {
+    entry = &storage->entries[storage->slots[slot] - 1];
+    if (entry->key == key)return storage->slots[slot] - 1;
+    if ((!interned) && (mgl_dict_key_atom(entry->key)->hash == keyHash) && (strcmp(entry->key,key) == 0))return storage->slots[slot] - 1;
+  }
+  return -1;
+}
+
+static void mgl_dict_hash_slot_insert(MglDictHash *storage,MglUint index)
+{
+  MglUint slot,mask;
+  mask = storage->slotCount - 1;
+  for (slot = mgl_dict_key_atom(storage->entries[index].key)->hash & mask;storage->slots[slot] != 0;slot = (slot + 1) & mask);
+  storage->slots[slot] = index + 1;
+}
+
+/*rebuilds the index for the current entries, growing it if the hash has outgrown it*/
+static void mgl_dict_hash_reindex(MglDict *hash)
+{
+  MglDictHash *storage;
+  MglUint slotCount,i;
+  MglUint *slots;
+  storage = (MglDictHash *)hash->keyValue;
+  if (hash->itemCount <= MGL_DICT_HASH_LINEAR)
+  {
+    if (hash->arena == NULL)free(storage->slots);
+    storage->slots = NULL;
+    storage->slotCount = 0;
+    return;
+  }
+  slotCount = MAX(storage->slotCount,32);
+  while (slotCount < hash->itemCount * 2)slotCount *= 2;
+  if (slotCount != storage->slotCount)
+  {
+    if (hash->arena != NULL)
+    {
+      slots = (MglUint *)mgl_dict_arena_alloc(hash->arena,slotCount * sizeof(MglUint));
+    }
+    else
+    {
+      slots = (MglUint *)malloc(slotCount * sizeof(MglUint));
+    }
+    if (!slots)
+    {
+      /*without an index the entries are searched in order*/
+      if (hash->arena == NULL)free(storage->slots);
+      storage->slots = NULL;
+      storage->slotCount = 0;
+      return;
+    }
+    if (hash->arena == NULL)free(storage->slots);
+    storage->slots = slots;
+    storage->slotCount = slotCount;
+  }
+  memset(storage->slots,0,storage->slotCount * sizeof(MglUint));
+  for (i = 0;i < hash->itemCount;i++)
+  {
+    mgl_dict_hash_slot_insert(storage,i);
+  }
+}
+
+void mgl_dict_hash_remove(MglDict *hash,char *key)
+{
+  MglDictHash *storage;
+  MglDict *value;
+  MglInt i;
+  if (!hash)return;
+  if (hash->keyType != MGL_DICT_HASH)return;
+  if (hash->keyValue == NULL)return;
+  if (!key)return;
+  i = mgl_dict_hash_find(hash,key,mgl_dict_key_hash(key),MglFalse);
+  if (i < 0)return;
+  if (!mgl_dict_own(hash))return;
+  storage = (MglDictHash *)hash->keyValue;
+  value = storage->entries[i].value;
+  memmove(&storage->entries[i],&storage->entries[i + 1],(hash->itemCount - i - 1) * sizeof(MglDictHashEntry));
+  hash->itemCount--;
+  storage->shared.branches -= mgl_dict_branch(value);
+  /*everything after the removed key moved down one*/
+  if (storage->slots != NULL)mgl_dict_hash_reindex(hash);
+  mgl_dict_arena_touch(hash);
+  mgl_dict_child_release(value,hash->arena);
+}
+
+void mgl_dict_hash_insert(MglDict *hash,char *key,MglDict *value)
+{
+  if (!hash)return;
+  if (hash->keyType != MGL_DICT_HASH)return;
+  if (hash->keyValue == NULL)return;
+  mgl_dict_hash_insert_key(hash,mgl_dict_key_intern(key),value);
+}
+
+void mgl_dict_hash_insert_key(MglDict *hash,MglDictKey atom,MglDict *value)
+{
+  MglDictHash *storage;
+  MglDictHashEntry *entries;
+  MglDictHashEntry *entry;
+  MglInt i;
+  if ((!hash) || (!atom))return;
+  if (hash->keyType != MGL_DICT_HASH)return;
+  if (hash->keyValue == NULL)return;
+  if (!mgl_dict_own(hash))return;
+  storage = (MglDictHash *)hash->keyValue;
+  i = mgl_dict_hash_find(hash,atom,mgl_dict_key_atom(atom)->hash,MglTrue);
+  if (i >= 0)
+  {
+    /*replacing a value keeps the key where it was*/
+    entry = &storage->entries[i];
+    if (entry->value == value)return;
+    mgl_dict_arena_check_foreign(hash,value);
+    mgl_dict_arena_touch(hash);
+    storage->shared.branches += mgl_dict_branch(value) - mgl_dict_branch(entry->value);
+    mgl_dict_child_release(entry->value,hash->arena);
+    entry->value = value;
+    return;
+  }
+  entries = (MglDictHashEntry *)mgl_dict_array_grow(hash,storage->entries,&storage->capacity,hash->itemCount + 1,sizeof(MglDictHashEntry));
+  if (!entries)return;
+  storage->entries = entries;
+  mgl_dict_arena_check_foreign(hash,value);
+  entries[hash->itemCount].key = atom;
+  entries[hash->itemCount].value = value;
+  hash->itemCount++;
+  storage->shared.branches += mgl_dict_branch(value);
+  mgl_dict_arena_touch(hash);
+  if ((hash->itemCount > MGL_DICT_HASH_LINEAR) && (hash->itemCount * 2 > storage->slotCount))
   {
-    g_hash_table_insert(hashtable,g_strdup(key),value);
-    hash->itemCount++;
+    mgl_dict_hash_reindex(hash);
+  }
+  else if (storage->slots != NULL)
+  {
+    mgl_dict_hash_slot_insert(storage,hash->itemCount - 1);
   }
 }
 
 void mgl_dict_list_append(MglDict *list,MglDict *item)
 {
   if (!list)return;
-  if (list->keyType != MGL_DICT_LIST)return;
-  list->keyValue = g_list_append(list->keyValue,item);
-  list->itemCount++;
+  mgl_dict_list_insert(list,list->itemCount,item);
 }
 
 void mgl_dict_list_insert(MglDict *list,MglUint position,MglDict *item)
 {
-    if (!list)return;
-    if (list->keyType != MGL_DICT_LIST)return;
-    list->keyValue = g_list_insert (list->keyValue,(gpointer)item,(gint)position);    
-    list->itemCount++;
+  MglDictList *storage;
+  MglDict **items;
+  if (!list)return;
+  if (list->keyType != MGL_DICT_LIST)return;
+  if (list->keyValue == NULL)
+  {
+    list->keyValue = mgl_dict_storage_new(list,sizeof(MglDictList));
+    if (list->keyValue == NULL)return;
+  }
+  else if (!mgl_dict_own(list))return;
+  storage = (MglDictList *)list->keyValue;
+  items = (MglDict **)mgl_dict_array_grow(list,storage->items,&storage->capacity,list->itemCount + 1,sizeof(MglDict *));
+  if (!items)return;
+  storage->items = items;
+  if (position > list->itemCount)position = list->itemCount;
+  memmove(&items[position + 1],&items[position],(list->itemCount - position) * sizeof(MglDict *));
+  items[position] = item;
+  list->itemCount++;
+  storage->shared.branches += mgl_dict_branch(item);
+  mgl_dict_arena_check_foreign(list,item);
+  mgl_dict_arena_touch(list);
 }
 
 MglDict *mgl_dict_get_hash_value(MglDict *hash,MglLine key)
 {
-  GHashTable*hashtable = NULL;
+  MglInt i;
   if (!hash)
   {    
     return NULL;
@@ -377,12 +1182,24 @@ MglDict *mgl_dict_get_hash_value(MglDict *hash,MglLine key)
   {    
     return NULL;
   }
-  if (hash->keyValue == NULL)
+  if ((hash->keyValue == NULL) || (key == NULL))
   {
     return NULL;
   }
-  hashtable = (GHashTable*)hash->keyValue;
-  return g_hash_table_lookup(hashtable,key);
+  i = mgl_dict_hash_find(hash,key,mgl_dict_key_hash(key),MglFalse);
+  if (i < 0)return NULL;
+  return ((MglDictHash *)hash->keyValue)->entries[i].value;
+}
+
+MglDict *mgl_dict_get_hash_value_by_key(MglDict *hash,MglDictKey key)
+{
+  MglInt i;
+  if ((!hash) || (!key))return NULL;
+  if (hash->keyType != MGL_DICT_HASH)return NULL;
+  if (hash->keyValue == NULL)return NULL;
+  i = mgl_dict_hash_find(hash,key,mgl_dict_key_atom(key)->hash,MglTrue);
+  if (i < 0)return NULL;
+  return ((MglDictHash *)hash->keyValue)->entries[i].value;
 }
 
 MglUint mgl_dict_get_hash_count(MglDict *list)
@@ -403,19 +1220,14 @@ MglUint mgl_dict_get_list_count(MglDict *list)
 
 MglDict *mgl_dict_get_hash_nth(MglLine key, MglDict *hash, MglUint n)
 {
-  GHashTable *hashtable = NULL;
-  MglDict *result = NULL;
-  GList *keys = NULL;
+  MglDictHash *storage;
   if (!hash)return NULL;
   if (hash->keyType != MGL_DICT_HASH)return NULL;
   if (hash->keyValue == NULL)return NULL;
-  hashtable = (GHashTable*)hash->keyValue;
-  keys = g_hash_table_get_keys(hashtable);
-  if (!keys)return NULL;
-  mgl_line_cpy(key,g_list_nth_data(keys,n));
-  result = mgl_dict_get_hash_value(hash,key);
-  g_list_free(keys);
-  return result;
+  if (n >= hash->itemCount)return NULL;
+  storage = (MglDictHash *)hash->keyValue;
+  mgl_line_cpy(key,storage->entries[n].key);
+  return storage->entries[n].value;
 }
 
 MglDict *mgl_dict_get_list_nth(MglDict *list, MglUint n)
@@ -423,199 +1235,675 @@ MglDict *mgl_dict_get_list_nth(MglDict *list, MglUint n)
   if (!list)return NULL;
   if (list->keyType != MGL_DICT_LIST)return NULL;
   if (list->keyValue == NULL)return NULL;
-  return g_list_nth_data((GList*)list->keyValue,n);
+  if (n >= list->itemCount)return NULL;
+  return ((MglDictList *)list->keyValue)->items[n];
 }
 
 void mgl_dict_list_remove_nth(MglDict *list, MglUint n)
 {
-  GList *link;
+  MglDict **items;
+  MglDict *item;
   if (!list)return;
   if (list->keyType != MGL_DICT_LIST)return;
   if (list->keyValue == NULL)return;
-  link = g_list_nth((GList*)list->keyValue,n);
-  if (link == NULL)return;
-  list->keyValue = g_list_remove_link(list->keyValue,link);
-  mgl_dict_free((MglDict**)&link->data);
-  g_list_free(link);
+  if (n >= list->itemCount)return;
+  if (!mgl_dict_own(list))return;
+  items = ((MglDictList *)list->keyValue)->items;
+  item = items[n];
+  memmove(&items[n],&items[n + 1],(list->itemCount - n - 1) * sizeof(MglDict *));
+  list->itemCount--;
+  ((MglDictList *)list->keyValue)->shared.branches -= mgl_dict_branch(item);
+  mgl_dict_arena_touch(list);
+  mgl_dict_child_release(item,list->arena);
 }
 
 void mgl_dict_list_move_nth_top(MglDict *list, MglUint n)
 {
-  GList *link;
+  MglDict **items;
+  MglDict *item;
   if (!list)return;
   if (list->keyType != MGL_DICT_LIST)return;
   if (list->keyValue == NULL)return;
-  link = g_list_nth((GList*)list->keyValue,n);
-  if (link == NULL)return;
-  list->keyValue = g_list_remove_link(list->keyValue,link);
-  list->keyValue = g_list_concat(link,list->keyValue);
-  g_list_free(link);
+  if (n >= list->itemCount)return;
+  if (!mgl_dict_own(list))return;
+  items = ((MglDictList *)list->keyValue)->items;
+  item = items[n];
+  memmove(&items[1],&items[0],n * sizeof(MglDict *));
+  items[0] = item;
+  mgl_dict_arena_touch(list);
 }
 
 void mgl_dict_list_move_nth_bottom(MglDict *list, MglUint n)
 {
-  GList *link;
+  MglDict **items;
+  MglDict *item;
   if (!list)return;
   if (list->keyType != MGL_DICT_LIST)return;
   if (list->keyValue == NULL)return;
-  link = g_list_nth((GList*)list->keyValue,n);
-  if (link == NULL)return;
-  list->keyValue = g_list_remove_link(list->keyValue,link);
-  list->keyValue = g_list_concat(list->keyValue,link);
-  g_list_free(link);
+  if (n >= list->itemCount)return;
+  if (!mgl_dict_own(list))return;
+  items = ((MglDictList *)list->keyValue)->items;
+  item = items[n];
+  memmove(&items[n],&items[n + 1],(list->itemCount - n - 1) * sizeof(MglDict *));
+  items[list->itemCount - 1] = item;
+  mgl_dict_arena_touch(list);
 }
 
-MglBool mgl_dict_get_hash_value_as_uint(MglUint *output, MglDict *hash, MglLine key)
+void mgl_dict_iter_init(MglDictIter *iter,MglDict *container)
+{
+  if (!iter)return;
+  iter->container = container;
+  iter->index = 0;
+}
+
+MglBool mgl_dict_iter_next(MglDictIter *iter,const char **key,MglDict **value)
+{
+  MglDict *container;
+  MglDictHashEntry *entry;
+  if (!iter)return MglFalse;
+  container = iter->container;
+  if ((!container) || (container->keyValue == NULL))return MglFalse;
+  if (iter->index >= container->itemCount)return MglFalse;
+  if (container->keyType == MGL_DICT_HASH)
+  {
+    entry = &((MglDictHash *)container->keyValue)->entries[iter->index];
+    if (key)*key = entry->key;
+    if (value)*value = entry->value;
+  }
+  else if (container->keyType == MGL_DICT_LIST)
+  {
+    if (key)*key = NULL;
+    if (value)*value = ((MglDictList *)container->keyValue)->items[iter->index];
+  }
+  else return MglFalse;
+  iter->index++;
+  return MglTrue;
+}
+
+MglBool mgl_dict_get_value_as_uint(MglUint *output, MglDict *value)
 {
   MglUint temp = 0;
   MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%ui",&temp) != 1)return MglFalse;
-  *output = temp;
-  return MglTrue;
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_UINT:
+      *output = value->scalar.u;
+      return MglTrue;
+    case MGL_DICT_INT:
+      *output = (MglUint)value->scalar.i;
+      return MglTrue;
+    case MGL_DICT_FLOAT:
+      *output = (MglUint)value->scalar.f;
+      return MglTrue;
+    case MGL_DICT_BOOL:
+      *output = value->scalar.b;
+      return MglTrue;
+    case MGL_DICT_STRING:
+      mgl_line_cpy(keyValue,value->keyValue);
+      if (sscanf(keyValue,"%ui",&temp) != 1)return MglFalse;
+      *output = temp;
+      return MglTrue;
+    default:
+      return MglFalse;
+  }
 }
 
-MglBool mgl_dict_get_hash_value_as_int(MglInt *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_int(MglInt *output, MglDict *value)
 {
   MglInt temp = 0;
   MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%i",&temp) != 1)return MglFalse;
-  *output = temp;
-  return MglTrue;
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_INT:
+      *output = value->scalar.i;
+      return MglTrue;
+    case MGL_DICT_UINT:
+      *output = (MglInt)value->scalar.u;
+      return MglTrue;
+    case MGL_DICT_FLOAT:
+      *output = (MglInt)value->scalar.f;
+      return MglTrue;
+    case MGL_DICT_BOOL:
+      *output = value->scalar.b;
+      return MglTrue;
+    case MGL_DICT_STRING:
+      mgl_line_cpy(keyValue,value->keyValue);
+      if (sscanf(keyValue,"%i",&temp) != 1)return MglFalse;
+      *output = temp;
+      return MglTrue;
+    default:
+      return MglFalse;
+  }
 }
 
-MglBool mgl_dict_get_hash_value_as_float(MglFloat *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_float(MglFloat *output, MglDict *value)
 {
   MglFloat temp = 0;
   MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%f",&temp) != 1)return MglFalse;
-  *output = temp;
-  return MglTrue;
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_FLOAT:
+      *output = value->scalar.f;
+      return MglTrue;
+    case MGL_DICT_INT:
+      *output = (MglFloat)value->scalar.i;
+      return MglTrue;
+    case MGL_DICT_UINT:
+      *output = (MglFloat)value->scalar.u;
+      return MglTrue;
+    case MGL_DICT_BOOL:
+      *output = (MglFloat)value->scalar.b;
+      return MglTrue;
+    case MGL_DICT_STRING:
+      mgl_line_cpy(keyValue,value->keyValue);
+      if (sscanf(keyValue,"%f",&temp) != 1)return MglFalse;
+      *output = temp;
+      return MglTrue;
+    default:
+      return MglFalse;
+  }
 }
 
-MglBool mgl_dict_get_hash_value_as_bool(MglBool *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_bool(MglBool *output, MglDict *value)
 {
-  MglDict *chain;
   MglInt boo;
-  if ((!hash) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
   {
-    return MglFalse;
+    case MGL_DICT_BOOL:
+      *output = value->scalar.b;
+      return MglTrue;
+    case MGL_DICT_INT:
+    case MGL_DICT_UINT:
+      /*same as the strings "0" and "1"*/
+      if ((value->scalar.u != 0) && (value->scalar.u != 1))return MglFalse;
+      *output = (MglBool)value->scalar.u;
+      return MglTrue;
+    case MGL_DICT_FLOAT:
+      if ((value->scalar.f != 0) && (value->scalar.f != 1))return MglFalse;
+      *output = (MglBool)value->scalar.f;
+      return MglTrue;
+    case MGL_DICT_STRING:
+      boo = mgl_bool_from_string(value->keyValue);
+      if (boo == -1)return MglFalse;/*tag was not boolean*/
+      *output = boo;
+      return MglTrue;
+    default:
+      return MglFalse;
   }
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  boo = mgl_bool_from_string(chain->keyValue);
-  if (boo == -1)return MglFalse;/*tag was not boolean*/
-  *output = boo;
-  return MglTrue;
 }
 
-MglBool mgl_dict_get_hash_value_as_line(MglLine output, MglDict *hash, MglLine key)
+/*reads "x,y,..." the way sscanf("%lf,%lf,...") does, without the format parsing*/
+static MglBool mgl_dict_parse_doubles(const char *text,MglDouble *output,int count)
 {
-  MglDict *chain;
-  if ((!hash) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)
+  char *end;
+  int i;
+  if (!text)return MglFalse;
+  for (i = 0;i < count;i++)
   {
-    return MglFalse;
+    output[i] = strtod(text,&end);
+    if (end == text)return MglFalse;
+    if (i + 1 == count)break;
+    if (*end != ',')return MglFalse;
+    text = end + 1;
   }
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(output,chain->keyValue);
   return MglTrue;
 }
 
-MglBool mgl_dict_get_hash_value_as_vec4d(MglVec4D *output, MglDict *hash, MglLine key)
+/*vectors and rects convert to each other when the target has no more components than the source*/
+MglBool mgl_dict_get_value_as_vec4d(MglVec4D *output, MglDict *value)
 {
   MglVec4D temp = {0,0,0,0};
-  MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%lf,%lf,%lf,%lf",&temp.x,&temp.y,&temp.z,&temp.w) != 4)return MglFalse;
+  MglDouble numbers[4];
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_VEC4D:
+      temp = value->scalar.v4;
+      break;
+    case MGL_DICT_RECTF:
+      mgl_vec4d_set(temp,value->scalar.rf.x,value->scalar.rf.y,value->scalar.rf.w,value->scalar.rf.h);
+      break;
+    case MGL_DICT_RECT:
+      mgl_vec4d_set(temp,value->scalar.r.x,value->scalar.r.y,value->scalar.r.w,value->scalar.r.h);
+      break;
+    case MGL_DICT_STRING:
+      if (!mgl_dict_parse_doubles(value->keyValue,numbers,4))return MglFalse;
+      mgl_vec4d_set(temp,numbers[0],numbers[1],numbers[2],numbers[3]);
+      break;
+    default:
+      return MglFalse;
+  }
   mgl_vec4d_copy((*output),temp);
   return MglTrue;
 }
 
-MglBool mgl_dict_get_hash_value_as_vec3d(MglVec3D *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_vec3d(MglVec3D *output, MglDict *value)
 {
   MglVec3D temp = {0,0,0};
-  MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%lf,%lf,%lf",&temp.x,&temp.y,&temp.z) != 3)return MglFalse;
+  MglDouble numbers[3];
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_VEC3D:
+      temp = value->scalar.v3;
+      break;
+    case MGL_DICT_VEC4D:
+      mgl_vec3d_set(temp,value->scalar.v4.x,value->scalar.v4.y,value->scalar.v4.z);
+      break;
+    case MGL_DICT_STRING:
+      if (!mgl_dict_parse_doubles(value->keyValue,numbers,3))return MglFalse;
+      mgl_vec3d_set(temp,numbers[0],numbers[1],numbers[2]);
+      break;
+    default:
+      return MglFalse;
+  }
   mgl_vec3d_copy((*output),temp);
   return MglTrue;
 }
 
-MglBool mgl_dict_get_hash_value_as_vec2d(MglVec2D *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_vec2d(MglVec2D *output, MglDict *value)
 {
   MglVec2D temp = {0,0};
-  MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%lf,%lf",&temp.x,&temp.y) != 2)return MglFalse;
+  MglDouble numbers[2];
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_VEC2D:
+      temp = value->scalar.v2;
+      break;
+    case MGL_DICT_VEC3D:
+      mgl_vec2d_set(temp,value->scalar.v3.x,value->scalar.v3.y);
+      break;
+    case MGL_DICT_VEC4D:
+      mgl_vec2d_set(temp,value->scalar.v4.x,value->scalar.v4.y);
+      break;
+    case MGL_DICT_RECTF:
+      mgl_vec2d_set(temp,value->scalar.rf.x,value->scalar.rf.y);
+      break;
+    case MGL_DICT_RECT:
+      mgl_vec2d_set(temp,value->scalar.r.x,value->scalar.r.y);
+      break;
+    case MGL_DICT_STRING:
+      if (!mgl_dict_parse_doubles(value->keyValue,numbers,2))return MglFalse;
+      mgl_vec2d_set(temp,numbers[0],numbers[1]);
+      break;
+    default:
+      return MglFalse;
+  }
   mgl_vec2d_copy((*output),temp);
   return MglTrue;
 }
 
-MglBool mgl_dict_get_hash_value_as_rect(MglRect *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_rect(MglRect *output, MglDict *value)
 {
   MglRect temp = {0,0,0,0};
   MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%i,%i,%i,%i",&temp.x,&temp.y,&temp.w,&temp.h) != 4)return MglFalse;
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_RECT:
+      temp = value->scalar.r;
+      break;
+    case MGL_DICT_RECTF:
+      temp = mgl_rect(value->scalar.rf.x,value->scalar.rf.y,value->scalar.rf.w,value->scalar.rf.h);
+      break;
+    case MGL_DICT_VEC4D:
+      temp = mgl_rect(value->scalar.v4.x,value->scalar.v4.y,value->scalar.v4.z,value->scalar.v4.w);
+      break;
+    case MGL_DICT_STRING:
+      mgl_line_cpy(keyValue,value->keyValue);
+      if (sscanf(keyValue,"%i,%i,%i,%i",&temp.x,&temp.y,&temp.w,&temp.h) != 4)return MglFalse;
+      break;
+    default:
+      return MglFalse;
+  }
   mgl_rect_copy(output,temp);
   return MglTrue;
 }
 
-MglBool mgl_dict_get_hash_value_as_rectfloat(MglRectFloat *output, MglDict *hash, MglLine key)
+MglBool mgl_dict_get_value_as_rectfloat(MglRectFloat *output, MglDict *value)
 {
   MglRectFloat temp = {0,0,0,0};
-  MglLine keyValue;
-  MglDict *chain;
-  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
-  chain = mgl_dict_get_hash_value(hash,key);
-  if (!chain)return MglFalse;
-  if (chain->keyType != MGL_DICT_STRING)return MglFalse;
-  mgl_line_cpy(keyValue,chain->keyValue);
-  if (sscanf(keyValue,"%lf,%lf,%lf,%lf",&temp.x,&temp.y,&temp.w,&temp.h) != 4)return MglFalse;
+  MglDouble numbers[4];
+  if ((!value) || (!output))return MglFalse;
+  switch (value->keyType)
+  {
+    case MGL_DICT_RECTF:
+      temp = value->scalar.rf;
+      break;
+    case MGL_DICT_RECT:
+      temp = mgl_rectf(value->scalar.r.x,value->scalar.r.y,value->scalar.r.w,value->scalar.r.h);
+      break;
+    case MGL_DICT_VEC4D:
+      temp = mgl_rectf(value->scalar.v4.x,value->scalar.v4.y,value->scalar.v4.z,value->scalar.v4.w);
+      break;
+    case MGL_DICT_STRING:
+      if (!mgl_dict_parse_doubles(value->keyValue,numbers,4))return MglFalse;
+      temp.x = numbers[0];
+      temp.y = numbers[1];
+      temp.w = numbers[2];
+      temp.h = numbers[3];
+      break;
+    default:
+      return MglFalse;
+  }
   mgl_rectf_copy(output,temp);
   return MglTrue;
 }
 
+MglBool mgl_dict_get_hash_value_as_uint(MglUint *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_uint(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_int(MglInt *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_int(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_float(MglFloat *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_float(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_bool(MglBool *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_bool(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_line(MglLine output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_line(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_vec4d(MglVec4D *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_vec4d(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_vec3d(MglVec3D *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_vec3d(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_vec2d(MglVec2D *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_vec2d(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_rect(MglRect *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_rect(output,mgl_dict_get_hash_value(hash,key));
+}
+
+MglBool mgl_dict_get_hash_value_as_rectfloat(MglRectFloat *output, MglDict *hash, MglLine key)
+{
+  if ((!hash) || (!output) || (strlen(key) == 0))return MglFalse;
+  return mgl_dict_get_value_as_rectfloat(output,mgl_dict_get_hash_value(hash,key));
+}
+
+static size_t mgl_dict_field_size(MglDictTypes type)
+{
+  switch (type)
+  {
+    case MGL_DICT_BOOL:
+      return sizeof(MglBool);
+    case MGL_DICT_INT:
+      return sizeof(MglInt);
+    case MGL_DICT_UINT:
+      return sizeof(MglUint);
+    case MGL_DICT_FLOAT:
+      return sizeof(MglFloat);
+    case MGL_DICT_VEC2D:
+      return sizeof(MglVec2D);
+    case MGL_DICT_VEC3D:
+      return sizeof(MglVec3D);
+    case MGL_DICT_VEC4D:
+      return sizeof(MglVec4D);
+    case MGL_DICT_RECT:
+      return sizeof(MglRect);
+    case MGL_DICT_RECTF:
+      return sizeof(MglRectFloat);
+    default:
+      return 0;
+  }
+}
+
+static MglBool mgl_dict_field_decode(MglDictField *field,void *member,MglDict *value)
+{
+  switch (field->type)
+  {
+    case MGL_DICT_BOOL:
+      return mgl_dict_get_value_as_bool((MglBool *)member,value);
+    case MGL_DICT_INT:
+      return mgl_dict_get_value_as_int((MglInt *)member,value);
+    case MGL_DICT_UINT:
+      return mgl_dict_get_value_as_uint((MglUint *)member,value);
+    case MGL_DICT_FLOAT:
+      return mgl_dict_get_value_as_float((MglFloat *)member,value);
+    case MGL_DICT_VEC2D:
+      return mgl_dict_get_value_as_vec2d((MglVec2D *)member,value);
+    case MGL_DICT_VEC3D:
+      return mgl_dict_get_value_as_vec3d((MglVec3D *)member,value);
+    case MGL_DICT_VEC4D:
+      return mgl_dict_get_value_as_vec4d((MglVec4D *)member,value);
+    case MGL_DICT_RECT:
+      return mgl_dict_get_value_as_rect((MglRect *)member,value);
+    case MGL_DICT_RECTF:
+      return mgl_dict_get_value_as_rectfloat((MglRectFloat *)member,value);
+    case MGL_DICT_STRING:
+      return mgl_dict_get_line(*(MglLine *)member,value);
+    case MGL_DICT_HASH:
+    case MGL_DICT_LIST:
+      if ((!value) || (value->keyType != field->type))return MglFalse;
+      *(MglDict **)member = value;
+      return MglTrue;
+    default:
+      return MglFalse;
+  }
+}
+
+MglUI64 mgl_dict_decode_hash(void *output,MglDict *hash,MglDictField *fields,MglUint count)
+{
+  MglDictHash *storage;
+  MglDictField *field;
+  MglDictKey key;
+  MglUI64 found = 0;
+  MglUint i,j;
+  char *base;
+  if ((!output) || (!fields))return 0;
+  base = (char *)output;
+  for (i = 0;i < count;i++)
+  {
+    field = &fields[i];
+    if (field->key == NULL)
+    {
+      /*interning always gives the same pointer, so it does not matter which thread stores it*/
+      SDL_AtomicCASPtr((void **)&field->key,NULL,(void *)mgl_dict_key_intern(field->name));
+    }
+    switch (field->type)
+    {
+      case MGL_DICT_STRING:
+        ((char *)(base + field->offset))[0] = '\0';
+        break;
+      case MGL_DICT_HASH:
+      case MGL_DICT_LIST:
+        *(MglDict **)(base + field->offset) = NULL;
+        break;
+      default:
+        memcpy(base + field->offset,&field->defaultValue,mgl_dict_field_size(field->type));
+    }
+  }
+  if ((!hash) || (hash->keyType != MGL_DICT_HASH) || (hash->keyValue == NULL))return 0;
+  storage = (MglDictHash *)hash->keyValue;
+  for (j = 0;j < hash->itemCount;j++)
+  {
+    key = storage->entries[j].key;
+    for (i = 0;i < count;i++)
+    {
+      if (fields[i].key != key)continue;
+      if (mgl_dict_field_decode(&fields[i],base + fields[i].offset,storage->entries[j].value))
+      {
+        if (i < 64)found |= (MglUI64)1 << i;
+      }
+      break;
+    }
+  }
+  return found;
+}
+
+/*copies the next segment of a path into segment, returns where the one after starts or NULL at the end*/
+static const char *mgl_dict_path_segment(const char *path,MglLine segment)
+{
+  size_t length;
+  while (*path == '/')path++;
+  if (*path == '\0')return NULL;
+  length = strcspn(path,"/");
+  /*keys are limited to an MglLine, longer segments are cut the same way*/
+  memcpy(segment,path,MIN(length,MGLLINELEN - 1));
+  segment[MIN(length,MGLLINELEN - 1)] = '\0';
+  return path + length;
+}
+
+static MglBool mgl_dict_path_index(const char *segment,MglInt *index)
+{
+  const char *c = segment;
+  char *end = NULL;
+  if (*c == '-')c++;
+  if ((*c < '0') || (*c > '9'))return MglFalse;
+  *index = (MglInt)strtol(segment,&end,10);
+  return (*end == '\0');
+}
+
+/*one step down the tree, keys on hashes and indices on lists*/
+static MglDict *mgl_dict_path_step(MglDict *node,MglDictPathStep *step,const char *segment)
+{
+  MglInt index;
+  if (node->keyType == MGL_DICT_HASH)
+  {
+    if (segment)return mgl_dict_get_hash_value(node,(char *)segment);
+    return mgl_dict_get_hash_value_by_key(node,step->key);
+  }
+  if ((node->keyType != MGL_DICT_LIST) || (!step->isIndex))return NULL;
+  index = step->index;
+  if (index < 0)index += (MglInt)node->itemCount;
+  if (index < 0)return NULL;
+  return mgl_dict_get_list_nth(node,(MglUint)index);
+}
+
+MglDictPath *mgl_dict_path_new(const char *text,MglBool memo)
+{
+  MglDictPath *path;
+  MglDictPathStep *step;
+  MglLine segment;
+  const char *c;
+  MglUint count = 0;
+  if (!text)return NULL;
+  for (c = mgl_dict_path_segment(text,segment);c != NULL;c = mgl_dict_path_segment(c,segment))count++;
+  path = (MglDictPath *)malloc(sizeof(MglDictPath) + count * sizeof(MglDictPathStep));
+  if (!path)return NULL;
+  memset(path,0,sizeof(MglDictPath) + count * sizeof(MglDictPathStep));
+  path->steps = (MglDictPathStep *)(path + 1);
+  path->count = count;
+  path->memo = memo;
+  /*serials are never reused, so a memo entry can not match a new query that took a freed one's address*/
+  path->serial = (MglUint)SDL_AtomicAdd(&__mgl_dict_path_serial,1) + 1;
+  step = path->steps;
+  for (c = mgl_dict_path_segment(text,segment);c != NULL;c = mgl_dict_path_segment(c,segment),step++)
+  {
+    step->key = mgl_dict_key_intern(segment);
+    step->isIndex = mgl_dict_path_index(segment,&step->index);
+  }
+  return path;
+}
+
+void mgl_dict_path_free(MglDictPath **path)
+{
+  if ((!path) || (!*path))return;
+  free(*path);
+  *path = NULL;
+}
+
+static MglDict *mgl_dict_path_walk(MglDictPath *path,MglDict *root)
+{
+  MglUint i;
+  MglDict *node = root;
+  for (i = 0;(i < path->count) && (node != NULL);i++)
+  {
+    node = mgl_dict_path_step(node,&path->steps[i],NULL);
+  }
+  return node;
+}
+
+MglDict *mgl_dict_path_get(MglDictPath *path,MglDict *root)
+{
+  MglDictArena *arena;
+  MglDictPathMemo *entry;
+  MglDict *result;
+  MglUint slot,generation;
+  if ((!path) || (!root))return NULL;
+  arena = root->arena;
+  /*dicts from outside the arena do not bump its generation, so trees holding them are always walked*/
+  if ((!path->memo) || (!arena) || (arena->foreign))return mgl_dict_path_walk(path,root);
+  slot = (path->serial * 2654435761u ^ (MglUint)((uintptr_t)root >> 4)) & (MGL_DICT_PATH_MEMO_SIZE - 1);
+  SDL_AtomicLock(&arena->memoLock);
+  generation = arena->generation;
+  if (arena->memo)
+  {
+    entry = &arena->memo[slot];
+    if ((entry->serial == path->serial) && (entry->root == root) && (entry->generation == generation))
+    {
+      result = entry->result;
+      SDL_AtomicUnlock(&arena->memoLock);
+      return result;
+    }
+  }
+  SDL_AtomicUnlock(&arena->memoLock);
+  result = mgl_dict_path_walk(path,root);
+  SDL_AtomicLock(&arena->memoLock);
+  if (!arena->memo)
+  {
+    arena->memo = (MglDictPathMemo *)calloc(MGL_DICT_PATH_MEMO_SIZE,sizeof(MglDictPathMemo));
+  }
+  if (arena->memo)
+  {
+    entry = &arena->memo[slot];
+    entry->serial = path->serial;
+    entry->generation = generation;
+    entry->root = root;
+    entry->result = result;
+  }
+  SDL_AtomicUnlock(&arena->memoLock);
+  return result;
+}
+
+MglDict *mgl_dict_get_path(MglDict *root,const char *path)
+{
+  MglDictPathStep step = {0};
+  MglLine segment;
+  const char *c;
+  if (!path)return NULL;
+  for (c = mgl_dict_path_segment(path,segment);(c != NULL) && (root != NULL);c = mgl_dict_path_segment(c,segment))
+  {
+    step.isIndex = mgl_dict_path_index(segment,&step.index);
+    root = mgl_dict_path_step(root,&step,segment);
+  }
+  return root;
+}
+
 const char * mgl_dict_get_string(MglDict *string)
 {
     if (!string)return NULL;
@@ -634,43 +1922,70 @@ void mgl_dict_print_string(MglDict *link,MglUint depth)
 void mgl_dict_print_hash(MglDict *link,MglUint depth,MglBool listStart)
 {
   int i;
-  GList *keys = NULL;
-  GList *values = NULL;
+  MglDictIter iter;
+  const char *key;
+  MglDict *value;
   if (!link)return;
   if (link->keyType != MGL_DICT_HASH)return;
-  keys = g_hash_table_get_keys((GHashTable*)link->keyValue);
-  values = g_hash_table_get_values((GHashTable*)link->keyValue);
   if (!listStart)printf("\n");
-  for (;(keys != NULL) && (values != NULL); keys = keys->next,values = values->next)
+  mgl_dict_iter_init(&iter,link);
+  while (mgl_dict_iter_next(&iter,&key,&value))
   {
     for (i = 0; i < depth;i++){printf("  ");}
-    printf("%s :",(char *)keys->data);
-    mgl_dict_print_link((MglDict *)values->data,depth + 1,MglFalse);
+    printf("%s :",key);
+    mgl_dict_print_link(value,depth + 1,MglFalse);
     printf("\n");
   }
-  g_list_free(values);
-  g_list_free(keys);
 }
 
 void mgl_dict_print_list(MglDict *link,MglUint depth,MglBool listStart)
 {
   int i;
-  GList *it;
+  MglDictIter iter;
+  MglDict *item;
   if (!link)return;
   if (link->keyType != MGL_DICT_LIST)return;
   printf("\n");
-  for (it = (GList *)link->keyValue;it != NULL;it = it->next)
+  mgl_dict_iter_init(&iter,link);
+  while (mgl_dict_iter_next(&iter,NULL,&item))
   {
     for (i = 0; i < (depth - 1);i++){printf("  ");}
     printf("- ");
-    mgl_dict_print_link((MglDict *)it->data,depth + 1,MglTrue);
+    mgl_dict_print_link(item,depth + 1,MglTrue);
     printf("\n");
   }
 }
 
+void mgl_dict_print_ui32_array(MglDict *link,MglUint depth)
+{
+  int i;
+  MglUI32 *values;
+  for (i = 0; i < depth;i++){printf("  ");}
+  values = (MglUI32 *)link->keyValue;
+  for (i = 0;i < link->itemCount;i++)
+  {
+    printf(i?",%u":"%u",values[i]);
+  }
+  printf("\n");
+}
+
+void mgl_dict_print_scalar(MglDict *link,MglUint depth)
+{
+  int i;
+  MglLine text;
+  if (!mgl_dict_scalar_to_line(text,link))return;
+  for (i = 0; i < depth;i++){printf("  ");}
+  printf("%s\n",text);
+}
+
 void mgl_dict_print_link(MglDict *link,MglUint depth,MglBool listStart)
 {
   if (!link)return;
+  if (mgl_dict_is_scalar(link))
+  {
+    mgl_dict_print_scalar(link,depth);
+    return;
+  }
   switch(link->keyType)
   {
     case MGL_DICT_STRING:
@@ -682,6 +1997,9 @@ void mgl_dict_print_link(MglDict *link,MglUint depth,MglBool listStart)
     case MGL_DICT_HASH:
       mgl_dict_print_hash(link,depth,listStart);
       break;
+    case MGL_DICT_UI32_ARRAY:
+      mgl_dict_print_ui32_array(link,depth);
+      break;
     default:
       printf("unhandled type: %i\n",(int)link->keyType);
   }